@@ -126,6 +126,33 @@ euromc0 = qf.euroBSMC(payofftype = 1, strike = 100, timetoexp = 1.0, spot = 100,
 print(f'URNGTYPE={mcpars0["URNGTYPE"]} PATHGENTYPE={mcpars0["PATHGENTYPE"]} NPATHS={npaths0}')
 print(f'Price={euromc0['Mean']:0.4f}  StdErr={euromc0['StdErr']:0.4f}')
 
+print('=================')
+print('Quantiles and tail means of the Monte Carlo prices')
+
+# with a tiny strike the price of a path is df * (S_T - K), with S_T lognormal,
+# so that its quantiles and tail means are known exactly
+from statistics import NormalDist
+levels = [0.001, 0.01, 0.05, 0.5, 0.95, 0.99, 0.999]
+tinyk, texp, vol, divyld = 0.01, 1.0, 0.4, 0.02
+dfexp = qf.discount(yc, texp)
+fwd = 100 * np.exp((qf.spotRate(yc, texp) - divyld) * texp)
+sdev = vol * np.sqrt(texp)
+nd = NormalDist()
+exactq, exacttm = [], []
+for p in levels:
+    z = nd.inv_cdf(p)
+    exactq.append(dfexp * (fwd * np.exp(-0.5 * sdev**2 + sdev * z) - tinyk))
+    tailfwd = fwd * nd.cdf(z - sdev) / p if p <= 0.5 else fwd * nd.cdf(sdev - z) / (1 - p)
+    exacttm.append(dfexp * (tailfwd - tinyk))
+for npathsq in [100000, 1000000]:
+    quantmc = qf.euroBSMC(payofftype = 1, strike = tinyk, timetoexp = texp, spot = 100,
+                          discountcrv =  yc, divyield = divyld, volatility = vol,
+                          mcparams = mcpars0, npaths = npathsq, quantiles = levels)
+    print(f'NPATHS={npathsq}')
+    for i, p in enumerate(levels):
+        print(f'Level={p:0.3f}  Quantile={quantmc["Quantiles"][i]:0.4f} (exact {exactq[i]:0.4f})'
+              f'  TailMean={quantmc["TailMeans"][i]:0.4f} (exact {exacttm[i]:0.4f})')
+
 print('=================')
 print('Asian basket option using Black-Scholes Monte Carlo')
 
@@ -152,6 +179,23 @@ asianmc = qf.asianBasketBSMC(payofftype = 1, strike = 100, fixtimes = fixtimes,
 print(f'URNGTYPE={mcpars1["URNGTYPE"]} PATHGENTYPE={mcpars1["PATHGENTYPE"]} NPATHS={npaths1}')
 print(f'Price={asianmc['Mean']:0.4f}  StdErr={asianmc['StdErr']:0.4f}')
 
+print('=================')
+print('Autocallable note using Black-Scholes Monte Carlo, streamed and unstreamed with a control variate')
+
+# the same paths either way, so the prices must agree to rounding
+autofix = [0.5, 1.0, 1.5, 2.0]
+for stream in [False, True]:
+    mcpars2 = {'URNGTYPE': 'MT19937', 'PATHGENTYPE': 'EULER', 'CONTROLVARTYPE': 'CONTROLVARIATE',
+               'STREAMFIXINGS': stream}
+    automc = qf.autocallBSMC(fixtimes = autofix, refspots = spots, calllevel = 1.0, coupon = 0.05,
+                             protectionlevel = 0.7, spots = spots, discountcrv = yc, divyields = divylds,
+                             volatilities = vols, correlmat = correls, mcparams = mcpars2, npaths = 100000)
+    print(f'STREAMFIXINGS={stream}  Price={automc["Mean"]:0.6f}  StdErr={automc["StdErr"]:0.6f}')
+    if stream:
+        assert abs(automc['Mean'] - autounstreamed) < 1e-8, 'streamed and unstreamed prices differ!'
+    else:
+        autounstreamed = automc['Mean']
+
 #%%
 # function group 4
 print('=================')
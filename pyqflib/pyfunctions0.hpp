@@ -255,6 +255,31 @@ PY_BEGIN;
 PY_END;
 }
 
+static 
+PyObject*  pyQfPcaFactors(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+  PyObject* pyMat(NULL);
+  PyObject* pyNFactors(NULL);
+  if (!PyArg_ParseTuple(pyArgs, "OO", &pyMat, &pyNFactors))
+    return NULL;
+  qf::Matrix mat = asMatrix(pyMat);
+  int nfactors = asInt(pyNFactors);
+  QF_ASSERT(nfactors > 0, "error: the number of factors must be positive");
+  qf::Matrix loadings;
+  qf::Vector idiovars;
+  double explained = qf::pcafactors(mat, (size_t) nfactors, loadings, idiovars);
+
+  // write loadings, idiosyncratic variances and explained variance into a Python dictionary
+  PyObject* ret = PyDict_New();
+  int ok = PyDict_SetItem(ret, asPyScalar("Loadings"), asNumpy(loadings));
+  ok = PyDict_SetItem(ret, asPyScalar("IdioVars"), asNumpy(idiovars));
+  ok = PyDict_SetItem(ret, asPyScalar("ExplainedVariance"), asPyScalar(explained));
+  return ret;
+
+PY_END;
+}
+
 static 
 PyObject*  pyQfPPolyIntegral(PyObject* pyDummy, PyObject* pyArgs)
 {
@@ -14,11 +14,13 @@ PY_BEGIN;
 
   std::vector<std::string> ycnames = qf::market().yieldCurves().list();
   std::vector<std::string> volnames = qf::market().volatilities().list();
+  std::vector<std::string> lvnames = qf::market().localVolSurfaces().list();
 
   // return market contents as a Python dictionary
   PyObject* ret = PyDict_New();
   int ok = PyDict_SetItem(ret, asPyScalar("YieldCurves"), asPyList(ycnames));
   PyDict_SetItem(ret, asPyScalar("Volatilities"), asPyList(volnames));
+  PyDict_SetItem(ret, asPyScalar("LocalVolSurfaces"), asPyList(lvnames));
   return ret;
 PY_END;
 }
@@ -249,6 +251,56 @@ PY_BEGIN;
 PY_END;
 }
 
+static
+PyObject*  pyQfLocalVolCreate(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyLvName(NULL);
+  PyObject* pyTMats(NULL);
+  PyObject* pyLogMoneyness(NULL);
+  PyObject* pyImpliedVols(NULL);
+  if (!PyArg_ParseTuple(pyArgs, "OOOO", &pyLvName, &pyTMats, &pyLogMoneyness, &pyImpliedVols))
+    return NULL;
+
+  std::string name = asString(pyLvName);
+  qf::Vector tmats = asVector(pyTMats);
+  qf::Vector logmoneyness = asVector(pyLogMoneyness);
+  qf::Matrix impliedvols = asMatrix(pyImpliedVols);
+
+  std::pair<std::string, unsigned long> pr =
+    qf::market().localVolSurfaces().set(name,
+      std::make_shared<qf::LocalVolSurface>(tmats, logmoneyness, impliedvols)
+    );
+
+  std::string tag = pr.first;
+  return asPyScalar(tag);
+PY_END;
+}
+
+static
+PyObject*  pyQfLocalVol(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyLvName(NULL);
+  PyObject* pyTime(NULL);
+  PyObject* pyLogMoneyness(NULL);
+
+  if (!PyArg_ParseTuple(pyArgs, "OOO", &pyLvName, &pyTime, &pyLogMoneyness))
+    return NULL;
+
+  std::string name = asString(pyLvName);
+  double t = asDouble(pyTime);
+  double y = asDouble(pyLogMoneyness);
+
+  qf::SPtrLocalVolSurface splv = qf::market().localVolSurfaces().get(name);
+  QF_ASSERT(splv, "error: local vol surface " + name + " not found");
+
+  return asPyScalar(splv->localVol(t, y));
+PY_END;
+}
+
 static
 PyObject*  pyQfCapFloorletBS(PyObject* pyDummy, PyObject* pyArgs)
 {
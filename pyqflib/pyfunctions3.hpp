@@ -7,10 +7,21 @@
 #include <qflib/defines.hpp>
 #include <qflib/products/europeancallput.hpp>
 #include <qflib/products/asianbasketcallput.hpp>
+#include <qflib/products/americanbasketcallput.hpp>
+#include <qflib/products/barriercallput.hpp>
+#include <qflib/products/autocallable.hpp>
 #include <qflib/pricers/bsmcpricer.hpp>
 #include <qflib/pricers/multiassetbsmcpricer.hpp>
+#include <qflib/pricers/portfoliobsmcpricer.hpp>
+#include <qflib/pricers/lsmbsmcpricer.hpp>
+#include <qflib/pricers/mlmcbsmcpricer.hpp>
+#include <qflib/pricers/hestonmcpricer.hpp>
+#include <qflib/pricers/localvolmcpricer.hpp>
 #include <qflib/math/stats/meanvarcalculator.hpp>
+#include <qflib/math/stats/welfordcalculator.hpp>
+#include <qflib/math/stats/quantilecalculator.hpp>
 #include <qflib/math/random/rng.hpp>
+#include <memory>
 
 using namespace std;
 
@@ -28,9 +39,10 @@ PY_BEGIN;
   PyObject* pyVolatility(NULL);
   PyObject* pyMcParams(NULL);
   PyObject* pyNPaths(NULL);
+  PyObject* pyQuantiles(NULL);
 
-  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOO", &pyPayoffType, &pyStrike, &pyTimeToExp, 
-    &pySpot, &pyDiscountCrv, &pyDivYield, &pyVolatility, &pyMcParams, &pyNPaths))
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOO|O", &pyPayoffType, &pyStrike, &pyTimeToExp, 
+    &pySpot, &pyDiscountCrv, &pyDivYield, &pyVolatility, &pyMcParams, &pyNPaths, &pyQuantiles))
     return NULL;
 
   int payoffType = asInt(pyPayoffType);
@@ -49,15 +61,25 @@ PY_BEGIN;
   qf::McParams mcparams = asMcParams(pyMcParams);
   // read the number of paths
   unsigned long npaths = asInt(pyNPaths);
+  // read the optional quantile levels
+  qf::Vector levels;
+  if (pyQuantiles && pyQuantiles != Py_None)
+    levels = asVector(pyQuantiles);
+  // with variance reduction, the samples are pair averages or controlled values, not the PVs of the paths
+  QF_ASSERT(levels.empty() || mcparams.controlVarType == qf::McParams::ControlVarType::NONE,
+    "quantiles of the PV are not available with CONTROLVARTYPE other than NONE!");
 
   // create the product
   qf::SPtrProduct spprod(new qf::EuropeanCallPut(payoffType, strike, timeToExp));
   // create the pricer
   qf::BsMcPricer bsmcpricer(spprod, spyc, divYield, vol, spot, mcparams);
   // create the statistics calculator
-  qf::MeanVarCalculator<double *> sc(bsmcpricer.nVariables());
+  std::unique_ptr<qf::WelfordCalculator<double *>> spsc(levels.empty()
+    ? new qf::WelfordCalculator<double *>(bsmcpricer.nVariables())
+    : new qf::QuantileCalculator<double *>(bsmcpricer.nVariables(), levels));
+  qf::WelfordCalculator<double *>& sc = *spsc;
   // run the simulation
-  bsmcpricer.simulate(sc, npaths);
+  qf::McRunInfo runinfo = bsmcpricer.simulate(sc, npaths);
   // collect results
   qf::Matrix const& results = sc.results();
   // read out results
@@ -70,6 +92,24 @@ PY_BEGIN;
   PyObject* ret = PyDict_New();
   int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mean));
   PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(stderror));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  if (!levels.empty()) {
+    size_t nlevels = levels.size();
+    qf::Vector quantiles(nlevels), tailmeans(nlevels);
+    for (size_t i = 0; i < nlevels; ++i) {
+      quantiles[i] = results(2 + i, 0);
+      tailmeans[i] = results(2 + nlevels + i, 0);
+    }
+    PyDict_SetItem(ret, asPyScalar("Quantiles"), asNumpy(quantiles));
+    PyDict_SetItem(ret, asPyScalar("TailMeans"), asNumpy(tailmeans));
+  }
+  if (mcparams.greeks) {
+    PyDict_SetItem(ret, asPyScalar("Delta"), asPyScalar(results(0, 1)));
+    PyDict_SetItem(ret, asPyScalar("DeltaStdErr"), asPyScalar(std::sqrt(results(1, 1) / nsamples)));
+    PyDict_SetItem(ret, asPyScalar("Vega"), asPyScalar(results(0, 2)));
+    PyDict_SetItem(ret, asPyScalar("VegaStdErr"), asPyScalar(std::sqrt(results(1, 2) / nsamples)));
+  }
   return ret;
 
 PY_END;
@@ -92,10 +132,11 @@ PY_BEGIN;
   PyObject* pyCorrelMatrix(NULL);
   PyObject* pyMcParams(NULL);
   PyObject* pyNPaths(NULL);
+  PyObject* pyQuantiles(NULL);
 
-  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOOOO", &pyPayoffType, &pyStrike, &pyFixingTimes, 
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOOOO|O", &pyPayoffType, &pyStrike, &pyFixingTimes, 
     &pyAssetQuantities, &pySpots, &pyDiscountCrv, &pyDivYields, &pyVolatilities, 
-    &pyCorrelMatrix, &pyMcParams, &pyNPaths))
+    &pyCorrelMatrix, &pyMcParams, &pyNPaths, &pyQuantiles))
     return NULL;
 
   int payoffType = asInt(pyPayoffType);
@@ -115,15 +156,207 @@ PY_BEGIN;
   qf::McParams mcparams = asMcParams(pyMcParams);
   // read the number of paths
   unsigned long npaths = asInt(pyNPaths);
+  // read the optional quantile levels
+  qf::Vector levels;
+  if (pyQuantiles && pyQuantiles != Py_None)
+    levels = asVector(pyQuantiles);
+  // with variance reduction, the samples are pair averages or controlled values, not the PVs of the paths
+  QF_ASSERT(levels.empty() || mcparams.controlVarType == qf::McParams::ControlVarType::NONE,
+    "quantiles of the PV are not available with CONTROLVARTYPE other than NONE!");
 
   // create the product
   qf::SPtrProduct spprod(new qf::AsianBasketCallPut(payoffType, strike, fixingTimes, assetQuantities));
   // create the pricer
   qf::MultiAssetBsMcPricer bsmcpricer(spprod, spyc, divYields, vols, spots, correlMat, mcparams);
   // create the statistics calculator
-  qf::MeanVarCalculator<double *> sc(bsmcpricer.nVariables());
+  std::unique_ptr<qf::WelfordCalculator<double *>> spsc(levels.empty()
+    ? new qf::WelfordCalculator<double *>(bsmcpricer.nVariables())
+    : new qf::QuantileCalculator<double *>(bsmcpricer.nVariables(), levels));
+  qf::WelfordCalculator<double *>& sc = *spsc;
+  // run the simulation
+  qf::McRunInfo runinfo = bsmcpricer.simulate(sc, npaths);
+  // collect results
+  qf::Matrix const & results = sc.results();
+  // read out results
+  double mean = results(0, 0);
+  double stderror = results(1, 0);
+  stderror = std::sqrt(stderror / sc.nSamples());
+
+  // write mean and standard error into a Python dictionary
+  PyObject* ret = PyDict_New();
+  int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mean));
+  PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(stderror));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  if (!levels.empty()) {
+    size_t nlevels = levels.size();
+    qf::Vector quantiles(nlevels), tailmeans(nlevels);
+    for (size_t i = 0; i < nlevels; ++i) {
+      quantiles[i] = results(2 + i, 0);
+      tailmeans[i] = results(2 + nlevels + i, 0);
+    }
+    PyDict_SetItem(ret, asPyScalar("Quantiles"), asNumpy(quantiles));
+    PyDict_SetItem(ret, asPyScalar("TailMeans"), asNumpy(tailmeans));
+  }
+  if (mcparams.nCorrFactors > 0)
+    PyDict_SetItem(ret, asPyScalar("ExplainedVariance"), asPyScalar(bsmcpricer.explainedVariance()));
+  if (mcparams.greeks) {
+    size_t nassets = spprod->nAssets();
+    qf::Vector deltas(nassets), deltaerrs(nassets), vegas(nassets), vegaerrs(nassets);
+    for (size_t j = 0; j < nassets; ++j) {
+      deltas[j] = results(0, 1 + j);
+      deltaerrs[j] = std::sqrt(results(1, 1 + j) / sc.nSamples());
+      vegas[j] = results(0, 1 + nassets + j);
+      vegaerrs[j] = std::sqrt(results(1, 1 + nassets + j) / sc.nSamples());
+    }
+    PyDict_SetItem(ret, asPyScalar("Delta"), asNumpy(deltas));
+    PyDict_SetItem(ret, asPyScalar("DeltaStdErr"), asNumpy(deltaerrs));
+    PyDict_SetItem(ret, asPyScalar("Vega"), asNumpy(vegas));
+    PyDict_SetItem(ret, asPyScalar("VegaStdErr"), asNumpy(vegaerrs));
+    if (mcparams.aad) {
+      size_t nrates = spyc->fwdRateTimes().size();
+      qf::Vector divsens(nassets), ratesens(nrates);
+      for (size_t j = 0; j < nassets; ++j)
+        divsens[j] = results(0, 1 + 2 * nassets + j);
+      for (size_t k = 0; k < nrates; ++k)
+        ratesens[k] = results(0, 1 + 3 * nassets + k);
+      PyDict_SetItem(ret, asPyScalar("DivSens"), asNumpy(divsens));
+      PyDict_SetItem(ret, asPyScalar("RateSens"), asNumpy(ratesens));
+      PyDict_SetItem(ret, asPyScalar("CorrelSens"), asNumpy(bsmcpricer.correlationSensitivities()));
+    }
+  }
+  return ret;
+
+PY_END;
+}
+
+
+static
+PyObject*  pyQfEuroLadderBSMC(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyPayoffType(NULL);
+  PyObject* pySpot(NULL);
+  PyObject* pyStrikes(NULL);
+  PyObject* pyTimesToExp(NULL);
+  PyObject* pyDiscountCrv(NULL);
+  PyObject* pyDivYield(NULL);
+  PyObject* pyVolatility(NULL);
+  PyObject* pyMcParams(NULL);
+  PyObject* pyNPaths(NULL);
+
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOO", &pyPayoffType, &pyStrikes, &pyTimesToExp, 
+    &pySpot, &pyDiscountCrv, &pyDivYield, &pyVolatility, &pyMcParams, &pyNPaths))
+    return NULL;
+
+  int payoffType = asInt(pyPayoffType);
+  double spot = asDouble(pySpot);
+  qf::Vector strikes = asVector(pyStrikes);
+  qf::Vector timesToExp = asVector(pyTimesToExp);
+  QF_ASSERT(strikes.size() == timesToExp.size(), "need as many times to expiration as strikes!");
+
+  std::string name = asString(pyDiscountCrv);
+  qf::SPtrYieldCurve spyc = qf::market().yieldCurves().get(name);
+  QF_ASSERT(spyc, "error: yield curve " + name + " not found");
+
+  double divYield = asDouble(pyDivYield);
+  double vol = asDouble(pyVolatility);
+ 
+  // read the MC parameters
+  qf::McParams mcparams = asMcParams(pyMcParams);
+  // read the number of paths
+  unsigned long npaths = asInt(pyNPaths);
+
+  // create the products
+  std::vector<qf::SPtrProduct> prods;
+  for (size_t i = 0; i < strikes.size(); ++i)
+    prods.push_back(qf::SPtrProduct(new qf::EuropeanCallPut(payoffType, strikes[i], timesToExp[i])));
+  // create the pricer
+  qf::PortfolioBsMcPricer bsmcpricer(prods, spyc, qf::Vector{ divYield }, qf::Vector{ vol }, qf::Vector{ spot },
+    qf::Matrix(), mcparams);
+  // create the statistics calculator
+  qf::WelfordCalculator<double *> sc(bsmcpricer.nVariables());
+  // run the simulation
+  qf::McRunInfo runinfo = bsmcpricer.simulate(sc, npaths);
+  // collect results
+  qf::Matrix const& results = sc.results();
+  // read out results
+  size_t nsamples = sc.nSamples();
+  qf::Vector means(prods.size()), stderrors(prods.size());
+  for (size_t i = 0; i < prods.size(); ++i) {
+    means[i] = results(0, i);
+    stderrors[i] = std::sqrt(results(1, i) / nsamples);
+  }
+
+  // write means and standard errors into a Python dictionary
+  PyObject* ret = PyDict_New();
+  int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asNumpy(means));
+  PyDict_SetItem(ret, asPyScalar("StdErr"), asNumpy(stderrors));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  return ret;
+
+PY_END;
+}
+
+
+static
+PyObject*  pyQfAmerBasketBSMC(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyPayoffType(NULL);
+  PyObject* pyStrike(NULL);
+  PyObject* pyExerciseTimes(NULL);
+  PyObject* pyAssetQuantities(NULL);
+  PyObject* pySpots(NULL);
+  PyObject* pyDiscountCrv(NULL);
+  PyObject* pyDivYields(NULL);
+  PyObject* pyVolatilities(NULL);
+  PyObject* pyCorrelMatrix(NULL);
+  PyObject* pyMcParams(NULL);
+  PyObject* pyNPaths(NULL);
+
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOOOO", &pyPayoffType, &pyStrike, &pyExerciseTimes, 
+    &pyAssetQuantities, &pySpots, &pyDiscountCrv, &pyDivYields, &pyVolatilities, 
+    &pyCorrelMatrix, &pyMcParams, &pyNPaths))
+    return NULL;
+
+  int payoffType = asInt(pyPayoffType);
+  double strike = asDouble(pyStrike);
+  qf::Vector exerciseTimes = asVector(pyExerciseTimes);
+  qf::Vector assetQuantities = asVector(pyAssetQuantities);
+  qf::Vector spots = asVector(pySpots);
+
+  std::string name = asString(pyDiscountCrv);
+  qf::SPtrYieldCurve spyc = qf::market().yieldCurves().get(name);
+  QF_ASSERT(spyc, "error: yield curve " + name + " not found");
+
+  qf::Vector divYields = asVector(pyDivYields);
+  qf::Vector vols = asVector(pyVolatilities);
+  qf::Matrix correlMat = asMatrix(pyCorrelMatrix);
+  // read the MC parameters, and the regression parameters
+  qf::McParams mcparams = asMcParams(pyMcParams);
+  qf::RegressionBasis basis = asRegressionBasis(pyMcParams);
+  unsigned long nregpaths = 16384;
+  std::string paramname = "LSMPATHS";
+  if (PyDict_Contains(pyMcParams, asPyScalar(paramname)) == 1) {
+    int n = asInt(PyDict_GetItemString(pyMcParams, paramname.c_str()));
+    QF_ASSERT(n > 0, "McParam LSMPATHS must be positive!");
+    nregpaths = (unsigned long) n;
+  }
+  // read the number of paths
+  unsigned long npaths = asInt(pyNPaths);
+
+  // create the product
+  qf::SPtrProduct spprod(new qf::AmericanBasketCallPut(payoffType, strike, exerciseTimes, assetQuantities));
+  // create the pricer
+  qf::LsmBsMcPricer bsmcpricer(spprod, spyc, divYields, vols, spots, correlMat, mcparams, basis, nregpaths);
+  // create the statistics calculator
+  qf::WelfordCalculator<double *> sc(bsmcpricer.nVariables());
   // run the simulation
-  bsmcpricer.simulate(sc, npaths);
+  qf::McRunInfo runinfo = bsmcpricer.simulate(sc, npaths);
   // collect results
   qf::Matrix const & results = sc.results();
   // read out results
@@ -135,6 +368,383 @@ PY_BEGIN;
   PyObject* ret = PyDict_New();
   int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mean));
   PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(stderror));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  PyDict_SetItem(ret, asPyScalar("RegressionMean"), asPyScalar(bsmcpricer.regressionPV()));
+  return ret;
+
+PY_END;
+}
+
+
+static
+PyObject*  pyQfAsianBasketBSMLMC(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyPayoffType(NULL);
+  PyObject* pyStrike(NULL);
+  PyObject* pyFixingTimes(NULL);
+  PyObject* pyAssetQuantities(NULL);
+  PyObject* pySpots(NULL);
+  PyObject* pyDiscountCrv(NULL);
+  PyObject* pyDivYields(NULL);
+  PyObject* pyVolatilities(NULL);
+  PyObject* pyCorrelMatrix(NULL);
+  PyObject* pyMcParams(NULL);
+  PyObject* pyRmse(NULL);
+
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOOOO", &pyPayoffType, &pyStrike, &pyFixingTimes, 
+    &pyAssetQuantities, &pySpots, &pyDiscountCrv, &pyDivYields, &pyVolatilities, 
+    &pyCorrelMatrix, &pyMcParams, &pyRmse))
+    return NULL;
+
+  int payoffType = asInt(pyPayoffType);
+  double strike = asDouble(pyStrike);
+  qf::Vector fixingTimes = asVector(pyFixingTimes);
+  qf::Vector assetQuantities = asVector(pyAssetQuantities);
+  qf::Vector spots = asVector(pySpots);
+
+  std::string name = asString(pyDiscountCrv);
+  qf::SPtrYieldCurve spyc = qf::market().yieldCurves().get(name);
+  QF_ASSERT(spyc, "error: yield curve " + name + " not found");
+
+  qf::Vector divYields = asVector(pyDivYields);
+  qf::Vector vols = asVector(pyVolatilities);
+  qf::Matrix correlMat = asMatrix(pyCorrelMatrix);
+  // read the MC parameters, and the multilevel parameters
+  qf::McParams mcparams = asMcParams(pyMcParams);
+  size_t ncoarsesteps = 1;
+  std::string paramname = "MLMCCOARSESTEPS";
+  if (PyDict_Contains(pyMcParams, asPyScalar(paramname)) == 1) {
+    int n = asInt(PyDict_GetItemString(pyMcParams, paramname.c_str()));
+    QF_ASSERT(n > 0, "McParam MLMCCOARSESTEPS must be positive!");
+    ncoarsesteps = (size_t) n;
+  }
+  unsigned long npilotpaths = 1024;
+  paramname = "MLMCPILOTPATHS";
+  if (PyDict_Contains(pyMcParams, asPyScalar(paramname)) == 1) {
+    int n = asInt(PyDict_GetItemString(pyMcParams, paramname.c_str()));
+    QF_ASSERT(n > 1, "McParam MLMCPILOTPATHS must be at least 2!");
+    npilotpaths = (unsigned long) n;
+  }
+  // read the target root mean square error
+  double rmse = asDouble(pyRmse);
+
+  // create the product
+  qf::SPtrProduct spprod(new qf::AsianBasketCallPut(payoffType, strike, fixingTimes, assetQuantities));
+  // create the pricer
+  qf::MlmcBsMcPricer mlmcpricer(spprod, spyc, divYields, vols, spots, correlMat, mcparams, 
+                                ncoarsesteps, npilotpaths);
+  // run the simulation
+  qf::McRunInfo runinfo = mlmcpricer.simulate(rmse);
+
+  // write the results into a Python dictionary
+  PyObject* ret = PyDict_New();
+  int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mlmcpricer.mean()));
+  PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(runinfo.stdErr));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  PyDict_SetItem(ret, asPyScalar("Converged"), asPyScalar(runinfo.converged));
+  std::vector<unsigned long> levelpaths = mlmcpricer.levelPaths();
+  qf::Vector npathsvec(levelpaths.size());
+  for (size_t l = 0; l < levelpaths.size(); ++l)
+    npathsvec[l] = (double) levelpaths[l];
+  PyDict_SetItem(ret, asPyScalar("LevelMeans"), asNumpy(mlmcpricer.levelMeans()));
+  PyDict_SetItem(ret, asPyScalar("LevelVariances"), asNumpy(mlmcpricer.levelVariances()));
+  PyDict_SetItem(ret, asPyScalar("LevelPaths"), asNumpy(npathsvec));
+  return ret;
+
+PY_END;
+}
+
+static
+PyObject*  pyQfEuroHestonMC(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyPayoffType(NULL);
+  PyObject* pyStrike(NULL);
+  PyObject* pyTimeToExp(NULL);
+  PyObject* pySpot(NULL);
+  PyObject* pyDiscountCrv(NULL);
+  PyObject* pyDivYield(NULL);
+  PyObject* pyV0(NULL);
+  PyObject* pyKappa(NULL);
+  PyObject* pyTheta(NULL);
+  PyObject* pyXi(NULL);
+  PyObject* pyRho(NULL);
+  PyObject* pyMcParams(NULL);
+  PyObject* pyNPaths(NULL);
+  PyObject* pyNSteps(NULL);
+
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOOOOOO|O", &pyPayoffType, &pyStrike, &pyTimeToExp,
+    &pySpot, &pyDiscountCrv, &pyDivYield, &pyV0, &pyKappa, &pyTheta, &pyXi, &pyRho,
+    &pyMcParams, &pyNPaths, &pyNSteps))
+    return NULL;
+
+  int payoffType = asInt(pyPayoffType);
+  double strike = asDouble(pyStrike);
+  double timeToExp = asDouble(pyTimeToExp);
+  double spot = asDouble(pySpot);
+
+  std::string name = asString(pyDiscountCrv);
+  qf::SPtrYieldCurve spyc = qf::market().yieldCurves().get(name);
+  QF_ASSERT(spyc, "error: yield curve " + name + " not found");
+
+  double divYield = asDouble(pyDivYield);
+  qf::HestonParams params;
+  params.v0 = asDouble(pyV0);
+  params.kappa = asDouble(pyKappa);
+  params.theta = asDouble(pyTheta);
+  params.xi = asDouble(pyXi);
+  params.rho = asDouble(pyRho);
+
+  // read the MC parameters
+  qf::McParams mcparams = asMcParams(pyMcParams);
+  // read the number of paths, and the optional minimum number of time steps
+  unsigned long npaths = asInt(pyNPaths);
+  size_t nsteps = 0;
+  if (pyNSteps && pyNSteps != Py_None) {
+    int n = asInt(pyNSteps);
+    QF_ASSERT(n >= 0, "the number of time steps must be non-negative!");
+    nsteps = (size_t) n;
+  }
+
+  // create the product
+  qf::SPtrProduct spprod(new qf::EuropeanCallPut(payoffType, strike, timeToExp));
+  // create the pricer
+  qf::HestonMcPricer hestonpricer(spprod, spyc, divYield, params, spot, mcparams, nsteps);
+  // create the statistics calculator
+  qf::WelfordCalculator<double *> sc(hestonpricer.nVariables());
+  // run the simulation
+  qf::McRunInfo runinfo = hestonpricer.simulate(sc, npaths);
+  // collect results
+  qf::Matrix const& results = sc.results();
+  size_t nsamples = sc.nSamples();
+  double mean = results(0, 0);
+  double stderror = std::sqrt(results(1, 0) / nsamples);
+
+  // write the results into a Python dictionary
+  PyObject* ret = PyDict_New();
+  int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mean));
+  PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(stderror));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  PyDict_SetItem(ret, asPyScalar("NSteps"), asPyScalar((long) hestonpricer.nSimSteps()));
+  return ret;
+
+PY_END;
+}
+
+static
+PyObject*  pyQfEuroLocalVolMC(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyPayoffType(NULL);
+  PyObject* pyStrike(NULL);
+  PyObject* pyTimeToExp(NULL);
+  PyObject* pySpot(NULL);
+  PyObject* pyDiscountCrv(NULL);
+  PyObject* pyDivYield(NULL);
+  PyObject* pyLvName(NULL);
+  PyObject* pyMcParams(NULL);
+  PyObject* pyNPaths(NULL);
+  PyObject* pyNSteps(NULL);
+
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOO|O", &pyPayoffType, &pyStrike, &pyTimeToExp,
+    &pySpot, &pyDiscountCrv, &pyDivYield, &pyLvName, &pyMcParams, &pyNPaths, &pyNSteps))
+    return NULL;
+
+  int payoffType = asInt(pyPayoffType);
+  double strike = asDouble(pyStrike);
+  double timeToExp = asDouble(pyTimeToExp);
+  double spot = asDouble(pySpot);
+
+  std::string name = asString(pyDiscountCrv);
+  qf::SPtrYieldCurve spyc = qf::market().yieldCurves().get(name);
+  QF_ASSERT(spyc, "error: yield curve " + name + " not found");
+
+  double divYield = asDouble(pyDivYield);
+
+  name = asString(pyLvName);
+  qf::SPtrLocalVolSurface splv = qf::market().localVolSurfaces().get(name);
+  QF_ASSERT(splv, "error: local vol surface " + name + " not found");
+
+  // read the MC parameters
+  qf::McParams mcparams = asMcParams(pyMcParams);
+  // read the number of paths, and the optional minimum number of time steps
+  unsigned long npaths = asInt(pyNPaths);
+  size_t nsteps = 0;
+  if (pyNSteps && pyNSteps != Py_None) {
+    int n = asInt(pyNSteps);
+    QF_ASSERT(n >= 0, "the number of time steps must be non-negative!");
+    nsteps = (size_t) n;
+  }
+
+  // create the product
+  qf::SPtrProduct spprod(new qf::EuropeanCallPut(payoffType, strike, timeToExp));
+  // create the pricer
+  qf::LocalVolMcPricer lvpricer(spprod, spyc, divYield, splv, spot, mcparams, nsteps);
+  // create the statistics calculator
+  qf::WelfordCalculator<double *> sc(lvpricer.nVariables());
+  // run the simulation
+  qf::McRunInfo runinfo = lvpricer.simulate(sc, npaths);
+  // collect results
+  qf::Matrix const& results = sc.results();
+  size_t nsamples = sc.nSamples();
+  double mean = results(0, 0);
+  double stderror = std::sqrt(results(1, 0) / nsamples);
+
+  // write the results into a Python dictionary
+  PyObject* ret = PyDict_New();
+  int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mean));
+  PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(stderror));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  PyDict_SetItem(ret, asPyScalar("NSteps"), asPyScalar((long) lvpricer.nSimSteps()));
+  return ret;
+
+PY_END;
+}
+
+static
+PyObject*  pyQfBarrierBSMC(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyPayoffType(NULL);
+  PyObject* pyStrike(NULL);
+  PyObject* pyBarrier(NULL);
+  PyObject* pyBarrierType(NULL);
+  PyObject* pyFixingTimes(NULL);
+  PyObject* pySpot(NULL);
+  PyObject* pyDiscountCrv(NULL);
+  PyObject* pyDivYield(NULL);
+  PyObject* pyVolatility(NULL);
+  PyObject* pyMcParams(NULL);
+  PyObject* pyNPaths(NULL);
+  PyObject* pyRebate(NULL);
+
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOOOO|O", &pyPayoffType, &pyStrike, &pyBarrier, &pyBarrierType,
+    &pyFixingTimes, &pySpot, &pyDiscountCrv, &pyDivYield, &pyVolatility, &pyMcParams, &pyNPaths, &pyRebate))
+    return NULL;
+
+  int payoffType = asInt(pyPayoffType);
+  double strike = asDouble(pyStrike);
+  double barrier = asDouble(pyBarrier);
+  int barrierType = asInt(pyBarrierType);
+  qf::Vector fixingTimes = asVector(pyFixingTimes);
+  double spot = asDouble(pySpot);
+
+  std::string name = asString(pyDiscountCrv);
+  qf::SPtrYieldCurve spyc = qf::market().yieldCurves().get(name);
+  QF_ASSERT(spyc, "error: yield curve " + name + " not found");
+
+  double divYield = asDouble(pyDivYield);
+  double vol = asDouble(pyVolatility);
+  // read the MC parameters
+  qf::McParams mcparams = asMcParams(pyMcParams);
+  // read the number of paths
+  unsigned long npaths = asInt(pyNPaths);
+  // read the optional rebate
+  double rebate = 0.0;
+  if (pyRebate && pyRebate != Py_None)
+    rebate = asDouble(pyRebate);
+
+  // create the product
+  qf::SPtrProduct spprod(new qf::BarrierCallPut(payoffType, strike, barrier, barrierType, fixingTimes, rebate));
+  // create the pricer
+  qf::BsMcPricer bsmcpricer(spprod, spyc, divYield, vol, spot, mcparams);
+  // create the statistics calculator
+  qf::WelfordCalculator<double *> sc(bsmcpricer.nVariables());
+  // run the simulation
+  qf::McRunInfo runinfo = bsmcpricer.simulate(sc, npaths);
+  // collect results
+  qf::Matrix const& results = sc.results();
+  size_t nsamples = sc.nSamples();
+  double mean = results(0, 0);
+  double stderror = std::sqrt(results(1, 0) / nsamples);
+
+  // write the results into a Python dictionary
+  PyObject* ret = PyDict_New();
+  int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mean));
+  PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(stderror));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  if (mcparams.greeks) {
+    PyDict_SetItem(ret, asPyScalar("Delta"), asPyScalar(results(0, 1)));
+    PyDict_SetItem(ret, asPyScalar("DeltaStdErr"), asPyScalar(std::sqrt(results(1, 1) / nsamples)));
+    PyDict_SetItem(ret, asPyScalar("Vega"), asPyScalar(results(0, 2)));
+    PyDict_SetItem(ret, asPyScalar("VegaStdErr"), asPyScalar(std::sqrt(results(1, 2) / nsamples)));
+  }
+  return ret;
+
+PY_END;
+}
+
+static
+PyObject*  pyQfAutocallBSMC(PyObject* pyDummy, PyObject* pyArgs)
+{
+PY_BEGIN;
+
+  PyObject* pyFixingTimes(NULL);
+  PyObject* pyRefSpots(NULL);
+  PyObject* pyCallLevel(NULL);
+  PyObject* pyCoupon(NULL);
+  PyObject* pyProtectionLevel(NULL);
+  PyObject* pySpots(NULL);
+  PyObject* pyDiscountCrv(NULL);
+  PyObject* pyDivYields(NULL);
+  PyObject* pyVolatilities(NULL);
+  PyObject* pyCorrelMatrix(NULL);
+  PyObject* pyMcParams(NULL);
+  PyObject* pyNPaths(NULL);
+
+  if (!PyArg_ParseTuple(pyArgs, "OOOOOOOOOOOO", &pyFixingTimes, &pyRefSpots, &pyCallLevel, &pyCoupon,
+    &pyProtectionLevel, &pySpots, &pyDiscountCrv, &pyDivYields, &pyVolatilities, &pyCorrelMatrix,
+    &pyMcParams, &pyNPaths))
+    return NULL;
+
+  qf::Vector fixingTimes = asVector(pyFixingTimes);
+  qf::Vector refSpots = asVector(pyRefSpots);
+  double callLevel = asDouble(pyCallLevel);
+  double coupon = asDouble(pyCoupon);
+  double protectionLevel = asDouble(pyProtectionLevel);
+  qf::Vector spots = asVector(pySpots);
+
+  std::string name = asString(pyDiscountCrv);
+  qf::SPtrYieldCurve spyc = qf::market().yieldCurves().get(name);
+  QF_ASSERT(spyc, "error: yield curve " + name + " not found");
+
+  qf::Vector divYields = asVector(pyDivYields);
+  qf::Vector vols = asVector(pyVolatilities);
+  qf::Matrix correlMat = asMatrix(pyCorrelMatrix);
+  // read the MC parameters
+  qf::McParams mcparams = asMcParams(pyMcParams);
+  // read the number of paths
+  unsigned long npaths = asInt(pyNPaths);
+
+  // create the product
+  qf::SPtrProduct spprod(new qf::Autocallable(fixingTimes, refSpots, callLevel, coupon, protectionLevel));
+  // create the pricer
+  qf::MultiAssetBsMcPricer bsmcpricer(spprod, spyc, divYields, vols, spots, correlMat, mcparams);
+  // create the statistics calculator
+  qf::WelfordCalculator<double *> sc(bsmcpricer.nVariables());
+  // run the simulation
+  qf::McRunInfo runinfo = bsmcpricer.simulate(sc, npaths);
+  // collect results
+  qf::Matrix const& results = sc.results();
+  double mean = results(0, 0);
+  double stderror = std::sqrt(results(1, 0) / sc.nSamples());
+
+  // write the results into a Python dictionary
+  PyObject* ret = PyDict_New();
+  int ok = PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mean));
+  PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(stderror));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
   return ret;
 
 PY_END;
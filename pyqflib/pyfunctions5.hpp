@@ -13,6 +13,7 @@
 #include <qflib/methods/pde/pde1dsolver.hpp>
 #include <qflib/methods/pde/pderesults.hpp>
 #include <qflib/math/random/rng.hpp>
+#include <qflib/math/stats/welfordcalculator.hpp>
 #include <qflib/methods/montecarlo/mcparams.hpp>
 
 using namespace std;
@@ -112,10 +113,10 @@ PY_BEGIN;
   qf::BsMcQuantoPricer pricer(spprod, discyc, growyc, divYield, assetVol, fxVol, correl, spot, mcparams);
 
   // Create the statistics calculator
-  qf::MeanVarCalculator<double*> stats(pricer.nVariables());
+  qf::WelfordCalculator<double*> stats(pricer.nVariables());
 
   // Run the simulation
-  pricer.simulate(stats, npaths);
+  qf::McRunInfo runinfo = pricer.simulate(stats, npaths);
 
   // Collect results
   qf::Matrix const& results = stats.results();
@@ -126,8 +127,18 @@ PY_BEGIN;
 
   // Return result as dictionary
   PyObject* ret = PyDict_New();
-  PyDict_SetItem(ret, asPyScalar("Price"), asPyScalar(mean));
+  PyDict_SetItem(ret, asPyScalar("Mean"), asPyScalar(mean));
   PyDict_SetItem(ret, asPyScalar("StdErr"), asPyScalar(stderror));
+  PyDict_SetItem(ret, asPyScalar("NPaths"), asPyScalar((long) runinfo.nPaths));
+  PyDict_SetItem(ret, asPyScalar("Seconds"), asPyScalar(runinfo.seconds));
+  if (mcparams.greeks) {
+    char const* names[] = { "Delta", "Vega", "FxVega", "CorrelSens" };
+    for (size_t k = 0; k < 4; ++k) {
+      PyDict_SetItem(ret, asPyScalar(std::string(names[k])), asPyScalar(results(0, 1 + k)));
+      PyDict_SetItem(ret, asPyScalar(std::string(names[k]) + "StdErr"),
+                     asPyScalar(std::sqrt(results(1, 1 + k) / nsamples)));
+    }
+  }
   return ret;
 
 PY_END;
@@ -40,6 +40,7 @@ static PyMethodDef PyQflibMethods[] =
   { "cholDcmp", pyQfCholDcmp, METH_VARARGS, "Cholesky decomposition of symmetric, positive definite matrix" },
   { "eigenSym", pyQfEigenSym, METH_VARARGS, "eigenvalues/eigenvectors of a real symmetric matrix" },
   { "specTrunc", pyQfSpecTrunc, METH_VARARGS, "spectral truncation of a read symmetric matrix" },
+  { "pcaFactors", pyQfPcaFactors, METH_VARARGS, "principal components factor model of a correlation matrix" },
   { "ppolyEval", pyQfPPolyEval, METH_VARARGS, "evaluation of derivatives of a piecewise polynomial curve" },
   { "ppolyIntegral", pyQfPPolyIntegral, METH_VARARGS, "evaluation of integral of a piecewise polynomial curve" },
   { "ppolySum", pyQfPPolySum, METH_VARARGS, "breakpoints and values of the sum of two ppoly curves" },
@@ -64,11 +65,20 @@ static PyMethodDef PyQflibMethods[] =
   { "volCreate", pyQfVolCreate, METH_VARARGS, "creates a volatility curve." },
   { "spotVol", pyQfSpotVol, METH_VARARGS, "spot volatility to maturity." },
   { "fwdVol", pyQfFwdVol, METH_VARARGS, "fwd volatility between the two maturities." },
+  { "localVolCreate", pyQfLocalVolCreate, METH_VARARGS, "creates a local volatility surface from implied volatilities." },
+  { "localVol", pyQfLocalVol, METH_VARARGS, "local volatility at a time and log-moneyness." },
   { "capFloorletBS", pyQfCapFloorletBS, METH_VARARGS, "present value of a caplet/floorlet on fwd rate." },
   { "cdsPV", pyQfCDSPV, METH_VARARGS, "present value of a CDS." },
 // functions 3
   { "euroBSMC", pyQfEuroBSMC, METH_VARARGS, "price of a European option in the Black-Scholes model using Monte Carlo." },
   { "asianBasketBSMC", pyQfAsianBasketBSMC, METH_VARARGS, "price of a Asian basket option in the Black-Scholes model using Monte Carlo." },
+  { "euroLadderBSMC", pyQfEuroLadderBSMC, METH_VARARGS, "prices of a ladder of European options in the Black-Scholes model using Monte Carlo on shared paths." },
+  { "amerBasketBSMC", pyQfAmerBasketBSMC, METH_VARARGS, "price of an American basket option in the Black-Scholes model using Longstaff-Schwartz Monte Carlo." },
+  { "asianBasketBSMLMC", pyQfAsianBasketBSMLMC, METH_VARARGS, "price of a Asian basket option in the Black-Scholes model using multilevel Monte Carlo." },
+  { "euroHestonMC", pyQfEuroHestonMC, METH_VARARGS, "price of a European option in the Heston model using Monte Carlo with the QE scheme." },
+  { "euroLocalVolMC", pyQfEuroLocalVolMC, METH_VARARGS, "price of a European option in the local volatility model using Monte Carlo." },
+  { "barrierBSMC", pyQfBarrierBSMC, METH_VARARGS, "price of a discretely monitored knock-out option in the Black-Scholes model using Monte Carlo." },
+  { "autocallBSMC", pyQfAutocallBSMC, METH_VARARGS, "price of a worst-of autocallable note in the Black-Scholes model using Monte Carlo." },
 // functions 4
   { "euroBSPDE", pyQfEuroBSPDE, METH_VARARGS, "price of a European option in the Black-Scholes model using PDE." },
   { "digiBSPDE", pyQfDigiBSPDE, METH_VARARGS, "Price of a European digital option in the Black-Scholes model using PDE." },
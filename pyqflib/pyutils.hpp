@@ -8,6 +8,7 @@
 
 #include <qflib/math/matrix.hpp>
 #include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/methods/montecarlo/regressionbasis.hpp>
 #include <qflib/methods/pde/pdeparams.hpp>
 #include <pyqflib/pycpp.hpp>   // NOTE: include the python headers last (before armadillo)
 
@@ -80,6 +81,8 @@ static qf::McParams asMcParams(PyObject* dict)
   std::transform(paramvalue.begin(), paramvalue.end(), paramvalue.begin(), ::toupper);
   if (paramvalue == "EULER")
     mcparams.pathGenType = qf::McParams::PathGenType::EULER;
+  else if (paramvalue == "SOBOL")
+    mcparams.pathGenType = qf::McParams::PathGenType::SOBOL;
   else
     QF_ASSERT(0, "asMcParams: invalid value for McParam " + paramname + "!");
 
@@ -97,12 +100,165 @@ static qf::McParams asMcParams(PyObject* dict)
     mcparams.urngType = qf::McParams::UrngType::RANLUX3;
   else if (paramvalue == "RANLUX4")
     mcparams.urngType = qf::McParams::UrngType::RANLUX4;
+  else if (paramvalue == "PHILOX4X32")
+    mcparams.urngType = qf::McParams::UrngType::PHILOX4X32;
+  else if (paramvalue == "THREEFRY4X32")
+    mcparams.urngType = qf::McParams::UrngType::THREEFRY4X32;
   else
     QF_ASSERT(0, "asMcParams: invalid value for McParam " + paramname + "!");
 
+  // optional parameters
+  paramname = "NTHREADS";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1) {
+    int nthreads = asInt(PyDict_GetItemString(dict, paramname.c_str()));
+    QF_ASSERT(nthreads > 0, "asMcParams: McParam NTHREADS must be positive!");
+    mcparams.nThreads = (size_t) nthreads;
+  }
+
+  paramname = "SEED";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    mcparams.seed = (unsigned long) asLong(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "NORMALGENTYPE";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1) {
+    paramvalue = asString(PyDict_GetItemString(dict, paramname.c_str()));
+    paramvalue = trim(paramvalue);
+    std::transform(paramvalue.begin(), paramvalue.end(), paramvalue.begin(), ::toupper);
+    if (paramvalue == "STDLIB")
+      mcparams.normalGenType = qf::McParams::NormalGenType::STDLIB;
+    else if (paramvalue == "INVCDF")
+      mcparams.normalGenType = qf::McParams::NormalGenType::INVCDF;
+    else
+      QF_ASSERT(0, "asMcParams: invalid value for McParam " + paramname + "!");
+  }
+
+  paramname = "CONTROLVARTYPE";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1) {
+    paramvalue = asString(PyDict_GetItemString(dict, paramname.c_str()));
+    paramvalue = trim(paramvalue);
+    std::transform(paramvalue.begin(), paramvalue.end(), paramvalue.begin(), ::toupper);
+    if (paramvalue == "NONE")
+      mcparams.controlVarType = qf::McParams::ControlVarType::NONE;
+    else if (paramvalue == "ANTITHETIC")
+      mcparams.controlVarType = qf::McParams::ControlVarType::ANTITHETIC;
+    else if (paramvalue == "CONTROLVARIATE")
+      mcparams.controlVarType = qf::McParams::ControlVarType::CONTROLVARIATE;
+    else if (paramvalue == "BOTH")
+      mcparams.controlVarType = qf::McParams::ControlVarType::BOTH;
+    else
+      QF_ASSERT(0, "asMcParams: invalid value for McParam " + paramname + "!");
+  }
+
+  paramname = "ABSTOL";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    mcparams.absTol = asDouble(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "RELTOL";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    mcparams.relTol = asDouble(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "MAXSECONDS";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    mcparams.maxSeconds = asDouble(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "GREEKS";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    mcparams.greeks = asBool(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "AAD";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    mcparams.aad = asBool(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "NCORRFACTORS";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1) {
+    int ncorrfactors = asInt(PyDict_GetItemString(dict, paramname.c_str()));
+    QF_ASSERT(ncorrfactors >= 0, "asMcParams: McParam NCORRFACTORS must be non-negative!");
+    mcparams.nCorrFactors = (size_t) ncorrfactors;
+  }
+
+  paramname = "FUSEDKERNELS";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    mcparams.fusedKernels = asBool(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "PRECISION";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1) {
+    paramvalue = asString(PyDict_GetItemString(dict, paramname.c_str()));
+    paramvalue = trim(paramvalue);
+    std::transform(paramvalue.begin(), paramvalue.end(), paramvalue.begin(), ::toupper);
+    if (paramvalue == "DOUBLE")
+      mcparams.precision = qf::McParams::Precision::DOUBLE;
+    else if (paramvalue == "FLOAT")
+      mcparams.precision = qf::McParams::Precision::FLOAT;
+    else
+      QF_ASSERT(0, "asMcParams: invalid value for McParam " + paramname + "!");
+  }
+
+  paramname = "STREAMFIXINGS";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    mcparams.streamFixings = asBool(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "SCRAMBLETYPE";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1) {
+    paramvalue = asString(PyDict_GetItemString(dict, paramname.c_str()));
+    paramvalue = trim(paramvalue);
+    std::transform(paramvalue.begin(), paramvalue.end(), paramvalue.begin(), ::toupper);
+    if (paramvalue == "NONE")
+      mcparams.scrambleType = qf::McParams::ScrambleType::NONE;
+    else if (paramvalue == "SHIFT")
+      mcparams.scrambleType = qf::McParams::ScrambleType::SHIFT;
+    else if (paramvalue == "LMS")
+      mcparams.scrambleType = qf::McParams::ScrambleType::LMS;
+    else
+      QF_ASSERT(0, "asMcParams: invalid value for McParam " + paramname + "!");
+  }
+
   return mcparams;
 }
 
+/** Reads the Longstaff-Schwartz regression basis from the optional keys LSMBASIS, LSMDEGREE,
+    LSMCROSSTERMS and LSMEXERCISEVALUE of a Python dictionary of MC parameters.
+*/
+static qf::RegressionBasis asRegressionBasis(PyObject* dict)
+{
+  QF_ASSERT(PyDict_Check(dict) == 1, "asRegressionBasis: input param must be a dictionary");
+
+  qf::RegressionBasis defaults;
+  qf::RegressionBasis::Type type = defaults.type();
+  size_t degree = defaults.degree();
+  bool crossterms = defaults.crossTerms();
+  bool exercisevalue = defaults.exerciseValue();
+
+  std::string paramname = "LSMBASIS";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1) {
+    std::string paramvalue = asString(PyDict_GetItemString(dict, paramname.c_str()));
+    paramvalue = trim(paramvalue);
+    std::transform(paramvalue.begin(), paramvalue.end(), paramvalue.begin(), ::toupper);
+    if (paramvalue == "MONOMIAL")
+      type = qf::RegressionBasis::Type::MONOMIAL;
+    else if (paramvalue == "LAGUERRE")
+      type = qf::RegressionBasis::Type::LAGUERRE;
+    else
+      QF_ASSERT(0, "asRegressionBasis: invalid value for McParam " + paramname + "!");
+  }
+
+  paramname = "LSMDEGREE";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1) {
+    int deg = asInt(PyDict_GetItemString(dict, paramname.c_str()));
+    QF_ASSERT(deg > 0, "asRegressionBasis: McParam LSMDEGREE must be positive!");
+    degree = (size_t) deg;
+  }
+
+  paramname = "LSMCROSSTERMS";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    crossterms = asBool(PyDict_GetItemString(dict, paramname.c_str()));
+
+  paramname = "LSMEXERCISEVALUE";
+  if (PyDict_Contains(dict, asPyScalar(paramname)) == 1)
+    exercisevalue = asBool(PyDict_GetItemString(dict, paramname.c_str()));
+
+  return qf::RegressionBasis(type, degree, crossterms, exercisevalue);
+}
+
 /** Converts a Python dictionary with name-value pairs to an PdeParams structure.
 */
 static qf::PdeParams asPdeParams(PyObject* dict)
@@ -157,6 +157,30 @@ def specTrunc(mat):
     return pyqflib.specTrunc(mat)
 
 
+def pcaFactors(mat, nfactors): 
+    """Principal components factor model of a correlation matrix,
+    mat ~ Loadings * Loadings^T + diag(IdioVars).
+
+    Parameters
+    ----------
+    mat : 2D numpy array
+        input correlation matrix
+    nfactors : int
+        number of principal components kept, between 1 and the matrix size
+
+    Returns
+    -------
+    dictionary
+        Loadings : 2D numpy array
+            the factor loadings, one column per principal component
+        IdioVars : 1D numpy array
+            the idiosyncratic variances, restoring the unit diagonal
+        ExplainedVariance : double
+            the fraction of the total variance explained by the principal components
+    """
+    return pyqflib.pcaFactors(mat, nfactors)
+
+
 def ppolyEval(bkpoints, values, polyorder, xvec, derivorder): 
     """Values and derivatives of a piecewise polynomial function at a set of points.
 
@@ -469,6 +493,7 @@ def mktList():
     dictionary
         YieldCurves : list with names of yield curves
         Volatilities : list with names of volatility term structures   
+        LocalVolSurfaces : list with names of local volatility surfaces
     """
     return pyqflib.mktList()
 
@@ -646,10 +671,54 @@ def fwdVol(volname, tmat1, tmat2):
     return pyqflib.fwdVol(volname, tmat1, tmat2)
 
 
+def localVolCreate(lvname, tmats, logmoneyness, impliedvols):
+    """Creates a new Dupire local volatility surface from a surface of implied volatilities.
+    The total implied variance is interpolated with natural cubic splines in log-moneyness
+    and linearly in maturity, flat in implied volatility outside the input.
+
+    Parameters
+    ----------
+    lvname : str
+        name of the local volatility surface
+    tmats : list(double) or 1D numpy array
+        maturities (expirations) in years, positive and increasing
+    logmoneyness : list(double) or 1D numpy array
+        log-moneyness log(K / F(T)) of the implied volatilities, increasing
+    impliedvols : 2D numpy array
+        implied volatilities, one row per maturity and one column per log-moneyness
+
+    Returns
+    -------
+    str 
+        name of the newly created local volatility surface
+    """
+    return pyqflib.localVolCreate(lvname, tmats, logmoneyness, impliedvols)
+
+
+def localVol(lvname, t, logmoneyness):
+    """Local volatility from a local volatility surface.
+
+    Parameters
+    ----------
+    lvname : str
+        name of the local volatility surface
+    t : double
+        time in years, positive
+    logmoneyness : double
+        log-moneyness log(S / F(t)) of the spot
+
+    Returns
+    -------
+    double
+        local volatility
+    """
+    return pyqflib.localVol(lvname, t, logmoneyness)
+
+
 ###################
 # function group 3
 
-def euroBSMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, volatility, mcparams, npaths):
+def euroBSMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, volatility, mcparams, npaths, quantiles=None):
     """Price and standard error of a European option in the Black-Scholes model using Monte Carlo.
 
     Parameters
@@ -669,23 +738,51 @@ def euroBSMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, volatil
     volatility : double
         asset return volatility
     mcparams : dictionary
-        URNGTYPE : 'MINSTDRAND', 'MT19937', 'RANLUX3', 'RANLUX4'
-        PATHGENTYPE : 'EULER'
-        CONTROLVARTYPE : 'ANTITHETIC', 'NONE'
+        URNGTYPE : 'MINSTDRAND', 'MT19937', 'RANLUX3', 'RANLUX4', 'PHILOX4X32', 'THREEFRY4X32'
+        PATHGENTYPE : 'EULER', 'SOBOL'; SOBOL draws at most 1111 deviates per path, time steps times factors
+        NTHREADS : (int, optional) number of worker threads, default 1
+        SEED : (int, optional) random stream seed, default 0
+        NORMALGENTYPE : (optional) 'STDLIB' (default), 'INVCDF'
+        SCRAMBLETYPE : (optional, SOBOL only) 'NONE' (default), 'SHIFT', 'LMS'
+        CONTROLVARTYPE : (optional) 'NONE' (default), 'ANTITHETIC', 'CONTROLVARIATE', 'BOTH'
+        ABSTOL : (double, optional) stop once the standard error is below this value
+        RELTOL : (double, optional) stop once the standard error is below this fraction of the mean
+        MAXSECONDS : (double, optional) stop after this wall-clock time
+        GREEKS : (bool, optional) also estimate delta and vega in the same simulation, default False
+        FUSEDKERNELS : (bool, optional) with EULER paths and no variance reduction or Greeks, price in
+                       a fused kernel compiled for the urng type, default True
+        PRECISION : (optional, fused kernels only) 'DOUBLE' (default), 'FLOAT'; with 'FLOAT' the normal
+                    deviates, paths and payoffs are computed in single precision, about 2 times as fast as
+                    'DOUBLE'; an error where no fused kernel applies
+        STREAMFIXINGS : (bool, optional) with EULER paths and no ANTITHETIC or Greeks, simulate one path
+                        at a time and stream its fixings into the payoff, default False
     npaths : int
-        number of Monte Carlo paths
+        number of Monte Carlo paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
+    quantiles : list(double) or 1D numpy array, optional
+        levels in (0, 1) of the quantiles of the simulated prices, estimated in bounded memory;
+        not available with CONTROLVARTYPE other than 'NONE', whose samples are not the path prices
     
     Returns
     -------
     dictionary
         Mean : Monte Carlo mean price
         StdErr : Monte Carlo standard error
+        NPaths : number of paths simulated
+        Seconds : wall-clock time spent
+        Quantiles : with quantiles, 1D numpy array, the quantile of the price at each level
+        TailMeans : with quantiles, 1D numpy array, the mean price below the quantile for levels up to 0.5,
+                    above it otherwise
+        Delta, DeltaStdErr : with GREEKS, the pathwise delta and its standard error
+        Vega, VegaStdErr : with GREEKS, the pathwise vega and its standard error
     """
-    return pyqflib.euroBSMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, volatility, mcparams, npaths)
+    if quantiles is None:
+        return pyqflib.euroBSMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, volatility, mcparams, npaths)
+    return pyqflib.euroBSMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, volatility, mcparams, npaths, 
+                            quantiles)
 
 
 def asianBasketBSMC(payofftype, strike, fixtimes, assetquantities, spots, discountcrv, divyields, 
-                    volatilities, correlmat, mcparams, npaths):
+                    volatilities, correlmat, mcparams, npaths, quantiles=None):
     """Price and standard error of an Asian basket option in the Black-Scholes model using Monte Carlo.
 
     Parameters
@@ -709,20 +806,374 @@ def asianBasketBSMC(payofftype, strike, fixtimes, assetquantities, spots, discou
     correlmat : 2D numpy array
         asset correlation matrix
     mcparams : dictionary
-        URNGTYPE : 'MINSTDRAND', 'MT19937', 'RANLUX3', 'RANLUX4'
-        PATHGENTYPE : 'EULER'
-        CONTROLVARTYPE : 'ANTITHETIC', 'NONE'
+        URNGTYPE : 'MINSTDRAND', 'MT19937', 'RANLUX3', 'RANLUX4', 'PHILOX4X32', 'THREEFRY4X32'
+        PATHGENTYPE : 'EULER', 'SOBOL'; SOBOL draws at most 1111 deviates per path, time steps times factors
+        NTHREADS : (int, optional) number of worker threads, default 1
+        SEED : (int, optional) random stream seed, default 0
+        NORMALGENTYPE : (optional) 'STDLIB' (default), 'INVCDF'
+        SCRAMBLETYPE : (optional, SOBOL only) 'NONE' (default), 'SHIFT', 'LMS'
+        CONTROLVARTYPE : (optional) 'NONE' (default), 'ANTITHETIC', 'CONTROLVARIATE', 'BOTH'
+        ABSTOL : (double, optional) stop once the standard error is below this value
+        RELTOL : (double, optional) stop once the standard error is below this fraction of the mean
+        MAXSECONDS : (double, optional) stop after this wall-clock time
+        GREEKS : (bool, optional) also estimate delta and vega in the same simulation, default False
+        AAD : (bool, optional) with GREEKS, compute the Greeks by adjoint differentiation, default False
+        NCORRFACTORS : (int, optional) if less than the number of assets, simulate the correlation with
+                       this many principal components plus an idiosyncratic term per asset, default 0 (full)
+        FUSEDKERNELS : (bool, optional) with EULER paths, no variance reduction, Greeks or NCORRFACTORS,
+                       price in a fused kernel compiled for the urng type, default True
+        PRECISION : (optional, fused kernels only) 'DOUBLE' (default), 'FLOAT'; with 'FLOAT' the normal
+                    deviates, paths and payoffs are computed in single precision, about 2 times as fast as
+                    'DOUBLE'; an error where no fused kernel applies
+        STREAMFIXINGS : (bool, optional) with EULER paths and no ANTITHETIC or Greeks, simulate one path
+                        at a time and stream its fixings into the payoff, keeping only the current spots
+                        instead of blocks of whole paths, default False
     npaths : int
-        number of Monte Carlo paths
+        number of Monte Carlo paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
+    quantiles : list(double) or 1D numpy array, optional
+        levels in (0, 1) of the quantiles of the simulated prices, estimated in bounded memory;
+        not available with CONTROLVARTYPE other than 'NONE', whose samples are not the path prices
     
     Returns
     -------
     dictionary
         Mean : Monte Carlo mean price
         StdErr : Monte Carlo standard error
+        NPaths : number of paths simulated
+        Seconds : wall-clock time spent
+        Quantiles : with quantiles, 1D numpy array, the quantile of the price at each level
+        TailMeans : with quantiles, 1D numpy array, the mean price below the quantile for levels up to 0.5,
+                    above it otherwise
+        ExplainedVariance : with NCORRFACTORS, the fraction of the variance explained by the principal components
+        Delta, DeltaStdErr : with GREEKS, 1D numpy arrays, the pathwise delta of each asset and its standard error
+        Vega, VegaStdErr : with GREEKS, 1D numpy arrays, the pathwise vega of each asset and its standard error
+        DivSens : with GREEKS and AAD, 1D numpy array, the sensitivity to the dividend yield of each asset
+        RateSens : with GREEKS and AAD, 1D numpy array, the sensitivity to each forward rate of the discount curve
+        CorrelSens : with GREEKS and AAD, 2D numpy array, the sensitivity to each correlation
     """
+    if quantiles is None:
+        return pyqflib.asianBasketBSMC(payofftype, strike, fixtimes, assetquantities, spots, discountcrv, divyields, 
+                                       volatilities, correlmat, mcparams, npaths)
     return pyqflib.asianBasketBSMC(payofftype, strike, fixtimes, assetquantities, spots, discountcrv, divyields, 
-                                   volatilities, correlmat, mcparams, npaths)
+                                   volatilities, correlmat, mcparams, npaths, quantiles)
+
+
+def euroLadderBSMC(payofftype, strikes, timestoexp, spot, discountcrv, divyield, volatility, mcparams, npaths):
+    """Prices and standard errors of a ladder of European options in the Black-Scholes model using Monte Carlo.
+    All options are evaluated on the same paths, simulated on the union of their expirations.
+
+    Parameters
+    ----------
+    payofftype : {1, -1}
+        1 for call, -1 for put
+    strikes : list(double) or 1D numpy array
+        strike prices, one per option
+    timestoexp : list(double) or 1D numpy array
+        times to expiration in years, one per option
+    spot : double
+        asset spot price
+    discountcrv : str
+        discount yield curve name
+    divyield : double    
+        asset dividend yield, p.a. and c.c.
+    volatility : double
+        asset return volatility
+    mcparams : dictionary
+        as in euroBSMC; CONTROLVARTYPE may only be 'NONE' or 'ANTITHETIC', and GREEKS is not supported.
+        ABSTOL and RELTOL must be met by every option.
+    npaths : int
+        number of Monte Carlo paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
+    
+    Returns
+    -------
+    dictionary
+        Mean : 1D numpy array, Monte Carlo mean price of each option
+        StdErr : 1D numpy array, Monte Carlo standard error of each option
+        NPaths : number of paths simulated
+        Seconds : wall-clock time spent
+    """
+    return pyqflib.euroLadderBSMC(payofftype, strikes, timestoexp, spot, discountcrv, divyield, volatility, mcparams, npaths)
+
+def amerBasketBSMC(payofftype, strike, exertimes, assetquantities, spots, discountcrv, divyields, 
+                   volatilities, correlmat, mcparams, npaths):
+    """Price and standard error of an American (Bermudan) basket option in the Black-Scholes model
+    using Longstaff-Schwartz Monte Carlo. The exercise policy is regressed on a first set of paths,
+    then applied to npaths independent paths.
+
+    Parameters
+    ----------
+    payofftype : {1, -1}
+        1 for call, -1 for put
+    strike : double
+        strike price
+    exertimes : list(double) or 1D numpy array
+        exercise times in years, unique and in increasing order; the last one is the expiration
+    assetquantities : list(double) or 1D numpy array
+        asset quantities
+    spots : list(double) or 1D numpy array
+        asset spot prices
+    discountcrv : str
+        discount yield curve name
+    divyields : list(double) or 1D numpy array
+        asset dividend yields, p.a. and c.c.
+    volatilities : list(double) or 1D numpy array
+        asset return volatilities
+    correlmat : 2D numpy array
+        asset correlation matrix
+    mcparams : dictionary
+        as in asianBasketBSMC; CONTROLVARTYPE may only be 'NONE' or 'ANTITHETIC', and GREEKS is not supported.
+        LSMPATHS : (int, optional) number of regression paths, default 16384
+        LSMBASIS : (optional) 'MONOMIAL' (default), 'LAGUERRE', the polynomials in each spot
+        LSMDEGREE : (int, optional) degree of the polynomials, default 2
+        LSMCROSSTERMS : (bool, optional) also regress on the products of two spots, default True
+        LSMEXERCISEVALUE : (bool, optional) also regress on the exercise value, default True
+    npaths : int
+        number of pricing paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
+    
+    Returns
+    -------
+    dictionary
+        Mean : Monte Carlo mean price, biased low
+        StdErr : Monte Carlo standard error
+        NPaths : number of pricing paths simulated
+        Seconds : wall-clock time spent on the pricing paths
+        RegressionMean : mean price on the regression paths, biased high
+    """
+    return pyqflib.amerBasketBSMC(payofftype, strike, exertimes, assetquantities, spots, discountcrv, divyields, 
+                                  volatilities, correlmat, mcparams, npaths)
+
+def asianBasketBSMLMC(payofftype, strike, fixtimes, assetquantities, spots, discountcrv, divyields, 
+                      volatilities, correlmat, mcparams, rmse):
+    """Price of an Asian basket option in the Black-Scholes model using multilevel Monte Carlo.
+    Level l simulates MLMCCOARSESTEPS * 2^l fixings and interpolates the others; the number of paths
+    of each level is chosen from the observed variances to reach the target root mean square error.
+
+    Parameters
+    ----------
+    payofftype : {1, -1}
+        1 for call, -1 for put
+    strike : double
+        strike price
+    fixtimes : list(double) or 1D numpy array
+        fixing times in years, unique and in increasing order
+    assetquantities : list(double) or 1D numpy array
+        asset quantities
+    spots : list(double) or 1D numpy array
+        asset spot prices
+    discountcrv : str
+        discount yield curve name
+    divyields : list(double) or 1D numpy array
+        asset dividend yields, p.a. and c.c.
+    volatilities : list(double) or 1D numpy array
+        asset return volatilities
+    correlmat : 2D numpy array
+        asset correlation matrix
+    mcparams : dictionary
+        as in asianBasketBSMC; PATHGENTYPE may only be 'EULER', CONTROLVARTYPE may only be 'NONE',
+        GREEKS is not supported, ABSTOL and RELTOL are ignored.
+        MLMCCOARSESTEPS : (int, optional) number of steps of the coarsest level, default 1
+        MLMCPILOTPATHS : (int, optional) number of paths of the first run of each level, default 1024
+    rmse : double
+        target root mean square error of the price
+    
+    Returns
+    -------
+    dictionary
+        Mean : multilevel Monte Carlo mean price
+        StdErr : Monte Carlo standard error
+        NPaths : number of paths simulated over all levels
+        Seconds : wall-clock time spent
+        Converged : whether the target was met within MAXSECONDS
+        LevelMeans : mean of the price difference of each level with the level below
+        LevelVariances : variance of the price difference of each level with the level below
+        LevelPaths : number of paths of each level
+    """
+    return pyqflib.asianBasketBSMLMC(payofftype, strike, fixtimes, assetquantities, spots, discountcrv, divyields, 
+                                     volatilities, correlmat, mcparams, rmse)
+
+def euroHestonMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, v0, kappa, theta, xi, rho, 
+                 mcparams, npaths, nsteps=0):
+    """Price and standard error of a European option in the Heston model using Monte Carlo.
+    The variance follows dV = kappa (theta - V) dt + xi sqrt(V) dW, correlated with the asset by rho,
+    and is simulated with the Quadratic-Exponential scheme of Andersen, so a few steps a year suffice.
+
+    Parameters
+    ----------
+    payofftype : {1, -1}
+        1 for call, -1 for put
+    strike : double
+        strike price
+    timetoexp : double
+        time to expiration in years
+    spot : double
+        asset spot price
+    discountcrv : str
+        discount yield curve name
+    divyield : double    
+        asset dividend yield, p.a. and c.c.
+    v0 : double
+        initial variance
+    kappa : double
+        speed of mean reversion of the variance
+    theta : double
+        long-term variance
+    xi : double
+        volatility of the variance
+    rho : double
+        correlation of the asset and the variance
+    mcparams : dictionary
+        as in euroBSMC; URNGTYPE and PATHGENTYPE select the normal deviates under the QE scheme,
+        GREEKS, FUSEDKERNELS, PRECISION and STREAMFIXINGS are not supported
+    npaths : int
+        number of Monte Carlo paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
+    nsteps : int, optional
+        minimum number of time steps to expiration, default 0 for a single step
+
+    Returns
+    -------
+    dictionary
+        Mean : Monte Carlo mean price
+        StdErr : Monte Carlo standard error
+        NPaths : number of paths simulated
+        Seconds : wall-clock time spent
+        NSteps : number of time steps simulated
+    """
+    return pyqflib.euroHestonMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, v0, kappa, theta, xi, rho,
+                                mcparams, npaths, nsteps)
+
+
+def euroLocalVolMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, lvname, mcparams, npaths, nsteps=0):
+    """Price and standard error of a European option in the Dupire local volatility model using Monte Carlo.
+    The local volatility surface is resampled once onto the time steps and a uniform grid of log spots,
+    so each step of a path costs one table lookup and one linear interpolation.
+
+    Parameters
+    ----------
+    payofftype : {1, -1}
+        1 for call, -1 for put
+    strike : double
+        strike price
+    timetoexp : double
+        time to expiration in years
+    spot : double
+        asset spot price
+    discountcrv : str
+        discount yield curve name
+    divyield : double    
+        asset dividend yield, p.a. and c.c.
+    lvname : str
+        local volatility surface name, see localVolCreate
+    mcparams : dictionary
+        as in euroBSMC; GREEKS, FUSEDKERNELS, PRECISION and STREAMFIXINGS are not supported
+    npaths : int
+        number of Monte Carlo paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
+    nsteps : int, optional
+        minimum number of time steps to expiration, default 0 for a single step
+
+    Returns
+    -------
+    dictionary
+        Mean : Monte Carlo mean price
+        StdErr : Monte Carlo standard error
+        NPaths : number of paths simulated
+        Seconds : wall-clock time spent
+        NSteps : number of time steps simulated
+    """
+    return pyqflib.euroLocalVolMC(payofftype, strike, timetoexp, spot, discountcrv, divyield, lvname, 
+                                  mcparams, npaths, nsteps)
+
+def barrierBSMC(payofftype, strike, barrier, barriertype, fixtimes, spot, discountcrv, divyield, volatility, 
+                mcparams, npaths, rebate=0.0):
+    """Price and standard error of a discretely monitored knock-out option in the Black-Scholes model 
+    using Monte Carlo. With EULER paths and no CONTROLVARTYPE or GREEKS, a path stops being simulated 
+    at its knock-out.
+
+    Parameters
+    ----------
+    payofftype : {1, -1}
+        1 for call, -1 for put
+    strike : double
+        strike price
+    barrier : double
+        barrier level
+    barriertype : {1, -1}
+        1 for up-and-out, -1 for down-and-out
+    fixtimes : 1D numpy array
+        barrier monitoring times in years, increasing, the last of which is the expiration
+    spot : double
+        asset spot price
+    discountcrv : str
+        discount yield curve name
+    divyield : double    
+        asset dividend yield, p.a. and c.c.
+    volatility : double
+        Black-Scholes volatility, p.a.
+    mcparams : dictionary
+        as in euroBSMC
+    npaths : int
+        number of Monte Carlo paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
+    rebate : double, optional
+        amount paid at expiration on knock-out, default 0
+
+    Returns
+    -------
+    dictionary
+        Mean : Monte Carlo mean price
+        StdErr : Monte Carlo standard error
+        NPaths : number of paths simulated
+        Seconds : wall-clock time spent
+        Delta, DeltaStdErr : with GREEKS, the likelihood ratio delta and its standard error
+        Vega, VegaStdErr : with GREEKS, the likelihood ratio vega and its standard error
+    """
+    return pyqflib.barrierBSMC(payofftype, strike, barrier, barriertype, fixtimes, spot, discountcrv, divyield, 
+                               volatility, mcparams, npaths, rebate)
+
+def autocallBSMC(fixtimes, refspots, calllevel, coupon, protectionlevel, spots, discountcrv, divyields, 
+                 volatilities, correlmat, mcparams, npaths):
+    """Price and standard error of a worst-of autocallable note of unit notional in the multi-asset 
+    Black-Scholes model using Monte Carlo. At each fixing, the note is called if the worst performance 
+    is at or above the call level, and pays 1 plus a coupon per period elapsed. If never called, at the 
+    last fixing it pays 1 if the worst performance is at or above the protection level, and the worst 
+    performance otherwise. With EULER paths and no CONTROLVARTYPE or GREEKS, a path stops being 
+    simulated once the note is called.
+
+    Parameters
+    ----------
+    fixtimes : 1D numpy array
+        fixing times in years, increasing
+    refspots : 1D numpy array
+        reference spot prices of the assets, the performances are the spots over them
+    calllevel : double
+        worst performance at or above which the note is called
+    coupon : double
+        coupon per period elapsed, paid on call
+    protectionlevel : double
+        worst performance at or above which the notional is repaid at the last fixing
+    spots : 1D numpy array
+        asset spot prices
+    discountcrv : str
+        discount yield curve name
+    divyields : 1D numpy array
+        asset dividend yields, p.a. and c.c.
+    volatilities : 1D numpy array
+        asset Black-Scholes volatilities, p.a.
+    correlmat : 2D numpy array
+        asset correlation matrix
+    mcparams : dictionary
+        as in asianBasketBSMC
+    npaths : int
+        number of Monte Carlo paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
+
+    Returns
+    -------
+    dictionary
+        Mean : Monte Carlo mean price
+        StdErr : Monte Carlo standard error
+        NPaths : number of paths simulated
+        Seconds : wall-clock time spent
+    """
+    return pyqflib.autocallBSMC(fixtimes, refspots, calllevel, coupon, protectionlevel, spots, discountcrv, 
+                                divyields, volatilities, correlmat, mcparams, npaths)
 
 ###################
 # function group 4
@@ -912,16 +1363,38 @@ def qEuroBSMC(payofftype, strike, timetoexp, spot, discountcrv, growthcrv, divyi
     correl : double
         correlation between asset return and FX return
     mcparams : dict
-        URNGTYPE : 'MINSTDRAND', 'MT19937', 'RANLUX3', 'RANLUX4'
-        PATHGENTYPE : 'EULER'
+        URNGTYPE : 'MINSTDRAND', 'MT19937', 'RANLUX3', 'RANLUX4', 'PHILOX4X32', 'THREEFRY4X32'
+        PATHGENTYPE : 'EULER', 'SOBOL'; SOBOL draws at most 1111 deviates per path, time steps times factors
+        NTHREADS : (int, optional) number of worker threads, default 1
+        SEED : (int, optional) random stream seed, default 0
+        NORMALGENTYPE : (optional) 'STDLIB' (default), 'INVCDF'
+        SCRAMBLETYPE : (optional, SOBOL only) 'NONE' (default), 'SHIFT', 'LMS'
+        CONTROLVARTYPE : (optional) 'NONE' (default), 'ANTITHETIC', 'CONTROLVARIATE', 'BOTH'
+        ABSTOL : (double, optional) stop once the standard error is below this value
+        RELTOL : (double, optional) stop once the standard error is below this fraction of the mean
+        MAXSECONDS : (double, optional) stop after this wall-clock time
+        GREEKS : (bool, optional) also estimate the delta, vega, FX vega and correlation sensitivity
+                 in the same simulation, default False
+        FUSEDKERNELS : (bool, optional) with EULER paths and no variance reduction or Greeks, price in
+                       a fused kernel compiled for the urng type, default True
+        PRECISION : (optional, fused kernels only) 'DOUBLE' (default), 'FLOAT'; with 'FLOAT' the normal
+                    deviates, paths and payoffs are computed in single precision, about 2 times as fast as
+                    'DOUBLE'; an error where no fused kernel applies
     npaths : int
-        number of Monte Carlo paths
+        number of Monte Carlo paths, the maximum number with ABSTOL, RELTOL or MAXSECONDS
     
     Returns
     -------
     dict
         Mean : Monte Carlo mean price
         StdErr : Monte Carlo standard error
+        NPaths : number of paths simulated
+        Seconds : wall-clock time spent
+        Delta, DeltaStdErr : with GREEKS, the delta and its standard error
+        Vega, VegaStdErr : with GREEKS, the sensitivity to the asset volatility and its standard error
+        FxVega, FxVegaStdErr : with GREEKS, the sensitivity to the FX volatility and its standard error
+        CorrelSens, CorrelSensStdErr : with GREEKS, the sensitivity to the asset/FX correlation
+                                       and its standard error
     """
     return pyqflib.qEuroBSMC(payofftype, strike, timetoexp, spot, discountcrv, growthcrv, divyield, assetvol, fxvol, correl, mcparams, npaths)
 
@@ -0,0 +1,30 @@
+/**
+  @file  alloccounter.cpp
+  @brief Replacement of the global operator new and delete that counts the allocations
+*/
+
+#include <qflib/alloccounter.hpp>
+
+#ifdef QF_COUNT_ALLOCATIONS
+
+// The array and nothrow forms of the standard library call these
+
+void* operator new(std::size_t size)
+{
+  void* ptr = qf::AllocCounter::allocate(size);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  qf::AllocCounter::deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  qf::AllocCounter::deallocate(ptr);
+}
+
+#endif // QF_COUNT_ALLOCATIONS
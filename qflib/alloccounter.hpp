@@ -0,0 +1,68 @@
+/**
+@file  alloccounter.hpp
+@brief Per-thread count of heap allocations, a test hook for allocation-free loops
+*/
+
+#ifndef QF_ALLOCCOUNTER_HPP
+#define QF_ALLOCCOUNTER_HPP
+
+#include <qflib/defines.hpp>
+#include <cstdlib>
+#include <new>
+
+BEGIN_NAMESPACE(qf)
+
+/** Counts the heap allocations made by each thread.
+    The counts only move when qflib is built with QF_COUNT_ALLOCATIONS defined:
+    then the global operator new (see alloccounter.cpp) and the armadillo matrices
+    (see matrix.hpp) allocate through allocate(). Otherwise count() is always zero.
+    The Monte Carlo pricers report the allocations of their path loop in McRunInfo::nAllocs.
+*/
+class AllocCounter
+{
+public:
+  /** Returns the number of heap allocations made by the calling thread so far */
+  static unsigned long count();
+
+  /** Allocates size bytes with malloc and counts the allocation; returns nullptr on failure */
+  static void* allocate(size_t size);
+
+  /** Frees memory returned by allocate() */
+  static void deallocate(void* ptr);
+
+private:
+  static unsigned long& counter();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+unsigned long& AllocCounter::counter()
+{
+  thread_local unsigned long n = 0;
+  return n;
+}
+
+inline
+unsigned long AllocCounter::count()
+{
+  return counter();
+}
+
+inline
+void* AllocCounter::allocate(size_t size)
+{
+  ++counter();
+  return std::malloc(size > 0 ? size : 1);
+}
+
+inline
+void AllocCounter::deallocate(void* ptr)
+{
+  std::free(ptr);
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_ALLOCCOUNTER_HPP
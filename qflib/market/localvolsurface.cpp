@@ -0,0 +1,136 @@
+/**
+@file  localvolsurface.cpp
+@brief Implementation of the Dupire local volatility surface class.
+*/
+
+#include <qflib/market/localvolsurface.hpp>
+#include <algorithm>
+#include <cmath>
+
+BEGIN_NAMESPACE(qf)
+
+using namespace std;
+
+LocalVolSurface::LocalVolSurface(Vector const& tMats, Vector const& logMoneyness, Matrix const& impliedVols)
+: tmats_(tMats), ys_(logMoneyness)
+{
+  size_t nmats = tMats.size();
+  size_t ny = logMoneyness.size();
+  QF_ASSERT(nmats > 0 && ny > 0, "LocalVolSurface: no maturities or log-moneyness!");
+  QF_ASSERT(impliedVols.n_rows == nmats && impliedVols.n_cols == ny,
+    "LocalVolSurface: the implied vols must have one row per maturity and one column per log-moneyness!");
+  for (size_t j = 0; j < nmats; ++j)
+    QF_ASSERT(tMats[j] > 0.0 && (j == 0 || tMats[j] > tMats[j - 1]),
+      "LocalVolSurface: maturities must be positive and increasing");
+  for (size_t k = 1; k < ny; ++k)
+    QF_ASSERT(logMoneyness[k] > logMoneyness[k - 1], "LocalVolSurface: log-moneyness must be increasing");
+
+  // the total variances
+  maxvol_ = 0.0;
+  w_.set_size(nmats, ny);
+  for (size_t j = 0; j < nmats; ++j) {
+    for (size_t k = 0; k < ny; ++k) {
+      double vol = impliedVols(j, k);
+      QF_ASSERT(vol > 0.0, "LocalVolSurface: implied vols must be positive");
+      maxvol_ = max(maxvol_, vol);
+      w_(j, k) = vol * vol * tMats[j];
+    }
+  }
+
+  // the natural cubic splines in y of each maturity, by the tridiagonal algorithm
+  wyy_.zeros(nmats, ny);
+  if (ny < 3)
+    return;
+  vector<double> c(ny), d(ny);
+  for (size_t j = 0; j < nmats; ++j) {
+    c[0] = d[0] = 0.0;
+    for (size_t k = 1; k + 1 < ny; ++k) {
+      double h0 = ys_[k] - ys_[k - 1];
+      double h1 = ys_[k + 1] - ys_[k];
+      double rhs = 6.0 * ((w_(j, k + 1) - w_(j, k)) / h1 - (w_(j, k) - w_(j, k - 1)) / h0);
+      double piv = 2.0 * (h0 + h1) - h0 * c[k - 1];
+      c[k] = h1 / piv;
+      d[k] = (rhs - h0 * d[k - 1]) / piv;
+    }
+    for (size_t k = ny - 2; k > 0; --k)
+      wyy_(j, k) = d[k] - c[k] * wyy_(j, k + 1);
+  }
+}
+
+void LocalVolSurface::totalVariance(size_t j, double y, double& w, double& wy, double& wyy) const
+{
+  size_t ny = ys_.size();
+  // flat implied vol outside the nodes
+  if (ny == 1 || y <= ys_[0] || y >= ys_[ny - 1]) {
+    w = y <= ys_[0] ? w_(j, 0) : w_(j, ny - 1);
+    wy = wyy = 0.0;
+    return;
+  }
+  size_t k = upper_bound(ys_.begin(), ys_.end(), y) - ys_.begin() - 1;
+  double h = ys_[k + 1] - ys_[k];
+  double a = (ys_[k + 1] - y) / h;
+  double b = 1.0 - a;
+  double m0 = wyy_(j, k), m1 = wyy_(j, k + 1);
+  w = a * w_(j, k) + b * w_(j, k + 1) + ((a * a * a - a) * m0 + (b * b * b - b) * m1) * h * h / 6.0;
+  wy = (w_(j, k + 1) - w_(j, k)) / h - (3.0 * a * a - 1.0) * h * m0 / 6.0 + (3.0 * b * b - 1.0) * h * m1 / 6.0;
+  wyy = a * m0 + b * m1;
+}
+
+double LocalVolSurface::impliedVol(double tMat, double y) const
+{
+  QF_ASSERT(tMat > 0.0, "LocalVolSurface: implied vols at non-positive maturities are not defined");
+  size_t nmats = tmats_.size();
+  size_t j = lower_bound(tmats_.begin(), tmats_.end(), tMat) - tmats_.begin();
+  double w, wy, wyy;
+  if (j == 0 || j == nmats) {
+    // flat implied vol before the first and after the last maturity
+    size_t jref = j == 0 ? 0 : nmats - 1;
+    totalVariance(jref, y, w, wy, wyy);
+    return sqrt(w / tmats_[jref]);
+  }
+  double w1, w2;
+  totalVariance(j - 1, y, w1, wy, wyy);
+  totalVariance(j, y, w2, wy, wyy);
+  double a = (tMat - tmats_[j - 1]) / (tmats_[j] - tmats_[j - 1]);
+  w = (1.0 - a) * w1 + a * w2;
+  return sqrt(w / tMat);
+}
+
+double LocalVolSurface::localVol(double t, double y) const
+{
+  QF_ASSERT(t > 0.0, "LocalVolSurface: local vols at non-positive times are not defined");
+  size_t nmats = tmats_.size();
+  size_t j = lower_bound(tmats_.begin(), tmats_.end(), t) - tmats_.begin();
+
+  // the total variance, its derivatives in y and its derivative in T at (t, y)
+  double w, wy, wyy, wt;
+  if (j == 0 || j == nmats) {
+    size_t jref = j == 0 ? 0 : nmats - 1;
+    double wref, wyref, wyyref;
+    totalVariance(jref, y, wref, wyref, wyyref);
+    double a = t / tmats_[jref];
+    w = a * wref;
+    wy = a * wyref;
+    wyy = a * wyyref;
+    wt = wref / tmats_[jref];
+  }
+  else {
+    double w1, wy1, wyy1, w2, wy2, wyy2;
+    totalVariance(j - 1, y, w1, wy1, wyy1);
+    totalVariance(j, y, w2, wy2, wyy2);
+    double dT = tmats_[j] - tmats_[j - 1];
+    double a = (t - tmats_[j - 1]) / dT;
+    w = (1.0 - a) * w1 + a * w2;
+    wy = (1.0 - a) * wy1 + a * wy2;
+    wyy = (1.0 - a) * wyy1 + a * wyy2;
+    wt = (w2 - w1) / dT;
+  }
+
+  double const denFloor = 1.0e-6;
+  if (w <= 0.0)
+    return sqrt(max(wt, 0.0));
+  double den = 1.0 - y * wy / w + 0.25 * (-0.25 - 1.0 / w + y * y / (w * w)) * wy * wy + 0.5 * wyy;
+  return sqrt(max(wt, 0.0) / max(den, denFloor));
+}
+
+END_NAMESPACE(qf)
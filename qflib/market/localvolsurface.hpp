@@ -0,0 +1,78 @@
+/**
+@file  localvolsurface.hpp
+@brief Class representing a Dupire local volatility surface
+*/
+
+#ifndef QF_LOCALVOLSURFACE_HPP
+#define QF_LOCALVOLSURFACE_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <qflib/math/matrix.hpp>
+#include <memory>
+
+BEGIN_NAMESPACE(qf)
+
+/** The local volatility surface of Dupire, implied by a surface of implied volatilities.
+    The implied vols are given at maturities T_j and log-moneyness y_k = log(K / F(T)), with F the forward.
+    The total implied variance w(T, y) = sigma^2 T is interpolated with a natural cubic spline in y at each
+    maturity, extrapolated flat in implied vol in y, and linearly in T from w(0, y) = 0, flat in implied vol
+    after the last maturity. The local variance follows from Dupire's formula in total variance, see
+    Gatheral, The Volatility Surface (2006), eq. (1.10), with the derivatives of the interpolated w.
+    It costs a search in both directions per call; path generators resample it once onto their grid,
+    see LocalVolPathGenerator.
+*/
+class LocalVolSurface
+{
+public:
+  /** Ctor from the maturities, positive and increasing, the log-moneyness, increasing,
+      and the implied vols, one row per maturity and one column per log-moneyness
+  */
+  LocalVolSurface(Vector const& tMats, Vector const& logMoneyness, Matrix const& impliedVols);
+
+  /** Returns the interpolated implied vol at maturity tMat and log-moneyness y */
+  double impliedVol(double tMat, double y) const;
+
+  /** Returns the local vol at time t > 0 and log-moneyness y = log(S / F(t)).
+      Where the interpolated surface has calendar or butterfly arbitrage, the local variance is floored at zero
+      and its denominator at a small positive number.
+  */
+  double localVol(double t, double y) const;
+
+  /** Returns the largest implied vol of the input surface */
+  double maxImpliedVol() const;
+
+  /** Returns the last maturity of the input surface */
+  double lastMaturity() const;
+
+private:
+  // the total variance w and its first and second derivatives in y, on the spline of maturity j
+  void totalVariance(size_t j, double y, double& w, double& wy, double& wyy) const;
+
+  Vector tmats_;    // the maturities
+  Vector ys_;       // the log-moneyness nodes
+  Matrix w_;        // the total implied variances, one row per maturity
+  Matrix wyy_;      // the second derivatives in y of the natural cubic splines of each row of w_
+  double maxvol_;   // the largest implied vol
+};
+
+using SPtrLocalVolSurface = std::shared_ptr<LocalVolSurface>;
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+double LocalVolSurface::maxImpliedVol() const
+{
+  return maxvol_;
+}
+
+inline
+double LocalVolSurface::lastMaturity() const
+{
+  return tmats_[tmats_.size() - 1];
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_LOCALVOLSURFACE_HPP
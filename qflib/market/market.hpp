@@ -11,6 +11,7 @@
 #include <qflib/sptrmap.hpp>
 #include <qflib/market/yieldcurve.hpp>
 #include <qflib/market/volatilitytermstructure.hpp>
+#include <qflib/market/localvolsurface.hpp>
 
 BEGIN_NAMESPACE(qf)
 
@@ -30,6 +31,9 @@ public:
   /** Returns the volatility termstructure map */
   SPtrMap<VolatilityTermStructure>& volatilities() { return volmap_; }
 
+  /** Returns the local volatility surface map */
+  SPtrMap<LocalVolSurface>& localVolSurfaces() { return lvmap_; }
+
 private:
 
   /** allow private default ctor */
@@ -44,6 +48,7 @@ private:
   // state
   SPtrMap<YieldCurve> ycmap_;
   SPtrMap<VolatilityTermStructure> volmap_;
+  SPtrMap<LocalVolSurface> lvmap_;
 };
 
 /** Free function returning the market singleton */
@@ -99,4 +99,33 @@ double YieldCurve::fwdRate(double tMat1, double tMat2) const
   return frate / (tMat2 - tMat1);  // return the annualized rate
 }
 
+Vector const& YieldCurve::fwdRateTimes() const
+{
+  return fwdrates_.breakPoints();
+}
+
+Vector YieldCurve::fwdRates() const
+{
+  Vector rates(fwdrates_.size());
+  for (size_t i = 0; i < fwdrates_.size(); ++i)
+    rates[i] = fwdrates_.coefficient(0, i);
+  return rates;
+}
+
+Vector YieldCurve::fwdRateWeights(double tMat1, double tMat2) const
+{
+  QF_ASSERT(tMat1 >= 0.0, "YieldCurve: negative times not allowed");
+  QF_ASSERT(tMat1 <= tMat2, "YieldCurve: maturities are out of order");
+  size_t n = fwdrates_.size();
+  Vector weights(n, arma::fill::zeros);
+  for (size_t i = 0; i < n; ++i) {
+    // the forward rate i applies on [T_i, T_{i+1}), the last one is extrapolated flat
+    double lo = std::max(tMat1, fwdrates_.breakPoint(i));
+    double hi = i + 1 < n ? std::min(tMat2, fwdrates_.breakPoint(i + 1)) : tMat2;
+    if (hi > lo)
+      weights[i] = hi - lo;
+  }
+  return weights;
+}
+
 END_NAMESPACE(qf)
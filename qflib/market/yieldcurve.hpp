@@ -67,6 +67,18 @@ public:
   /** Returns the forward rate between times tMat1 and tMat2 */
   double fwdRate(double tMat1, double tMat2) const;
 
+  /** Returns the start times of the piecewise constant forward rates of the curve */
+  Vector const& fwdRateTimes() const;
+
+  /** Returns the piecewise constant forward rates of the curve */
+  Vector fwdRates() const;
+
+  /** Returns the derivatives of the integral of the forward rate between times tMat1 and tMat2
+      with respect to each of the piecewise constant forward rates,
+      i.e. the time spent in each forward rate interval
+  */
+  Vector fwdRateWeights(double tMat1, double tMat2) const;
+
   /** Returns the swap rate at time tMat */
   // TODO Not implemented yet, requires frequency arg
   // double swapRate(double tMat1) const;
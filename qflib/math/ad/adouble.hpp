@@ -0,0 +1,179 @@
+/**
+@file  adouble.hpp
+@brief Active double for reverse mode algorithmic differentiation
+*/
+
+#ifndef QF_ADOUBLE_HPP
+#define QF_ADOUBLE_HPP
+
+#include <qflib/math/ad/tape.hpp>
+#include <cmath>
+
+BEGIN_NAMESPACE(qf)
+
+/** A double whose operations are recorded on a Tape.
+    A variable created from a plain double is a constant and is not recorded; operations
+    between constants are not recorded either, so only the computations depending on
+    the leaves are on the tape.
+*/
+class ADouble
+{
+public:
+  /** Ctor of a constant */
+  ADouble(double value = 0.0);
+
+  /** Ctor of an independent variable, a new leaf of the tape */
+  ADouble(Tape& tape, double value);
+
+  /** Ctor of the result of an operation already recorded on the tape as node */
+  ADouble(Tape* tape, size_t node, double value);
+
+  /** The value */
+  double value() const;
+
+  /** The tape, or nullptr for a constant */
+  Tape* tape() const;
+
+  /** The node on the tape; only valid if tape() is not nullptr */
+  size_t node() const;
+
+  /** The adjoint, zero for a constant */
+  double adjoint() const;
+
+  ADouble& operator+=(ADouble const& rhs);
+  ADouble& operator-=(ADouble const& rhs);
+  ADouble& operator*=(ADouble const& rhs);
+  ADouble& operator/=(ADouble const& rhs);
+
+  /** Records a function of one variable, given its value and derivative */
+  static ADouble unary(ADouble const& a, double value, double da);
+
+  /** Records a function of two variables, given its value and partial derivatives */
+  static ADouble binary(ADouble const& a, ADouble const& b, double value, double da, double db);
+
+  // The operators and functions are only found by argument dependent lookup,
+  // so that they do not hide the std functions of plain doubles in namespace qf.
+  friend ADouble operator-(ADouble const& a)
+  {
+    return unary(a, -a.value_, -1.0);
+  }
+
+  friend ADouble operator+(ADouble const& a, ADouble const& b)
+  {
+    return binary(a, b, a.value_ + b.value_, 1.0, 1.0);
+  }
+
+  friend ADouble operator-(ADouble const& a, ADouble const& b)
+  {
+    return binary(a, b, a.value_ - b.value_, 1.0, -1.0);
+  }
+
+  friend ADouble operator*(ADouble const& a, ADouble const& b)
+  {
+    return binary(a, b, a.value_ * b.value_, b.value_, a.value_);
+  }
+
+  friend ADouble operator/(ADouble const& a, ADouble const& b)
+  {
+    double q = a.value_ / b.value_;
+    return binary(a, b, q, 1.0 / b.value_, -q / b.value_);
+  }
+
+  friend ADouble exp(ADouble const& a)
+  {
+    double e = std::exp(a.value_);
+    return unary(a, e, e);
+  }
+
+  friend ADouble log(ADouble const& a)
+  {
+    return unary(a, std::log(a.value_), 1.0 / a.value_);
+  }
+
+  friend ADouble sqrt(ADouble const& a)
+  {
+    double s = std::sqrt(a.value_);
+    return unary(a, s, 0.5 / s);
+  }
+
+private:
+  double value_;
+  Tape* tape_;
+  size_t node_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline ADouble::ADouble(double value)
+: value_(value), tape_(nullptr), node_(0)
+{}
+
+inline ADouble::ADouble(Tape& tape, double value)
+: value_(value), tape_(&tape), node_(tape.newLeaf())
+{}
+
+inline ADouble::ADouble(Tape* tape, size_t node, double value)
+: value_(value), tape_(tape), node_(node)
+{}
+
+inline double ADouble::value() const
+{
+  return value_;
+}
+
+inline Tape* ADouble::tape() const
+{
+  return tape_;
+}
+
+inline size_t ADouble::node() const
+{
+  return node_;
+}
+
+inline double ADouble::adjoint() const
+{
+  return tape_ ? tape_->adjoint(node_) : 0.0;
+}
+
+inline ADouble ADouble::unary(ADouble const& a, double value, double da)
+{
+  if (!a.tape_)
+    return ADouble(value);
+  return ADouble(a.tape_, a.tape_->newNode(a.node_, da), value);
+}
+
+inline ADouble ADouble::binary(ADouble const& a, ADouble const& b, double value, double da, double db)
+{
+  if (!b.tape_)
+    return unary(a, value, da);
+  if (!a.tape_)
+    return unary(b, value, db);
+  QF_ASSERT(a.tape_ == b.tape_, "ADouble: the operands are recorded on different tapes!");
+  return ADouble(a.tape_, a.tape_->newNode(a.node_, da, b.node_, db), value);
+}
+
+inline ADouble& ADouble::operator+=(ADouble const& rhs)
+{
+  return *this = *this + rhs;
+}
+
+inline ADouble& ADouble::operator-=(ADouble const& rhs)
+{
+  return *this = *this - rhs;
+}
+
+inline ADouble& ADouble::operator*=(ADouble const& rhs)
+{
+  return *this = *this * rhs;
+}
+
+inline ADouble& ADouble::operator/=(ADouble const& rhs)
+{
+  return *this = *this / rhs;
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_ADOUBLE_HPP
@@ -0,0 +1,162 @@
+/**
+@file  tape.hpp
+@brief Tape for reverse mode algorithmic differentiation
+*/
+
+#ifndef QF_TAPE_HPP
+#define QF_TAPE_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Records a computation as a sequence of nodes, one per intermediate result, for reverse mode
+    (adjoint) algorithmic differentiation.
+    Each node stores its arguments and the partial derivatives of its value with respect to them.
+    A node may have any number of arguments, so that e.g. a dot product or a whole update
+    of a path takes one node.
+    propagate() sweeps the nodes backwards, accumulating the adjoint of each node into its arguments;
+    after seeding the adjoints of the outputs, the adjoints of the inputs are their sensitivities.
+    rewind() drops the nodes recorded after a checkpoint, so that e.g. a Monte Carlo pricer can
+    record, differentiate and drop one path at a time, keeping the tape size bounded.
+    The storage is kept across rewinds, so recording the next path does not allocate.
+*/
+class Tape
+{
+public:
+  /** Default ctor, an empty tape */
+  Tape();
+
+  /** Returns the number of nodes */
+  size_t size() const;
+
+  /** Records an independent variable, e.g. a model parameter, and returns its node */
+  size_t newLeaf();
+
+  /** Records a node depending on nargs other nodes, with the partial derivatives of its value
+      with respect to each, and returns it
+  */
+  size_t newNode(size_t nargs, size_t const* args, double const* partials);
+
+  /** Records a node depending on one other node */
+  size_t newNode(size_t arg, double partial);
+
+  /** Records a node depending on two other nodes */
+  size_t newNode(size_t arg1, double partial1, size_t arg2, double partial2);
+
+  /** The adjoint of a node */
+  double& adjoint(size_t node);
+
+  /** The adjoint of a node */
+  double adjoint(size_t node) const;
+
+  /** Propagates the adjoints of the nodes [to, from) backwards to their arguments, last node first */
+  void propagate(size_t from, size_t to = 0);
+
+  /** Sets the adjoints of the nodes from onwards to zero */
+  void clearAdjoints(size_t from = 0);
+
+  /** Drops the nodes from onwards, e.g. back to a checkpoint returned by size() */
+  void rewind(size_t from);
+
+  /** Drops all nodes */
+  void clear();
+
+private:
+  std::vector<size_t> argsEnd_;    // node i has the arguments [argsEnd_[i - 1], argsEnd_[i])
+  std::vector<size_t> args_;       // the arguments of all nodes
+  std::vector<double> partials_;   // the partial derivatives with respect to each argument
+  std::vector<double> adjoints_;   // the adjoint of each node
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline Tape::Tape()
+{}
+
+inline size_t Tape::size() const
+{
+  return argsEnd_.size();
+}
+
+inline size_t Tape::newLeaf()
+{
+  return newNode(0, nullptr, nullptr);
+}
+
+inline size_t Tape::newNode(size_t nargs, size_t const* args, double const* partials)
+{
+  size_t node = argsEnd_.size();
+  for (size_t k = 0; k < nargs; ++k) {
+    QF_ASSERT(args[k] < node, "Tape: a node can only depend on earlier nodes!");
+    args_.push_back(args[k]);
+    partials_.push_back(partials[k]);
+  }
+  argsEnd_.push_back(args_.size());
+  adjoints_.push_back(0.0);
+  return node;
+}
+
+inline size_t Tape::newNode(size_t arg, double partial)
+{
+  return newNode(1, &arg, &partial);
+}
+
+inline size_t Tape::newNode(size_t arg1, double partial1, size_t arg2, double partial2)
+{
+  size_t args[2] = { arg1, arg2 };
+  double partials[2] = { partial1, partial2 };
+  return newNode(2, args, partials);
+}
+
+inline double& Tape::adjoint(size_t node)
+{
+  return adjoints_[node];
+}
+
+inline double Tape::adjoint(size_t node) const
+{
+  return adjoints_[node];
+}
+
+inline void Tape::propagate(size_t from, size_t to)
+{
+  QF_ASSERT(from <= size(), "Tape: cannot propagate from beyond the last node!");
+  for (size_t node = from; node-- > to;) {
+    double adj = adjoints_[node];
+    if (adj == 0.0)
+      continue;
+    size_t begin = node == 0 ? 0 : argsEnd_[node - 1];
+    for (size_t k = begin; k < argsEnd_[node]; ++k)
+      adjoints_[args_[k]] += adj * partials_[k];
+  }
+}
+
+inline void Tape::clearAdjoints(size_t from)
+{
+  for (size_t node = from; node < adjoints_.size(); ++node)
+    adjoints_[node] = 0.0;
+}
+
+inline void Tape::rewind(size_t from)
+{
+  if (from >= size())
+    return;
+  size_t nargs = from == 0 ? 0 : argsEnd_[from - 1];
+  argsEnd_.resize(from);
+  adjoints_.resize(from);
+  args_.resize(nargs);
+  partials_.resize(nargs);
+}
+
+inline void Tape::clear()
+{
+  rewind(0);
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_TAPE_HPP
@@ -0,0 +1,45 @@
+/**
+@file   choleskymultiplier.cpp
+@brief  Implementation of the blocked multiplication by a lower triangular matrix
+*/
+
+#include <qflib/math/linalg/linalg.hpp>
+#include <qflib/exception.hpp>
+#include <algorithm>
+
+BEGIN_NAMESPACE(qf)
+
+CholeskyMultiplier::CholeskyMultiplier()
+: n_(0)
+{}
+
+CholeskyMultiplier::CholeskyMultiplier(Matrix const& lowerMat, size_t blockSize)
+: n_(lowerMat.n_rows)
+{
+  QF_ASSERT(lowerMat.is_square(), "CholeskyMultiplier: the matrix must be square!");
+  QF_ASSERT(blockSize > 0, "CholeskyMultiplier: the block size must be positive!");
+  for (size_t start = 0; start < n_; start += blockSize) {
+    size_t end = std::min(start + blockSize, n_);
+    blockStart_.push_back(start);
+    // column j of the product is sum_{k <= j} in(:, k) L(j, k)
+    Matrix factor(end, end - start, arma::fill::zeros);
+    for (size_t j = start; j < end; ++j)
+      for (size_t k = 0; k <= j; ++k)
+        factor(k, j - start) = lowerMat(j, k);
+    blockFactors_.push_back(factor);
+  }
+  blockStart_.push_back(n_);
+}
+
+void CholeskyMultiplier::apply(double const* in, double* out, size_t nrows) const
+{
+  for (size_t b = 0; b < blockFactors_.size(); ++b) {
+    size_t start = blockStart_[b], end = blockStart_[b + 1];
+    // views of the first end columns of in and the block's columns of out, without copies
+    Matrix const inView(const_cast<double*>(in), nrows, end, false, true);
+    Matrix outView(out + start * nrows, nrows, end - start, false, true);
+    outView = inView * blockFactors_[b];
+  }
+}
+
+END_NAMESPACE(qf)
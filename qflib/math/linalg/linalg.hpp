@@ -7,6 +7,7 @@
 #define QF_LINALG_HPP
 
 #include <qflib/math/matrix.hpp>
+#include <vector>
 
 BEGIN_NAMESPACE(qf)
 
@@ -29,6 +30,44 @@ void eigensym(Matrix const& inputMatrix, Vector& eigenValues, Matrix& eigenVecto
 */
 void spectrunc(Matrix& corrmat, double tolerance = 1e-8);
 
+/** 
+* Principal components factor model of a correlation matrix, corrmat ~ loadings * trans(loadings) + diag(idioVars).
+* The n x nfactors loadings are the eigenvectors of the nfactors largest eigenvalues, scaled by their square roots;
+* the idiosyncratic variances restore the ones along the diagonal.
+* Returns the explained variance ratio, the sum of the kept eigenvalues over the sum of all eigenvalues.
+*/
+double pcafactors(Matrix const& corrmat, size_t nfactors, Matrix& loadings, Vector& idioVars);
+
+/**
+* Right multiplication by the transpose of a lower triangular matrix L, e.g. a Cholesky factor:
+* out = in * trans(L), for matrices with one row per sample, such as the deviates of a block
+* of paths and time steps. The columns of the product are computed in blocks, each block
+* as one matrix product (BLAS gemm) over the columns of L up to the end of the block only,
+* which skips the zero blocks above the diagonal.
+*/
+class CholeskyMultiplier
+{
+public:
+  /** Default ctor, multiplies by an empty matrix */
+  CholeskyMultiplier();
+
+  /** Ctor from the lower triangular matrix L and the number of columns per block */
+  explicit CholeskyMultiplier(Matrix const& lowerMat, size_t blockSize = 64);
+
+  /** The number of columns of L */
+  size_t size() const { return n_; }
+
+  /** Computes out = in * trans(L), for in and out with nrows rows and size() columns,
+      stored column-wise at distinct locations. It does not allocate.
+  */
+  void apply(double const* in, double* out, size_t nrows) const;
+
+private:
+  size_t n_;
+  std::vector<size_t> blockStart_;   // the first column of each block, followed by n_
+  std::vector<Matrix> blockFactors_; // block b: trans(L) restricted to rows [0, end) and the block's columns
+};
+
 END_NAMESPACE(qf)
 
 #endif // QF_LINALG_HPP
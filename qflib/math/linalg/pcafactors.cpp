@@ -0,0 +1,50 @@
+/**
+@file   pcafactors.cpp
+@brief  Principal components factor model of a correlation matrix
+*/
+
+#include <qflib/math/linalg/linalg.hpp>
+#include <qflib/exception.hpp>
+#include <algorithm>
+#include <cmath>
+
+BEGIN_NAMESPACE(qf)
+
+double pcafactors(Matrix const& corrmat, size_t nfactors, Matrix& loadings, Vector& idioVars)
+{
+  size_t n = corrmat.n_rows;
+  QF_ASSERT(corrmat.is_square(), "pcafactors: input correlation matrix is not square!");
+  QF_ASSERT(nfactors > 0 && nfactors <= n, "pcafactors: the number of factors must be between 1 and the matrix size!");
+
+  Vector eigenvals;
+  Matrix eigenvecs;
+  eigensym(corrmat, eigenvals, eigenvecs);
+
+  // the eigenvalues are in ascending order; negative ones are truncated to zero
+  double total = 0.0, kept = 0.0;
+  for (size_t m = 0; m < n; ++m)
+    total += std::max(eigenvals[m], 0.0);
+  QF_ASSERT(total > 0.0, "pcafactors: the correlation matrix has no positive eigenvalue!");
+
+  loadings.set_size(n, nfactors);
+  for (size_t f = 0; f < nfactors; ++f) {
+    size_t m = n - 1 - f;
+    double lambda = std::max(eigenvals[m], 0.0);
+    kept += lambda;
+    double scale = std::sqrt(lambda);
+    for (size_t i = 0; i < n; ++i)
+      loadings(i, f) = eigenvecs(i, m) * scale;
+  }
+
+  idioVars.set_size(n);
+  for (size_t i = 0; i < n; ++i) {
+    double var = 0.0;
+    for (size_t f = 0; f < nfactors; ++f)
+      var += loadings(i, f) * loadings(i, f);
+    idioVars[i] = std::max(corrmat(i, i) - var, 0.0);
+  }
+
+  return kept / total;
+}
+
+END_NAMESPACE(qf)
@@ -6,9 +6,17 @@
 #ifndef QF_MATRIX_HPP
 #define QF_MATRIX_HPP
 
-#include <armadillo>
 #include <qflib/defines.hpp>
 
+// count the allocations of matrices and vectors, see alloccounter.hpp
+#ifdef QF_COUNT_ALLOCATIONS
+#include <qflib/alloccounter.hpp>
+#define ARMA_ALIEN_MEM_ALLOC_FUNCTION qf::AllocCounter::allocate
+#define ARMA_ALIEN_MEM_FREE_FUNCTION qf::AllocCounter::deallocate
+#endif
+
+#include <armadillo>
+
 BEGIN_NAMESPACE(qf)
 
 /** The qf::Vector class is an alias for the armadillo column vector, a sequence of doubles */
@@ -0,0 +1,61 @@
+/**
+@file   matrixview.hpp
+@brief  Definition of a non-owning, read-only view of a strided mxn matrix of double values
+*/
+
+#ifndef QF_MATRIXVIEW_HPP
+#define QF_MATRIXVIEW_HPP
+
+#include <qflib/math/matrix.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+/** A read-only view of an mxn matrix of doubles stored elsewhere, with arbitrary
+    strides between rows and columns. Element (i, j) is at data[i * rowStride + j * colStride].
+    It does not own the data, so it is cheap to create and copy, e.g. to view
+    one path of a block of paths stored paths innermost without copying it out.
+    A Matrix converts implicitly to a view of all its elements.
+*/
+class MatrixView
+{
+public:
+  /** Ctor of a view of nrows x ncols elements starting at data */
+  MatrixView(double const* data, size_t nrows, size_t ncols, size_t rowStride, size_t colStride);
+
+  /** Ctor of a view of a whole Matrix */
+  MatrixView(Matrix const& mat);
+
+  /** Element (i, j) */
+  double operator()(size_t i, size_t j) const;
+
+  size_t const n_rows;   // number of rows, named as in Matrix
+  size_t const n_cols;   // number of columns, named as in Matrix
+
+private:
+  double const* data_;
+  size_t rowStride_;
+  size_t colStride_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+MatrixView::MatrixView(double const* data, size_t nrows, size_t ncols, size_t rowStride, size_t colStride)
+: n_rows(nrows), n_cols(ncols), data_(data), rowStride_(rowStride), colStride_(colStride)
+{}
+
+inline
+MatrixView::MatrixView(Matrix const& mat)
+: n_rows(mat.n_rows), n_cols(mat.n_cols), data_(mat.memptr()), rowStride_(1), colStride_(mat.n_rows)
+{}
+
+inline
+double MatrixView::operator()(size_t i, size_t j) const
+{
+  return data_[i * rowStride_ + j * colStride_];
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_MATRIXVIEW_HPP
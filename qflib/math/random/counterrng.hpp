@@ -0,0 +1,208 @@
+/**
+@file  counterrng.hpp
+@brief Counter-based uniform random number generators: Philox4x32-10 and Threefry4x32-20
+*/
+
+#ifndef QF_COUNTERRNG_HPP
+#define QF_COUNTERRNG_HPP
+
+#include <qflib/defines.hpp>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+BEGIN_NAMESPACE(qf)
+
+/** Counter-based generators (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", 2011).
+    The n-th output of the stream (key, stream) is a pure function of (key, stream, n),
+    so any stream can be started, or jumped ahead, in O(1) without sequential state.
+    Both engines satisfy the UniformRandomBitGenerator requirements and return 32-bit words.
+
+    The counter is made of four 32-bit words: the first two hold the position n / 4
+    within the stream, the last two hold the stream id.
+*/
+template <typename BIJECTION>
+class CounterRng
+{
+public:
+  using result_type = uint32_t;
+  using key_type = typename BIJECTION::key_type;
+  using ctr_type = std::array<uint32_t, 4>;
+
+  /** Ctor from a seed, on stream 0 */
+  explicit CounterRng(uint64_t seed = 0);
+
+  /** Restarts the generator on the stream (seed, stream) */
+  void seed(uint64_t seed, uint64_t stream = 0);
+
+  /** Seeds the generator from a seed sequence, as the std engines do */
+  template <typename SSEQ, typename = std::enable_if_t<!std::is_integral_v<SSEQ>>>
+  void seed(SSEQ& seq);
+
+  /** Skips the next n outputs in O(1) */
+  void discard(unsigned long long n);
+
+  /** Returns the next output */
+  result_type operator()();
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+private:
+  void setPosition(uint64_t n);
+
+  key_type key_;
+  ctr_type ctr_;
+  ctr_type out_;    // the output of the current counter
+  unsigned idx_;    // the next word of out_ to return
+};
+
+/** The Philox4x32 bijection with 10 rounds */
+struct Philox4x32Bijection
+{
+  using key_type = std::array<uint32_t, 2>;
+  static key_type makeKey(uint64_t seed);
+  static std::array<uint32_t, 4> apply(std::array<uint32_t, 4> ctr, key_type key);
+};
+
+/** The Threefry4x32 bijection with 20 rounds */
+struct Threefry4x32Bijection
+{
+  using key_type = std::array<uint32_t, 4>;
+  static key_type makeKey(uint64_t seed);
+  static std::array<uint32_t, 4> apply(std::array<uint32_t, 4> ctr, key_type key);
+};
+
+/** Philox4x32-10 */
+using Philox4x32 = CounterRng<Philox4x32Bijection>;
+
+/** Threefry4x32-20 */
+using Threefry4x32 = CounterRng<Threefry4x32Bijection>;
+
+/** Tells whether a uniform rng is counter-based, i.e. can start any stream in O(1) */
+template <typename URNG>
+struct IsCounterBased : std::false_type {};
+
+template <typename BIJECTION>
+struct IsCounterBased<CounterRng<BIJECTION>> : std::true_type {};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+template <typename BIJECTION>
+inline CounterRng<BIJECTION>::CounterRng(uint64_t seed)
+{
+  this->seed(seed, 0);
+}
+
+template <typename BIJECTION>
+inline void CounterRng<BIJECTION>::seed(uint64_t seed, uint64_t stream)
+{
+  key_ = BIJECTION::makeKey(seed);
+  ctr_[2] = uint32_t(stream);
+  ctr_[3] = uint32_t(stream >> 32);
+  setPosition(0);
+}
+
+template <typename BIJECTION>
+template <typename SSEQ, typename>
+inline void CounterRng<BIJECTION>::seed(SSEQ& seq)
+{
+  std::array<uint32_t, 4> w;
+  seq.generate(w.begin(), w.end());
+  seed(uint64_t(w[0]) | (uint64_t(w[1]) << 32), uint64_t(w[2]) | (uint64_t(w[3]) << 32));
+}
+
+template <typename BIJECTION>
+inline void CounterRng<BIJECTION>::discard(unsigned long long n)
+{
+  uint64_t pos = (uint64_t(ctr_[0]) | (uint64_t(ctr_[1]) << 32)) * 4 + idx_;
+  setPosition(pos + n);
+}
+
+template <typename BIJECTION>
+inline typename CounterRng<BIJECTION>::result_type CounterRng<BIJECTION>::operator()()
+{
+  if (idx_ == 4) {
+    // move to the next counter
+    if (++ctr_[0] == 0)
+      ++ctr_[1];
+    out_ = BIJECTION::apply(ctr_, key_);
+    idx_ = 0;
+  }
+  return out_[idx_++];
+}
+
+template <typename BIJECTION>
+inline void CounterRng<BIJECTION>::setPosition(uint64_t n)
+{
+  uint64_t c = n / 4;
+  ctr_[0] = uint32_t(c);
+  ctr_[1] = uint32_t(c >> 32);
+  out_ = BIJECTION::apply(ctr_, key_);
+  idx_ = unsigned(n % 4);
+}
+
+inline Philox4x32Bijection::key_type Philox4x32Bijection::makeKey(uint64_t seed)
+{
+  return key_type{ uint32_t(seed), uint32_t(seed >> 32) };
+}
+
+inline std::array<uint32_t, 4> Philox4x32Bijection::apply(std::array<uint32_t, 4> ctr, key_type key)
+{
+  const uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+  const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+  for (int r = 0; r < 10; ++r) {
+    if (r > 0) {
+      key[0] += W0;
+      key[1] += W1;
+    }
+    uint64_t p0 = uint64_t(M0) * ctr[0];
+    uint64_t p1 = uint64_t(M1) * ctr[2];
+    ctr = { uint32_t(p1 >> 32) ^ ctr[1] ^ key[0], uint32_t(p1),
+            uint32_t(p0 >> 32) ^ ctr[3] ^ key[1], uint32_t(p0) };
+  }
+  return ctr;
+}
+
+inline Threefry4x32Bijection::key_type Threefry4x32Bijection::makeKey(uint64_t seed)
+{
+  return key_type{ uint32_t(seed), uint32_t(seed >> 32), 0, 0 };
+}
+
+inline std::array<uint32_t, 4> Threefry4x32Bijection::apply(std::array<uint32_t, 4> ctr, key_type key)
+{
+  static const unsigned R[8][2] = { {10, 26}, {11, 21}, {13, 27}, {23, 5},
+                                    {6, 20}, {17, 11}, {25, 10}, {18, 20} };
+  auto rotl = [](uint32_t x, unsigned n) { return (x << n) | (x >> (32 - n)); };
+
+  uint32_t ks[5] = { key[0], key[1], key[2], key[3],
+                     0x1BD11BDAu ^ key[0] ^ key[1] ^ key[2] ^ key[3] };
+  std::array<uint32_t, 4> x;
+  for (int i = 0; i < 4; ++i)
+    x[i] = ctr[i] + ks[i];
+
+  for (unsigned r = 0; r < 20; ++r) {
+    unsigned const* rot = R[r % 8];
+    if (r % 2 == 0) {
+      x[0] += x[1]; x[1] = rotl(x[1], rot[0]); x[1] ^= x[0];
+      x[2] += x[3]; x[3] = rotl(x[3], rot[1]); x[3] ^= x[2];
+    }
+    else {
+      x[0] += x[3]; x[3] = rotl(x[3], rot[0]); x[3] ^= x[0];
+      x[2] += x[1]; x[1] = rotl(x[1], rot[1]); x[1] ^= x[2];
+    }
+    if (r % 4 == 3) {
+      // key injection
+      unsigned n = r / 4 + 1;
+      for (unsigned i = 0; i < 4; ++i)
+        x[i] += ks[(n + i) % 5];
+      x[3] += n;
+    }
+  }
+  return x;
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_COUNTERRNG_HPP
@@ -9,10 +9,46 @@
 
 #include <qflib/defines.hpp>
 #include <qflib/exception.hpp>
+#include <qflib/math/stats/normalinvcdf.hpp>
+#include <qflib/math/random/counterrng.hpp>
+#include <algorithm>
+#include <bit>
 #include <random>
+#include <limits>
+#include <vector>
+#include <cstdint>
 
 BEGIN_NAMESPACE(qf)
 
+/** The methods for turning uniform deviates into normal deviates */
+enum class NormalGenType
+{
+  STDLIB,   // std::normal_distribution
+  INVCDF    // inverse cdf (AS241), applied over the whole batch
+};
+
+/** The seed sequence of a stream (seed, stream): the four 32-bit words of the pair, mixed
+    with the algorithm of std::seed_seq, so that it seeds an engine exactly like
+    std::seed_seq{ seed_lo, seed_hi, stream_lo, stream_hi } would, but without allocating.
+    Only generate() is provided, which is all the standard engines' seed() use.
+*/
+class StreamSeedSeq
+{
+public:
+  using result_type = std::uint_least32_t;
+
+  /** Ctor from the seed and the stream */
+  StreamSeedSeq(unsigned long seed, unsigned long stream);
+
+  /** Fills [begin, end) with 32-bit values derived from the seed and the stream */
+  template <typename ITER>
+  void generate(ITER begin, ITER end) const;
+
+private:
+  static std::uint32_t mix(std::uint32_t x) { return x ^ (x >> 27); }
+  std::uint32_t v_[4];
+};
+
 /** Generator of normal deviates. It is templatized on the underlying uniform RNG
 */
 template<typename URNG>
@@ -20,35 +56,99 @@ class NormalRng
 {
 
 public:
+  /** The underlying uniform rng type */
+  using urng_type = URNG;
+
   /** Ctor from distribution parameters */
-  explicit NormalRng(size_t dimension, double mean = 0.0, double stdev = 1.0, URNG const & urng = URNG());
+  explicit NormalRng(size_t dimension, double mean = 0.0, double stdev = 1.0, URNG const & urng = URNG(),
+                     NormalGenType method = NormalGenType::STDLIB);
 
   /** Returns the dimension of the generator */
   size_t dim() const;
 
-  /** Returns a batch of random deviates
-      CAUTION: it requires end - begin == dimension() */
+  /** Returns a batch of random deviates, normally end - begin == dimension().
+      Consecutive calls continue the same sequence, so a batch may also be drawn in smaller pieces,
+      e.g. one time step at a time, with the same deviates. */
   template <typename ITER>
   void next(ITER begin, ITER end);
 
+  /** Returns a uniform deviate in (0,1) in single precision, (k + 1/2) 2^-23 for k the top 23 bits
+      of one draw from the urng: it is exact in float and symmetric about 1/2, and the normal deviates
+      it gives through normalInvCdfPPND7 stay within about 5.3 in absolute value. */
+  float nextUniformFloat();
+
   /** Returns the underlying uniform rng. */
   URNG & urng();
 
+  /** Returns the method used to generate the normal deviates. */
+  NormalGenType method() const;
+
+  /** Restarts the generator on the stream identified by the pair (seed, stream).
+      Different streams of the same seed are seeded through StreamSeedSeq,
+      except for counter-based urngs, which take (seed, stream) as key and counter.
+  */
+  void seed(unsigned long seed, unsigned long stream);
+
 private:
+  /** Returns a uniform deviate in (0,1), using only integer draws from the urng,
+      so that the result does not depend on the standard library implementation */
+  double nextUniform();
 
   // state
   size_t dim_;      // the dimension of the generator
   URNG urng_;       // the uniform random number generator
   std::normal_distribution<double> normcdf_;  // the normal distribution
+  NormalGenType method_;      // the normal generation method
+  double mean_, stdev_;
+  std::vector<double> unifs_; // scratch buffer of uniforms for the INVCDF method
+  std::vector<double> devs_;  // scratch buffer of deviates for the INVCDF method
 
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 // Inline definitions
 
+inline
+StreamSeedSeq::StreamSeedSeq(unsigned long seed, unsigned long stream)
+{
+  unsigned long long s = seed, k = stream;
+  v_[0] = std::uint32_t(s);
+  v_[1] = std::uint32_t(s >> 32);
+  v_[2] = std::uint32_t(k);
+  v_[3] = std::uint32_t(k >> 32);
+}
+
+template <typename ITER>
+inline void StreamSeedSeq::generate(ITER begin, ITER end) const
+{
+  // the algorithm of std::seed_seq::generate, [rand.util.seedseq], for 4 input words
+  if (begin == end)
+    return;
+  std::fill(begin, end, 0x8b8b8b8bu);
+  size_t n = end - begin, s = 4;
+  size_t t = n >= 623 ? 11 : n >= 68 ? 7 : n >= 39 ? 5 : n >= 7 ? 3 : (n - 1) / 2;
+  size_t p = (n - t) / 2, q = p + t, m = std::max(s + 1, n);
+  auto at = [&](size_t k) -> decltype(*begin) { return begin[k % n]; };
+  for (size_t k = 0; k < m; ++k) {
+    std::uint32_t r1 = 1664525u * mix(std::uint32_t(at(k) ^ at(k + p) ^ at(k + n - 1)));
+    std::uint32_t r2 = r1 + std::uint32_t(k == 0 ? s : k <= s ? k % n + v_[k - 1] : k % n);
+    at(k + p) = std::uint32_t(at(k + p) + r1);
+    at(k + q) = std::uint32_t(at(k + q) + r2);
+    at(k) = r2;
+  }
+  for (size_t k = m; k < m + n; ++k) {
+    std::uint32_t r3 = 1566083941u * mix(std::uint32_t(at(k) + at(k + p) + at(k + n - 1)));
+    std::uint32_t r4 = r3 - std::uint32_t(k % n);
+    at(k + p) = std::uint32_t(at(k + p) ^ r3);
+    at(k + q) = std::uint32_t(at(k + q) ^ r4);
+    at(k) = r4;
+  }
+}
+
 template<typename URNG>
-NormalRng<URNG>::NormalRng(size_t dimension, double mean, double stdev, URNG const & urng)
-  : dim_(dimension), urng_(urng)
+NormalRng<URNG>::NormalRng(size_t dimension, double mean, double stdev, URNG const & urng,
+                           NormalGenType method)
+  : dim_(dimension), urng_(urng), method_(method), mean_(mean), stdev_(stdev)
 {
   QF_ASSERT(stdev > 0.0, "the standard deviation must be positive!");
   normcdf_ = std::normal_distribution<double>(mean, stdev);
@@ -64,8 +164,56 @@ template<typename URNG>
 template <typename ITER>
 void NormalRng<URNG>::next(ITER begin, ITER end)
 {
+  if (method_ == NormalGenType::STDLIB) {
+    for (ITER it = begin; it != end; ++it)
+      *it = normcdf_(urng_);
+    return;
+  }
+
+  // INVCDF: draw all the uniforms first, then transform them in one pass
+  unifs_.clear();
   for (ITER it = begin; it != end; ++it)
-    *it = normcdf_(urng_);
+    unifs_.push_back(nextUniform());
+  devs_.resize(unifs_.size());
+  normalInvCdfAS241(unifs_.data(), devs_.data(), unifs_.size());
+  size_t i = 0;
+  for (ITER it = begin; it != end; ++it, ++i)
+    *it = mean_ + stdev_ * devs_[i];
+}
+
+template<typename URNG>
+double NormalRng<URNG>::nextUniform()
+{
+  using result_type = typename URNG::result_type;
+  constexpr double maxbelow1 = 1.0 - std::numeric_limits<double>::epsilon() / 2;
+  double range = double(URNG::max() - URNG::min()) + 1.0;
+  if (range < 4294967296.0) {
+    // narrow engines (e.g. minstd_rand): combine two draws
+    double hi = double(result_type(urng_() - URNG::min()));
+    double lo = double(result_type(urng_() - URNG::min()));
+    double u = hi * range + lo;
+    return std::min((u + 0.5) / (range * range), maxbelow1);
+  }
+  double u = double(urng_() - URNG::min());
+  return std::min((u + 0.5) / range, maxbelow1);
+}
+
+template<typename URNG>
+float NormalRng<URNG>::nextUniformFloat()
+{
+  using result_type = typename URNG::result_type;
+  // the number of bits of the draws, e.g. 31 for minstd_rand, 24 for ranlux24
+  constexpr result_type span = URNG::max() - URNG::min();
+  constexpr int nbits = std::numeric_limits<result_type>::digits - std::countl_zero(span);
+  result_type x = result_type(urng_() - URNG::min());
+  std::uint32_t k = nbits > 23 ? std::uint32_t(x >> (nbits - 23)) : std::uint32_t(x) << (23 - nbits);
+  return (float(k) + 0.5f) * (1.0f / 8388608.0f);
+}
+
+template<typename URNG>
+NormalGenType NormalRng<URNG>::method() const
+{
+  return method_;
 }
 
 template<typename URNG>
@@ -74,6 +222,19 @@ URNG & NormalRng<URNG>::urng()
   return urng_;
 }
 
+template<typename URNG>
+void NormalRng<URNG>::seed(unsigned long seed, unsigned long stream)
+{
+  if constexpr (IsCounterBased<URNG>::value) {
+    urng_.seed(seed, stream);
+  }
+  else {
+    StreamSeedSeq seq(seed, stream);
+    urng_.seed(seq);
+  }
+  normcdf_.reset();   // discard any cached deviate from the previous stream
+}
+
 END_NAMESPACE(qf)
 
 #endif // QF_NORMALRNG_HPP
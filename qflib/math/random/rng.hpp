@@ -22,6 +22,12 @@ using NormalRngRanLux3 = NormalRng<std::ranlux24>;
 /** RanLux level 4 */
 using NormalRngRanLux4 = NormalRng<std::ranlux48>;
 
+/** Philox4x32-10, counter-based */
+using NormalRngPhilox4x32 = NormalRng<Philox4x32>;
+
+/** Threefry4x32-20, counter-based */
+using NormalRngThreefry4x32 = NormalRng<Threefry4x32>;
+
 END_NAMESPACE(qf)
 
 #endif // QF_RNG_HPP
@@ -0,0 +1,99 @@
+/**
+@file  sobolrsg.hpp
+@brief Sobol low discrepancy sequence generator, with optional randomization
+*/
+
+#ifndef QF_SOBOLRSG_HPP
+#define QF_SOBOLRSG_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <cstdint>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** The randomizations of the Sobol sequence */
+enum class SobolScrambleType
+{
+  NONE,     // the plain Sobol sequence
+  SHIFT,    // random digital shift
+  LMS       // random linear matrix scrambling (Matousek) followed by a random digital shift
+};
+
+/** Generator of Sobol points in the unit hypercube, 32 bits per coordinate.
+    The dimensions use the primitive polynomials and initial direction numbers of Joe and Kuo
+    (new-joe-kuo-6.21201), tabulated up to MAXDIM dimensions; larger dimensions are rejected, as
+    direction numbers without the two-dimensional projection criteria of the table degrade the sequence.
+    Point 0 of the sequence (the origin) is never returned.
+*/
+class SobolRsg
+{
+public:
+  /** The largest dimension, that of the table of direction numbers */
+  static const size_t MAXDIM = 1111;
+
+  /** Ctor from the dimension, at most MAXDIM, and the randomization type */
+  explicit SobolRsg(size_t dimension, SobolScrambleType scramble = SobolScrambleType::NONE);
+
+  /** Returns the dimension of the generator */
+  size_t dim() const;
+
+  /** Moves to the point with index (index + 1) of the sequence, in O(dimension * 32).
+      The seed drives the randomization, if any, and is otherwise ignored.
+  */
+  void seed(unsigned long seed, unsigned long index);
+
+  /** Writes the current point into u[0], ..., u[dim - 1], with coordinates in (0,1),
+      and moves to the next point in Gray code order.
+  */
+  void next(double* u);
+
+private:
+  void initDirections();
+  void scramble(unsigned long seed);
+
+  static const size_t NBITS = 32;
+
+  size_t dim_;
+  SobolScrambleType scrambleType_;
+  std::vector<uint32_t> directions_;    // the direction numbers, NBITS per dimension
+  std::vector<uint32_t> scrambled_;     // the randomized direction numbers
+  std::vector<uint32_t> shift_;         // the digital shift, one per dimension
+  std::vector<uint32_t> point_;         // the current point, as integers
+  unsigned long scrambleSeed_;          // the seed of scrambled_ and shift_
+  bool scrambleInit_;                   // whether scrambled_ and shift_ are set up
+  unsigned long long index_;            // the index of the current point
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline size_t SobolRsg::dim() const
+{
+  return dim_;
+}
+
+inline void SobolRsg::next(double* u)
+{
+  const double scale = 1.0 / 4294967296.0;
+  for (size_t d = 0; d < dim_; ++d)
+    u[d] = (double(point_[d]) + 0.5) * scale;
+
+  // Gray code update: the next point differs by the direction number of the lowest zero bit
+  unsigned long long n = index_;
+  size_t c = 0;
+  while (n & 1) {
+    n >>= 1;
+    ++c;
+  }
+  QF_ASSERT(c < NBITS, "SobolRsg: exhausted the 2^32 points of the sequence");
+  uint32_t const* v = scrambleType_ == SobolScrambleType::LMS ? scrambled_.data() : directions_.data();
+  for (size_t d = 0; d < dim_; ++d)
+    point_[d] ^= v[d * NBITS + c];
+  ++index_;
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_SOBOLRSG_HPP
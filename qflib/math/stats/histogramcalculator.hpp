@@ -0,0 +1,163 @@
+/**
+@file  histogramcalculator.hpp
+@brief Calculates the mean, variance and a fixed-bin histogram of a set of samples
+*/
+
+#ifndef QF_HISTOGRAMCALCULATOR_HPP
+#define QF_HISTOGRAMCALCULATOR_HPP
+
+#include <qflib/math/stats/welfordcalculator.hpp>
+#include <qflib/exception.hpp>
+#include <cmath>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Statistics calculator for the histogram of each variable over nbins equal bins.
+    Variable j has bins of width (upper(j) - lower(j)) / nbins, bin k covering
+    [lower(j) + k width, lower(j) + (k + 1) width).
+    The results are, one column per variable:
+    row 0 the mean, row 1 the variance, as in WelfordCalculator,
+    rows 2 to nbins + 1 the fraction of the samples in each bin,
+    row nbins + 2 the fraction below lower(j), row nbins + 3 the fraction at or above upper(j) or NaN.
+    The counts are exact, so that calculators merge without loss.
+    NaN samples count in the bin above the range; QuantileCalculator counts them apart instead.
+    ITER must be a random access iterator.
+*/
+template <typename ITER>
+class HistogramCalculator : public WelfordCalculator < ITER >
+{
+  using StatisticsCalculator<ITER>::nVariables;
+  using StatisticsCalculator<ITER>::nsamples_;
+  using StatisticsCalculator<ITER>::results_;
+
+public:
+
+  /** Ctor; the same bins for all variables */
+  HistogramCalculator(size_t nvars, double lower, double upper, size_t nbins);
+
+  /** Ctor; the bins of variable j span [lowers(j), uppers(j)) */
+  HistogramCalculator(Vector const& lowers, Vector const& uppers, size_t nbins);
+
+  virtual ~HistogramCalculator() {}
+
+  virtual void addSample(ITER begin, ITER end) override;
+
+  virtual void addSamples(ITER begin, ITER end, size_t nsamples) override;
+
+  /** Adds the samples of another calculator on the same variables and bins */
+  void merge(HistogramCalculator const& other);
+
+  virtual void reset() override;
+
+  virtual Matrix const & results() override;
+
+  size_t nBins() const { return nbins_; }
+
+  /** The number of samples of variable j in bin k; bin nbins counts those below the range, bin nbins + 1 those above and the NaNs */
+  unsigned long count(size_t j, size_t k) const { return counts_[j * (nbins_ + 2) + k]; }
+
+protected:
+
+  // Counts value x of variable j
+  void countValue(size_t j, double x);
+
+  // state
+  size_t nbins_;
+  Vector lowers_;
+  Vector invWidths_;
+  std::vector<unsigned long> counts_;  // nbins + 2 per variable
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+template <typename ITER>
+HistogramCalculator<ITER>::HistogramCalculator(size_t nvars, double lower, double upper, size_t nbins)
+  : HistogramCalculator<ITER>(Vector(nvars, arma::fill::value(lower)), Vector(nvars, arma::fill::value(upper)), nbins)
+{
+}
+
+template <typename ITER>
+HistogramCalculator<ITER>::HistogramCalculator(Vector const& lowers, Vector const& uppers, size_t nbins)
+  : WelfordCalculator<ITER>(lowers.size(), nbins + 4), nbins_(nbins), lowers_(lowers), invWidths_(lowers.size()),
+  counts_(lowers.size() * (nbins + 2), 0)
+{
+  QF_ASSERT(nbins > 0, "HistogramCalculator: need at least one bin!");
+  QF_ASSERT(uppers.size() == lowers.size(), "HistogramCalculator: need as many upper as lower bounds!");
+  for (size_t j = 0; j < lowers.size(); ++j) {
+    QF_ASSERT(uppers(j) > lowers(j), "HistogramCalculator: the upper bounds must be above the lower bounds!");
+    invWidths_(j) = nbins / (uppers(j) - lowers(j));
+  }
+}
+
+template <typename ITER>
+void HistogramCalculator<ITER>::countValue(size_t j, double x)
+{
+  // a NaN fails the range tests and is counted above the range, as is +inf
+  double b = std::floor((x - lowers_(j)) * invWidths_(j));
+  size_t k;
+  if (b >= 0.0 && b < nbins_)
+    k = static_cast<size_t>(b);
+  else if (b < 0.0)
+    k = nbins_;
+  else
+    k = nbins_ + 1;
+  ++counts_[j * (nbins_ + 2) + k];
+}
+
+template <typename ITER>
+void HistogramCalculator<ITER>::addSample(ITER begin, ITER end)
+{
+  WelfordCalculator<ITER>::addSample(begin, end);
+  ITER it = begin;
+  for (size_t j = 0; j < nVariables(); ++j, ++it)
+    countValue(j, *it);
+}
+
+template <typename ITER>
+void HistogramCalculator<ITER>::addSamples(ITER begin, ITER end, size_t nsamples)
+{
+  WelfordCalculator<ITER>::addSamples(begin, end, nsamples);
+  size_t nvars = nVariables();
+  ITER it = begin;
+  for (size_t k = 0; k < nsamples; ++k)
+    for (size_t j = 0; j < nvars; ++j, ++it)
+      countValue(j, *it);
+}
+
+template <typename ITER>
+void HistogramCalculator<ITER>::merge(HistogramCalculator const& other)
+{
+  QF_ASSERT(other.nbins_ == nbins_ && other.lowers_.size() == lowers_.size(), "the calculators must have the same bins!");
+  for (size_t j = 0; j < lowers_.size(); ++j)
+    QF_ASSERT(other.lowers_[j] == lowers_[j] && other.invWidths_[j] == invWidths_[j],
+      "the calculators must have the same bins!");
+  WelfordCalculator<ITER>::merge(other);
+  for (size_t i = 0; i < counts_.size(); ++i)
+    counts_[i] += other.counts_[i];
+}
+
+template <typename ITER>
+Matrix const & HistogramCalculator<ITER>::results()
+{
+  WelfordCalculator<ITER>::results();
+  for (size_t j = 0; j < nVariables(); ++j) {
+    for (size_t k = 0; k < nbins_ + 2; ++k)
+      results_(2 + k, j) = nsamples_ > 0 ? double(count(j, k)) / nsamples_ : 0.0;
+  }
+
+  return results_;
+}
+
+template <typename ITER>
+void HistogramCalculator<ITER>::reset()
+{
+  WelfordCalculator<ITER>::reset();
+  std::fill(counts_.begin(), counts_.end(), 0);
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_HISTOGRAMCALCULATOR_HPP
@@ -72,6 +72,8 @@ Matrix const & MeanVarCalculator<ITER>::results()
     results_(0, j) = runningSum_(j) / nsamples_;
     double mean = results_(0, j);
     results_(1, j) = runningSum2_(j) / nsamples_ - mean * mean;
+    if (results_(1, j) < 0.0)
+      results_(1, j) = 0.0;     // round-off, e.g. with constant samples
     results_(1, j) *= nsamples_;
     results_(1, j) /= (nsamples_ - 1);
   }
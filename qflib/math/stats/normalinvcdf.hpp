@@ -0,0 +1,209 @@
+/**
+@file  normalinvcdf.hpp
+@brief Inverse of the standard normal cumulative distribution, algorithm AS241
+*/
+
+#ifndef QF_NORMALINVCDF_HPP
+#define QF_NORMALINVCDF_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <cmath>
+#include <cstddef>
+
+BEGIN_NAMESPACE(qf)
+
+/** Inverse of the standard normal cdf for p in (0,1).
+    Implementation of Wichura's algorithm AS241 (PPND16), accurate to about 1e-16.
+*/
+double normalInvCdfAS241(double p);
+
+/** Inverse of the standard normal cdf applied to the n probabilities p[0], ..., p[n-1].
+    The results are written into x, which must not overlap p.
+    The central region is computed first over the whole array without branches,
+    so that the compiler can vectorize it; the tails are then patched one by one.
+*/
+void normalInvCdfAS241(double const* p, double* x, size_t n);
+
+/** Inverse of the standard normal cdf in single precision, for p in (0,1).
+    Implementation of Wichura's algorithm AS241 (PPND7), accurate to about 1e-7.
+*/
+float normalInvCdfPPND7(float p);
+
+/** Inverse of the standard normal cdf in single precision applied to the n probabilities p[0], ..., p[n-1],
+    in two passes as the double version. The results are written into x, which must not overlap p.
+*/
+void normalInvCdfPPND7(float const* p, float* x, size_t n);
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+BEGIN_NAMESPACE(as241)
+
+// central region, |p - 0.5| <= 0.425
+inline double central(double q)
+{
+  double r = 0.180625 - q * q;
+  double num = (((((((2.5090809287301226727e+3 * r +
+                      3.3430575583588128105e+4) * r +
+                      6.7265770927008700853e+4) * r +
+                      4.5921953931549871457e+4) * r +
+                      1.3731693765509461125e+4) * r +
+                      1.9715909503065514427e+3) * r +
+                      1.3314166789178437745e+2) * r +
+                      3.3871328727963666080e+0) * q;
+  double den = (((((((5.2264952788528545610e+3 * r +
+                      2.8729085735721942674e+4) * r +
+                      3.9307895800092710610e+4) * r +
+                      2.1213794301586595867e+4) * r +
+                      5.3941960214247511077e+3) * r +
+                      6.8718700749205790830e+2) * r +
+                      4.2313330701600911252e+1) * r +
+                      1.0);
+  return num / den;
+}
+
+// tails, |p - 0.5| > 0.425
+inline double tail(double p)
+{
+  double q = p - 0.5;
+  double r = q <= 0.0 ? p : 1.0 - p;
+  r = std::sqrt(-std::log(r));
+  double x;
+  if (r <= 5.0) {
+    r -= 1.6;
+    double num = (((((((7.74545014278341407640e-4 * r +
+                        2.27238449892691845833e-2) * r +
+                        2.41780725177450611770e-1) * r +
+                        1.27045825245236838258e+0) * r +
+                        3.64784832476320460504e+0) * r +
+                        5.76949722146069140550e+0) * r +
+                        4.63033784615654529590e+0) * r +
+                        1.42343711074968357734e+0);
+    double den = (((((((1.05075007164441684324e-9 * r +
+                        5.47593808499534494600e-4) * r +
+                        1.51986665636164571966e-2) * r +
+                        1.48103976427480074590e-1) * r +
+                        6.89767334985100004550e-1) * r +
+                        1.67638483018380384940e+0) * r +
+                        2.05319162663775882187e+0) * r +
+                        1.0);
+    x = num / den;
+  }
+  else {
+    r -= 5.0;
+    double num = (((((((2.01033439929228813265e-7 * r +
+                        2.71155556874348757815e-5) * r +
+                        1.24266094738807843860e-3) * r +
+                        2.65321895265761230930e-2) * r +
+                        2.96560571828504891230e-1) * r +
+                        1.78482653991729133580e+0) * r +
+                        5.46378491116411436990e+0) * r +
+                        6.65790464350110377720e+0);
+    double den = (((((((2.04426310338993978564e-15 * r +
+                        1.42151175831644588870e-7) * r +
+                        1.84631831751005468180e-5) * r +
+                        7.86869131145613259100e-4) * r +
+                        1.48753612908506148525e-2) * r +
+                        1.36929880922735805310e-1) * r +
+                        5.99832206555887937690e-1) * r +
+                        1.0);
+    x = num / den;
+  }
+  return q < 0.0 ? -x : x;
+}
+
+// central region in single precision, |p - 0.5| <= 0.425
+inline float centralf(float q)
+{
+  float r = 0.180625f - q * q;
+  float num = (((5.9109374720e+1f * r +
+                 1.5929113202e+2f) * r +
+                 5.0434271938e+1f) * r +
+                 3.3871327179e+0f) * q;
+  float den = (((6.7187563600e+1f * r +
+                 7.8757757664e+1f) * r +
+                 1.7895169469e+1f) * r +
+                 1.0f);
+  return num / den;
+}
+
+// tails in single precision, |p - 0.5| > 0.425
+inline float tailf(float p)
+{
+  float q = p - 0.5f;
+  float r = q <= 0.0f ? p : 1.0f - p;
+  r = std::sqrt(-std::log(r));
+  float x;
+  if (r <= 5.0f) {
+    r -= 1.6f;
+    float num = (((1.7023821103e-1f * r +
+                   1.3067284816e+0f) * r +
+                   2.7568153900e+0f) * r +
+                   1.4234372777e+0f);
+    float den = ((1.2021132975e-1f * r +
+                  7.3700164250e-1f) * r +
+                  1.0f);
+    x = num / den;
+  }
+  else {
+    r -= 5.0f;
+    float num = (((1.7337203997e-2f * r +
+                   4.2868294337e-1f) * r +
+                   3.0812263860e+0f) * r +
+                   6.6579051150e+0f);
+    float den = ((1.2258202635e-2f * r +
+                  2.4197894225e-1f) * r +
+                  1.0f);
+    x = num / den;
+  }
+  return q < 0.0f ? -x : x;
+}
+
+END_NAMESPACE(as241)
+
+inline double normalInvCdfAS241(double p)
+{
+  QF_ASSERT(p > 0.0 && p < 1.0, "normalInvCdfAS241: prob. must be in (0,1)");
+  double q = p - 0.5;
+  return std::fabs(q) <= 0.425 ? as241::central(q) : as241::tail(p);
+}
+
+inline void normalInvCdfAS241(double const* p, double* x, size_t n)
+{
+  // first pass: central region for all entries; the tail entries keep their probability
+  for (size_t i = 0; i < n; ++i) {
+    double pi = p[i];
+    double q = pi - 0.5;
+    double xc = as241::central(q);
+    x[i] = std::fabs(q) <= 0.425 ? xc : pi;
+  }
+  // second pass: the tails, about 15% of the entries
+  for (size_t i = 0; i < n; ++i) {
+    if (std::fabs(p[i] - 0.5) > 0.425)
+      x[i] = as241::tail(p[i]);
+  }
+}
+
+inline float normalInvCdfPPND7(float p)
+{
+  QF_ASSERT(p > 0.0f && p < 1.0f, "normalInvCdfPPND7: prob. must be in (0,1)");
+  float q = p - 0.5f;
+  return std::fabs(q) <= 0.425f ? as241::centralf(q) : as241::tailf(p);
+}
+
+inline void normalInvCdfPPND7(float const* p, float* x, size_t n)
+{
+  // the central rational function has no pole for |p - 0.5| <= 0.5, so it runs on all the entries
+  // without a select, which would keep the compiler from vectorizing the division
+  for (size_t i = 0; i < n; ++i)
+    x[i] = as241::centralf(p[i] - 0.5f);
+  for (size_t i = 0; i < n; ++i) {
+    if (std::fabs(p[i] - 0.5f) > 0.425f)
+      x[i] = as241::tailf(p[i]);
+  }
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_NORMALINVCDF_HPP
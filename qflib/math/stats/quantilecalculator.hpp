@@ -0,0 +1,140 @@
+/**
+@file  quantilecalculator.hpp
+@brief Calculates the mean, variance, quantiles and tail expectations of a set of samples in bounded memory
+*/
+
+#ifndef QF_QUANTILECALCULATOR_HPP
+#define QF_QUANTILECALCULATOR_HPP
+
+#include <qflib/math/stats/welfordcalculator.hpp>
+#include <qflib/math/stats/tdigest.hpp>
+#include <qflib/exception.hpp>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Statistics calculator for the quantiles of each variable, e.g. the VaR and expected shortfall of a PV.
+    Each variable is summarized by a TDigest, so that the memory does not grow with the number of samples.
+    For levels p_1, ..., p_m, the results are, one column per variable:
+    row 0 the mean, row 1 the variance, as in WelfordCalculator,
+    rows 2 to m + 1 the quantiles at levels p_i,
+    rows m + 2 to 2m + 1 the tail expectations at levels p_i: the mean of the samples below the quantile
+    if p_i <= 0.5, above it otherwise.
+    The quantiles are those of the samples fed: with antithetic paths or a control variate, the samples are
+    pair averages or controlled values, whose quantiles are not those of the PV, so the pricing functions
+    reject quantiles with variance reduction.
+    NaN samples are left out of the quantiles and tail expectations, and counted apart by the digests,
+    see TDigest::nanWeight(), as HistogramCalculator counts them in its bin above the range.
+    ITER must be a random access iterator.
+*/
+template <typename ITER>
+class QuantileCalculator : public WelfordCalculator < ITER >
+{
+  using StatisticsCalculator<ITER>::nVariables;
+  using StatisticsCalculator<ITER>::results_;
+
+public:
+
+  /** Ctor; the levels must be in (0, 1), the compression is that of the digests */
+  QuantileCalculator(size_t nvars, Vector const& levels, double compression = 100.0);
+
+  virtual ~QuantileCalculator() {}
+
+  virtual void addSample(ITER begin, ITER end) override;
+
+  virtual void addSamples(ITER begin, ITER end, size_t nsamples) override;
+
+  /** Adds the samples of another calculator on the same variables and levels */
+  void merge(QuantileCalculator const& other);
+
+  virtual void reset() override;
+
+  virtual Matrix const & results() override;
+
+  /** The quantile levels */
+  Vector const& levels() const { return levels_; }
+
+  /** The digest of variable j */
+  TDigest& digest(size_t j) { return digests_[j]; }
+
+protected:
+
+  // state
+  Vector levels_;
+  std::vector<TDigest> digests_;  // one per variable
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+template <typename ITER>
+QuantileCalculator<ITER>::QuantileCalculator(size_t nvars, Vector const& levels, double compression)
+  : WelfordCalculator<ITER>(nvars, 2 + 2 * levels.size()), levels_(levels)
+{
+  // moved in, not copied, to keep the capacity the digests reserve
+  digests_.reserve(nvars);
+  for (size_t j = 0; j < nvars; ++j)
+    digests_.push_back(TDigest(compression));
+  for (size_t i = 0; i < levels.size(); ++i)
+    QF_ASSERT(levels[i] > 0.0 && levels[i] < 1.0, "QuantileCalculator: the levels must be in (0, 1)!");
+}
+
+template <typename ITER>
+void QuantileCalculator<ITER>::addSample(ITER begin, ITER end)
+{
+  WelfordCalculator<ITER>::addSample(begin, end);
+  ITER it = begin;
+  for (size_t j = 0; j < nVariables(); ++j, ++it)
+    digests_[j].add(*it);
+}
+
+template <typename ITER>
+void QuantileCalculator<ITER>::addSamples(ITER begin, ITER end, size_t nsamples)
+{
+  WelfordCalculator<ITER>::addSamples(begin, end, nsamples);
+  size_t nvars = nVariables();
+  ITER it = begin;
+  for (size_t k = 0; k < nsamples; ++k)
+    for (size_t j = 0; j < nvars; ++j, ++it)
+      digests_[j].add(*it);
+}
+
+template <typename ITER>
+void QuantileCalculator<ITER>::merge(QuantileCalculator const& other)
+{
+  QF_ASSERT(other.levels_.size() == levels_.size(), "the calculators must have the same levels!");
+  for (size_t i = 0; i < levels_.size(); ++i)
+    QF_ASSERT(other.levels_[i] == levels_[i], "the calculators must have the same levels!");
+  WelfordCalculator<ITER>::merge(other);
+  for (size_t j = 0; j < nVariables(); ++j)
+    digests_[j].merge(other.digests_[j]);
+}
+
+template <typename ITER>
+Matrix const & QuantileCalculator<ITER>::results()
+{
+  WelfordCalculator<ITER>::results();
+  size_t nlevels = levels_.size();
+  for (size_t j = 0; j < nVariables(); ++j) {
+    for (size_t i = 0; i < nlevels; ++i) {
+      double p = levels_[i];
+      results_(2 + i, j) = digests_[j].quantile(p);
+      results_(2 + nlevels + i, j) = p <= 0.5 ? digests_[j].lowerTailMean(p) : digests_[j].upperTailMean(p);
+    }
+  }
+
+  return results_;
+}
+
+template <typename ITER>
+void QuantileCalculator<ITER>::reset()
+{
+  WelfordCalculator<ITER>::reset();
+  for (TDigest& digest : digests_)
+    digest.reset();
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_QUANTILECALCULATOR_HPP
@@ -25,6 +25,12 @@ public:
   /** Adds one sample; requires end - big == nVariables() */
   virtual void addSample(ITER begin, ITER end) = 0;
 
+  /** Adds nsamples samples stored one after the other, sample k at begin + k * nVariables();
+      requires end - begin == nsamples * nVariables().
+      The default implementation calls addSample() once per sample.
+  */
+  virtual void addSamples(ITER begin, ITER end, size_t nsamples);
+
   /** Clears samples and results */
   virtual void reset();
 
@@ -71,6 +77,15 @@ size_t StatisticsCalculator<ITER>::nVariables() const
   return results_.n_cols;
 }
 
+template <typename ITER>
+void StatisticsCalculator<ITER>::addSamples(ITER begin, ITER end, size_t nsamples)
+{
+  size_t nvars = nVariables();
+  QF_ASSERT(end - begin == nsamples * nvars, "missing variable values!");
+  for (size_t k = 0; k < nsamples; ++k, begin += nvars)
+    addSample(begin, begin + nvars);
+}
+
 template <typename ITER>
 void StatisticsCalculator<ITER>::reset()
 {
@@ -0,0 +1,304 @@
+/**
+@file  tdigest.hpp
+@brief Mergeable sketch of a distribution, for quantiles and tail expectations in bounded memory
+*/
+
+#ifndef QF_TDIGEST_HPP
+#define QF_TDIGEST_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** The merging t-digest of Dunning and Ertl.
+    The distribution is summarized by weighted centroids, sorted by mean, whose maximum weight
+    follows the scale function k(q) = compression / Z(n) log(q / (1 - q)), with
+    Z(n) = 4 log(n / compression) + 24 (the k2 function of Dunning): a centroid at weight fraction q
+    holds at most a fixed fraction of the weight min(q, 1 - q) beyond it, so that the extreme
+    centroids are singletons and the tail quantiles keep their relative accuracy as n grows.
+    New values are buffered and merged into the centroids when the buffer is full, so that
+    the memory is bounded by a few times the compression, whatever the number of values.
+    The quantile function is the piecewise linear interpolation between the centroid means,
+    placed at the middle of their weight, and the minimum and maximum values.
+    Tail expectations sum the centroids below the cut, plus the part of the centroid straddling it,
+    shaped by the quantile function but scaled to the centroid's own sum.
+    Two digests merge into one summarizing all their values, e.g. the digests of several threads.
+    NaN values are counted apart, see nanWeight(), and left out of the centroids, the total weight,
+    the minimum and the maximum, as the centroids must be ordered by mean.
+*/
+class TDigest
+{
+public:
+
+  /** Ctor; the compression bounds the number of centroids to about its value */
+  explicit TDigest(double compression = 100.0);
+
+  /** Adds a value with weight w; a NaN only adds to nanWeight() */
+  void add(double x, double w = 1.0);
+
+  /** Adds the values summarized by another digest */
+  void merge(TDigest const& other);
+
+  /** Clears all values */
+  void reset();
+
+  /** The total weight of the values added */
+  double totalWeight() const { return totalWeight_; }
+
+  /** The total weight of the NaN values added, which are not in totalWeight() */
+  double nanWeight() const { return nanWeight_; }
+
+  double min() const { return min_; }
+  double max() const { return max_; }
+  double compression() const { return compression_; }
+
+  /** The number of centroids, after merging the buffer */
+  size_t nCentroids();
+
+  /** The quantile at level p in [0, 1] */
+  double quantile(double p);
+
+  /** The mean of the values below the quantile at level p in (0, 1] */
+  double lowerTailMean(double p);
+
+  /** The mean of the values above the quantile at level p in [0, 1) */
+  double upperTailMean(double p);
+
+private:
+
+  struct Centroid
+  {
+    double mean;
+    double weight;
+  };
+
+  // Merges the buffer into the centroids
+  void compress();
+  // The integral of the quantile function over the weights [0, t], t in [0, totalWeight_]
+  double integral(double t) const;
+  // The sum of the values up to weight t, t in [0, totalWeight_], from the centroids
+  double lowerSum(double t) const;
+  // The sum of all the values
+  double totalSum() const;
+  // Walks the interpolation nodes up to weight t; returns the quantile, and the integral up to t in area
+  double interpolate(double t, double* area) const;
+
+  double compression_;
+  size_t bufferSize_;
+  std::vector<Centroid> centroids_;
+  std::vector<Centroid> buffer_;
+  std::vector<Centroid> scratch_;
+  double totalWeight_;
+  double nanWeight_;
+  double min_, max_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+TDigest::TDigest(double compression)
+: compression_(compression), bufferSize_(static_cast<size_t>(5 * compression)),
+  totalWeight_(0.0), nanWeight_(0.0), min_(std::numeric_limits<double>::infinity()), max_(-std::numeric_limits<double>::infinity())
+{
+  QF_ASSERT(compression >= 10.0, "TDigest: the compression must be at least 10!");
+  // reserve for the worst case, so that adding values never allocates
+  size_t maxCentroids = static_cast<size_t>(2 * compression) + 10;
+  centroids_.reserve(maxCentroids);
+  buffer_.reserve(bufferSize_ + maxCentroids);
+  scratch_.reserve(bufferSize_ + maxCentroids);
+}
+
+inline void TDigest::add(double x, double w)
+{
+  if (w <= 0.0)
+    return;
+  if (std::isnan(x)) {
+    nanWeight_ += w;
+    return;
+  }
+  buffer_.push_back(Centroid{ x, w });
+  totalWeight_ += w;
+  min_ = std::min(min_, x);
+  max_ = std::max(max_, x);
+  if (buffer_.size() >= bufferSize_)
+    compress();
+}
+
+inline void TDigest::merge(TDigest const& other)
+{
+  for (Centroid const& c : other.centroids_) {
+    buffer_.push_back(c);
+    if (buffer_.size() >= bufferSize_)
+      compress();
+  }
+  for (Centroid const& c : other.buffer_) {
+    buffer_.push_back(c);
+    if (buffer_.size() >= bufferSize_)
+      compress();
+  }
+  totalWeight_ += other.totalWeight_;
+  nanWeight_ += other.nanWeight_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+inline void TDigest::reset()
+{
+  centroids_.clear();
+  buffer_.clear();
+  totalWeight_ = 0.0;
+  nanWeight_ = 0.0;
+  min_ = std::numeric_limits<double>::infinity();
+  max_ = -std::numeric_limits<double>::infinity();
+}
+
+inline size_t TDigest::nCentroids()
+{
+  compress();
+  return centroids_.size();
+}
+
+inline void TDigest::compress()
+{
+  if (buffer_.empty())
+    return;
+
+  buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+  std::sort(buffer_.begin(), buffer_.end(),
+    [](Centroid const& a, Centroid const& b) { return a.mean < b.mean; });
+
+  // the weight fraction up to which the current centroid may grow, k^-1(k(q0) + 1);
+  // with the k2 scale function the odds q / (1 - q) grow by the factor r = exp(Z(n) / compression)
+  double total = 0.0;
+  for (Centroid const& c : buffer_)
+    total += c.weight;
+  double z = 4.0 * std::log(std::max(total / compression_, 1.0)) + 24.0;
+  double r = std::exp(z / compression_);
+  auto qLimit = [r](double q0) { return q0 * r / (1.0 - q0 + q0 * r); };
+
+  scratch_.clear();
+  Centroid cur = buffer_[0];
+  double wsofar = 0.0;
+  double qlimit = qLimit(0.0);
+  for (size_t i = 1; i < buffer_.size(); ++i) {
+    Centroid const& c = buffer_[i];
+    if ((wsofar + cur.weight + c.weight) / total <= qlimit) {
+      cur.weight += c.weight;
+      cur.mean += (c.mean - cur.mean) * c.weight / cur.weight;
+    }
+    else {
+      wsofar += cur.weight;
+      scratch_.push_back(cur);
+      qlimit = qLimit(wsofar / total);
+      cur = c;
+    }
+  }
+  scratch_.push_back(cur);
+
+  centroids_.swap(scratch_);
+  buffer_.clear();
+}
+
+inline double TDigest::interpolate(double t, double* area) const
+{
+  // the nodes are (0, min), (centre of each centroid, its mean), (total weight, max)
+  double sum = 0.0, t0 = 0.0, x0 = min_, cum = 0.0;
+  size_t n = centroids_.size();
+  for (size_t i = 0; i <= n; ++i) {
+    double t1, x1;
+    if (i < n) {
+      t1 = cum + 0.5 * centroids_[i].weight;
+      x1 = centroids_[i].mean;
+      cum += centroids_[i].weight;
+    }
+    else {
+      t1 = totalWeight_;
+      x1 = max_;
+    }
+    if (t <= t1) {
+      double x = t1 > t0 ? x0 + (x1 - x0) * (t - t0) / (t1 - t0) : x1;
+      if (area)
+        *area = sum + 0.5 * (x0 + x) * (t - t0);
+      return x;
+    }
+    sum += 0.5 * (x0 + x1) * (t1 - t0);
+    t0 = t1;
+    x0 = x1;
+  }
+  if (area)
+    *area = sum;
+  return max_;
+}
+
+inline double TDigest::integral(double t) const
+{
+  double area;
+  interpolate(t, &area);
+  return area;
+}
+
+inline double TDigest::lowerSum(double t) const
+{
+  double sum = 0.0, cum = 0.0;
+  for (Centroid const& c : centroids_) {
+    if (t >= cum + c.weight) {
+      sum += c.weight * c.mean;
+      cum += c.weight;
+      continue;
+    }
+    // the part [cum, t] of the centroid straddling the cut: the integral of the quantile function,
+    // corrected in proportion so that the whole centroid sums to weight * mean
+    double a0 = integral(cum);
+    double whole = integral(cum + c.weight) - a0;
+    sum += integral(t) - a0 + (t - cum) / c.weight * (c.weight * c.mean - whole);
+    break;
+  }
+  return sum;
+}
+
+inline double TDigest::totalSum() const
+{
+  double sum = 0.0;
+  for (Centroid const& c : centroids_)
+    sum += c.weight * c.mean;
+  return sum;
+}
+
+inline double TDigest::quantile(double p)
+{
+  QF_ASSERT(p >= 0.0 && p <= 1.0, "TDigest: the level must be in [0, 1]!");
+  if (totalWeight_ == 0.0)
+    return 0.0;
+  compress();
+  return interpolate(p * totalWeight_, nullptr);
+}
+
+inline double TDigest::lowerTailMean(double p)
+{
+  QF_ASSERT(p > 0.0 && p <= 1.0, "TDigest: the level must be in (0, 1]!");
+  if (totalWeight_ == 0.0)
+    return 0.0;
+  compress();
+  double t = p * totalWeight_;
+  return lowerSum(t) / t;
+}
+
+inline double TDigest::upperTailMean(double p)
+{
+  QF_ASSERT(p >= 0.0 && p < 1.0, "TDigest: the level must be in [0, 1)!");
+  if (totalWeight_ == 0.0)
+    return 0.0;
+  compress();
+  double t = p * totalWeight_;
+  return (totalSum() - lowerSum(t)) / (totalWeight_ - t);
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_TDIGEST_HPP
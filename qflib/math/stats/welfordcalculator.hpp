@@ -0,0 +1,171 @@
+/**
+@file  welfordcalculator.hpp
+@brief Calculates the mean and variance of a set of samples with numerically stable, mergeable updates
+*/
+
+#ifndef QF_WELFORDCALCULATOR_HPP
+#define QF_WELFORDCALCULATOR_HPP
+
+#include <qflib/math/stats/statisticscalculator.hpp>
+#include <qflib/exception.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+/** Mean and variance calculator with the same results as MeanVarCalculator.
+    Instead of raw sums of values and squares, which lose precision when the mean is large
+    compared to the standard deviation, it keeps the running mean and the sum of squared
+    deviations from it, updated with Welford's method for single samples.
+    A block of samples is first reduced on its own, then combined with the running moments
+    with the pairwise formula of Chan, Golub and LeVeque; the same formula merges the moments
+    of another calculator, e.g. one accumulated by another thread or process.
+    ITER must be a random access iterator.
+*/
+template <typename ITER>
+class WelfordCalculator : public StatisticsCalculator < ITER >
+{
+  using StatisticsCalculator<ITER>::nVariables;
+  using StatisticsCalculator<ITER>::nsamples_;
+  using StatisticsCalculator<ITER>::results_;
+
+public:
+
+  WelfordCalculator(size_t nvars);
+
+  virtual ~WelfordCalculator() {}
+
+  virtual void addSample(ITER begin, ITER end) override;
+
+  /** Adds nsamples samples at once, sample k at begin + k * nVariables() */
+  virtual void addSamples(ITER begin, ITER end, size_t nsamples) override;
+
+  /** Adds the samples of another calculator on the same variables, as if they had been added to this one */
+  void merge(WelfordCalculator const& other);
+
+  virtual void reset() override;
+
+  virtual Matrix const & results() override;
+
+protected:
+
+  // Ctor for derived calculators with more results; the mean and variance are the first two rows
+  WelfordCalculator(size_t nvars, size_t nresults);
+
+  // Combines the running moments with nsamples samples of means means and squared deviations m2s
+  void combine(size_t nsamples, Vector const& means, Vector const& m2s);
+
+  // state
+  Vector mean_;       // the running means
+  Vector m2_;         // the running sums of squared deviations from the means
+  Vector blockMean_;  // scratch, the means of a block
+  Vector blockM2_;    // scratch, the sums of squared deviations of a block
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+template <typename ITER>
+WelfordCalculator<ITER>::WelfordCalculator(size_t nvars)
+  : WelfordCalculator<ITER>(nvars, 2)
+{
+}
+
+template <typename ITER>
+WelfordCalculator<ITER>::WelfordCalculator(size_t nvars, size_t nresults)
+  : StatisticsCalculator<ITER>(nvars, nresults), mean_(nvars), m2_(nvars), blockMean_(nvars), blockM2_(nvars)
+{
+  QF_ASSERT(nresults >= 2, "WelfordCalculator: need room for the mean and the variance!");
+  for (size_t j = 0; j < nvars; ++j) {
+    mean_(j) = m2_(j) = 0.0;
+  }
+}
+
+template <typename ITER>
+void WelfordCalculator<ITER>::addSample(ITER begin, ITER end)
+{
+  QF_ASSERT(end - begin == nVariables(), "missing variable values!");
+
+  ++nsamples_;
+  ITER it = begin;
+  for (size_t j = 0; j < nVariables(); ++j, ++it) {
+    double delta = *it - mean_(j);
+    mean_(j) += delta / nsamples_;
+    m2_(j) += delta * (*it - mean_(j));
+  }
+}
+
+template <typename ITER>
+void WelfordCalculator<ITER>::addSamples(ITER begin, ITER end, size_t nsamples)
+{
+  size_t nvars = nVariables();
+  QF_ASSERT(end - begin == nsamples * nvars, "missing variable values!");
+  if (nsamples == 0)
+    return;
+
+  // two passes over the block: its means, then the squared deviations from them
+  for (size_t j = 0; j < nvars; ++j) {
+    blockMean_(j) = blockM2_(j) = 0.0;
+  }
+  ITER it = begin;
+  for (size_t k = 0; k < nsamples; ++k)
+    for (size_t j = 0; j < nvars; ++j, ++it)
+      blockMean_(j) += *it;
+  for (size_t j = 0; j < nvars; ++j)
+    blockMean_(j) /= nsamples;
+  it = begin;
+  for (size_t k = 0; k < nsamples; ++k) {
+    for (size_t j = 0; j < nvars; ++j, ++it) {
+      double delta = *it - blockMean_(j);
+      blockM2_(j) += delta * delta;
+    }
+  }
+
+  combine(nsamples, blockMean_, blockM2_);
+}
+
+template <typename ITER>
+void WelfordCalculator<ITER>::merge(WelfordCalculator const& other)
+{
+  QF_ASSERT(other.nVariables() == nVariables(), "the calculators must track the same number of variables!");
+  combine(other.nsamples_, other.mean_, other.m2_);
+}
+
+template <typename ITER>
+void WelfordCalculator<ITER>::combine(size_t nsamples, Vector const& means, Vector const& m2s)
+{
+  if (nsamples == 0)
+    return;
+  double na = double(nsamples_), nb = double(nsamples), n = na + nb;
+  for (size_t j = 0; j < nVariables(); ++j) {
+    double delta = means(j) - mean_(j);
+    mean_(j) += delta * (nb / n);
+    m2_(j) += m2s(j) + delta * delta * (na * nb / n);
+  }
+  nsamples_ += nsamples;
+}
+
+template <typename ITER>
+Matrix const & WelfordCalculator<ITER>::results()
+{
+  for (size_t j = 0; j < nVariables(); ++j) {
+    results_(0, j) = mean_(j);
+    results_(1, j) = nsamples_ > 1 ? m2_(j) / (nsamples_ - 1) : 0.0;
+  }
+
+  return results_;
+}
+
+template <typename ITER>
+void WelfordCalculator<ITER>::reset()
+{
+  StatisticsCalculator<ITER>::reset();
+  nsamples_ = 0;
+  for (size_t j = 0; j < nVariables(); ++j) {
+    mean_(j) = 0.0;
+    m2_(j) = 0.0;
+  }
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_WELFORDCALCULATOR_HPP
@@ -0,0 +1,108 @@
+/**
+@file  antitheticpathgenerator.hpp
+@brief Path generator returning antithetic pairs of paths
+*/
+
+#ifndef QF_ANTITHETICPATHGENERATOR_HPP
+#define QF_ANTITHETICPATHGENERATOR_HPP
+
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+/** Wraps another path generator and returns its paths in antithetic pairs:
+    path 2k is path k of the underlying generator and path 2k+1 is its negative.
+    Path pairs must not be split, so streams and batch sizes must be even.
+*/
+class AntitheticPathGenerator : public PathGenerator
+{
+public:
+  /** Ctor from the underlying generator */
+  explicit AntitheticPathGenerator(SPtrPathGenerator pathgen);
+
+  /** Returns the next price path */
+  virtual void next(Matrix& pricePath) override;
+
+  /** Returns the next npaths paths, paths innermost; npaths must be even */
+  virtual void nextBatch(size_t npaths, Matrix& pathBatch) override;
+
+  /** Restarts on path pair stream / 2 of the underlying generator; stream must be even */
+  virtual void seed(unsigned long seed, unsigned long stream) override;
+
+  /** Returns a copy of this generator, with its own copy of the underlying generator */
+  virtual std::shared_ptr<PathGenerator> clone() const override;
+
+  /** Returns the correlation matrix of the underlying generator */
+  virtual Matrix correlation() const override;
+
+protected:
+  SPtrPathGenerator pathgen_;   // the underlying generator
+  Matrix lastPath_;             // the first path of the current pair
+  bool pending_;                // whether the negative of lastPath_ is due
+  Matrix halfBatch_;            // scratch block, the first paths of the pairs
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+AntitheticPathGenerator::AntitheticPathGenerator(SPtrPathGenerator pathgen)
+: pathgen_(pathgen), pending_(false)
+{
+  QF_ASSERT(pathgen, "AntitheticPathGenerator: no underlying path generator!");
+  ntimesteps_ = pathgen->nTimeSteps();
+  nfactors_ = pathgen->nFactors();
+  ndraws_ = pathgen->nDraws();
+  explainedVar_ = pathgen->explainedVariance();
+}
+
+inline void AntitheticPathGenerator::next(Matrix& pricePath)
+{
+  if (pending_) {
+    pricePath = -lastPath_;
+    pending_ = false;
+  }
+  else {
+    pathgen_->next(lastPath_);
+    pricePath = lastPath_;
+    pending_ = true;
+  }
+}
+
+inline void AntitheticPathGenerator::nextBatch(size_t npaths, Matrix& pathBatch)
+{
+  QF_ASSERT(!pending_ && npaths % 2 == 0,
+    "AntitheticPathGenerator: a batch must hold whole antithetic pairs!");
+  size_t npairs = npaths / 2;
+  pathgen_->nextBatch(npairs, halfBatch_);
+  pathBatch.set_size(npaths, halfBatch_.n_cols);
+  for (size_t m = 0; m < halfBatch_.n_cols; ++m) {
+    double const* z = halfBatch_.colptr(m);
+    double* zz = pathBatch.colptr(m);
+    for (size_t k = 0; k < npairs; ++k) {
+      zz[2 * k] = z[k];
+      zz[2 * k + 1] = -z[k];
+    }
+  }
+}
+
+inline void AntitheticPathGenerator::seed(unsigned long seed, unsigned long stream)
+{
+  QF_ASSERT(stream % 2 == 0, "AntitheticPathGenerator: the stream must start a path pair!");
+  pathgen_->seed(seed, stream / 2);
+  pending_ = false;
+}
+
+inline std::shared_ptr<PathGenerator> AntitheticPathGenerator::clone() const
+{
+  return std::shared_ptr<PathGenerator>(new AntitheticPathGenerator(pathgen_->clone()));
+}
+
+inline Matrix AntitheticPathGenerator::correlation() const
+{
+  return pathgen_->correlation();
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_ANTITHETICPATHGENERATOR_HPP
@@ -0,0 +1,119 @@
+/**
+@file  brownianbridge.hpp
+@brief Brownian bridge construction of Brownian motion paths
+*/
+
+#ifndef QF_BROWNIANBRIDGE_HPP
+#define QF_BROWNIANBRIDGE_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <cmath>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Builds a Brownian motion path on the times t_1 < ... < t_n from n independent
+    standard normal deviates, in Brownian bridge order: the first deviate sets the terminal
+    value, the next ones fill in the midpoints of the remaining intervals.
+    With low discrepancy numbers, this concentrates the variance of the path in
+    the first dimensions of the sequence.
+*/
+class BrownianBridge
+{
+public:
+  /** Ctor from the path times */
+  template <typename ITER>
+  BrownianBridge(ITER timesBegin, ITER timesEnd);
+
+  /** Returns the number of time steps */
+  size_t size() const;
+
+  /** Converts the deviates z[0], ..., z[n-1] into the standardized increments
+      (W(t_i) - W(t_{i-1})) / sqrt(t_i - t_{i-1}), written at dw[0], dw[stride], ..., dw[(n-1)*stride].
+      The increments are again independent standard normal deviates.
+  */
+  void increments(double const* z, double* dw, size_t stride = 1);
+
+private:
+  std::vector<double> times_, sqrtdt_;
+  std::vector<size_t> bridgeIndex_, leftIndex_, rightIndex_;
+  std::vector<double> leftWeight_, rightWeight_, stdev_;
+  std::vector<double> path_;      // scratch array, the Brownian path
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+template <typename ITER>
+inline BrownianBridge::BrownianBridge(ITER timesBegin, ITER timesEnd)
+: times_(timesBegin, timesEnd)
+{
+  size_t n = times_.size();
+  QF_ASSERT(n > 0, "BrownianBridge: no time steps!");
+  sqrtdt_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    double dt = times_[i] - (i == 0 ? 0.0 : times_[i - 1]);
+    QF_ASSERT(dt > 0.0, "BrownianBridge: time steps are not unique or not in increasing order!");
+    sqrtdt_[i] = std::sqrt(dt);
+  }
+  bridgeIndex_.resize(n);
+  leftIndex_.resize(n);
+  rightIndex_.resize(n);
+  leftWeight_.resize(n);
+  rightWeight_.resize(n);
+  stdev_.resize(n);
+  path_.resize(n);
+
+  // map[i] != 0 once point i is constructed
+  std::vector<size_t> map(n, 0);
+  map[n - 1] = 1;
+  bridgeIndex_[0] = n - 1;
+  stdev_[0] = std::sqrt(times_[n - 1]);
+  leftWeight_[0] = rightWeight_[0] = 0.0;
+  size_t j = 0;
+  for (size_t i = 1; i < n; ++i) {
+    // the next interval [j, k] of unconstructed points, bounded by k
+    while (map[j])
+      ++j;
+    size_t k = j;
+    while (!map[k])
+      ++k;
+    size_t l = j + ((k - 1 - j) >> 1);
+    map[l] = i + 1;
+    bridgeIndex_[i] = l;
+    leftIndex_[i] = j;
+    rightIndex_[i] = k;
+    double tleft = j == 0 ? 0.0 : times_[j - 1];
+    leftWeight_[i] = (times_[k] - times_[l]) / (times_[k] - tleft);
+    rightWeight_[i] = (times_[l] - tleft) / (times_[k] - tleft);
+    stdev_[i] = std::sqrt((times_[l] - tleft) * (times_[k] - times_[l]) / (times_[k] - tleft));
+    j = k + 1;
+    if (j >= n)
+      j = 0;
+  }
+}
+
+inline size_t BrownianBridge::size() const
+{
+  return times_.size();
+}
+
+inline void BrownianBridge::increments(double const* z, double* dw, size_t stride)
+{
+  size_t n = times_.size();
+  path_[n - 1] = stdev_[0] * z[0];
+  for (size_t i = 1; i < n; ++i) {
+    size_t j = leftIndex_[i], k = rightIndex_[i], l = bridgeIndex_[i];
+    double left = j == 0 ? 0.0 : path_[j - 1];
+    path_[l] = leftWeight_[i] * left + rightWeight_[i] * path_[k] + stdev_[i] * z[i];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    double prev = i == 0 ? 0.0 : path_[i - 1];
+    dw[i * stride] = (path_[i] - prev) / sqrtdt_[i];
+  }
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_BROWNIANBRIDGE_HPP
@@ -8,11 +8,19 @@
 
 #include <qflib/methods/montecarlo/pathgenerator.hpp>
 #include <qflib/math/random/rng.hpp>
+#include <algorithm>
+#include <vector>
 
 BEGIN_NAMESPACE(qf)
 
 /** Creates standard normal increments populating the time line sequentially.
+    The deviates of each path are drawn time step by time step, all factors of a step together.
     It is templetized on the underlying normal deviate generator.
+    With a counter-based urng, path n after seed(seed, stream) is drawn from the stream
+    (seed, stream + n), so every path can be regenerated on its own.
+    Streamed paths and blocks are the same paths as next() and nextBatch() return: with a counter-based urng
+    each path draws its deviates lazily from its own stream, so that none are drawn after it is settled;
+    otherwise the paths share one sequence, so all their deviates are drawn up front.
 */
 template <typename NRNG>
 class EulerPathGenerator : public PathGenerator
@@ -20,11 +28,16 @@ class EulerPathGenerator : public PathGenerator
 public:
 
   /** Ctor for generating increments for correlated factors.
-      If the correlation matrix is not passed in, it assumes independent factors
+      If the correlation matrix is not passed in, it assumes independent factors.
+      The normal deviates are generated with the given method.
+      With 0 < ncorrfactors < nfactors, the correlation is simulated with a factor model
+      of ncorrfactors principal components plus an idiosyncratic term per factor.
   */
   template<typename ITER>
   EulerPathGenerator(ITER timestepsBegin, ITER timestepsEnd, size_t nfactors,
-                     Matrix const & correlMat = Matrix());
+                     Matrix const & correlMat = Matrix(),
+                     NormalGenType normalGenType = NormalGenType::STDLIB,
+                     size_t ncorrfactors = 0);
 
   /** Returns the dimension of the generator */
   size_t dim() const;
@@ -32,10 +45,43 @@ public:
   /** Returns the next price path */
   virtual void next(Matrix& pricePath) override;
 
+  /** Returns the next npaths paths, paths innermost */
+  virtual void nextBatch(size_t npaths, Matrix& pathBatch) override;
+
+  /** The deviates are drawn time step by time step, so a path can be streamed */
+  virtual bool canStream() const override;
+
+  /** Starts the next path to be streamed */
+  virtual void beginPath() override;
+
+  /** Draws and correlates the deviates of time step i of the current path */
+  virtual void nextStep(size_t i, double* devs) override;
+
+  /** Starts the next block of paths to be streamed, the same paths as nextBatch() would return */
+  virtual void beginBatch(size_t npaths) override;
+
+  /** Draws and correlates the deviates of time step i of the paths lanes[0], ..., lanes[nlanes - 1] of the block */
+  virtual void nextStepBatch(size_t i, size_t nlanes, size_t const* lanes, double* devs) override;
+
+  /** Restarts the normal generator on the stream (seed, stream) */
+  virtual void seed(unsigned long seed, unsigned long stream) override;
+
+  /** Returns a copy of this generator */
+  virtual std::shared_ptr<PathGenerator> clone() const override;
+
 protected:
+  /** Draws the deviates of the next path into normalDevs_ */
+  void drawPath();
+
   NRNG nrng_;
+  unsigned long seed_;             // the seed and the stream of the next path,
+  unsigned long stream_;           // only used with counter-based urngs
   Vector sqrtDeltaT_;              // sqrt(T1), sqrt(T2-T1), ...
-  Vector normalDevs_;              // scratch array
+  Vector normalDevs_;              // scratch array, the deviates of one path
+  Vector stepDevs_;                // scratch array, the deviates of one time step of a streamed path
+  std::vector<NRNG> laneRngs_;     // with a counter-based urng, the generator of each path of a streamed block
+  Vector laneDraws_;               // otherwise, the deviates of all the paths of a streamed block, one path after the other
+  Vector laneDevs_;                // scratch array, the correlated deviates of one path of a streamed block
 
 };
 
@@ -47,12 +93,17 @@ template <typename ITER>
 inline EulerPathGenerator<NRNG>::EulerPathGenerator(ITER timestepsBegin,
                           ITER timestepsEnd,
                           size_t nfactors,
-                          Matrix const& correlMat)
-  : PathGenerator((timestepsEnd - timestepsBegin), nfactors, correlMat),
-  nrng_((timestepsEnd - timestepsBegin) * nfactors, 0.0, 1.0)
+                          Matrix const& correlMat,
+                          NormalGenType normalGenType,
+                          size_t ncorrfactors)
+  : PathGenerator((timestepsEnd - timestepsBegin), nfactors, correlMat, ncorrfactors),
+  nrng_((timestepsEnd - timestepsBegin) * ndraws_, 0.0, 1.0,
+        typename NRNG::urng_type(), normalGenType),
+  seed_(0), stream_(0)
 {
   QF_ASSERT(ntimesteps_ > 0, "no time steps!");
-  normalDevs_.resize(ntimesteps_);
+  normalDevs_.resize(ntimesteps_ * ndraws_);
+  stepDevs_.resize(ndraws_);
   sqrtDeltaT_.resize(ntimesteps_);
   sqrtDeltaT_[0] = sqrt(*timestepsBegin);
   ITER it = ++timestepsBegin;
@@ -71,27 +122,128 @@ inline size_t EulerPathGenerator<NRNG>::dim() const
 }
 
 template <typename NRNG>
-inline void EulerPathGenerator<NRNG>::next(Matrix& pricePath)
+inline void EulerPathGenerator<NRNG>::seed(unsigned long seed, unsigned long stream)
+{
+  nrng_.seed(seed, stream);
+  seed_ = seed;
+  stream_ = stream;
+}
+
+template <typename NRNG>
+inline std::shared_ptr<PathGenerator> EulerPathGenerator<NRNG>::clone() const
 {
-  pricePath.resize(ntimesteps_, nfactors_);
-  // iterate over columns; the matrix will be filled column by column
-  for (size_t j = 0; j < nfactors_; ++j) {
-    nrng_.next(normalDevs_.begin(), normalDevs_.end());
-    for (size_t i = 0; i < ntimesteps_; ++i)
-      pricePath(i, j) = normalDevs_(i);
+  return std::shared_ptr<PathGenerator>(new EulerPathGenerator<NRNG>(*this));
+}
+
+template <typename NRNG>
+inline void EulerPathGenerator<NRNG>::drawPath()
+{
+  if constexpr (IsCounterBased<typename NRNG::urng_type>::value)
+    nrng_.seed(seed_, stream_++);
+  nrng_.next(normalDevs_.begin(), normalDevs_.end());
+}
+
+template <typename NRNG>
+inline bool EulerPathGenerator<NRNG>::canStream() const
+{
+  return true;
+}
+
+template <typename NRNG>
+inline void EulerPathGenerator<NRNG>::beginPath()
+{
+  // without its own stream, a path that stops early would shift the next ones, so it is drawn whole
+  if constexpr (IsCounterBased<typename NRNG::urng_type>::value)
+    nrng_.seed(seed_, stream_++);
+  else
+    drawPath();
+}
+
+template <typename NRNG>
+inline void EulerPathGenerator<NRNG>::nextStep(size_t i, double* devs)
+{
+  // the deviates of the steps continue the sequence, so they are the ones drawPath() would draw
+  if constexpr (IsCounterBased<typename NRNG::urng_type>::value) {
+    nrng_.next(stepDevs_.begin(), stepDevs_.end());
+    correlateStep(stepDevs_.memptr(), devs);
   }
-  // finally apply the Cholesky factor if not empty
-  if (sqrtCorrel_.n_rows != 0) {
-    for (size_t i = 0; i < ntimesteps_; ++i) {
-      for (size_t j = 0; j < nfactors_; ++j) {
-        double sum = 0.0;
-        for (size_t k = 0; k < nfactors_; ++k) {
-          sum += sqrtCorrel_(nfactors_ - j - 1, k) * pricePath(i, k);
-        }
-        pricePath(i, nfactors_ - j - 1) = sum;
-      }
+  else
+    correlateStep(normalDevs_.memptr() + i * ndraws_, devs);
+}
+
+template <typename NRNG>
+inline void EulerPathGenerator<NRNG>::beginBatch(size_t npaths)
+{
+  if constexpr (IsCounterBased<typename NRNG::urng_type>::value) {
+    // each path of the block draws from its own stream, as in drawPath()
+    if (laneRngs_.size() < npaths)
+      laneRngs_.resize(npaths, nrng_);
+    for (size_t p = 0; p < npaths; ++p)
+      laneRngs_[p].seed(seed_, stream_++);
+  }
+  else {
+    // the paths follow each other in one sequence, so they are all drawn now
+    size_t pathDraws = ntimesteps_ * ndraws_;
+    if (laneDraws_.size() < npaths * pathDraws)
+      laneDraws_.set_size(npaths * pathDraws);
+    for (size_t p = 0; p < npaths; ++p) {
+      drawPath();
+      std::copy(normalDevs_.begin(), normalDevs_.end(), laneDraws_.begin() + p * pathDraws);
+    }
+  }
+  laneDevs_.set_size(nfactors_);
+}
+
+template <typename NRNG>
+inline void EulerPathGenerator<NRNG>::nextStepBatch(size_t i, size_t nlanes, size_t const* lanes, double* devs)
+{
+  for (size_t k = 0; k < nlanes; ++k) {
+    double const* draws;
+    if constexpr (IsCounterBased<typename NRNG::urng_type>::value) {
+      QF_ASSERT(lanes[k] < laneRngs_.size(), "nextStepBatch: the lane is not a path of the block!");
+      laneRngs_[lanes[k]].next(stepDevs_.begin(), stepDevs_.end());
+      draws = stepDevs_.memptr();
+    }
+    else {
+      QF_ASSERT((lanes[k] + 1) * ntimesteps_ * ndraws_ <= laneDraws_.size(),
+        "nextStepBatch: the lane is not a path of the block!");
+      draws = laneDraws_.memptr() + (lanes[k] * ntimesteps_ + i) * ndraws_;
     }
+    if (ndraws_ == 1 && nfactors_ == 1) {
+      devs[k] = draws[0];
+      continue;
+    }
+    correlateStep(draws, laneDevs_.memptr());
+    for (size_t j = 0; j < nfactors_; ++j)
+      devs[j * nlanes + k] = laneDevs_[j];
+  }
+}
+
+template <typename NRNG>
+inline void EulerPathGenerator<NRNG>::next(Matrix& pricePath)
+{
+  pricePath.set_size(ntimesteps_, ndraws_);
+  // the deviates are drawn time step by time step
+  drawPath();
+  for (size_t i = 0; i < ntimesteps_; ++i)
+    for (size_t j = 0; j < ndraws_; ++j)
+      pricePath(i, j) = normalDevs_(i * ndraws_ + j);
+  // finally apply the correlation, if any
+  correlatePath(pricePath);
+}
+
+template <typename NRNG>
+inline void EulerPathGenerator<NRNG>::nextBatch(size_t npaths, Matrix& pathBatch)
+{
+  Matrix& draws = drawBatch(npaths, pathBatch);
+  // draw each path in the same order as next() and scatter it into the block
+  for (size_t p = 0; p < npaths; ++p) {
+    drawPath();
+    for (size_t j = 0; j < ndraws_; ++j)
+      for (size_t i = 0; i < ntimesteps_; ++i)
+        draws(p, j * ntimesteps_ + i) = normalDevs_(i * ndraws_ + j);
   }
+  correlateBatch(npaths, pathBatch);
 }
 
 END_NAMESPACE(qf)
@@ -0,0 +1,230 @@
+/**
+@file  hestonpathgenerator.hpp
+@brief Path generator of the Heston stochastic volatility model with Andersen's QE scheme
+*/
+
+#ifndef QF_HESTONPATHGENERATOR_HPP
+#define QF_HESTONPATHGENERATOR_HPP
+
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <cmath>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** The parameters of the Heston model, dS/S = (r - q) dt + sqrt(V) dW_S,
+    dV = kappa (theta - V) dt + xi sqrt(V) dW_V, with d<W_S, W_V> = rho dt
+*/
+struct HestonParams
+{
+  double v0;      // the initial variance
+  double kappa;   // the speed of mean reversion of the variance
+  double theta;   // the long-term variance
+  double xi;      // the volatility of the variance
+  double rho;     // the correlation of the asset and the variance
+};
+
+/** Generates price paths of the asset in the Heston model with the Quadratic-Exponential scheme
+    of Andersen (2008), with the central discretization of the integrated variance and the martingale correction.
+    The variance is sampled from a moment-matched squared normal when its distribution is far from zero,
+    and from a mixture of a mass at zero and an exponential otherwise, so the steps may be much longer
+    than with an Euler scheme on the variance.
+    The correction exists where 2 A a < 1 (quadratic) or A < beta (exponential), always for rho <= 0;
+    elsewhere the step keeps the uncorrected drift, and the discounted spot is a martingale only approximately.
+    It wraps the generator of the independent normal deviates, two factors over the simulation times:
+    factor 0 drives the asset and factor 1 the variance, whose uniform draws are taken as N(z).
+    Euler, Sobol and antithetic generators can all be wrapped. The paths are built a block at a time,
+    each step in loops over the paths of the block.
+    Its paths are spots, one factor at the fixing times, a subset of the simulation times.
+*/
+class HestonPathGenerator : public PathGenerator
+{
+public:
+  /** Ctor from the generator of the independent deviates, the simulation times, the index in them of each
+      fixing time, the model parameters, the initial spot and the log drift (r - q) dt of each simulation step
+  */
+  HestonPathGenerator(SPtrPathGenerator devgen,
+                      Vector const& simTimes,
+                      std::vector<size_t> const& fixSteps,
+                      HestonParams const& params,
+                      double spot,
+                      Vector const& logDrifts);
+
+  /** Returns the next price path, the spot at each fixing time */
+  virtual void next(Matrix& pricePath) override;
+
+  /** Returns the next npaths price paths, paths innermost */
+  virtual void nextBatch(size_t npaths, Matrix& pathBatch) override;
+
+  /** Restarts the underlying generator on the stream (seed, stream) */
+  virtual void seed(unsigned long seed, unsigned long stream) override;
+
+  /** Returns a copy of this generator, with its own copy of the underlying generator */
+  virtual std::shared_ptr<PathGenerator> clone() const override;
+
+protected:
+  SPtrPathGenerator devgen_;        // the generator of the independent deviates
+  std::vector<size_t> fixSteps_;    // the simulation step of each fixing time
+  HestonParams params_;
+  double logSpot_;                  // the log of the initial spot
+  Vector logDrifts_;                // (r - q) dt of each simulation step
+  // the constants of each simulation step
+  Vector expKappaDt_;               // exp(-kappa dt)
+  Vector c1_, c2_;                  // the conditional variance of V is c1 V + c2
+  Vector k1_, k2_, k3_, k4_;        // the coefficients of V(t) and V(t + dt) in the log spot step
+  Vector k0_;                       // the log spot step constant without martingale correction
+  // scratch
+  Matrix devBatch_;                 // the deviates of a block
+  std::vector<double> logSpots_;    // the log spots of the paths of the block
+  std::vector<double> vars_;        // the variances of the paths of the block
+  Matrix onePath_;                  // one path, for next()
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+HestonPathGenerator::HestonPathGenerator(SPtrPathGenerator devgen,
+                                         Vector const& simTimes,
+                                         std::vector<size_t> const& fixSteps,
+                                         HestonParams const& params,
+                                         double spot,
+                                         Vector const& logDrifts)
+: devgen_(devgen), fixSteps_(fixSteps), params_(params), logSpot_(std::log(spot)), logDrifts_(logDrifts)
+{
+  QF_ASSERT(devgen, "HestonPathGenerator: no generator of deviates!");
+  size_t nsteps = simTimes.size();
+  QF_ASSERT(devgen->nTimeSteps() == nsteps && devgen->nFactors() == 2,
+    "HestonPathGenerator: need two factors of deviates over the simulation times!");
+  QF_ASSERT(logDrifts.size() == nsteps, "HestonPathGenerator: need one log drift per simulation step!");
+  QF_ASSERT(!fixSteps.empty(), "HestonPathGenerator: no fixing times!");
+  for (size_t k = 0; k < fixSteps.size(); ++k)
+    QF_ASSERT(fixSteps[k] < nsteps && (k == 0 || fixSteps[k] > fixSteps[k - 1]),
+      "HestonPathGenerator: the fixing steps must be increasing simulation steps!");
+  QF_ASSERT(spot > 0.0, "HestonPathGenerator: the spot must be positive!");
+  QF_ASSERT(params.v0 >= 0.0, "HestonPathGenerator: the initial variance must be non-negative!");
+  QF_ASSERT(params.kappa > 0.0, "HestonPathGenerator: the mean reversion speed must be positive!");
+  QF_ASSERT(params.theta > 0.0, "HestonPathGenerator: the long-term variance must be positive!");
+  QF_ASSERT(params.xi > 0.0, "HestonPathGenerator: the volatility of the variance must be positive!");
+  QF_ASSERT(params.rho >= -1.0 && params.rho <= 1.0, "HestonPathGenerator: the correlation must be in [-1, 1]!");
+
+  ntimesteps_ = fixSteps.size();
+  nfactors_ = 1;
+  ndraws_ = 2;
+
+  // with gamma1 = gamma2 = 1/2 in the integrated variance, Andersen (2008), eq. (33)
+  double kappa = params.kappa, theta = params.theta, xi = params.xi, rho = params.rho;
+  expKappaDt_.resize(nsteps);
+  c1_.resize(nsteps);
+  c2_.resize(nsteps);
+  k0_.resize(nsteps);
+  k1_.resize(nsteps);
+  k2_.resize(nsteps);
+  k3_.resize(nsteps);
+  k4_.resize(nsteps);
+  double t1 = 0.0;
+  for (size_t i = 0; i < nsteps; ++i) {
+    double dt = simTimes[i] - t1;
+    QF_ASSERT(dt > 0.0, "HestonPathGenerator: the simulation times must be positive and increasing!");
+    double e = std::exp(-kappa * dt);
+    expKappaDt_[i] = e;
+    c1_[i] = xi * xi * e * (1.0 - e) / kappa;
+    c2_[i] = theta * xi * xi * (1.0 - e) * (1.0 - e) / (2.0 * kappa);
+    k0_[i] = -rho * kappa * theta * dt / xi;
+    k1_[i] = 0.5 * dt * (kappa * rho / xi - 0.5) - rho / xi;
+    k2_[i] = 0.5 * dt * (kappa * rho / xi - 0.5) + rho / xi;
+    k3_[i] = 0.5 * dt * (1.0 - rho * rho);
+    k4_[i] = k3_[i];
+    t1 = simTimes[i];
+  }
+}
+
+inline void HestonPathGenerator::next(Matrix& pricePath)
+{
+  nextBatch(1, onePath_);
+  pricePath.set_size(ntimesteps_, 1);
+  for (size_t k = 0; k < ntimesteps_; ++k)
+    pricePath(k, 0) = onePath_(0, k);
+}
+
+inline void HestonPathGenerator::nextBatch(size_t npaths, Matrix& pathBatch)
+{
+  devgen_->nextBatch(npaths, devBatch_);
+  pathBatch.set_size(npaths, ntimesteps_);
+  if (logSpots_.size() < npaths) {
+    logSpots_.resize(npaths);
+    vars_.resize(npaths);
+  }
+  double* x = logSpots_.data();
+  double* v = vars_.data();
+  for (size_t p = 0; p < npaths; ++p) {
+    x[p] = logSpot_;
+    v[p] = params_.v0;
+  }
+
+  double const theta = params_.theta;
+  double const psiCrit = 1.5;           // the switching rule of the variance scheme
+  size_t nsteps = logDrifts_.size();
+  size_t k = 0;                         // the next fixing
+  for (size_t i = 0; i < nsteps; ++i) {
+    double const* zx = devBatch_.colptr(i);
+    double const* zv = devBatch_.colptr(nsteps + i);
+    double e = expKappaDt_[i], c1 = c1_[i], c2 = c2_[i];
+    double k1 = k1_[i], k2 = k2_[i], k3 = k3_[i], k4 = k4_[i];
+    double drift = logDrifts_[i];
+    // the martingale correction makes E[exp(k2 V(t + dt) + k4 V(t + dt) / 2)] explicit
+    double A = k2 + 0.5 * k4;
+    for (size_t p = 0; p < npaths; ++p) {
+      double v0 = v[p];
+      double m = theta + (v0 - theta) * e;
+      double s2 = v0 * c1 + c2;
+      double psi = s2 / (m * m);
+      double v1, k0;
+      if (psi <= psiCrit) {
+        // quadratic: V(t + dt) = a (b + z)^2
+        double t = 2.0 / psi;
+        double b2 = t - 1.0 + std::sqrt(t * (t - 1.0));
+        double a = m / (1.0 + b2);
+        double b = std::sqrt(b2);
+        v1 = a * (b + zv[p]) * (b + zv[p]);
+        k0 = 2.0 * A * a < 1.0
+          ? -A * b2 * a / (1.0 - 2.0 * A * a) + 0.5 * std::log(1.0 - 2.0 * A * a) - (k1 + 0.5 * k3) * v0
+          : k0_[i];
+      }
+      else {
+        // exponential: V(t + dt) = 0 with probability pz, else exponential with rate beta;
+        // 1 - u = N(-z) directly, so that it does not round to zero
+        double pz = (psi - 1.0) / (psi + 1.0);
+        double beta = (1.0 - pz) / m;
+        double oneMinusU = 0.5 * std::erfc(zv[p] * M_SQRT1_2);
+        v1 = oneMinusU >= 1.0 - pz ? 0.0 : std::log((1.0 - pz) / oneMinusU) / beta;
+        k0 = A < beta
+          ? -std::log(pz + beta * (1.0 - pz) / (beta - A)) - (k1 + 0.5 * k3) * v0
+          : k0_[i];
+      }
+      x[p] += drift + k0 + k1 * v0 + k2 * v1 + std::sqrt(k3 * v0 + k4 * v1) * zx[p];
+      v[p] = v1;
+    }
+    if (k < ntimesteps_ && fixSteps_[k] == i) {
+      double* spots = pathBatch.colptr(k++);
+      for (size_t p = 0; p < npaths; ++p)
+        spots[p] = std::exp(x[p]);
+    }
+  }
+}
+
+inline void HestonPathGenerator::seed(unsigned long seed, unsigned long stream)
+{
+  devgen_->seed(seed, stream);
+}
+
+inline std::shared_ptr<PathGenerator> HestonPathGenerator::clone() const
+{
+  HestonPathGenerator* pathgen = new HestonPathGenerator(*this);
+  pathgen->devgen_ = devgen_->clone();
+  return std::shared_ptr<PathGenerator>(pathgen);
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_HESTONPATHGENERATOR_HPP
@@ -0,0 +1,190 @@
+/**
+@file  localvolpathgenerator.hpp
+@brief Path generator of the local volatility model on a precomputed grid of local vols
+*/
+
+#ifndef QF_LOCALVOLPATHGENERATOR_HPP
+#define QF_LOCALVOLPATHGENERATOR_HPP
+
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <qflib/market/localvolsurface.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Generates price paths of the asset in the local volatility model dS/S = (r - q) dt + sigma(t, S) dW,
+    with log-Euler steps x += (r - q) dt - s^2 / 2 + s z, s = sigma(t, S) sqrt(dt) frozen at the start of the step,
+    so that the discounted spot is a martingale at any step size.
+    The local vol surface is resampled once, in the ctor, onto the simulation steps and a uniform grid of log spots
+    centred on the log forward at the mid-point time of each step, spanning nStdDevs standard deviations at the largest implied vol
+    of the surface over the last simulation time. Each step of a path then costs one lookup and one linear interpolation
+    in the table, instead of a two-dimensional interpolation of the surface; beyond the grid the local vol is flat.
+    Each step samples the surface at its mid-point time, which avoids the singularity of Dupire's formula at t = 0,
+    and at the log-moneyness log(S / F(tmid)) against the forward at that same time; the forward rate is taken
+    constant over the step.
+    It wraps the generator of the independent normal deviates, one factor over the simulation times:
+    Euler, Sobol and antithetic generators can all be wrapped. The paths are built a block at a time,
+    each step in loops over the paths of the block.
+    Its paths are spots, one factor at the fixing times, a subset of the simulation times.
+*/
+class LocalVolPathGenerator : public PathGenerator
+{
+public:
+  /** Ctor from the generator of the independent deviates, the simulation times, the index in them of each
+      fixing time, the local vol surface, the initial spot, the log drift (r - q) dt of each simulation step,
+      and the size and the width in standard deviations of the grid of log spots
+  */
+  LocalVolPathGenerator(SPtrPathGenerator devgen,
+                        Vector const& simTimes,
+                        std::vector<size_t> const& fixSteps,
+                        SPtrLocalVolSurface surface,
+                        double spot,
+                        Vector const& logDrifts,
+                        size_t nGridPoints = 401,
+                        double nStdDevs = 5.0);
+
+  /** Returns the next price path, the spot at each fixing time */
+  virtual void next(Matrix& pricePath) override;
+
+  /** Returns the next npaths price paths, paths innermost */
+  virtual void nextBatch(size_t npaths, Matrix& pathBatch) override;
+
+  /** Restarts the underlying generator on the stream (seed, stream) */
+  virtual void seed(unsigned long seed, unsigned long stream) override;
+
+  /** Returns a copy of this generator, with its own copy of the underlying generator */
+  virtual std::shared_ptr<PathGenerator> clone() const override;
+
+protected:
+  SPtrPathGenerator devgen_;        // the generator of the independent deviates
+  std::vector<size_t> fixSteps_;    // the simulation step of each fixing time
+  double logSpot_;                  // the log of the initial spot
+  Vector logDrifts_;                // (r - q) dt of each simulation step
+  // the grid of each simulation step
+  Vector gridStart_;                // the lowest log spot of the grid, log F(tmid) - halfwidth
+  double invDx_;                    // the inverse of the grid spacing
+  Matrix stdevs_;                   // sigma(t, S) sqrt(dt) at each grid point, one column per simulation step
+  // scratch
+  Matrix devBatch_;                 // the deviates of a block
+  std::vector<double> logSpots_;    // the log spots of the paths of the block
+  Matrix onePath_;                  // one path, for next()
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+LocalVolPathGenerator::LocalVolPathGenerator(SPtrPathGenerator devgen,
+                                             Vector const& simTimes,
+                                             std::vector<size_t> const& fixSteps,
+                                             SPtrLocalVolSurface surface,
+                                             double spot,
+                                             Vector const& logDrifts,
+                                             size_t nGridPoints,
+                                             double nStdDevs)
+: devgen_(devgen), fixSteps_(fixSteps), logSpot_(std::log(spot)), logDrifts_(logDrifts)
+{
+  QF_ASSERT(devgen, "LocalVolPathGenerator: no generator of deviates!");
+  QF_ASSERT(surface, "LocalVolPathGenerator: no local vol surface!");
+  size_t nsteps = simTimes.size();
+  QF_ASSERT(devgen->nTimeSteps() == nsteps && devgen->nFactors() == 1,
+    "LocalVolPathGenerator: need one factor of deviates over the simulation times!");
+  QF_ASSERT(logDrifts.size() == nsteps, "LocalVolPathGenerator: need one log drift per simulation step!");
+  QF_ASSERT(!fixSteps.empty(), "LocalVolPathGenerator: no fixing times!");
+  for (size_t k = 0; k < fixSteps.size(); ++k)
+    QF_ASSERT(fixSteps[k] < nsteps && (k == 0 || fixSteps[k] > fixSteps[k - 1]),
+      "LocalVolPathGenerator: the fixing steps must be increasing simulation steps!");
+  QF_ASSERT(spot > 0.0, "LocalVolPathGenerator: the spot must be positive!");
+  QF_ASSERT(nGridPoints > 1, "LocalVolPathGenerator: need at least two grid points!");
+  QF_ASSERT(nStdDevs > 0.0, "LocalVolPathGenerator: the grid width must be positive!");
+
+  ntimesteps_ = fixSteps.size();
+  nfactors_ = 1;
+  ndraws_ = 1;
+
+  // the grid of log-moneyness log(S / F(t)), the same for all steps
+  double halfwidth = nStdDevs * surface->maxImpliedVol() * std::sqrt(simTimes[nsteps - 1]);
+  double dx = 2.0 * halfwidth / (nGridPoints - 1);
+  invDx_ = 1.0 / dx;
+
+  // resample the local vols, at the mid-point time tmid of each step and the log-moneyness log(S / F(tmid))
+  // of each grid point
+  gridStart_.resize(nsteps);
+  stdevs_.set_size(nGridPoints, nsteps);
+  double t1 = 0.0;
+  double logfwd = logSpot_;
+  for (size_t i = 0; i < nsteps; ++i) {
+    double t2 = simTimes[i];
+    double dt = t2 - t1;
+    QF_ASSERT(dt > 0.0, "LocalVolPathGenerator: the simulation times must be positive and increasing!");
+    double sqrtdt = std::sqrt(dt);
+    double tmid = t1 + 0.5 * dt;
+    gridStart_[i] = logfwd + 0.5 * logDrifts_[i] - halfwidth;
+    double* sdevs = stdevs_.colptr(i);
+    for (size_t k = 0; k < nGridPoints; ++k)
+      sdevs[k] = surface->localVol(tmid, -halfwidth + k * dx) * sqrtdt;
+    logfwd += logDrifts_[i];
+    t1 = t2;
+  }
+}
+
+inline void LocalVolPathGenerator::next(Matrix& pricePath)
+{
+  nextBatch(1, onePath_);
+  pricePath.set_size(ntimesteps_, 1);
+  for (size_t k = 0; k < ntimesteps_; ++k)
+    pricePath(k, 0) = onePath_(0, k);
+}
+
+inline void LocalVolPathGenerator::nextBatch(size_t npaths, Matrix& pathBatch)
+{
+  devgen_->nextBatch(npaths, devBatch_);
+  pathBatch.set_size(npaths, ntimesteps_);
+  if (logSpots_.size() < npaths)
+    logSpots_.resize(npaths);
+  double* x = logSpots_.data();
+  for (size_t p = 0; p < npaths; ++p)
+    x[p] = logSpot_;
+
+  size_t nsteps = logDrifts_.size();
+  double const umax = double(stdevs_.n_rows - 1);
+  size_t const kmax = stdevs_.n_rows - 2;
+  size_t k = 0;                         // the next fixing
+  for (size_t i = 0; i < nsteps; ++i) {
+    double const* z = devBatch_.colptr(i);
+    double const* sdevs = stdevs_.colptr(i);
+    double x0 = gridStart_[i];
+    double drift = logDrifts_[i];
+    for (size_t p = 0; p < npaths; ++p) {
+      // one lookup and one linear interpolation in the grid of the step, flat beyond it
+      double u = std::min(std::max((x[p] - x0) * invDx_, 0.0), umax);
+      size_t j = std::min(size_t(u), kmax);
+      double f = u - j;
+      double s = sdevs[j] + f * (sdevs[j + 1] - sdevs[j]);
+      x[p] += drift - 0.5 * s * s + s * z[p];
+    }
+    if (k < ntimesteps_ && fixSteps_[k] == i) {
+      double* spots = pathBatch.colptr(k++);
+      for (size_t p = 0; p < npaths; ++p)
+        spots[p] = std::exp(x[p]);
+    }
+  }
+}
+
+inline void LocalVolPathGenerator::seed(unsigned long seed, unsigned long stream)
+{
+  devgen_->seed(seed, stream);
+}
+
+inline std::shared_ptr<PathGenerator> LocalVolPathGenerator::clone() const
+{
+  LocalVolPathGenerator* pathgen = new LocalVolPathGenerator(*this);
+  pathgen->devgen_ = devgen_->clone();
+  return std::shared_ptr<PathGenerator>(pathgen);
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_LOCALVOLPATHGENERATOR_HPP
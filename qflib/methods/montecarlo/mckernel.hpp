@@ -0,0 +1,273 @@
+/**
+@file  mckernel.hpp
+@brief Fused Monte Carlo pricing kernels: random numbers, path scheme, payoff and discounting in one loop
+*/
+
+#ifndef QF_MCKERNEL_HPP
+#define QF_MCKERNEL_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <qflib/sptr.hpp>
+#include <qflib/math/matrix.hpp>
+#include <qflib/math/linalg/linalg.hpp>
+#include <qflib/math/random/rng.hpp>
+#include <qflib/math/stats/normalinvcdf.hpp>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** The type-erased interface of the fused kernels, one virtual call per block of paths.
+    It stands in for a path generator and a product in the pricers' hot loop.
+*/
+class McKernelBase
+{
+public:
+  /** Dtor */
+  virtual ~McKernelBase() {}
+
+  /** Restarts the random numbers on the stream (seed, stream), as PathGenerator::seed */
+  virtual void seed(unsigned long seed, unsigned long stream) = 0;
+
+  /** Simulates the next npaths paths and writes the PV of the product on path p into pvs[p * stride] */
+  virtual void run(size_t npaths, double* pvs, size_t stride) = 0;
+
+  /** Returns a copy of this kernel, e.g. one for each worker thread */
+  virtual std::shared_ptr<McKernelBase> clone() const = 0;
+};
+
+using SPtrMcKernel = std::shared_ptr<McKernelBase>;
+
+/** The path scheme of the fused kernels in the multiasset Black-Scholes model: log-Euler steps,
+    exact for deterministic rates and vols, S_ij = S_i-1,j exp(drift_ij + stdev_ij eps_ij),
+    with eps_i = L z_i for L the Cholesky factor of the correlation matrix.
+    A path scheme works on blocks stored with the paths innermost: it sets the spots of the
+    block at time 0, then moves them one step at a time given the independent deviates of the step.
+    The blocks are of type REAL, double or float; the drifts, standard deviations and correlations
+    are rounded to REAL once per step, so that with float the loops over the paths stay in float.
+*/
+class LogEulerScheme
+{
+public:
+  /** Ctor from the initial spots, the drifts and standard deviations of each step, one column per asset,
+      and the correlation matrix, which is spectrally truncated as in PathGenerator; empty for independent assets
+  */
+  LogEulerScheme(Vector const& spots, Matrix const& drifts, Matrix const& stdevs,
+                 Matrix const& correlMatrix = Matrix());
+
+  /** The number of assets, i.e. of deviates per step */
+  size_t nAssets() const;
+
+  /** The number of time steps */
+  size_t nSteps() const;
+
+  /** Sets the spots of npaths paths to their initial values; spots[j * npaths + p] is asset j of path p */
+  template <typename REAL>
+  void begin(size_t npaths, REAL* spots) const;
+
+  /** Correlates the deviates of step i in place, devs[j * npaths + p], and moves the spots to step i */
+  template <typename REAL>
+  void step(size_t i, size_t npaths, REAL* devs, REAL* spots) const;
+
+private:
+  Vector spots_;          // the initial spots
+  Matrix drifts_;         // the drift of each step, one column per asset
+  Matrix stdevs_;         // the standard deviation of each step, one column per asset
+  Matrix sqrtCorrel_;     // the Cholesky factor of the correlation matrix, empty without correlation
+};
+
+/** The fused pricing kernel of a product with a single payment, templatized on the normal rng,
+    the path scheme and the payoff, so that the compiler sees and inlines the whole path.
+    In double, it draws the deviates of each path exactly as EulerPathGenerator<NRNG> does, so the paths
+    are the same as the generic pricers', to rounding, and it then evolves the whole block
+    one step at a time, calling PAYOFF::fix on the spots of each step, in loops over the paths
+    that the compiler can vectorize. No path is ever stored, and there are no virtual calls per path.
+    PAYOFF must provide the type real_type of the spots it fixes, double or float, begin(npaths),
+    fix(i, npaths, spots) and payoffs(npaths, discount, pvs, stride), see e.g. EuropeanKernelPayoff.
+    The block of deviates and spots is of type PAYOFF::real_type. With float, the deviates are drawn
+    in float instead: one 23-bit uniform per deviate from the same stream, see NormalRng::nextUniformFloat,
+    inverted over the whole block by normalInvCdfPPND7, whatever the NormalGenType. With an urng of 32 bits
+    or more, that uniform is the top 23 bits of the same single draw NormalRng::nextUniform takes, so the float
+    paths are those of double with NormalGenType::INVCDF, to float rounding, and other paths than with STDLIB;
+    a narrower urng, e.g. minstd_rand, takes two draws per double uniform and one per float uniform.
+    The discounting and the PVs are in double.
+*/
+template <typename NRNG, typename SCHEME, typename PAYOFF>
+class McKernel : public McKernelBase
+{
+public:
+  /** Ctor from the path scheme, the payoff and the discount factor of the payment */
+  McKernel(SCHEME const& scheme, PAYOFF const& payoff, double discount,
+           NormalGenType normalGenType = NormalGenType::STDLIB);
+
+  /** Restarts the normal generator on the stream (seed, stream) */
+  virtual void seed(unsigned long seed, unsigned long stream) override;
+
+  /** Simulates and prices the next npaths paths */
+  virtual void run(size_t npaths, double* pvs, size_t stride) override;
+
+  /** Returns a copy of this kernel */
+  virtual std::shared_ptr<McKernelBase> clone() const override;
+
+private:
+  using real_type = typename PAYOFF::real_type;
+
+  NRNG nrng_;
+  unsigned long seed_;             // the seed and the stream of the next path,
+  unsigned long stream_;           // only used with counter-based urngs
+  SCHEME scheme_;
+  PAYOFF payoff_;
+  double discount_;                // the discount factor of the payment
+  std::vector<double> pathDevs_;   // scratch, the deviates of one path, time steps outermost
+  std::vector<real_type> devs_;    // scratch, the deviates of the block, time steps then assets, paths innermost
+  std::vector<real_type> spots_;   // scratch, the current spots of the block, paths innermost
+  std::vector<float> unifs_;       // scratch, with float the uniforms of the block, laid out as devs_
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+LogEulerScheme::LogEulerScheme(Vector const& spots, Matrix const& drifts, Matrix const& stdevs,
+                               Matrix const& correlMatrix)
+: spots_(spots), drifts_(drifts), stdevs_(stdevs)
+{
+  QF_ASSERT(drifts.n_cols == spots.size() && stdevs.n_cols == spots.size(),
+    "LogEulerScheme: need one column of drifts and standard deviations per asset!");
+  QF_ASSERT(drifts.n_rows == stdevs.n_rows, "LogEulerScheme: need as many drifts as standard deviations!");
+  if (!correlMatrix.is_empty()) {
+    QF_ASSERT(correlMatrix.n_rows == spots.size(), "LogEulerScheme: need one correlation matrix row per asset!");
+    Matrix fixedCorrel = correlMatrix;
+    spectrunc(fixedCorrel);
+    choldcmp(fixedCorrel, sqrtCorrel_);
+  }
+}
+
+inline size_t LogEulerScheme::nAssets() const
+{
+  return spots_.size();
+}
+
+inline size_t LogEulerScheme::nSteps() const
+{
+  return drifts_.n_rows;
+}
+
+template <typename REAL>
+inline void LogEulerScheme::begin(size_t npaths, REAL* spots) const
+{
+  for (size_t j = 0; j < spots_.size(); ++j) {
+    REAL spot = REAL(spots_[j]);
+    REAL* s = spots + j * npaths;
+    for (size_t p = 0; p < npaths; ++p)
+      s[p] = spot;
+  }
+}
+
+template <typename REAL>
+inline void LogEulerScheme::step(size_t i, size_t npaths, REAL* devs, REAL* spots) const
+{
+  size_t nassets = spots_.size();
+  // eps_j = sum_k<=j L_jk z_k, in place from the last asset down, as it only reads the assets before it
+  if (sqrtCorrel_.n_rows > 0) {
+    for (size_t j = nassets; j-- > 0; ) {
+      REAL* z = devs + j * npaths;
+      REAL ljj = REAL(sqrtCorrel_(j, j));
+      for (size_t p = 0; p < npaths; ++p)
+        z[p] *= ljj;
+      for (size_t k = 0; k < j; ++k) {
+        REAL ljk = REAL(sqrtCorrel_(j, k));
+        REAL const* zk = devs + k * npaths;
+        for (size_t p = 0; p < npaths; ++p)
+          z[p] += ljk * zk[p];
+      }
+    }
+  }
+  for (size_t j = 0; j < nassets; ++j) {
+    REAL drift = REAL(drifts_(i, j));
+    REAL stdev = REAL(stdevs_(i, j));
+    REAL const* z = devs + j * npaths;
+    REAL* s = spots + j * npaths;
+    for (size_t p = 0; p < npaths; ++p)
+      s[p] *= std::exp(drift + stdev * z[p]);
+  }
+}
+
+template <typename NRNG, typename SCHEME, typename PAYOFF>
+inline McKernel<NRNG, SCHEME, PAYOFF>::McKernel(SCHEME const& scheme, PAYOFF const& payoff, double discount,
+                                                NormalGenType normalGenType)
+: nrng_(scheme.nSteps() * scheme.nAssets(), 0.0, 1.0, typename NRNG::urng_type(), normalGenType),
+  seed_(0), stream_(0), scheme_(scheme), payoff_(payoff), discount_(discount)
+{
+  QF_ASSERT(scheme.nSteps() > 0, "McKernel: no time steps!");
+  pathDevs_.resize(scheme.nSteps() * scheme.nAssets());
+}
+
+template <typename NRNG, typename SCHEME, typename PAYOFF>
+inline void McKernel<NRNG, SCHEME, PAYOFF>::seed(unsigned long seed, unsigned long stream)
+{
+  nrng_.seed(seed, stream);
+  seed_ = seed;
+  stream_ = stream;
+}
+
+template <typename NRNG, typename SCHEME, typename PAYOFF>
+inline std::shared_ptr<McKernelBase> McKernel<NRNG, SCHEME, PAYOFF>::clone() const
+{
+  return std::shared_ptr<McKernelBase>(new McKernel<NRNG, SCHEME, PAYOFF>(*this));
+}
+
+template <typename NRNG, typename SCHEME, typename PAYOFF>
+inline void McKernel<NRNG, SCHEME, PAYOFF>::run(size_t npaths, double* pvs, size_t stride)
+{
+  size_t nassets = scheme_.nAssets();
+  size_t nsteps = scheme_.nSteps();
+  size_t ndevs = nsteps * nassets;
+  // the scratch blocks only grow, so they are allocated with the first block
+  if (devs_.size() < ndevs * npaths)
+    devs_.resize(ndevs * npaths);
+  if (spots_.size() < nassets * npaths)
+    spots_.resize(nassets * npaths);
+  real_type* devs = devs_.data();
+  real_type* spots = spots_.data();
+
+  if constexpr (std::is_same_v<real_type, float>) {
+    // draw the uniforms of each path in float, then invert the whole block in one pass
+    if (unifs_.size() < ndevs * npaths)
+      unifs_.resize(ndevs * npaths);
+    float* u = unifs_.data();
+    for (size_t p = 0; p < npaths; ++p) {
+      if constexpr (IsCounterBased<typename NRNG::urng_type>::value)
+        nrng_.seed(seed_, stream_++);
+      for (size_t k = 0; k < ndevs; ++k)
+        u[k * npaths + p] = nrng_.nextUniformFloat();
+    }
+    normalInvCdfPPND7(u, devs, ndevs * npaths);
+  }
+  else {
+    // draw each path in the same order as EulerPathGenerator and scatter it into the block
+    for (size_t p = 0; p < npaths; ++p) {
+      if constexpr (IsCounterBased<typename NRNG::urng_type>::value)
+        nrng_.seed(seed_, stream_++);
+      nrng_.next(pathDevs_.begin(), pathDevs_.end());
+      double const* z = pathDevs_.data();
+      for (size_t k = 0; k < ndevs; ++k)
+        devs[k * npaths + p] = z[k];
+    }
+  }
+
+  // evolve the whole block one step at a time, fixing the payoff on the way
+  scheme_.begin(npaths, spots);
+  payoff_.begin(npaths);
+  for (size_t i = 0; i < nsteps; ++i) {
+    scheme_.step(i, npaths, devs + i * nassets * npaths, spots);
+    payoff_.fix(i, npaths, spots);
+  }
+  payoff_.payoffs(npaths, discount_, pvs, stride);
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_MCKERNEL_HPP
@@ -8,6 +8,8 @@
 
 #include <qflib/defines.hpp>
 #include <qflib/exception.hpp>
+#include <qflib/math/random/normalrng.hpp>
+#include <qflib/math/random/sobolrsg.hpp>
 
 BEGIN_NAMESPACE(qf)
 
@@ -22,32 +24,113 @@ struct McParams
     MINSTDRAND,
     MT19937,
     RANLUX3,
-    RANLUX4
+    RANLUX4,
+    PHILOX4X32,     // counter-based, every path has its own stream
+    THREEFRY4X32    // counter-based, every path has its own stream
   };
 
   /** The known path generator types */
   enum class PathGenType
   {
-    EULER
+    EULER,
+    SOBOL     // Sobol numbers with Brownian bridge; ignores urngType and normalGenType
   };
 
+  /** The known variance reduction techniques */
+  enum class ControlVarType
+  {
+    NONE,
+    ANTITHETIC,       // antithetic path pairs
+    CONTROLVARIATE,   // closed-form control variate, beta estimated online
+    BOTH              // antithetic path pairs and control variate
+  };
+
+  /** The known floating point precisions of the fused kernels; FLOAT draws the normal deviates,
+      the paths and the payoffs in single precision, see McKernel, and is rejected where no fused kernel applies.
+  */
+  enum class Precision
+  {
+    DOUBLE,
+    FLOAT
+  };
+
+  /** The known methods for generating normal deviates */
+  using NormalGenType = qf::NormalGenType;
+
+  /** The known randomizations of the Sobol sequence */
+  using ScrambleType = qf::SobolScrambleType;
+
 
   /** Default ctor */
-  McParams(UrngType u = UrngType::MT19937, PathGenType p = PathGenType::EULER);
+  McParams(UrngType u = UrngType::MT19937, PathGenType p = PathGenType::EULER,
+           size_t nthreads = 1, unsigned long seed = 0);
 
   // state
   UrngType urngType;
   PathGenType pathGenType;
+  size_t nThreads;          // number of worker threads used by simulate()
+  unsigned long seed;       // the seed of the random number streams
+  size_t blockSize;         // number of paths drawn from one random stream
+  NormalGenType normalGenType;  // how uniform deviates are turned into normal ones
+  ScrambleType scrambleType;    // the randomization of the Sobol sequence
+  ControlVarType controlVarType;  // the variance reduction technique
+  bool greeks;              // whether simulate() also estimates delta and vega, in the same pass
+  bool aad;                 // with greeks, whether MultiAssetBsMcPricer uses adjoint differentiation
+  size_t nCorrFactors;      // if positive and less than the number of assets, the correlation is simulated
+                            // with a factor model of that many principal components, see PathGenerator
+  bool fusedKernels;        // whether BsMcPricer and MultiAssetBsMcPricer run the fused kernels of the products
+                            // that have one, see makeBsMcKernel
+  Precision precision;      // the floating point precision of the fused kernels; FLOAT is an error without one
+  bool streamFixings;       // whether BsMcPricer and MultiAssetBsMcPricer simulate one path at a time and stream
+                            // its fixings into the product, instead of storing blocks of whole paths,
+                            // see Product::isIncremental
+
+  // Early stopping: the simulation stops once the standard error of the mean is at most absTol,
+  // or at most relTol times the absolute mean, or after maxSeconds of wall-clock time,
+  // whichever comes first. Zero disables a criterion. They are checked after every block, and the time
+  // also before a worker starts a block, see runPathBlocks.
+  double absTol;
+  double relTol;
+  double maxSeconds;
+
+  /** Whether paths are generated in antithetic pairs */
+  bool antithetic() const;
+
+  /** Whether a control variate is used */
+  bool controlVariate() const;
+
+  /** Whether the standard error stopping criteria are met */
+  bool toleranceMet(double mean, double stdErr) const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 // Inline definitions
 
 inline
-McParams::McParams(UrngType u, PathGenType p)
-: urngType(u), pathGenType(p)
+McParams::McParams(UrngType u, PathGenType p, size_t nthreads, unsigned long seed)
+: urngType(u), pathGenType(p), nThreads(nthreads), seed(seed), blockSize(1024),
+  normalGenType(NormalGenType::STDLIB), scrambleType(ScrambleType::NONE),
+  controlVarType(ControlVarType::NONE), greeks(false), aad(false),
+  nCorrFactors(0), fusedKernels(true), precision(Precision::DOUBLE), streamFixings(false),
+  absTol(0.0), relTol(0.0), maxSeconds(0.0)
 {}
 
+inline bool McParams::antithetic() const
+{
+  return controlVarType == ControlVarType::ANTITHETIC || controlVarType == ControlVarType::BOTH;
+}
+
+inline bool McParams::controlVariate() const
+{
+  return controlVarType == ControlVarType::CONTROLVARIATE || controlVarType == ControlVarType::BOTH;
+}
+
+inline bool McParams::toleranceMet(double mean, double stdErr) const
+{
+  return (absTol > 0.0 && stdErr <= absTol)
+      || (relTol > 0.0 && stdErr <= relTol * (mean < 0.0 ? -mean : mean));
+}
+
 END_NAMESPACE(qf)
 
 #endif // QF_MCPARAMS_HPP
@@ -0,0 +1,26 @@
+/**
+@file  mcruninfo.hpp
+@brief Summary of a Monte Carlo simulation run
+*/
+
+#ifndef QF_MCRUNINFO_HPP
+#define QF_MCRUNINFO_HPP
+
+#include <qflib/defines.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+/** Summary of a Monte Carlo simulation run, as returned by the MC pricers' simulate()
+*/
+struct McRunInfo
+{
+  unsigned long nPaths;   // the number of paths simulated and fed to the statistics
+  double seconds;         // the wall-clock time spent
+  double stdErr;          // the standard error of the mean estimate
+  bool converged;         // whether a standard error tolerance was met
+  unsigned long nAllocs;  // heap allocations in the path loop after warm-up, see runPathBlocks
+};
+
+END_NAMESPACE(qf)
+
+#endif // QF_MCRUNINFO_HPP
@@ -0,0 +1,196 @@
+/**
+@file  pathblockrunner.hpp
+@brief Runs Monte Carlo paths in fixed-size blocks over a number of worker threads
+*/
+
+#ifndef QF_PATHBLOCKRUNNER_HPP
+#define QF_PATHBLOCKRUNNER_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/alloccounter.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** The maximum number of blocks that runPathBlocks simulates before feeding them.
+    State kept per block between processBlock and feedBlock can therefore live in this many slots,
+    indexed by the block number modulo this count.
+*/
+inline unsigned long pathBlocksInFlight(McParams const& mcparams)
+{
+  return 4 * std::max(mcparams.nThreads, size_t(1));
+}
+
+/** Runs npaths Monte Carlo paths, split into blocks of mcparams.blockSize paths,
+    over mcparams.nThreads worker threads.
+
+    makeWorker() is called once per thread and returns the per-thread state (path generator,
+    product copy, scratch arrays).
+    processBlock(worker, firstPath, nBlockPaths, values) simulates the paths
+    [firstPath, firstPath + nBlockPaths) and writes nvalues doubles per path into values.
+    feedBlock(values, nBlockPaths) is called on the calling thread, one block at a time
+    and in increasing path order, as soon as the block is simulated. It returns false to stop
+    the simulation after that block; the blocks already simulated beyond it are discarded.
+    The workers stop before starting another block once a block has returned false, or once
+    mcparams.maxSeconds, if positive, have passed since the call; the blocks fed are then those
+    simulated up to the first one missing. Callers that need all the paths pass a zero maxSeconds.
+    Returns the number of paths fed.
+    If nAllocs is not null, it receives the number of heap allocations made by processBlock
+    after the first block of each thread, when the scratch arrays have their size;
+    they are only counted when qflib is built with QF_COUNT_ALLOCATIONS (see AllocCounter).
+
+    Since every block is drawn from its own random stream and the blocks are fed in order,
+    the results are bit-identical for any number of threads.
+*/
+template <typename MAKEWORKER, typename PROCESS, typename FEED>
+unsigned long runPathBlocks(unsigned long npaths, size_t nvalues, McParams const& mcparams,
+                   MAKEWORKER makeWorker, PROCESS processBlock, FEED feedBlock,
+                   unsigned long* nAllocs = nullptr)
+{
+  if (nAllocs)
+    *nAllocs = 0;
+  QF_ASSERT(mcparams.blockSize > 0, "runPathBlocks: the block size must be positive!");
+  if (npaths == 0)
+    return 0;
+
+  auto start = std::chrono::steady_clock::now();
+  auto outOfTime = [&]() {
+    return mcparams.maxSeconds > 0.0
+      && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= mcparams.maxSeconds;
+  };
+
+  size_t blocksize = mcparams.blockSize;
+  unsigned long nblocks = (npaths + blocksize - 1) / blocksize;
+  size_t nthreads = std::max(mcparams.nThreads, size_t(1));
+  nthreads = static_cast<size_t>(std::min<unsigned long>(nthreads, nblocks));
+  auto blockPaths = [&](unsigned long b) {
+    return static_cast<size_t>(std::min<unsigned long>(blocksize, npaths - b * blocksize));
+  };
+
+  // one worker per thread, created up front
+  using Worker = decltype(makeWorker());
+  std::vector<Worker> workers;
+  workers.reserve(nthreads);
+  for (size_t k = 0; k < nthreads; ++k)
+    workers.push_back(makeWorker());
+
+  // block b is simulated into slot b % nslots of a ring, to bound the memory of the buffered values;
+  // a worker only starts it once block b - nslots has been fed
+  unsigned long nslots = 4 * nthreads;  // at most pathBlocksInFlight(mcparams)
+  std::vector<double> values(nslots * blocksize * nvalues);
+  auto slotValues = [&](unsigned long b) { return values.data() + (b % nslots) * blocksize * nvalues; };
+  std::vector<unsigned long> allocs(nthreads, 0);
+  unsigned long nfed = 0;
+  auto countAllocs = [&]() {
+    if (nAllocs)
+      for (unsigned long n : allocs)
+        *nAllocs += n;
+  };
+  auto runBlock = [&](size_t k, unsigned long b) {
+    unsigned long nallocs = AllocCounter::count();
+    processBlock(workers[k], b * blocksize, blockPaths(b), slotValues(b));
+    if (b >= nthreads)
+      allocs[k] += AllocCounter::count() - nallocs;
+  };
+
+  if (nthreads == 1) {
+    for (unsigned long b = 0; b < nblocks && !outOfTime(); ++b) {
+      runBlock(0, b);
+      nfed += blockPaths(b);
+      if (!feedBlock(slotValues(b), blockPaths(b)))
+        break;
+    }
+    countAllocs();
+    return nfed;
+  }
+
+  // worker k simulates the blocks k, k + nthreads, ..., while the calling thread feeds them in order
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<char> ready(nslots, 0);       // whether the slot holds a simulated block not yet fed
+  std::vector<char> finished(nthreads, 0);  // whether the worker has stopped
+  unsigned long nfedblocks = 0;
+  bool stop = false;
+  std::vector<std::exception_ptr> errors(nthreads);
+  auto work = [&](size_t k) {
+    try {
+      for (unsigned long b = k; b < nblocks; b += nthreads) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cond.wait(lock, [&]() { return stop || b < nfedblocks + nslots; });
+          if (stop)
+            break;
+        }
+        if (outOfTime())
+          break;
+        runBlock(k, b);
+        std::lock_guard<std::mutex> lock(mutex);
+        ready[b % nslots] = 1;
+        cond.notify_all();
+      }
+    }
+    catch (...) {
+      errors[k] = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    finished[k] = 1;
+    cond.notify_all();
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads);
+  for (size_t k = 0; k < nthreads; ++k)
+    threads.emplace_back(work, k);
+
+  // feed the results in path order, up to the first block that was not simulated
+  std::exception_ptr feedError;
+  try {
+    for (unsigned long b = 0; b < nblocks; ++b) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return ready[b % nslots] || finished[b % nthreads]; });
+        if (!ready[b % nslots])
+          break;
+      }
+      nfed += blockPaths(b);
+      bool more = feedBlock(slotValues(b), blockPaths(b));
+      std::lock_guard<std::mutex> lock(mutex);
+      ready[b % nslots] = 0;
+      nfedblocks = b + 1;
+      stop = !more;
+      cond.notify_all();
+      if (stop)
+        break;
+    }
+  }
+  catch (...) {
+    feedError = std::current_exception();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+    cond.notify_all();
+  }
+  for (auto& th : threads)
+    th.join();
+  if (feedError)
+    std::rethrow_exception(feedError);
+  for (auto const& err : errors)
+    if (err)
+      std::rethrow_exception(err);
+
+  countAllocs();
+  return nfed;
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_PATHBLOCKRUNNER_HPP
@@ -5,16 +5,139 @@
 
 #include <qflib/methods/montecarlo/pathgenerator.hpp>
 #include <qflib/math/linalg/linalg.hpp>
+#include <algorithm>
+#include <cmath>
 
 BEGIN_NAMESPACE(qf)
 
-void PathGenerator::initCorrelation(Matrix const& corrMat)
+void PathGenerator::initCorrelation(Matrix const& corrMat, size_t ncorrfactors)
 {
   if (corrMat.is_empty())
     return;               // no correlation passed, nothing to do
   Matrix fixedCorrel = corrMat;
   spectrunc(fixedCorrel);               // spectral truncation
+  if (ncorrfactors > 0 && ncorrfactors < nfactors_) {
+    // factor model: z = B * f + diag(s) * eta, with f the systematic and eta the idiosyncratic deviates
+    Matrix loadings;
+    Vector idioVars;
+    explainedVar_ = pcafactors(fixedCorrel, ncorrfactors, loadings, idioVars);
+    loadingsT_ = loadings.t();
+    idioStdevs_.set_size(nfactors_);
+    for (size_t j = 0; j < nfactors_; ++j)
+      idioStdevs_[j] = std::sqrt(idioVars[j]);
+    ndraws_ = ncorrfactors + nfactors_;
+    return;
+  }
   choldcmp(fixedCorrel, sqrtCorrel_);   // Cholesky decomposition
+  correlator_ = CholeskyMultiplier(sqrtCorrel_);
+}
+
+Matrix PathGenerator::correlation() const
+{
+  if (loadingsT_.n_rows > 0) {
+    Matrix correl = loadingsT_.t() * loadingsT_;
+    for (size_t j = 0; j < nfactors_; ++j)
+      correl(j, j) += idioStdevs_[j] * idioStdevs_[j];
+    return correl;
+  }
+  if (sqrtCorrel_.n_rows == 0)
+    return Matrix(nfactors_, nfactors_, arma::fill::eye);
+  return sqrtCorrel_ * sqrtCorrel_.t();
+}
+
+void PathGenerator::correlatePath(Matrix& pricePath) const
+{
+  // each row is a time step, each column a factor, or a deviate with a factor model
+  if (loadingsT_.n_rows > 0) {
+    size_t ncorrfactors = loadingsT_.n_rows;
+    Matrix corrPath = pricePath.cols(0, ncorrfactors - 1) * loadingsT_;
+    for (size_t j = 0; j < nfactors_; ++j)
+      for (size_t i = 0; i < ntimesteps_; ++i)
+        corrPath(i, j) += idioStdevs_[j] * pricePath(i, ncorrfactors + j);
+    pricePath.swap(corrPath);
+    return;
+  }
+  if (sqrtCorrel_.n_rows == 0)
+    return;
+  pricePath = pricePath * sqrtCorrel_.t();
+}
+
+void PathGenerator::correlateStep(double const* draws, double* devs) const
+{
+  if (loadingsT_.n_rows > 0) {
+    size_t ncorrfactors = loadingsT_.n_rows;
+    for (size_t j = 0; j < nfactors_; ++j) {
+      double eps = idioStdevs_[j] * draws[ncorrfactors + j];
+      for (size_t c = 0; c < ncorrfactors; ++c)
+        eps += loadingsT_(c, j) * draws[c];
+      devs[j] = eps;
+    }
+    return;
+  }
+  if (sqrtCorrel_.n_rows == 0) {
+    std::copy(draws, draws + nfactors_, devs);
+    return;
+  }
+  // the Cholesky factor is lower triangular
+  for (size_t j = 0; j < nfactors_; ++j) {
+    double eps = 0.0;
+    for (size_t k = 0; k <= j; ++k)
+      eps += sqrtCorrel_(j, k) * draws[k];
+    devs[j] = eps;
+  }
+}
+
+Matrix& PathGenerator::drawBatch(size_t npaths, Matrix& pathBatch)
+{
+  Matrix& draws = loadingsT_.n_rows > 0 ? drawBatch_ : pathBatch;
+  draws.set_size(npaths, ndraws_ * ntimesteps_);
+  return draws;
+}
+
+void PathGenerator::correlateBatch(size_t npaths, Matrix& pathBatch)
+{
+  // the block, stored column-wise with the paths innermost, is also the (npaths * ntimesteps) x ndraws
+  // matrix Z of the deviates of every path and time step, so the correlated deviates of the whole block
+  // are a single matrix product.
+  size_t nrows = npaths * ntimesteps_;
+  if (loadingsT_.n_rows > 0) {
+    // factor model: the systematic deviates times the loadings, written straight into the block,
+    // plus the scaled idiosyncratic deviates, one column at a time
+    size_t ncorrfactors = loadingsT_.n_rows;
+    QF_ASSERT(drawBatch_.n_rows == npaths, "correlateBatch: the block must have one row per path!");
+    pathBatch.set_size(npaths, nfactors_ * ntimesteps_);
+    Matrix const sysDevs(drawBatch_.memptr(), nrows, ncorrfactors, false, true);
+    Matrix corrDevs(pathBatch.memptr(), nrows, nfactors_, false, true);
+    corrDevs = sysDevs * loadingsT_;
+    for (size_t j = 0; j < nfactors_; ++j) {
+      double s = idioStdevs_[j];
+      double const* eta = drawBatch_.colptr(0) + (ncorrfactors + j) * nrows;
+      double* z = pathBatch.colptr(0) + j * nrows;
+      for (size_t r = 0; r < nrows; ++r)
+        z[r] += s * eta[r];
+    }
+    return;
+  }
+  if (sqrtCorrel_.n_rows == 0)
+    return;
+
+  // Z * trans(L) is written to the scratch block, which then swaps in.
+  QF_ASSERT(pathBatch.n_rows == npaths, "correlateBatch: the block must have one row per path!");
+  corrBatch_.set_size(pathBatch.n_rows, pathBatch.n_cols);
+  correlator_.apply(pathBatch.memptr(), corrBatch_.memptr(), nrows);
+  pathBatch.swap(corrBatch_);
+}
+
+void PathGenerator::nextBatch(size_t npaths, Matrix& pathBatch)
+{
+  pathBatch.set_size(npaths, nfactors_ * ntimesteps_);
+  Matrix path(ntimesteps_, nfactors_);
+  for (size_t p = 0; p < npaths; ++p) {
+    next(path);
+    for (size_t j = 0; j < nfactors_; ++j)
+      for (size_t i = 0; i < ntimesteps_; ++i)
+        pathBatch(p, j * ntimesteps_ + i) = path(i, j);
+  }
 }
 
 END_NAMESPACE(qf)
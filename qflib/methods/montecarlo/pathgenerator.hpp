@@ -11,6 +11,7 @@
 #include <qflib/exception.hpp>
 #include <qflib/sptr.hpp>
 #include <qflib/math/matrix.hpp>
+#include <qflib/math/linalg/linalg.hpp>
 
 BEGIN_NAMESPACE(qf)
 
@@ -29,21 +30,108 @@ public:
   /** Returns the number of simulated factors */
   size_t nFactors() const;
 
+  /** Returns the number of independent normal deviates drawn per time step:
+      nfactors, or ncorrfactors + nfactors with a factor model of the correlation
+  */
+  size_t nDraws() const;
+
+  /** Returns the fraction of the variance of the factors explained by the systematic
+      factors of the factor model, or 1 without a factor model
+  */
+  double explainedVariance() const;
+
   /** Returns the next price path.
       The Matrix is resized to size ntimesteps * nfactors
   */
   virtual void next(qf::Matrix& pricePath) = 0;
 
-protected:
-  PathGenerator() {};     // default ctor
-  PathGenerator(size_t ntimesteps, size_t nfactors, qf::Matrix const& correlation);
+  /** Returns the next npaths paths in a contiguous structure-of-arrays block.
+      The Matrix is resized to npaths * (nfactors * ntimesteps); the deviate of path p,
+      factor j and time step i is pathBatch(p, j * ntimesteps + i), i.e. the paths are innermost.
+      Path p of the block is the same as the p-th call to next() would return.
+      The default implementation calls next() once per path.
+  */
+  virtual void nextBatch(size_t npaths, qf::Matrix& pathBatch);
+
+  /** Whether the generator can stream a path one time step at a time, with beginPath() and nextStep(),
+      and a block of paths one time step at a time, with beginBatch() and nextStepBatch()
+  */
+  virtual bool canStream() const;
+
+  /** Starts the next path to be streamed; it is the same path as the next call to next() would return */
+  virtual void beginPath();
+
+  /** Writes the correlated deviates of time step i of the current path into devs, nfactors values.
+      The time steps must be taken in order, from i = 0; only a time step of deviates is kept.
+  */
+  virtual void nextStep(size_t i, double* devs);
 
-  // Does spectral truncation and Cholesky decomposition on the correlation matrix
-  void initCorrelation(qf::Matrix const& correlation);
+  /** Starts a block of npaths paths to be simulated together one time step at a time;
+      they are the same paths as the next call to nextBatch() would return
+  */
+  virtual void beginBatch(size_t npaths);
+
+  /** Writes the correlated deviates of time step i of nlanes paths of the block into devs, factor j of lane k
+      at devs[j * nlanes + k], lane k holding path lanes[k] of the block. The caller compacts out the paths
+      it no longer simulates, so that the generator need not draw their deviates; the lanes only ever shrink.
+      The time steps must be taken in order, from i = 0.
+  */
+  virtual void nextStepBatch(size_t i, size_t nlanes, size_t const* lanes, double* devs);
+
+  /** Restarts the generator on the random stream identified by (seed, stream).
+      The pricers pass the index of the first path they are about to draw as the stream,
+      so that a given path set does not depend on how the paths are split across threads.
+  */
+  virtual void seed(unsigned long seed, unsigned long stream) = 0;
+
+  /** Returns a copy of this generator, e.g. one for each worker thread */
+  virtual std::shared_ptr<PathGenerator> clone() const = 0;
+
+  /** Returns the correlation matrix of the factors actually simulated,
+      i.e. after spectral truncation of the input correlation matrix,
+      and after its reduction to the factor model, if any
+  */
+  virtual qf::Matrix correlation() const;
+
+protected:
+  PathGenerator() : ndraws_(0), explainedVar_(1.0) {};     // default ctor
+  // With 0 < ncorrfactors < nfactors, the correlation is simulated with a factor model
+  // of ncorrfactors systematic factors, see initCorrelation()
+  PathGenerator(size_t ntimesteps, size_t nfactors, qf::Matrix const& correlation,
+                size_t ncorrfactors = 0);
+
+  // Does spectral truncation and Cholesky decomposition on the correlation matrix.
+  // With 0 < ncorrfactors < nfactors, it instead keeps the ncorrfactors principal components
+  // as systematic factors, plus an idiosyncratic term per factor to restore the unit variances;
+  // a time step then takes ncorrfactors + nfactors deviates and O(nfactors * ncorrfactors) work.
+  void initCorrelation(qf::Matrix const& correlation, size_t ncorrfactors = 0);
+
+  // Maps each time step of a path of independent deviates, ntimesteps x ndraws,
+  // to the correlated deviates of the factors, ntimesteps x nfactors
+  void correlatePath(qf::Matrix& pricePath) const;
+
+  // Maps the ndraws independent deviates of one time step to the nfactors correlated deviates
+  void correlateStep(double const* draws, double* devs) const;
+
+  // Returns the block to fill with the independent deviates of npaths paths, npaths x (ndraws * ntimesteps),
+  // deviate d of time step i in column d * ntimesteps + i: pathBatch itself, or the scratch block
+  // drawBatch_ with a factor model, as the correlated block is then smaller
+  qf::Matrix& drawBatch(size_t npaths, qf::Matrix& pathBatch);
+
+  // Maps each time step of the block of independent deviates returned by drawBatch()
+  // to the correlated deviates in pathBatch, as one blocked matrix product
+  void correlateBatch(size_t npaths, qf::Matrix& pathBatch);
 
   size_t ntimesteps_;        // the number of time steps
   size_t nfactors_;          // the number of factors
+  size_t ndraws_;            // the number of deviates per time step
   qf::Matrix sqrtCorrel_;    // the Cholesky factor of the correlation matrix
+  qf::Matrix loadingsT_;     // factor model: the transposed loadings, ncorrfactors x nfactors
+  qf::Vector idioStdevs_;    // factor model: the idiosyncratic standard deviations
+  double explainedVar_;      // factor model: the explained variance ratio
+  CholeskyMultiplier correlator_;  // applies the Cholesky factor to a whole batch
+  qf::Matrix corrBatch_;     // scratch block, the correlated deviates of a batch
+  qf::Matrix drawBatch_;     // scratch block, the independent deviates of a batch with a factor model
 };
 
 using SPtrPathGenerator = std::shared_ptr<PathGenerator>;
@@ -51,14 +139,15 @@ using SPtrPathGenerator = std::shared_ptr<PathGenerator>;
 ///////////////////////////////////////////////////////////////////////////////
 // Inline definitions
 inline
-PathGenerator::PathGenerator(size_t ntimesteps, size_t nfactors, qf::Matrix const& correlMatrix)
-: ntimesteps_(ntimesteps), nfactors_(nfactors)
+PathGenerator::PathGenerator(size_t ntimesteps, size_t nfactors, qf::Matrix const& correlMatrix,
+                             size_t ncorrfactors)
+: ntimesteps_(ntimesteps), nfactors_(nfactors), ndraws_(nfactors), explainedVar_(1.0)
 {
   QF_ASSERT(correlMatrix.is_square(), "the correlation matrix is not square!");
   if (!correlMatrix.is_empty())
     QF_ASSERT(correlMatrix.n_rows == nfactors,
     "the correlation matrix number of rows is not equal to the number of factors!");
-  initCorrelation(correlMatrix);
+  initCorrelation(correlMatrix, ncorrfactors);
 }
 
 inline size_t PathGenerator::nTimeSteps() const
@@ -71,6 +160,41 @@ inline size_t PathGenerator::nFactors() const
   return nfactors_;
 }
 
+inline size_t PathGenerator::nDraws() const
+{
+  return ndraws_;
+}
+
+inline double PathGenerator::explainedVariance() const
+{
+  return explainedVar_;
+}
+
+inline bool PathGenerator::canStream() const
+{
+  return false;
+}
+
+inline void PathGenerator::beginPath()
+{
+  QF_ASSERT(0, "this path generator cannot stream a path one time step at a time!");
+}
+
+inline void PathGenerator::nextStep(size_t i, double* devs)
+{
+  QF_ASSERT(0, "this path generator cannot stream a path one time step at a time!");
+}
+
+inline void PathGenerator::beginBatch(size_t npaths)
+{
+  QF_ASSERT(0, "this path generator cannot stream a block of paths one time step at a time!");
+}
+
+inline void PathGenerator::nextStepBatch(size_t i, size_t nlanes, size_t const* lanes, double* devs)
+{
+  QF_ASSERT(0, "this path generator cannot stream a block of paths one time step at a time!");
+}
+
 END_NAMESPACE(qf)
 
 #endif // QF_PATHGENERATOR_HPP
@@ -0,0 +1,281 @@
+/**
+@file  pathstore.cpp
+@brief Implementation of the PathStore class
+*/
+
+#include <qflib/methods/montecarlo/pathstore.hpp>
+#include <qflib/methods/montecarlo/pathblockrunner.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+BEGIN_NAMESPACE(qf)
+
+namespace {
+
+// The file header: the magic, then the integer fields of the key, the times and the correlation;
+// the deviates follow at the next multiple of 64 bytes
+const char PATHSTORE_MAGIC[8] = { 'Q', 'F', 'P', 'A', 'T', 'H', 'S', '1' };
+const size_t PATHSTORE_NFIELDS = 12;
+const size_t PATHSTORE_ALIGN = 64;
+
+size_t headerBytes(size_t ntimesteps, size_t nfactors)
+{
+  size_t n = sizeof(PATHSTORE_MAGIC) + PATHSTORE_NFIELDS * sizeof(uint64_t)
+           + (ntimesteps + nfactors * nfactors) * sizeof(double);
+  return (n + PATHSTORE_ALIGN - 1) / PATHSTORE_ALIGN * PATHSTORE_ALIGN;
+}
+
+bool sameData(double const* a, size_t na, double const* b, size_t nb)
+{
+  return na == nb && (na == 0 || memcmp(a, b, na * sizeof(double)) == 0);
+}
+
+}
+
+PathStoreKey::PathStoreKey(Vector const& times_, size_t nfactors, Matrix const& correlation_,
+                           McParams const& mcparams)
+: times(times_), nFactors(nfactors), correlation(correlation_), seed(mcparams.seed),
+  blockSize(mcparams.blockSize), urngType(static_cast<int>(mcparams.urngType)),
+  pathGenType(static_cast<int>(mcparams.pathGenType)),
+  normalGenType(static_cast<int>(mcparams.normalGenType)),
+  scrambleType(static_cast<int>(mcparams.scrambleType)),
+  nCorrFactors(mcparams.nCorrFactors), antithetic(mcparams.antithetic())
+{
+  QF_ASSERT(correlation.n_rows == nfactors && correlation.n_cols == nfactors,
+    "PathStoreKey: need the correlation matrix of the factors!");
+}
+
+bool PathStoreKey::operator==(PathStoreKey const& other) const
+{
+  return nFactors == other.nFactors && seed == other.seed && blockSize == other.blockSize
+    && urngType == other.urngType && pathGenType == other.pathGenType
+    && normalGenType == other.normalGenType && scrambleType == other.scrambleType
+    && nCorrFactors == other.nCorrFactors && antithetic == other.antithetic
+    && sameData(times.memptr(), times.n_elem, other.times.memptr(), other.times.n_elem)
+    && sameData(correlation.memptr(), correlation.n_elem, other.correlation.memptr(), other.correlation.n_elem);
+}
+
+unsigned long long PathStoreKey::hash() const
+{
+  unsigned long long h = 14695981039346656037ull;
+  auto mix = [&h](void const* data, size_t nbytes) {
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    for (size_t k = 0; k < nbytes; ++k) {
+      h ^= bytes[k];
+      h *= 1099511628211ull;
+    }
+  };
+  uint64_t fields[] = { nFactors, seed, blockSize, uint64_t(urngType), uint64_t(pathGenType),
+                        uint64_t(normalGenType), uint64_t(scrambleType), nCorrFactors, uint64_t(antithetic) };
+  mix(fields, sizeof(fields));
+  mix(times.memptr(), times.n_elem * sizeof(double));
+  mix(correlation.memptr(), correlation.n_elem * sizeof(double));
+  return h;
+}
+
+std::string PathStoreKey::fileName() const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "qfpaths-%016llx.bin", hash());
+  return name;
+}
+
+PathStore::PathStore(PathStoreKey const& key, unsigned long npaths)
+: key_(key), npaths_(npaths), ncols_(key.nFactors * key.times.size()), data_(nullptr),
+  mapping_(nullptr), mappedBytes_(0), mapHandle_(nullptr)
+{}
+
+PathStore::~PathStore()
+{
+  if (!mapping_)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(mapping_);
+  CloseHandle(static_cast<HANDLE>(mapHandle_));
+#else
+  munmap(mapping_, mappedBytes_);
+#endif
+}
+
+void PathStore::fill(PathStoreKey const& key, PathGenerator const& pathgen, unsigned long npaths,
+                     McParams const& mcparams, double* data)
+{
+  QF_ASSERT(mcparams.blockSize == key.blockSize, "PathStore: the block size must be that of the key!");
+  QF_ASSERT(pathgen.nTimeSteps() == key.times.size() && pathgen.nFactors() == key.nFactors,
+    "PathStore: the path generator must have the time steps and factors of the key!");
+  size_t ncols = key.nFactors * key.times.size();
+
+  // each block is drawn from the stream of its first path, as in the pricers, and copied as is;
+  // all the paths are needed, so the time budget does not apply
+  struct Worker
+  {
+    SPtrPathGenerator pathgen;
+    Matrix pathBatch;
+  };
+  McParams fillparams = mcparams;
+  fillparams.maxSeconds = 0.0;
+  runPathBlocks(npaths, 0, fillparams,
+    [&]() { return Worker{ pathgen.clone(), Matrix() }; },
+    [&](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double*) {
+      worker.pathgen->seed(key.seed, firstPath);
+      worker.pathgen->nextBatch(nBlockPaths, worker.pathBatch);
+      std::copy(worker.pathBatch.memptr(), worker.pathBatch.memptr() + nBlockPaths * ncols,
+                data + firstPath * ncols);
+    },
+    [](double*, size_t) { return true; });
+}
+
+std::shared_ptr<PathStore> PathStore::create(PathStoreKey const& key, PathGenerator const& pathgen,
+                                             unsigned long npaths, McParams const& mcparams,
+                                             std::string const& fileName)
+{
+  QF_ASSERT(npaths > 0, "PathStore: need at least one path!");
+  std::shared_ptr<PathStore> store(new PathStore(key, npaths));
+  store->arena_.resize(npaths * store->ncols_);
+  fill(key, pathgen, npaths, mcparams, store->arena_.data());
+  store->data_ = store->arena_.data();
+  if (fileName.empty())
+    return store;
+
+  // write the header and the deviates to a temporary file, which then replaces the target,
+  // so that other processes never map a partial store
+  size_t ntimesteps = key.times.size();
+  std::vector<char> header(headerBytes(ntimesteps, key.nFactors), 0);
+  char* pos = header.data();
+  memcpy(pos, PATHSTORE_MAGIC, sizeof(PATHSTORE_MAGIC));
+  pos += sizeof(PATHSTORE_MAGIC);
+  uint64_t fields[PATHSTORE_NFIELDS] = { header.size(), npaths, ntimesteps, key.nFactors, key.seed,
+                                         key.blockSize, uint64_t(key.urngType), uint64_t(key.pathGenType),
+                                         uint64_t(key.normalGenType), uint64_t(key.scrambleType),
+                                         key.nCorrFactors, uint64_t(key.antithetic) };
+  memcpy(pos, fields, sizeof(fields));
+  pos += sizeof(fields);
+  memcpy(pos, key.times.memptr(), ntimesteps * sizeof(double));
+  pos += ntimesteps * sizeof(double);
+  memcpy(pos, key.correlation.memptr(), key.correlation.n_elem * sizeof(double));
+
+  std::string tmpName = fileName + ".tmp";
+  {
+    std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+    QF_ASSERT(out.good(), "PathStore: cannot write file " + tmpName);
+    out.write(header.data(), header.size());
+    out.write(reinterpret_cast<char const*>(store->arena_.data()), store->arena_.size() * sizeof(double));
+    QF_ASSERT(out.good(), "PathStore: failed writing file " + tmpName);
+  }
+  std::error_code err;
+  std::filesystem::rename(tmpName, fileName, err);
+  QF_ASSERT(!err, "PathStore: cannot replace file " + fileName);
+
+  // from now on the deviates are read from the file, like any other process would
+  store->arena_.clear();
+  store->arena_.shrink_to_fit();
+  store->map(fileName);
+  return store;
+}
+
+std::shared_ptr<PathStore> PathStore::open(std::string const& fileName, PathStoreKey const& key)
+{
+  std::shared_ptr<PathStore> store(new PathStore(key, 0));
+  store->map(fileName);
+  return store;
+}
+
+std::shared_ptr<PathStore> PathStore::openOrCreate(std::string const& directory, PathStoreKey const& key,
+                                                   PathGenerator const& pathgen, unsigned long npaths,
+                                                   McParams const& mcparams)
+{
+  std::string fileName = (std::filesystem::path(directory) / key.fileName()).string();
+  if (std::filesystem::exists(fileName)) {
+    std::shared_ptr<PathStore> store = open(fileName, key);
+    if (store->nPaths() >= npaths)
+      return store;
+  }
+  return create(key, pathgen, npaths, mcparams, fileName);
+}
+
+void PathStore::map(std::string const& fileName)
+{
+  size_t nbytes = 0;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  QF_ASSERT(file != INVALID_HANDLE_VALUE, "PathStore: cannot open file " + fileName);
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  nbytes = static_cast<size_t>(size.QuadPart);
+  HANDLE handle = nbytes > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+  CloseHandle(file);
+  QF_ASSERT(handle != NULL, "PathStore: cannot map file " + fileName);
+  void* mapping = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+  if (!mapping)
+    CloseHandle(handle);
+  QF_ASSERT(mapping != NULL, "PathStore: cannot map file " + fileName);
+  mapHandle_ = handle;
+#else
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  QF_ASSERT(fd >= 0, "PathStore: cannot open file " + fileName);
+  struct stat st;
+  fstat(fd, &st);
+  nbytes = static_cast<size_t>(st.st_size);
+  void* mapping = nbytes > 0 ? mmap(nullptr, nbytes, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  QF_ASSERT(mapping != MAP_FAILED, "PathStore: cannot map file " + fileName);
+#endif
+  mapping_ = mapping;
+  mappedBytes_ = nbytes;
+  fileName_ = fileName;
+
+  // check the header against the key
+  char const* pos = static_cast<char const*>(mapping);
+  size_t fixedbytes = sizeof(PATHSTORE_MAGIC) + PATHSTORE_NFIELDS * sizeof(uint64_t);
+  QF_ASSERT(nbytes >= fixedbytes && memcmp(pos, PATHSTORE_MAGIC, sizeof(PATHSTORE_MAGIC)) == 0,
+    "PathStore: " + fileName + " is not a path store file!");
+  uint64_t fields[PATHSTORE_NFIELDS];
+  memcpy(fields, pos + sizeof(PATHSTORE_MAGIC), sizeof(fields));
+  size_t hdrbytes = fields[0], ntimesteps = fields[2], nfactors = fields[3];
+  QF_ASSERT(hdrbytes == headerBytes(ntimesteps, nfactors) && nbytes >= hdrbytes,
+    "PathStore: corrupt header in file " + fileName);
+  Vector times(ntimesteps);
+  Matrix correlation(nfactors, nfactors);
+  memcpy(times.memptr(), pos + fixedbytes, ntimesteps * sizeof(double));
+  memcpy(correlation.memptr(), pos + fixedbytes + ntimesteps * sizeof(double), nfactors * nfactors * sizeof(double));
+  McParams mcparams;
+  mcparams.seed = static_cast<unsigned long>(fields[4]);
+  mcparams.blockSize = static_cast<size_t>(fields[5]);
+  mcparams.urngType = static_cast<McParams::UrngType>(fields[6]);
+  mcparams.pathGenType = static_cast<McParams::PathGenType>(fields[7]);
+  mcparams.normalGenType = static_cast<McParams::NormalGenType>(fields[8]);
+  mcparams.scrambleType = static_cast<McParams::ScrambleType>(fields[9]);
+  mcparams.nCorrFactors = static_cast<size_t>(fields[10]);
+  mcparams.controlVarType = fields[11] ? McParams::ControlVarType::ANTITHETIC : McParams::ControlVarType::NONE;
+  QF_ASSERT(PathStoreKey(times, nfactors, correlation, mcparams) == key_,
+    "PathStore: the paths in file " + fileName + " were drawn with another key!");
+
+  npaths_ = static_cast<unsigned long>(fields[1]);
+  QF_ASSERT(nbytes >= hdrbytes + npaths_ * ncols_ * sizeof(double),
+    "PathStore: truncated file " + fileName);
+  data_ = reinterpret_cast<double const*>(pos + hdrbytes);
+}
+
+END_NAMESPACE(qf)
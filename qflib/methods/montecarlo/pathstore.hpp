@@ -0,0 +1,161 @@
+/**
+@file  pathstore.hpp
+@brief Store of simulated normal deviates, replayed by the pricers as common random numbers
+*/
+
+#ifndef QF_PATHSTORE_HPP
+#define QF_PATHSTORE_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <qflib/sptr.hpp>
+#include <qflib/math/matrix.hpp>
+#include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** What identifies the deviates of a path generator: the time grid, the simulated correlation,
+    the seed and everything in McParams that changes the draws. Two pricers with the same key draw
+    the same deviates, whatever their spots, vols, rates or payoffs.
+*/
+struct PathStoreKey
+{
+  /** Ctor from the simulation times, the number of factors, the correlation of the factors
+      as simulated (PathGenerator::correlation) and the MC parameters
+  */
+  PathStoreKey(Vector const& times, size_t nfactors, Matrix const& correlation, McParams const& mcparams);
+
+  /** Whether the keys are the same; the times and the correlation must match exactly */
+  bool operator==(PathStoreKey const& other) const;
+
+  /** A 64-bit FNV-1a hash of the key */
+  unsigned long long hash() const;
+
+  /** The default file name of a store with this key, "qfpaths-<hash in hex>.bin" */
+  std::string fileName() const;
+
+  Vector times;
+  size_t nFactors;
+  Matrix correlation;
+  unsigned long seed;
+  size_t blockSize;
+  int urngType;
+  int pathGenType;
+  int normalGenType;
+  int scrambleType;
+  size_t nCorrFactors;
+  bool antithetic;
+};
+
+/** A read-only store of the correlated normal deviates of npaths paths, as drawn by a path generator
+    in blocks of McParams::blockSize paths, the block starting at path b * blockSize from the stream
+    (seed, b * blockSize), exactly as the pricers draw them.
+    Each block is kept as PathGenerator::nextBatch returns it, paths innermost, so that the pricers
+    replay it in place, without copying.
+    The deviates live in an in-memory arena, or in a binary file mapped into memory, which other
+    processes can map in turn: a header with the key, then the blocks, 64-byte aligned, in native byte order.
+*/
+class PathStore
+{
+public:
+  /** Draws npaths paths from pathgen into a new store, over McParams::nThreads threads.
+      With a file name, the store is written to that file and mapped from it, otherwise it stays in memory.
+  */
+  static std::shared_ptr<PathStore> create(PathStoreKey const& key, PathGenerator const& pathgen,
+                                           unsigned long npaths, McParams const& mcparams,
+                                           std::string const& fileName = "");
+
+  /** Maps an existing store file; its key must be the given one */
+  static std::shared_ptr<PathStore> open(std::string const& fileName, PathStoreKey const& key);
+
+  /** Maps the store file key.fileName() in the given directory if it exists and holds at least npaths paths,
+      otherwise draws it and writes it there
+  */
+  static std::shared_ptr<PathStore> openOrCreate(std::string const& directory, PathStoreKey const& key,
+                                                 PathGenerator const& pathgen, unsigned long npaths,
+                                                 McParams const& mcparams);
+
+  /** Dtor, unmaps the file if any */
+  ~PathStore();
+
+  PathStore(PathStore const&) = delete;
+  PathStore& operator=(PathStore const&) = delete;
+
+  /** The key of the deviates */
+  PathStoreKey const& key() const;
+
+  /** The number of paths stored */
+  unsigned long nPaths() const;
+
+  /** The name of the mapped file, empty for an in-memory store */
+  std::string const& fileName() const;
+
+  /** Returns the deviates of the block starting at path firstPath, a multiple of the block size:
+      the deviate of path firstPath + p, factor j and time step i is at
+      block(firstPath)[(j * ntimesteps + i) * blockRows(firstPath) + p]
+  */
+  double const* block(unsigned long firstPath) const;
+
+  /** The number of paths of the block starting at path firstPath, i.e. its column stride */
+  size_t blockRows(unsigned long firstPath) const;
+
+private:
+  PathStore(PathStoreKey const& key, unsigned long npaths);
+
+  // Draws the paths into data, laid out as in the file
+  static void fill(PathStoreKey const& key, PathGenerator const& pathgen, unsigned long npaths,
+                   McParams const& mcparams, double* data);
+
+  // Maps the file read-only, checks its header against the key and points data_ past it
+  void map(std::string const& fileName);
+
+  PathStoreKey key_;
+  unsigned long npaths_;
+  size_t ncols_;                   // deviates per path, nfactors * ntimesteps
+  std::vector<double> arena_;      // the deviates of an in-memory store
+  double const* data_;             // the deviates, in the arena or the mapped file
+  std::string fileName_;
+  void* mapping_;                  // the mapped file, if any
+  size_t mappedBytes_;
+  void* mapHandle_;                // the file mapping handle, Windows only
+};
+
+using SPtrPathStore = std::shared_ptr<PathStore>;
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline PathStoreKey const& PathStore::key() const
+{
+  return key_;
+}
+
+inline unsigned long PathStore::nPaths() const
+{
+  return npaths_;
+}
+
+inline std::string const& PathStore::fileName() const
+{
+  return fileName_;
+}
+
+inline double const* PathStore::block(unsigned long firstPath) const
+{
+  QF_ASSERT(firstPath % key_.blockSize == 0 && firstPath < npaths_,
+    "PathStore: a block must start at a multiple of the block size within the stored paths!");
+  return data_ + firstPath * ncols_;
+}
+
+inline size_t PathStore::blockRows(unsigned long firstPath) const
+{
+  return static_cast<size_t>(std::min<unsigned long>(key_.blockSize, npaths_ - firstPath));
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_PATHSTORE_HPP
@@ -0,0 +1,111 @@
+/**
+@file  regressionbasis.hpp
+@brief Basis functions for the regression of continuation values in Longstaff-Schwartz Monte Carlo
+*/
+
+#ifndef QF_REGRESSIONBASIS_HPP
+#define QF_REGRESSIONBASIS_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+/** The basis functions on which LsmBsMcPricer regresses the continuation values.
+    The state at an exercise date is the vector x of the spots divided by their initial values,
+    and the exercise value. The basis is the constant, the polynomials of degree 1 to degree
+    in each x_j, optionally the cross products x_j x_k, j < k, and optionally the exercise value.
+    The polynomials are the monomials or the Laguerre polynomials; both span the same space,
+    the Laguerre polynomials are better conditioned for high degrees.
+*/
+class RegressionBasis
+{
+public:
+  /** The known polynomial families */
+  enum class Type
+  {
+    MONOMIAL,
+    LAGUERRE
+  };
+
+  /** Ctor */
+  RegressionBasis(Type type = Type::MONOMIAL, size_t degree = 2, bool crossTerms = true,
+                  bool exerciseValue = true);
+
+  Type type() const { return type_; }
+  size_t degree() const { return degree_; }
+  bool crossTerms() const { return crossTerms_; }
+  bool exerciseValue() const { return exerciseValue_; }
+
+  /** The number of basis functions for nassets assets */
+  size_t size(size_t nassets) const;
+
+  /** Evaluates the basis functions at the state (x, exerciseValue) of nassets assets,
+      writing function k into out[k * outStride], e.g. row r of a column major regression matrix
+  */
+  void eval(double const* x, size_t nassets, double exerciseValue, double* out, size_t outStride) const;
+
+private:
+  Type type_;
+  size_t degree_;
+  bool crossTerms_;
+  bool exerciseValue_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+RegressionBasis::RegressionBasis(Type type, size_t degree, bool crossTerms, bool exerciseValue)
+: type_(type), degree_(degree), crossTerms_(crossTerms), exerciseValue_(exerciseValue)
+{
+  QF_ASSERT(degree > 0, "RegressionBasis: the degree must be positive!");
+}
+
+inline size_t RegressionBasis::size(size_t nassets) const
+{
+  size_t n = 1 + nassets * degree_;
+  if (crossTerms_)
+    n += nassets * (nassets - 1) / 2;
+  if (exerciseValue_)
+    ++n;
+  return n;
+}
+
+inline void RegressionBasis::eval(double const* x, size_t nassets, double exerciseValue,
+                                  double* out, size_t outStride) const
+{
+  size_t k = 0;
+  out[k++ * outStride] = 1.0;
+  for (size_t j = 0; j < nassets; ++j) {
+    double xj = x[j];
+    if (type_ == Type::MONOMIAL) {
+      double pow = 1.0;
+      for (size_t d = 1; d <= degree_; ++d) {
+        pow *= xj;
+        out[k++ * outStride] = pow;
+      }
+    }
+    else {
+      // L_0 = 1, L_1 = 1 - x, (n + 1) L_n+1 = (2n + 1 - x) L_n - n L_n-1
+      double lprev = 1.0, l = 1.0 - xj;
+      out[k++ * outStride] = l;
+      for (size_t d = 1; d < degree_; ++d) {
+        double lnext = ((2 * d + 1 - xj) * l - d * lprev) / (d + 1);
+        lprev = l;
+        l = lnext;
+        out[k++ * outStride] = l;
+      }
+    }
+  }
+  if (crossTerms_)
+    for (size_t j = 0; j < nassets; ++j)
+      for (size_t m = j + 1; m < nassets; ++m)
+        out[k++ * outStride] = x[j] * x[m];
+  if (exerciseValue_)
+    out[k++ * outStride] = exerciseValue;
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_REGRESSIONBASIS_HPP
@@ -0,0 +1,135 @@
+/**
+@file  sobolpathgenerator.hpp
+@brief Definition of Monte Carlo path generator with Sobol numbers and Brownian bridge
+*/
+
+#ifndef QF_SOBOLPATHGENERATOR_HPP
+#define QF_SOBOLPATHGENERATOR_HPP
+
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <qflib/methods/montecarlo/brownianbridge.hpp>
+#include <qflib/math/random/sobolrsg.hpp>
+#include <qflib/math/stats/normalinvcdf.hpp>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Creates standard normal increments from a Sobol sequence.
+    Each path takes one point of dimension ndraws * ntimesteps, where ndraws is nfactors,
+    or ncorrfactors + nfactors with a factor model of the correlation; the coordinates are
+    mapped to normal deviates through the inverse normal cdf, and each factor is built
+    with a Brownian bridge. The first coordinates drive the terminal values of all factors,
+    the next ones the midpoints, and so on; with a factor model, the systematic factors
+    come first at each bridge step, so they take the best distributed coordinates.
+    seed(seed, stream) moves to point stream + 1 of the sequence, so that a path set
+    does not depend on how it is split across threads.
+*/
+class SobolPathGenerator : public PathGenerator
+{
+public:
+
+  /** Ctor for generating increments for correlated factors.
+      If the correlation matrix is not passed in, it assumes independent factors.
+      With 0 < ncorrfactors < nfactors, the correlation is simulated with a factor model
+      of ncorrfactors principal components plus an idiosyncratic term per factor.
+  */
+  template<typename ITER>
+  SobolPathGenerator(ITER timestepsBegin, ITER timestepsEnd, size_t nfactors,
+                     Matrix const & correlMat = Matrix(),
+                     SobolScrambleType scramble = SobolScrambleType::NONE,
+                     size_t ncorrfactors = 0);
+
+  /** Returns the dimension of the generator */
+  size_t dim() const;
+
+  /** Returns the next price path */
+  virtual void next(Matrix& pricePath) override;
+
+  /** Returns the next npaths paths, paths innermost */
+  virtual void nextBatch(size_t npaths, Matrix& pathBatch) override;
+
+  /** Moves to the point stream + 1 of the Sobol sequence, randomized with seed */
+  virtual void seed(unsigned long seed, unsigned long stream) override;
+
+  /** Returns a copy of this generator */
+  virtual std::shared_ptr<PathGenerator> clone() const override;
+
+protected:
+  /** Writes the uncorrelated increments of the next path at incs[j * ntimesteps + i] */
+  void drawPath(double* incs);
+
+  SobolRsg rsg_;
+  BrownianBridge bridge_;
+  std::vector<double> unifs_, normals_, bridgeDevs_, pathDevs_;   // scratch arrays
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+template <typename ITER>
+inline SobolPathGenerator::SobolPathGenerator(ITER timestepsBegin,
+                          ITER timestepsEnd,
+                          size_t nfactors,
+                          Matrix const& correlMat,
+                          SobolScrambleType scramble,
+                          size_t ncorrfactors)
+  : PathGenerator((timestepsEnd - timestepsBegin), nfactors, correlMat, ncorrfactors),
+  rsg_((timestepsEnd - timestepsBegin) * ndraws_, scramble),
+  bridge_(timestepsBegin, timestepsEnd)
+{
+  QF_ASSERT(ntimesteps_ > 0, "no time steps!");
+  unifs_.resize(rsg_.dim());
+  normals_.resize(rsg_.dim());
+  bridgeDevs_.resize(ntimesteps_);
+  pathDevs_.resize(rsg_.dim());
+}
+
+inline size_t SobolPathGenerator::dim() const
+{
+  return rsg_.dim();
+}
+
+inline void SobolPathGenerator::seed(unsigned long seed, unsigned long stream)
+{
+  rsg_.seed(seed, stream);
+}
+
+inline std::shared_ptr<PathGenerator> SobolPathGenerator::clone() const
+{
+  return std::shared_ptr<PathGenerator>(new SobolPathGenerator(*this));
+}
+
+inline void SobolPathGenerator::drawPath(double* incs)
+{
+  rsg_.next(unifs_.data());
+  normalInvCdfAS241(unifs_.data(), normals_.data(), unifs_.size());
+  // coordinate k * ndraws + j is the k-th bridge deviate of factor j
+  for (size_t j = 0; j < ndraws_; ++j) {
+    for (size_t k = 0; k < ntimesteps_; ++k)
+      bridgeDevs_[k] = normals_[k * ndraws_ + j];
+    bridge_.increments(bridgeDevs_.data(), incs + j * ntimesteps_);
+  }
+}
+
+inline void SobolPathGenerator::next(Matrix& pricePath)
+{
+  pricePath.set_size(ntimesteps_, ndraws_);
+  drawPath(pricePath.memptr());   // column major: factor j starts at j * ntimesteps
+  correlatePath(pricePath);
+}
+
+inline void SobolPathGenerator::nextBatch(size_t npaths, Matrix& pathBatch)
+{
+  Matrix& draws = drawBatch(npaths, pathBatch);
+  size_t ndevs = ndraws_ * ntimesteps_;
+  for (size_t p = 0; p < npaths; ++p) {
+    drawPath(pathDevs_.data());
+    for (size_t m = 0; m < ndevs; ++m)
+      draws(p, m) = pathDevs_[m];
+  }
+  correlateBatch(npaths, pathBatch);
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_SOBOLPATHGENERATOR_HPP
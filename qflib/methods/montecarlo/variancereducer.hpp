@@ -0,0 +1,179 @@
+/**
+@file  variancereducer.hpp
+@brief Turns per-path values into statistics samples, with antithetic pairs and a control variate
+*/
+
+#ifndef QF_VARIANCEREDUCER_HPP
+#define QF_VARIANCEREDUCER_HPP
+
+#include <qflib/defines.hpp>
+#include <qflib/exception.hpp>
+#include <qflib/math/stats/statisticscalculator.hpp>
+#include <cmath>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Combines the values simulated on each path into the samples fed to a statistics calculator.
+    Each path holds the values of nvars variables and, with a control variate, the PV of the control,
+    whose exact expectation is known. The control variate only corrects the first variable, the PV.
+    With antithetic pairs, the two paths of a pair are averaged into one sample, so that the
+    sample variance, hence the standard error, accounts for their correlation.
+    The samples of a block are fed to the calculator at once, with addSamples().
+    With a control variate, the sample is Y - beta (C - E[C]), where beta = Cov(Y, C) / Var(C)
+    is estimated online from the previous blocks only, so that it is independent of the samples
+    it is applied to. The first block is a pilot and uses its own estimate, which biases the
+    result by O(1 / blockSize) on the first block only.
+*/
+class VarianceReducer
+{
+public:
+  /** Ctor; cvMean is the expectation of the control variate, if any */
+  VarianceReducer(bool antithetic, bool controlVariate, double cvMean = 0.0, size_t nvars = 1);
+
+  /** Number of variables per sample */
+  size_t nVariables() const;
+
+  /** Number of values per path: the variables, plus one with a control variate */
+  size_t nValues() const;
+
+  /** Number of paths per sample: 2 with antithetic pairs, 1 otherwise */
+  size_t pathsPerSample() const;
+
+  /** The current estimate of the control variate coefficient */
+  double beta() const;
+
+  /** The number of samples fed so far */
+  unsigned long nSamples() const;
+
+  /** The mean of variable k over the samples fed so far */
+  double mean(size_t k = 0) const;
+
+  /** The standard error of the mean of variable k over the samples fed so far */
+  double stdErr(size_t k = 0) const;
+
+  /** Feeds a block of npaths paths with values[p * nValues() + k] to the statistics calculator */
+  template <typename ITER>
+  void feed(double const* values, size_t npaths, StatisticsCalculator<ITER>& statsCalc);
+
+private:
+  bool antithetic_;
+  bool controlVariate_;
+  double cvMean_;
+  size_t nvars_;
+  double beta_;
+  // running moments of the (PV, control) samples
+  unsigned long n_;
+  double meanY_, meanC_, sCC_, sCY_;
+  // running moments of the samples fed, one per variable
+  unsigned long nfed_;
+  std::vector<double> meanX_, sXX_;
+  std::vector<double> samples_;   // scratch, the samples of the block being fed
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+VarianceReducer::VarianceReducer(bool antithetic, bool controlVariate, double cvMean, size_t nvars)
+: antithetic_(antithetic), controlVariate_(controlVariate), cvMean_(cvMean), nvars_(nvars), beta_(0.0),
+  n_(0), meanY_(0.0), meanC_(0.0), sCC_(0.0), sCY_(0.0), nfed_(0),
+  meanX_(nvars, 0.0), sXX_(nvars, 0.0)
+{
+  QF_ASSERT(nvars > 0, "VarianceReducer: no variables!");
+}
+
+inline size_t VarianceReducer::nVariables() const
+{
+  return nvars_;
+}
+
+inline size_t VarianceReducer::nValues() const
+{
+  return controlVariate_ ? nvars_ + 1 : nvars_;
+}
+
+inline size_t VarianceReducer::pathsPerSample() const
+{
+  return antithetic_ ? 2 : 1;
+}
+
+inline double VarianceReducer::beta() const
+{
+  return beta_;
+}
+
+inline unsigned long VarianceReducer::nSamples() const
+{
+  return nfed_;
+}
+
+inline double VarianceReducer::mean(size_t k) const
+{
+  return meanX_[k];
+}
+
+inline double VarianceReducer::stdErr(size_t k) const
+{
+  return nfed_ > 1 ? std::sqrt(sXX_[k] / (nfed_ - 1) / nfed_) : 0.0;
+}
+
+template <typename ITER>
+inline void VarianceReducer::feed(double const* values, size_t npaths, StatisticsCalculator<ITER>& statsCalc)
+{
+  size_t nvals = nValues();
+  size_t step = pathsPerSample();
+  QF_ASSERT(npaths % step == 0, "VarianceReducer: the block must hold whole antithetic pairs!");
+
+  // value k of the sample starting at path p
+  auto sample = [&](size_t p, size_t k) {
+    double v = values[p * nvals + k];
+    return antithetic_ ? 0.5 * (v + values[(p + 1) * nvals + k]) : v;
+  };
+  // updates the co-moments, Welford style
+  auto update = [&]() {
+    for (size_t p = 0; p < npaths; p += step) {
+      double y = sample(p, 0), c = sample(p, nvars_);
+      ++n_;
+      double dc = c - meanC_;
+      meanC_ += dc / n_;
+      meanY_ += (y - meanY_) / n_;
+      sCC_ += dc * (c - meanC_);
+      sCY_ += dc * (y - meanY_);
+    }
+    if (sCC_ > 0.0)
+      beta_ = sCY_ / sCC_;
+  };
+
+  // the first block is a pilot: its beta is estimated on the block itself
+  bool pilot = controlVariate_ && n_ == 0;
+  if (pilot)
+    update();
+
+  // the scratch array only grows, so it stops allocating after the first block
+  size_t nsamples = npaths / step;
+  if (samples_.size() < nsamples * nvars_)
+    samples_.resize(nsamples * nvars_);
+  for (size_t p = 0; p < npaths; p += step) {
+    double* x = samples_.data() + (p / step) * nvars_;
+    for (size_t k = 0; k < nvars_; ++k)
+      x[k] = sample(p, k);
+    if (controlVariate_)
+      x[0] -= beta_ * (sample(p, nvars_) - cvMean_);
+    ++nfed_;
+    for (size_t k = 0; k < nvars_; ++k) {
+      double dx = x[k] - meanX_[k];
+      meanX_[k] += dx / nfed_;
+      sXX_[k] += dx * (x[k] - meanX_[k]);
+    }
+  }
+
+  statsCalc.addSamples(samples_.data(), samples_.data() + nsamples * nvars_, nsamples);
+
+  if (controlVariate_ && !pilot)
+    update();
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_VARIANCEREDUCER_HPP
@@ -0,0 +1,80 @@
+/**
+@file  bsmckernels.cpp
+@brief Implementation of the dispatcher of the fused Monte Carlo kernels
+*/
+
+#include <qflib/pricers/bsmckernels.hpp>
+#include <qflib/products/kernelpayoffs.hpp>
+
+using namespace std;
+
+BEGIN_NAMESPACE(qf)
+
+namespace {
+
+// Instantiates the kernel of the payoff for the urng type of mcparams
+template <typename PAYOFF>
+SPtrMcKernel makeKernel(LogEulerScheme const& scheme, PAYOFF const& payoff, double discount,
+                        McParams const& mcparams)
+{
+  NormalGenType normalGenType = mcparams.normalGenType;
+  if (mcparams.urngType == McParams::UrngType::MINSTDRAND)
+    return SPtrMcKernel(new McKernel<NormalRngMinStdRand, LogEulerScheme, PAYOFF>(
+      scheme, payoff, discount, normalGenType));
+  else if (mcparams.urngType == McParams::UrngType::MT19937)
+    return SPtrMcKernel(new McKernel<NormalRngMt19937, LogEulerScheme, PAYOFF>(
+      scheme, payoff, discount, normalGenType));
+  else if (mcparams.urngType == McParams::UrngType::RANLUX3)
+    return SPtrMcKernel(new McKernel<NormalRngRanLux3, LogEulerScheme, PAYOFF>(
+      scheme, payoff, discount, normalGenType));
+  else if (mcparams.urngType == McParams::UrngType::RANLUX4)
+    return SPtrMcKernel(new McKernel<NormalRngRanLux4, LogEulerScheme, PAYOFF>(
+      scheme, payoff, discount, normalGenType));
+  else if (mcparams.urngType == McParams::UrngType::PHILOX4X32)
+    return SPtrMcKernel(new McKernel<NormalRngPhilox4x32, LogEulerScheme, PAYOFF>(
+      scheme, payoff, discount, normalGenType));
+  else if (mcparams.urngType == McParams::UrngType::THREEFRY4X32)
+    return SPtrMcKernel(new McKernel<NormalRngThreefry4x32, LogEulerScheme, PAYOFF>(
+      scheme, payoff, discount, normalGenType));
+  QF_ASSERT(0, "unknown urng type!");
+  return SPtrMcKernel();
+}
+
+// Instantiates the kernel of the product's payoff on spots of type REAL, or returns a null pointer if there is none
+template <typename REAL>
+SPtrMcKernel makeProductKernel(SPtrProduct prod, LogEulerScheme const& scheme, Vector const& discfactors,
+                               McParams const& mcparams)
+{
+  // all three products make a single payment, at the last fixing
+  if (auto euro = dynamic_pointer_cast<EuropeanCallPut>(prod))
+    return makeKernel(scheme, EuropeanKernelPayoff<REAL>(*euro), discfactors[0], mcparams);
+  if (auto digi = dynamic_pointer_cast<DigitalCallPut>(prod))
+    return makeKernel(scheme, DigitalKernelPayoff<REAL>(*digi), discfactors[0], mcparams);
+  if (auto asian = dynamic_pointer_cast<AsianBasketCallPut>(prod))
+    return makeKernel(scheme, AsianBasketKernelPayoff<REAL>(*asian), discfactors[0], mcparams);
+  return SPtrMcKernel();
+}
+
+}
+
+SPtrMcKernel makeBsMcKernel(SPtrProduct prod,
+                            Vector const& spots,
+                            Matrix const& drifts,
+                            Matrix const& stdevs,
+                            Matrix const& correlMatrix,
+                            Vector const& discfactors,
+                            McParams const& mcparams)
+{
+  size_t nassets = spots.size();
+  bool factormodel = mcparams.nCorrFactors > 0 && mcparams.nCorrFactors < nassets;
+  if (mcparams.pathGenType != McParams::PathGenType::EULER || mcparams.antithetic()
+      || mcparams.controlVariate() || mcparams.greeks || factormodel)
+    return SPtrMcKernel();
+
+  LogEulerScheme scheme(spots, drifts, stdevs, correlMatrix);
+  if (mcparams.precision == McParams::Precision::FLOAT)
+    return makeProductKernel<float>(prod, scheme, discfactors, mcparams);
+  return makeProductKernel<double>(prod, scheme, discfactors, mcparams);
+}
+
+END_NAMESPACE(qf)
@@ -0,0 +1,34 @@
+/**
+@file  bsmckernels.hpp
+@brief The dispatcher of the fused Monte Carlo kernels of common products in the Black Scholes model
+*/
+
+#ifndef QF_BSMCKERNELS_HPP
+#define QF_BSMCKERNELS_HPP
+
+#include <qflib/products/product.hpp>
+#include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/methods/montecarlo/mckernel.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+/** Returns the fused kernel McKernel<NRNG, LogEulerScheme, PAYOFF> pricing the product in the multiasset
+    Black-Scholes model, instantiated for the urng type of mcparams and the payoff of the product,
+    or a null pointer if there is none, in which case the pricer runs its generic path.
+    There are kernels for EuropeanCallPut, DigitalCallPut and AsianBasketCallPut with Euler paths,
+    without antithetic paths, control variates, Greeks or a correlation factor model.
+    The drifts and standard deviations are those of each fixing time, one column per asset,
+    and discfactors those of the payment times of the product.
+    With McParams::Precision::FLOAT, the kernel simulates the paths and evaluates the payoff in float.
+*/
+SPtrMcKernel makeBsMcKernel(SPtrProduct prod,
+                            Vector const& spots,
+                            Matrix const& drifts,
+                            Matrix const& stdevs,
+                            Matrix const& correlMatrix,
+                            Vector const& discfactors,
+                            McParams const& mcparams);
+
+END_NAMESPACE(qf)
+
+#endif // QF_BSMCKERNELS_HPP
@@ -4,6 +4,10 @@
 */
 
 #include <qflib/pricers/bsmcpricer.hpp>
+#include <qflib/pricers/bsmckernels.hpp>
+#include <qflib/pricers/simplepricers.hpp>
+#include <qflib/products/europeancallput.hpp>
+#include <qflib/products/digitalcallput.hpp>
 #include <cmath>
 
 using namespace std;
@@ -27,22 +31,42 @@ spot_(spot), mcparams_(mcparams)
   if (mcparams.pathGenType == McParams::PathGenType::EULER) {
     if (mcparams.urngType == McParams::UrngType::MINSTDRAND)
       pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMinStdRand>(
-          timesteps.begin(), timesteps.end(), 1));
+          timesteps.begin(), timesteps.end(), 1, Matrix(), mcparams.normalGenType));
     else if (mcparams.urngType == McParams::UrngType::MT19937)
       pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMt19937>(
-          timesteps.begin(), timesteps.end(), 1));
+          timesteps.begin(), timesteps.end(), 1, Matrix(), mcparams.normalGenType));
     else if (mcparams.urngType == McParams::UrngType::RANLUX3)
       pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux3>(
-          timesteps.begin(), timesteps.end(), 1));
+          timesteps.begin(), timesteps.end(), 1, Matrix(), mcparams.normalGenType));
     else if (mcparams.urngType == McParams::UrngType::RANLUX4)
       pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux4>(
-          timesteps.begin(), timesteps.end(), 1));
+          timesteps.begin(), timesteps.end(), 1, Matrix(), mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::PHILOX4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngPhilox4x32>(
+          timesteps.begin(), timesteps.end(), 1, Matrix(), mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::THREEFRY4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngThreefry4x32>(
+          timesteps.begin(), timesteps.end(), 1, Matrix(), mcparams.normalGenType));
     else
       QF_ASSERT(0, "unknown urng type!");
   }
+  else if (mcparams.pathGenType == McParams::PathGenType::SOBOL)
+    pathgen_ = SPtrPathGenerator(new SobolPathGenerator(
+        timesteps.begin(), timesteps.end(), 1, Matrix(), mcparams.scrambleType));
   else
     QF_ASSERT(0, "unknown path generator type!");
 
+  if (mcparams.antithetic()) {
+    QF_ASSERT(mcparams.blockSize % 2 == 0, "the block size must be even with antithetic paths!");
+    pathgen_ = SPtrPathGenerator(new AntitheticPathGenerator(pathgen_));
+  }
+
+  // the Greeks need whole paths
+  streaming_ = mcparams.streamFixings && pathgen_->canStream() && !mcparams.greeks;
+  // the control variate needs the final spot of every path
+  settling_ = prod->canSettle() && prod->isIncremental() && pathgen_->canStream()
+    && !mcparams.greeks && !mcparams.controlVariate();
+
   // Pre-compute the discount factors
   Vector const& paytimes = prod->payTimes();
   discfactors_.resize(paytimes.size());
@@ -54,6 +78,7 @@ spot_(spot), mcparams_(mcparams)
   double t1 = 0.0;
   drifts_.resize(fixtimes.size());
   stdevs_.resize(fixtimes.size());
+  cumDrifts_.resize(fixtimes.size());
   for (size_t i = 0; i < fixtimes.size(); ++i) {
     double t2 = fixtimes[i];
     double var = vol_ * vol_ * (t2 - t1);
@@ -61,33 +86,288 @@ spot_(spot), mcparams_(mcparams)
     double fwdrate = discyc_->fwdRate(t1, t2);
     // risk free rate less yield plus convexity adjustment
     drifts_[i] = (fwdrate - divyld_) * (t2 - t1) - 0.5 * var;
+    cumDrifts_[i] = (i == 0 ? 0.0 : cumDrifts_[i - 1]) + drifts_[i];
     t1 = t2;
   }
 
-  // Resize the payment amounts
-  payamts_.resize(prod->payTimes().size());
+  if (mcparams.fusedKernels && !streaming_ && !settling_) {
+    Vector spots(1);
+    spots[0] = spot_;
+    kernel_ = makeBsMcKernel(prod, spots, drifts_, stdevs_, Matrix(), discfactors_, mcparams);
+  }
+  // FLOAT changes only the fused kernels, so it must not fall back silently to the double paths
+  QF_ASSERT(mcparams.precision == McParams::Precision::DOUBLE || kernel_,
+    "FLOAT precision needs a fused kernel: a European, digital or Asian basket product with EULER paths, "
+    "FUSEDKERNELS and no variance reduction, Greeks, correlation factors, streamed fixings or settling!");
+
+  pathwise_ = prod->hasPathDerivs();
+  if (mcparams.greeks)
+    QF_ASSERT(vol_ > 0.0, "the volatility must be positive to compute Greeks!");
 
+  initControlVariate();
 }
 
+void BsMcPricer::initControlVariate()
+{
+  cvPayoffType_ = 0;
+  cvStrike_ = 0.0;
+  cvMean_ = 0.0;
+  Vector const& fixtimes = prod_->fixTimes();
+  double T = fixtimes[fixtimes.size() - 1];
+  cvDiscount_ = discyc_->discount(T);
+  if (!mcparams_.controlVariate())
+    return;
 
-double BsMcPricer::processOnePath(Matrix& pricePath)
+  if (auto euro = std::dynamic_pointer_cast<EuropeanCallPut>(prod_)) {
+    cvPayoffType_ = euro->payoffType();
+    cvStrike_ = euro->strike();
+  }
+  else if (auto digi = std::dynamic_pointer_cast<DigitalCallPut>(prod_)) {
+    cvPayoffType_ = digi->payoffType();
+    cvStrike_ = digi->strike();
+  }
+
+  if (cvPayoffType_ != 0) {
+    // the continuously compounded rate consistent with the simulated discount factor
+    double rate = -log(cvDiscount_) / T;
+    cvMean_ = europeanOptionBS(cvPayoffType_, spot_, cvStrike_, T, rate, divyld_, vol_)[0];
+  }
+  else
+    cvMean_ = spot_ * exp(-divyld_ * T);
+}
+
+PathStoreKey BsMcPricer::pathStoreKey() const
 {
-  pathgen_->next(pricePath);
-  // convert the normal deviates to a price path in-place
-  double spot = spot_;
-  for (size_t i = 0; i < pricePath.n_rows; ++i) {
-    double normaldeviate = pricePath(i, 0);
-    pricePath(i, 0) = spot * exp(drifts_[i] + stdevs_[i] * normaldeviate);
-    spot = pricePath(i, 0);
-  }
-  prod_->eval(pricePath);
-  payamts_ = prod_->payAmounts();
-
-  double pv = 0.0;
-  for (size_t i = 0; i < payamts_.size(); ++i)
-    pv += discfactors_[i] * payamts_[i];
-
-  return pv;
+  return PathStoreKey(prod_->fixTimes(), pathgen_->nFactors(), pathgen_->correlation(), mcparams_);
+}
+
+SPtrPathStore BsMcPricer::makePathStore(unsigned long npaths, std::string const& fileName) const
+{
+  return PathStore::create(pathStoreKey(), *pathgen_, npaths, mcparams_, fileName);
+}
+
+void BsMcPricer::setPathStore(SPtrPathStore store)
+{
+  QF_ASSERT(!store || mcparams_.precision == McParams::Precision::DOUBLE,
+    "FLOAT precision does not support a path store, whose deviates are in double!");
+  if (store)
+    QF_ASSERT(store->key() == pathStoreKey(), "the path store was drawn with another key than this pricer's!");
+  pathStore_ = store;
+}
+
+BsMcPricer::Worker BsMcPricer::makeWorker() const
+{
+  Worker worker;
+  if (kernel_ && !pathStore_) {
+    worker.kernel = kernel_->clone();
+    return worker;
+  }
+  worker.pathgen = pathgen_->clone();
+  worker.prod = prod_->clone();
+  if (streaming_ && !pathStore_)
+    return worker;
+  if (settling_ && !pathStore_) {
+    size_t blocksize = mcparams_.blockSize;
+    worker.laneProds.resize(blocksize);
+    for (size_t p = 0; p < blocksize; ++p)
+      worker.laneProds[p] = prod_->clone();
+    worker.lanes.resize(blocksize);
+    worker.laneSpots.set_size(blocksize);
+    worker.laneDevs.set_size(blocksize);
+    return worker;
+  }
+  worker.pathBatch.set_size(mcparams_.blockSize, pathgen_->nTimeSteps() * pathgen_->nFactors());
+  if (mcparams_.greeks && !pathwise_) {
+    worker.lrDelta.set_size(mcparams_.blockSize);
+    worker.lrVega.set_size(mcparams_.blockSize);
+  }
+  return worker;
+}
+
+void BsMcPricer::processBlock(Worker& worker, size_t npaths, double* values,
+                              double const* storedDevs, size_t storedStride) const
+{
+  bool cv = mcparams_.controlVariate();
+  bool greeks = mcparams_.greeks;
+  size_t nvars = greeks ? 3 : 1;
+  size_t nvalues = cv ? nvars + 1 : nvars;
+  size_t ntimesteps = drifts_.size();
+
+  // the deviates are drawn into the block and turn into spots in place,
+  // or are read from the path store and turn into spots in the block
+  Matrix& pathBatch = worker.pathBatch;
+  if (storedDevs)
+    pathBatch.set_size(npaths, ntimesteps);
+  else
+    worker.pathgen->nextBatch(npaths, pathBatch);
+  double const* deviates = storedDevs ? storedDevs : pathBatch.memptr();
+  size_t devStride = storedDevs ? storedStride : pathBatch.n_rows;
+
+  // the likelihood ratio weights are the derivatives of the log density of the path,
+  // accumulated from the normal deviates z_i before they turn into spots:
+  // d/dS0 = z_1 / (S0 sigma sqrt(dt_1)) and d/dsigma = sum_i (z_i^2 - 1) / sigma - z_i sqrt(dt_i)
+  double* lrdelta = worker.lrDelta.memptr();
+  double* lrvega = worker.lrVega.memptr();
+  if (greeks && !pathwise_) {
+    double const* devs = deviates;
+    for (size_t p = 0; p < npaths; ++p) {
+      lrdelta[p] = devs[p] / (spot_ * stdevs_[0]);
+      lrvega[p] = 0.0;
+    }
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double sqrtdt = stdevs_[i] / vol_;
+      devs = deviates + i * devStride;
+      for (size_t p = 0; p < npaths; ++p)
+        lrvega[p] += (devs[p] * devs[p] - 1.0) / vol_ - devs[p] * sqrtdt;
+    }
+  }
+
+  // convert the normal deviates to price paths, one time step at a time for all paths
+  for (size_t i = 0; i < ntimesteps; ++i) {
+    double drift = drifts_[i];
+    double stdev = stdevs_[i];
+    double const* devs = deviates + i * devStride;
+    double* spots = pathBatch.colptr(i);
+    if (i == 0) {
+      for (size_t p = 0; p < npaths; ++p)
+        spots[p] = spot_ * exp(drift + stdev * devs[p]);
+    }
+    else {
+      double const* prevspots = pathBatch.colptr(i - 1);
+      for (size_t p = 0; p < npaths; ++p)
+        spots[p] = prevspots[p] * exp(drift + stdev * devs[p]);
+    }
+  }
+
+  // evaluate the product on each path, viewed in place in the block
+  Product& prod = *worker.prod;
+  Matrix const& pathDerivs = worker.pathDerivs;
+  Vector const& payamts = prod.payAmounts();
+  Vector const& fixtimes = prod_->fixTimes();
+  size_t stride = pathBatch.n_rows;
+  for (size_t p = 0; p < npaths; ++p) {
+    MatrixView pricePath(pathBatch.colptr(0) + p, ntimesteps, 1, stride, stride * ntimesteps);
+    if (greeks && pathwise_)
+      prod.evalPathDerivs(pricePath, discfactors_, worker.pathDerivs);
+    else
+      prod.eval(pricePath);
+
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    values[p * nvalues] = pv;
+
+    if (greeks && pathwise_) {
+      // S_i = S0 exp(D_i + sigma W_i), so dS_i/dS0 = S_i / S0 and dS_i/dsigma = S_i (W_i - sigma t_i)
+      double delta = 0.0, vega = 0.0;
+      for (size_t i = 0; i < ntimesteps; ++i) {
+        double S = pricePath(i, 0);
+        double W = (log(S / spot_) - cumDrifts_[i]) / vol_;
+        delta += pathDerivs(i, 0) * S;
+        vega += pathDerivs(i, 0) * S * (W - vol_ * fixtimes[i]);
+      }
+      values[p * nvalues + 1] = delta / spot_;
+      values[p * nvalues + 2] = vega;
+    }
+    else if (greeks) {
+      values[p * nvalues + 1] = pv * lrdelta[p];
+      values[p * nvalues + 2] = pv * lrvega[p];
+    }
+
+    if (cv) {
+      double S_T = pathBatch(p, ntimesteps - 1);
+      double payoff = S_T;
+      if (cvPayoffType_ != 0)
+        payoff = cvPayoffType_ * (S_T - cvStrike_) > 0.0 ? cvPayoffType_ * (S_T - cvStrike_) : 0.0;
+      values[p * nvalues + nvars] = cvDiscount_ * payoff;
+    }
+  }
+}
+
+void BsMcPricer::streamBlock(Worker& worker, size_t npaths, double* values) const
+{
+  bool cv = mcparams_.controlVariate();
+  size_t nvalues = cv ? 2 : 1;
+  size_t ntimesteps = drifts_.size();
+  PathGenerator& pathgen = *worker.pathgen;
+  Product& prod = *worker.prod;
+  Vector const& payamts = prod.payAmounts();
+
+  for (size_t p = 0; p < npaths; ++p) {
+    pathgen.beginPath();
+    prod.begin();
+    double spot = spot_;
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double dev;
+      pathgen.nextStep(i, &dev);
+      spot *= exp(drifts_[i] + stdevs_[i] * dev);
+      prod.onFixing(i, &spot);
+      // a settled path is not simulated any further
+      if (settling_ && prod.isSettled())
+        break;
+    }
+    prod.finish();
+
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    values[p * nvalues] = pv;
+
+    if (cv) {
+      double payoff = spot;
+      if (cvPayoffType_ != 0)
+        payoff = cvPayoffType_ * (spot - cvStrike_) > 0.0 ? cvPayoffType_ * (spot - cvStrike_) : 0.0;
+      values[p * nvalues + 1] = cvDiscount_ * payoff;
+    }
+  }
+}
+
+void BsMcPricer::settleBlock(Worker& worker, size_t npaths, double* values) const
+{
+  size_t ntimesteps = drifts_.size();
+  PathGenerator& pathgen = *worker.pathgen;
+  size_t* lanes = worker.lanes.data();
+  double* spots = worker.laneSpots.memptr();
+  double* devs = worker.laneDevs.memptr();
+
+  pathgen.beginBatch(npaths);
+  for (size_t p = 0; p < npaths; ++p) {
+    lanes[p] = p;
+    spots[p] = spot_;
+    worker.laneProds[p]->begin();
+  }
+
+  // step the paths still simulated for all of them, then fix each one and compact out the settled ones
+  size_t nlanes = npaths;
+  for (size_t i = 0; i < ntimesteps && nlanes > 0; ++i) {
+    pathgen.nextStepBatch(i, nlanes, lanes, devs);
+    double drift = drifts_[i];
+    double stdev = stdevs_[i];
+    for (size_t k = 0; k < nlanes; ++k)
+      spots[k] *= exp(drift + stdev * devs[k]);
+
+    size_t nkept = 0;
+    for (size_t k = 0; k < nlanes; ++k) {
+      Product& prod = *worker.laneProds[lanes[k]];
+      prod.onFixing(i, spots + k);
+      if (prod.isSettled())
+        continue;
+      lanes[nkept] = lanes[k];
+      spots[nkept] = spots[k];
+      ++nkept;
+    }
+    nlanes = nkept;
+  }
+
+  for (size_t p = 0; p < npaths; ++p) {
+    Product& prod = *worker.laneProds[p];
+    prod.finish();
+    Vector const& payamts = prod.payAmounts();
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    values[p] = pv;
+  }
 }
 
 END_NAMESPACE(qf)
@@ -11,7 +11,16 @@
 #include <qflib/methods/montecarlo/mcparams.hpp>
 #include <qflib/methods/montecarlo/pathgenerator.hpp>
 #include <qflib/methods/montecarlo/eulerpathgenerator.hpp>
+#include <qflib/methods/montecarlo/sobolpathgenerator.hpp>
+#include <qflib/methods/montecarlo/antitheticpathgenerator.hpp>
+#include <qflib/methods/montecarlo/pathblockrunner.hpp>
+#include <qflib/methods/montecarlo/variancereducer.hpp>
+#include <qflib/methods/montecarlo/mcruninfo.hpp>
+#include <qflib/methods/montecarlo/mckernel.hpp>
+#include <qflib/methods/montecarlo/pathstore.hpp>
 #include <qflib/math/stats/statisticscalculator.hpp>
+#include <chrono>
+#include <vector>
 
 BEGIN_NAMESPACE(qf)
 
@@ -28,19 +37,91 @@ public:
              double spot,
              McParams mcparams);
 
-  /** Returns the number of variables that can be tracked for stats */
+  /** Returns the number of variables that can be tracked for stats:
+      the PV, and with McParams::greeks, the delta and the vega
+  */
   size_t nVariables();
 
-  /** Runs the simulation and collects statistics */
+  /** Runs the simulation and collects statistics.
+      The paths are split over McParams::nThreads threads; the results do not depend on the thread count.
+      With antithetic pairs, npaths is rounded up to an even number and each sample is the average of a pair.
+      With a control variate, each sample is corrected by the control; see VarianceReducer.
+      With McParams::greeks, the delta and vega are estimated on the same paths: pathwise for products
+      with path derivatives, with the likelihood ratio method otherwise (e.g. digital options).
+      With McParams::fusedKernels, the products with a fused kernel are priced by it, see makeBsMcKernel;
+      in DOUBLE the paths are the same, to rounding, and in FLOAT the same paths as DOUBLE with INVCDF,
+      to float rounding; other paths than STDLIB, see McKernel.
+      With a path store set, the deviates are read from it in place, and the fused kernel is not used.
+      With McParams::streamFixings, Euler paths and no antithetic paths or Greeks, each path is simulated
+      one time step at a time and its fixings are streamed into the product, see streamBlock().
+      With a product that can settle before its last fixing (e.g. a knock-out or an autocallable), Euler paths
+      and no variance reduction or Greeks, the simulation of each path stops as soon as it is settled:
+      streamed paths end early, and otherwise the block is simulated one time step at a time with the settled
+      paths compacted out, see settleBlock(). The paths and the prices are the same as without settling, to rounding.
+      With the McParams tolerances or time budget set, npaths is the maximum number of paths
+      and the simulation stops as soon as a criterion is met.
+      Returns the number of paths used, the time spent and the standard error.
+  */
   template<typename ITER>
-  void simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths);
+  McRunInfo simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths);
+
+  /** Returns the key of the deviates this pricer draws, see PathStore */
+  PathStoreKey pathStoreKey() const;
+
+  /** Draws npaths paths of this pricer into a path store, kept in memory or written to the given file */
+  SPtrPathStore makePathStore(unsigned long npaths, std::string const& fileName = "") const;
+
+  /** Makes simulate() replay the deviates of the path store instead of drawing them, e.g. to price
+      scenarios of spots, vols or curves on common random numbers; the store must have the key
+      of this pricer and at least as many paths as simulated. A null store draws them again.
+  */
+  void setPathStore(SPtrPathStore store);
 
 protected:
 
-  /** Creates and processes one price path.
-      It returns the PV of the product
-      */
-  double processOnePath(Matrix& pricePath);
+  /** The state owned by one simulation thread */
+  struct Worker
+  {
+    SPtrPathGenerator pathgen;   // this thread's path generator
+    SPtrMcKernel kernel;         // this thread's fused kernel, if any; it then replaces the path generator and product
+    SPtrProduct prod;            // this thread's copy of the product
+    Matrix pathBatch;            // scratch block of paths, paths innermost
+    Matrix pathDerivs;           // scratch, derivatives of the PV with respect to the price path
+    Vector lrDelta, lrVega;      // scratch, likelihood ratio weights of each path
+    std::vector<SPtrProduct> laneProds;  // a copy of the product per path of a block, for settleBlock()
+    std::vector<size_t> lanes;   // scratch, the paths still simulated by settleBlock(), compacted
+    Vector laneSpots;            // scratch, the current spots of the paths still simulated
+    Vector laneDevs;             // scratch, the deviates of a time step of the paths still simulated
+  };
+
+  /** Creates the state of one simulation thread */
+  Worker makeWorker() const;
+
+  /** Creates and processes a block of npaths price paths, from the path generator, or from the deviates
+      of a path store, column c of the block at storedDevs + c * storedStride.
+      It writes the PV of the product on each path into values[p * nvalues], with McParams::greeks
+      its delta and vega into values[p * nvalues + 1] and values[p * nvalues + 2],
+      and with a control variate, the PV of the control into values[p * nvalues + nVariables()].
+  */
+  void processBlock(Worker& worker, size_t npaths, double* values,
+                    double const* storedDevs = nullptr, size_t storedStride = 0) const;
+
+  /** Simulates npaths paths one at a time, one time step at a time, streaming the fixings into the product,
+      without storing the paths. It writes the same values as processBlock(), on the same paths, to rounding.
+  */
+  void streamBlock(Worker& worker, size_t npaths, double* values) const;
+
+  /** Simulates a block of npaths paths one time step at a time, each path evaluated incrementally by its own copy
+      of the product; after each fixing, the settled paths are compacted out, so that no more spots are computed
+      for them, nor, with a counter-based urng, deviates drawn. It writes the PV of each path into values[p],
+      on the same paths as processBlock(), see EulerPathGenerator.
+  */
+  void settleBlock(Worker& worker, size_t npaths, double* values) const;
+
+  /** Sets up the control variate: a European call/put with the product's strike and expiration
+      for European and digital products, the discounted final spot otherwise
+  */
+  void initControlVariate();
 
 private:
   SPtrProduct prod_;      // pointer to the product
@@ -51,11 +132,20 @@ private:
   McParams mcparams_;     // the Monte Carlo parameters
 
   SPtrPathGenerator pathgen_;  // pointer to the path generator
+  SPtrMcKernel kernel_;        // the fused kernel of the product, null if it has none, see makeBsMcKernel
+  SPtrPathStore pathStore_;    // the path store replayed by simulate(), if any
+  bool streaming_;             // whether simulate() streams the fixings of each path, see streamBlock()
+  bool settling_;              // whether simulate() stops simulating the settled paths, see settleBlock()
   Vector discfactors_;         // caches the pre-computed discount factors
   Vector drifts_;              // caches the pre-computed asset drifts
   Vector stdevs_;              // caches the pre-computed standard deviations 
+  Vector cumDrifts_;           // caches the drifts accumulated up to each fixing time
+  bool pathwise_;              // whether the Greeks are pathwise, or likelihood ratio estimates
 
-  Vector payamts_;             // scratch array for writing the payments after each simulation
+  int cvPayoffType_;           // control variate, 1: call; -1: put; 0: discounted final spot
+  double cvStrike_;            // control variate strike
+  double cvDiscount_;          // control variate discount factor, to the last fixing time
+  double cvMean_;              // control variate expectation
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -64,22 +154,61 @@ private:
 inline
 size_t BsMcPricer::nVariables()
 {
-  return 1;
+  return mcparams_.greeks ? 3 : 1;
 }
 
 template<typename ITER>
-void BsMcPricer::simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths)
+McRunInfo BsMcPricer::simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths)
 {
-  // create the price path matrix
-  Matrix pricePath(pathgen_->nTimeSteps(), pathgen_->nFactors());
   // check the size of the statistics calcuilator
-  QF_ASSERT(statsCalc.nVariables() == nVariables(), "the statistics calculator must track only one variable!");
-
-  // This is the HOT loop
-  for (unsigned long i = 0; i < npaths; ++i) {
-    double pv = processOnePath(pricePath);
-    statsCalc.addSample(&pv, &pv + 1);
-  }
+  QF_ASSERT(statsCalc.nVariables() == nVariables(), "the statistics calculator must track as many variables as the pricer captures!");
+
+  VarianceReducer reducer(mcparams_.antithetic(), mcparams_.controlVariate(), cvMean_, nVariables());
+  if (mcparams_.antithetic() && npaths % 2 != 0)
+    ++npaths;
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [start]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  bool converged = false;
+  unsigned long nallocs = 0;
+
+  if (pathStore_)
+    QF_ASSERT(npaths <= pathStore_->nPaths(), "the path store holds fewer paths than requested!");
+
+  unsigned long nused = runPathBlocks(npaths, reducer.nValues(), mcparams_,
+    [this]() { return makeWorker(); },
+    [this](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double* values) {
+      if (pathStore_) {
+        processBlock(worker, nBlockPaths, values, pathStore_->block(firstPath), pathStore_->blockRows(firstPath));
+        return;
+      }
+      if (worker.kernel) {
+        worker.kernel->seed(mcparams_.seed, firstPath);
+        worker.kernel->run(nBlockPaths, values, 1);
+        return;
+      }
+      worker.pathgen->seed(mcparams_.seed, firstPath);
+      if (streaming_) {
+        streamBlock(worker, nBlockPaths, values);
+        return;
+      }
+      if (settling_) {
+        settleBlock(worker, nBlockPaths, values);
+        return;
+      }
+      processBlock(worker, nBlockPaths, values);
+    },
+    [&](double* values, size_t nBlockPaths) {
+      reducer.feed(values, nBlockPaths, statsCalc);
+      converged = reducer.nSamples() > 1 && mcparams_.toleranceMet(reducer.mean(), reducer.stdErr());
+      bool outoftime = mcparams_.maxSeconds > 0.0 && elapsed() >= mcparams_.maxSeconds;
+      return !converged && !outoftime;
+    },
+    &nallocs);
+
+  return McRunInfo{ nused, elapsed(), reducer.stdErr(), converged, nallocs };
 }
 
 END_NAMESPACE(qf)
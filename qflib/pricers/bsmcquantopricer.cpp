@@ -0,0 +1,296 @@
+/**
+@file  bsmcquantopricer.cpp
+@brief Implementation of the BsMcQuantoPricer class
+*/
+
+#include <qflib/pricers/bsmcquantopricer.hpp>
+#include <qflib/pricers/bsmckernels.hpp>
+#include <qflib/pricers/simplepricers.hpp>
+#include <qflib/products/europeancallput.hpp>
+#include <qflib/products/digitalcallput.hpp>
+#include <qflib/methods/montecarlo/eulerpathgenerator.hpp>
+#include <qflib/methods/montecarlo/sobolpathgenerator.hpp>
+#include <qflib/methods/montecarlo/antitheticpathgenerator.hpp>
+#include <cmath>
+
+using namespace std;
+
+BEGIN_NAMESPACE(qf)
+
+BsMcQuantoPricer::BsMcQuantoPricer(SPtrProduct prod,
+                                   SPtrYieldCurve discountCurve,
+                                   SPtrYieldCurve growthCurve,
+                                   double divYield,
+                                   double assetVol,
+                                   double fxVol,
+                                   double correl,
+                                   double spot,
+                                   McParams mcparams,
+                                   double fxSpot)
+: prod_(prod), discyc_(discountCurve), growyc_(growthCurve), divyld_(divYield), vol_(assetVol),
+  fxvol_(fxVol), correl_(correl), spot_(spot), fxspot_(fxSpot), mcparams_(mcparams)
+{
+  QF_ASSERT(assetVol >= 0.0, "the asset volatility must be non-negative!");
+  QF_ASSERT(fxVol >= 0.0, "the FX volatility must be non-negative!");
+  QF_ASSERT(correl >= -1.0 && correl <= 1.0, "the asset/FX correlation must be in [-1, 1]!");
+  QF_ASSERT(fxSpot > 0.0, "the FX rate must be positive!");
+  nfactors_ = prod->nAssets();
+  QF_ASSERT(nfactors_ == 1 || nfactors_ == 2, "the product must depend on the asset, or on the asset and the FX rate!");
+
+  // Get the simulation times
+  Vector timesteps = prod->fixTimes();
+  size_t ntimesteps = timesteps.size();
+
+  // the asset and the FX rate are correlated factors
+  Matrix correlMat;
+  if (nfactors_ == 2) {
+    correlMat.eye(2, 2);
+    correlMat(0, 1) = correlMat(1, 0) = correl_;
+  }
+
+  // Create the path generator, one factor per simulated price
+  if (mcparams.pathGenType == McParams::PathGenType::EULER) {
+    if (mcparams.urngType == McParams::UrngType::MINSTDRAND)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMinStdRand>(
+          timesteps.begin(), timesteps.end(), nfactors_, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::MT19937)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMt19937>(
+          timesteps.begin(), timesteps.end(), nfactors_, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX3)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux3>(
+          timesteps.begin(), timesteps.end(), nfactors_, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX4)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux4>(
+          timesteps.begin(), timesteps.end(), nfactors_, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::PHILOX4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngPhilox4x32>(
+          timesteps.begin(), timesteps.end(), nfactors_, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::THREEFRY4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngThreefry4x32>(
+          timesteps.begin(), timesteps.end(), nfactors_, correlMat, mcparams.normalGenType));
+    else
+      QF_ASSERT(0, "unknown urng type!");
+  }
+  else if (mcparams.pathGenType == McParams::PathGenType::SOBOL)
+    pathgen_ = SPtrPathGenerator(new SobolPathGenerator(
+        timesteps.begin(), timesteps.end(), nfactors_, correlMat, mcparams.scrambleType));
+  else
+    QF_ASSERT(0, "unknown path generator type!");
+
+  if (mcparams.antithetic()) {
+    QF_ASSERT(mcparams.blockSize % 2 == 0, "the block size must be even with antithetic paths!");
+    pathgen_ = SPtrPathGenerator(new AntitheticPathGenerator(pathgen_));
+  }
+
+  // Pre-compute the discount factors, in the payment currency
+  Vector const& paytimes = prod->payTimes();
+  discfactors_.resize(paytimes.size());
+  for (size_t i = 0; i < paytimes.size(); ++i)
+    discfactors_[i] = discyc_->discount(paytimes[i]);
+
+  // Pre-compute the stdevs and drifts from time step to time step:
+  // the asset drifts at r_f - q + rho sigma_S sigma_X, the FX rate at r_f - r_d + sigma_X^2
+  Vector const& fixtimes = prod->fixTimes();
+  drifts_.resize(ntimesteps, nfactors_);
+  stdevs_.resize(ntimesteps, nfactors_);
+  cumDrifts_.resize(ntimesteps);
+  double quantoAdj = correl_ * vol_ * fxvol_;
+  double t1 = 0.0;
+  for (size_t i = 0; i < ntimesteps; ++i) {
+    double t2 = fixtimes[i];
+    double dt = t2 - t1;
+    double growrate = growyc_->fwdRate(t1, t2);
+    double var = vol_ * vol_ * dt;
+    stdevs_(i, 0) = sqrt(var);
+    drifts_(i, 0) = (growrate - divyld_ + quantoAdj) * dt - 0.5 * var;
+    cumDrifts_[i] = (i == 0 ? 0.0 : cumDrifts_[i - 1]) + drifts_(i, 0);
+    if (nfactors_ == 2) {
+      double fxvar = fxvol_ * fxvol_ * dt;
+      stdevs_(i, 1) = sqrt(fxvar);
+      drifts_(i, 1) = (growrate - discyc_->fwdRate(t1, t2)) * dt + 0.5 * fxvar;
+    }
+    t1 = t2;
+  }
+
+  if (mcparams.fusedKernels) {
+    Vector spots(nfactors_);
+    spots[0] = spot_;
+    if (nfactors_ == 2)
+      spots[1] = fxspot_;
+    kernel_ = makeBsMcKernel(prod, spots, drifts_, stdevs_, correlMat, discfactors_, mcparams);
+  }
+  // FLOAT changes only the fused kernels, so it must not fall back silently to the double paths
+  QF_ASSERT(mcparams.precision == McParams::Precision::DOUBLE || kernel_,
+    "FLOAT precision needs a fused kernel: a European, digital or Asian basket product with EULER paths, "
+    "FUSEDKERNELS and no variance reduction, Greeks, correlation factors, streamed fixings or settling!");
+
+  pathwise_ = prod->hasPathDerivs();
+  if (mcparams.greeks) {
+    QF_ASSERT(nfactors_ == 1, "the quanto Greeks need a product on the asset alone!");
+    QF_ASSERT(vol_ > 0.0, "the asset volatility must be positive to compute Greeks!");
+  }
+
+  initControlVariate();
+}
+
+void BsMcQuantoPricer::initControlVariate()
+{
+  cvPayoffType_ = 0;
+  cvStrike_ = 0.0;
+  cvMean_ = 0.0;
+  Vector const& fixtimes = prod_->fixTimes();
+  double T = fixtimes[fixtimes.size() - 1];
+  cvDiscount_ = discyc_->discount(T);
+  if (!mcparams_.controlVariate())
+    return;
+
+  if (nfactors_ == 1) {
+    if (auto euro = std::dynamic_pointer_cast<EuropeanCallPut>(prod_)) {
+      cvPayoffType_ = euro->payoffType();
+      cvStrike_ = euro->strike();
+    }
+    else if (auto digi = std::dynamic_pointer_cast<DigitalCallPut>(prod_)) {
+      cvPayoffType_ = digi->payoffType();
+      cvStrike_ = digi->strike();
+    }
+  }
+
+  // the quanto forward of the asset, consistent with the simulated drifts
+  double fwd = spot_ * exp(cumDrifts_[cumDrifts_.size() - 1] + 0.5 * vol_ * vol_ * T);
+  if (cvPayoffType_ != 0) {
+    // the continuously compounded rate and yield consistent with the discount factor and forward
+    double rate = -log(cvDiscount_) / T;
+    double yield = rate - log(fwd / spot_) / T;
+    cvMean_ = europeanOptionBS(cvPayoffType_, spot_, cvStrike_, T, rate, yield, vol_)[0];
+  }
+  else
+    cvMean_ = cvDiscount_ * fwd;
+}
+
+BsMcQuantoPricer::Worker BsMcQuantoPricer::makeWorker() const
+{
+  Worker worker;
+  if (kernel_) {
+    worker.kernel = kernel_->clone();
+    return worker;
+  }
+  worker.pathgen = pathgen_->clone();
+  worker.prod = prod_->clone();
+  worker.pathBatch.set_size(mcparams_.blockSize, pathgen_->nTimeSteps() * pathgen_->nFactors());
+  if (mcparams_.greeks && !pathwise_) {
+    worker.lrDelta.set_size(mcparams_.blockSize);
+    worker.lrVega.set_size(mcparams_.blockSize);
+    worker.lrW.set_size(mcparams_.blockSize);
+  }
+  return worker;
+}
+
+void BsMcQuantoPricer::processBlock(Worker& worker, size_t npaths, double* values) const
+{
+  bool cv = mcparams_.controlVariate();
+  bool greeks = mcparams_.greeks;
+  size_t nvars = greeks ? 5 : 1;
+  size_t nvalues = cv ? nvars + 1 : nvars;
+  size_t ntimesteps = drifts_.n_rows;
+
+  Matrix& pathBatch = worker.pathBatch;
+  worker.pathgen->nextBatch(npaths, pathBatch);
+
+  // the likelihood ratio weights are the derivatives of the log density of the path, accumulated
+  // from the normal deviates z_i of the asset before they turn into spots: d/dS0 = z_1 / (S0 sigma_S sqrt(dt_1))
+  // and d/dsigma_S = sum_i (z_i^2 - 1) / sigma_S + z_i sqrt(dt_i) (rho sigma_X / sigma_S - 1).
+  // The FX vol and the correlation only move the drift, by rho sigma_S sigma_X dt_i per step,
+  // so their weights are rho W_T and sigma_X W_T, with W_T = sum_i z_i sqrt(dt_i)
+  double* lrdelta = worker.lrDelta.memptr();
+  double* lrvega = worker.lrVega.memptr();
+  double* lrw = worker.lrW.memptr();
+  if (greeks && !pathwise_) {
+    double vegaAdj = correl_ * fxvol_ / vol_ - 1.0;
+    double const* devs = pathBatch.colptr(0);
+    for (size_t p = 0; p < npaths; ++p) {
+      lrdelta[p] = devs[p] / (spot_ * stdevs_(0, 0));
+      lrvega[p] = 0.0;
+      lrw[p] = 0.0;
+    }
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double sqrtdt = stdevs_(i, 0) / vol_;
+      devs = pathBatch.colptr(i);
+      for (size_t p = 0; p < npaths; ++p) {
+        lrvega[p] += (devs[p] * devs[p] - 1.0) / vol_ + devs[p] * sqrtdt * vegaAdj;
+        lrw[p] += devs[p] * sqrtdt;
+      }
+    }
+  }
+
+  // convert the normal deviates to price paths in place, one factor and time step at a time for all paths
+  for (size_t j = 0; j < nfactors_; ++j) {
+    double spot0 = j == 0 ? spot_ : fxspot_;
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double drift = drifts_(i, j);
+      double stdev = stdevs_(i, j);
+      double* spots = pathBatch.colptr(j * ntimesteps + i);
+      if (i == 0) {
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = spot0 * exp(drift + stdev * spots[p]);
+      }
+      else {
+        double const* prevspots = pathBatch.colptr(j * ntimesteps + i - 1);
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = prevspots[p] * exp(drift + stdev * spots[p]);
+      }
+    }
+  }
+
+  // evaluate the product on each path, viewed in place in the block
+  Product& prod = *worker.prod;
+  Matrix const& pathDerivs = worker.pathDerivs;
+  Vector const& payamts = prod.payAmounts();
+  Vector const& fixtimes = prod_->fixTimes();
+  size_t stride = pathBatch.n_rows;
+  for (size_t p = 0; p < npaths; ++p) {
+    MatrixView pricePath(pathBatch.colptr(0) + p, ntimesteps, nfactors_, stride, stride * ntimesteps);
+    if (greeks && pathwise_)
+      prod.evalPathDerivs(pricePath, discfactors_, worker.pathDerivs);
+    else
+      prod.eval(pricePath);
+
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    values[p * nvalues] = pv;
+
+    if (greeks && pathwise_) {
+      // S_i = S0 exp(D_i + sigma_S W_i), with D_i including rho sigma_S sigma_X t_i, so
+      // dS_i/dS0 = S_i / S0, dS_i/dsigma_S = S_i (W_i - sigma_S t_i + rho sigma_X t_i),
+      // dS_i/dsigma_X = S_i rho sigma_S t_i and dS_i/drho = S_i sigma_S sigma_X t_i
+      double delta = 0.0, vega = 0.0, drift = 0.0;
+      for (size_t i = 0; i < ntimesteps; ++i) {
+        double S = pricePath(i, 0);
+        double W = (log(S / spot_) - cumDrifts_[i]) / vol_;
+        delta += pathDerivs(i, 0) * S;
+        vega += pathDerivs(i, 0) * S * (W - (vol_ - correl_ * fxvol_) * fixtimes[i]);
+        drift += pathDerivs(i, 0) * S * fixtimes[i];
+      }
+      values[p * nvalues + 1] = delta / spot_;
+      values[p * nvalues + 2] = vega;
+      values[p * nvalues + 3] = drift * correl_ * vol_;
+      values[p * nvalues + 4] = drift * vol_ * fxvol_;
+    }
+    else if (greeks) {
+      values[p * nvalues + 1] = pv * lrdelta[p];
+      values[p * nvalues + 2] = pv * lrvega[p];
+      values[p * nvalues + 3] = pv * correl_ * lrw[p];
+      values[p * nvalues + 4] = pv * fxvol_ * lrw[p];
+    }
+
+    if (cv) {
+      double S_T = pathBatch(p, ntimesteps - 1);
+      double payoff = S_T;
+      if (cvPayoffType_ != 0)
+        payoff = cvPayoffType_ * (S_T - cvStrike_) > 0.0 ? cvPayoffType_ * (S_T - cvStrike_) : 0.0;
+      values[p * nvalues + nvars] = cvDiscount_ * payoff;
+    }
+  }
+}
+
+END_NAMESPACE(qf)
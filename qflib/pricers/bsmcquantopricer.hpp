@@ -0,0 +1,175 @@
+/**
+@file  bsmcquantopricer.hpp
+@brief Monte Carlo pricer of quanto products in the Black Scholes model
+*/
+
+#ifndef QF_BSMCQUANTOPRICER_HPP
+#define QF_BSMCQUANTOPRICER_HPP
+
+#include <qflib/products/product.hpp>
+#include <qflib/market/yieldcurve.hpp>
+#include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <qflib/methods/montecarlo/pathblockrunner.hpp>
+#include <qflib/methods/montecarlo/variancereducer.hpp>
+#include <qflib/methods/montecarlo/mcruninfo.hpp>
+#include <qflib/methods/montecarlo/mckernel.hpp>
+#include <qflib/math/stats/statisticscalculator.hpp>
+#include <chrono>
+
+BEGIN_NAMESPACE(qf)
+
+/** Monte Carlo pricer of quanto products in the Black-Scholes model (deterministic rates and vols).
+    The asset S grows at the rates of the growth (foreign) curve and pays the dividend yield; the product
+    pays in the discount (domestic) currency. The FX rate X is the price of one unit of the payment currency
+    in the asset currency, with volatility fxVol and correlation correl to the asset, so that under the
+    domestic measure the asset drift is adjusted by +correl * assetVol * fxVol, as in quantoEuropeanOptionBS,
+    and the FX drift is r_f - r_d + fxVol^2.
+    A product on one asset is a quanto on S; a product on two assets sees the price paths of S and of X,
+    e.g. to pay an asset converted at the FX rate. The two are simulated jointly, as two correlated factors
+    of one path generator; for a product on S alone, the FX factor only enters through the drift adjustment,
+    which is its exact effect on S, so it is not drawn.
+*/
+class BsMcQuantoPricer
+{
+public:
+  /** Initializing ctor, with the initial FX rate */
+  BsMcQuantoPricer(SPtrProduct prod,
+                   SPtrYieldCurve discountYieldCurve,
+                   SPtrYieldCurve growthYieldCurve,
+                   double divYield,
+                   double assetVol,
+                   double fxVol,
+                   double correl,
+                   double spot,
+                   McParams mcparams,
+                   double fxSpot = 1.0);
+
+  /** Returns the number of variables that can be tracked for stats: the PV, and with McParams::greeks,
+      the delta and the vega of the asset, the sensitivity to the FX volatility and to the correlation
+  */
+  size_t nVariables();
+
+  /** Runs the simulation and collects statistics.
+      The paths are split over McParams::nThreads threads; the results do not depend on the thread count.
+      With antithetic pairs, npaths is rounded up to an even number and each sample is the average of a pair.
+      With a control variate, each sample is corrected by the control; see VarianceReducer.
+      With McParams::greeks, the sensitivities are estimated on the same paths: pathwise for products
+      with path derivatives, with the likelihood ratio method otherwise (e.g. digital options).
+      They need a product on the asset alone, as the FX vol and the correlation then only move its drift.
+      With McParams::fusedKernels, the products with a fused kernel are priced by it, see makeBsMcKernel;
+      in DOUBLE the paths are the same, to rounding, and in FLOAT the same paths as DOUBLE with INVCDF,
+      to float rounding; other paths than STDLIB, see McKernel.
+      With the McParams tolerances or time budget set, npaths is the maximum number of paths
+      and the simulation stops as soon as a criterion is met.
+      Returns the number of paths used, the time spent and the standard error.
+  */
+  template<typename ITER>
+  McRunInfo simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths);
+
+protected:
+
+  /** The state owned by one simulation thread */
+  struct Worker
+  {
+    SPtrPathGenerator pathgen;   // this thread's path generator
+    SPtrMcKernel kernel;         // this thread's fused kernel, if any; it then replaces the path generator and product
+    SPtrProduct prod;            // this thread's copy of the product
+    Matrix pathBatch;            // scratch block of paths, paths innermost
+    Matrix pathDerivs;           // scratch, derivatives of the PV with respect to the price path
+    Vector lrDelta, lrVega;      // scratch, likelihood ratio weights of each path
+    Vector lrW;                  // scratch, the Brownian motion of the asset at expiry of each path
+  };
+
+  /** Creates the state of one simulation thread */
+  Worker makeWorker() const;
+
+  /** Creates and processes a block of npaths price paths.
+      It writes the PV of the product on each path into values[p * nvalues], with McParams::greeks
+      the delta, vega, FX vega and correlation sensitivity into values[p * nvalues + 1], ..., values[p * nvalues + 4],
+      and with a control variate, the PV of the control into values[p * nvalues + nVariables()].
+  */
+  void processBlock(Worker& worker, size_t npaths, double* values) const;
+
+  /** Sets up the control variate: a quanto European call/put with the product's strike and expiration
+      for European and digital products, the discounted final asset spot otherwise
+  */
+  void initControlVariate();
+
+private:
+  SPtrProduct prod_;      // pointer to the product
+  SPtrYieldCurve discyc_; // pointer to the discount (domestic) curve
+  SPtrYieldCurve growyc_; // pointer to the growth (foreign) curve
+  double divyld_;         // the constant dividend yield
+  double vol_;            // the constant asset volatility
+  double fxvol_;          // the constant FX volatility
+  double correl_;         // the asset/FX correlation
+  double spot_;           // the initial asset spot
+  double fxspot_;         // the initial FX rate
+  McParams mcparams_;     // the Monte Carlo parameters
+
+  size_t nfactors_;            // 1: the asset; 2: the asset and the FX rate
+  SPtrPathGenerator pathgen_;  // pointer to the path generator
+  SPtrMcKernel kernel_;        // the fused kernel of the product, null if it has none, see makeBsMcKernel
+  Vector discfactors_;         // caches the pre-computed discount factors
+  Matrix drifts_;              // caches the pre-computed drifts, one column per factor
+  Matrix stdevs_;              // caches the pre-computed standard deviations, one column per factor
+  Vector cumDrifts_;           // caches the asset drifts accumulated up to each fixing time
+  bool pathwise_;              // whether the Greeks are pathwise, or likelihood ratio estimates
+
+  int cvPayoffType_;           // control variate, 1: call; -1: put; 0: discounted final spot
+  double cvStrike_;            // control variate strike
+  double cvDiscount_;          // control variate discount factor, to the last fixing time
+  double cvMean_;              // control variate expectation
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+size_t BsMcQuantoPricer::nVariables()
+{
+  return mcparams_.greeks ? 5 : 1;
+}
+
+template<typename ITER>
+McRunInfo BsMcQuantoPricer::simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths)
+{
+  QF_ASSERT(statsCalc.nVariables() == nVariables(), "the statistics calculator must track as many variables as the pricer captures!");
+
+  VarianceReducer reducer(mcparams_.antithetic(), mcparams_.controlVariate(), cvMean_, nVariables());
+  if (mcparams_.antithetic() && npaths % 2 != 0)
+    ++npaths;
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [start]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  bool converged = false;
+  unsigned long nallocs = 0;
+
+  unsigned long nused = runPathBlocks(npaths, reducer.nValues(), mcparams_,
+    [this]() { return makeWorker(); },
+    [this](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double* values) {
+      if (worker.kernel) {
+        worker.kernel->seed(mcparams_.seed, firstPath);
+        worker.kernel->run(nBlockPaths, values, 1);
+        return;
+      }
+      worker.pathgen->seed(mcparams_.seed, firstPath);
+      processBlock(worker, nBlockPaths, values);
+    },
+    [&](double* values, size_t nBlockPaths) {
+      reducer.feed(values, nBlockPaths, statsCalc);
+      converged = reducer.nSamples() > 1 && mcparams_.toleranceMet(reducer.mean(), reducer.stdErr());
+      bool outoftime = mcparams_.maxSeconds > 0.0 && elapsed() >= mcparams_.maxSeconds;
+      return !converged && !outoftime;
+    },
+    &nallocs);
+
+  return McRunInfo{ nused, elapsed(), reducer.stdErr(), converged, nallocs };
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_BSMCQUANTOPRICER_HPP
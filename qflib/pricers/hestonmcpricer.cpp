@@ -0,0 +1,23 @@
+/**
+@file  hestonmcpricer.cpp
+@brief Implementation of the HestonMcPricer class
+*/
+
+#include <qflib/pricers/hestonmcpricer.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+HestonMcPricer::HestonMcPricer(SPtrProduct prod,
+                               SPtrYieldCurve discountCurve,
+                               double divYield,
+                               HestonParams const& params,
+                               double spot,
+                               McParams const& mcparams,
+                               size_t nsteps)
+: SingleAssetMcPricer(prod, discountCurve, divYield, spot, mcparams, nsteps, 2, "Heston"), params_(params)
+{
+  // factor 0 of the deviates drives the asset and 1 the variance
+  pathgen_ = SPtrPathGenerator(new HestonPathGenerator(devgen_, simTimes_, fixSteps_, params_, spot_, logDrifts_));
+}
+
+END_NAMESPACE(qf)
@@ -0,0 +1,45 @@
+/**
+@file  hestonmcpricer.hpp
+@brief Monte Carlo pricer in the Heston stochastic volatility model
+*/
+
+#ifndef QF_HESTONMCPRICER_HPP
+#define QF_HESTONMCPRICER_HPP
+
+#include <qflib/pricers/singleassetmcpricer.hpp>
+#include <qflib/methods/montecarlo/hestonpathgenerator.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+/** Monte Carlo pricer of single asset products in the Heston model (deterministic rates),
+    with the paths of HestonPathGenerator.
+    McParams::urngType and pathGenType select the generator of the normal deviates under the QE scheme,
+    Euler or Sobol; McParams::greeks and FLOAT precision are rejected, and fusedKernels does not apply.
+    The mean of the control variate, the spot discounted at the dividend yield, is exact only where
+    the martingale correction of the QE scheme applies. Andersen's correction needs 2 A a < 1 in the
+    quadratic region and A < beta in the exponential one, with A = K2 + K4 / 2; elsewhere the step falls back
+    to the uncorrected drift and the control variate biases the price by the drift error of the discounted spot.
+    Both conditions always hold for rho <= 0, where A <= 0; with a positive rho, a high xi and long steps,
+    prefer more steps or no control variate.
+*/
+class HestonMcPricer : public SingleAssetMcPricer
+{
+public:
+  /** Initializing ctor. The simulation takes at least nsteps equal steps up to the last fixing time,
+      and steps to every fixing time; with nsteps = 0, it steps from fixing time to fixing time.
+  */
+  HestonMcPricer(SPtrProduct prod,
+                 SPtrYieldCurve discountYieldCurve,
+                 double divYield,
+                 HestonParams const& params,
+                 double spot,
+                 McParams const& mcparams,
+                 size_t nsteps = 0);
+
+private:
+  HestonParams params_;        // the Heston model parameters
+};
+
+END_NAMESPACE(qf)
+
+#endif // QF_HESTONMCPRICER_HPP
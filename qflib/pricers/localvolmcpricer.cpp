@@ -0,0 +1,23 @@
+/**
+@file  localvolmcpricer.cpp
+@brief Implementation of the LocalVolMcPricer class
+*/
+
+#include <qflib/pricers/localvolmcpricer.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+LocalVolMcPricer::LocalVolMcPricer(SPtrProduct prod,
+                                   SPtrYieldCurve discountCurve,
+                                   double divYield,
+                                   SPtrLocalVolSurface localVolSurface,
+                                   double spot,
+                                   McParams const& mcparams,
+                                   size_t nsteps)
+: SingleAssetMcPricer(prod, discountCurve, divYield, spot, mcparams, nsteps, 1, "local vol"), lvs_(localVolSurface)
+{
+  QF_ASSERT(localVolSurface, "the local vol pricer needs a local vol surface!");
+  pathgen_ = SPtrPathGenerator(new LocalVolPathGenerator(devgen_, simTimes_, fixSteps_, lvs_, spot_, logDrifts_));
+}
+
+END_NAMESPACE(qf)
@@ -0,0 +1,41 @@
+/**
+@file  localvolmcpricer.hpp
+@brief Monte Carlo pricer in the local volatility model
+*/
+
+#ifndef QF_LOCALVOLMCPRICER_HPP
+#define QF_LOCALVOLMCPRICER_HPP
+
+#include <qflib/pricers/singleassetmcpricer.hpp>
+#include <qflib/methods/montecarlo/localvolpathgenerator.hpp>
+
+BEGIN_NAMESPACE(qf)
+
+/** Monte Carlo pricer of single asset products in the local volatility model of Dupire (deterministic rates),
+    with the paths of LocalVolPathGenerator.
+    McParams::urngType and pathGenType select the generator of the normal deviates, Euler or Sobol;
+    McParams::greeks and FLOAT precision are rejected, and fusedKernels does not apply.
+    The log-Euler steps keep the mean of the control variate, the discounted final spot, exact.
+*/
+class LocalVolMcPricer : public SingleAssetMcPricer
+{
+public:
+  /** Initializing ctor. The simulation takes at least nsteps equal steps up to the last fixing time,
+      and steps to every fixing time; with nsteps = 0, it steps from fixing time to fixing time.
+      The local vol surface is in the log-moneyness log(K / F(T)), with the forwards of the discount curve and dividend yield.
+  */
+  LocalVolMcPricer(SPtrProduct prod,
+                   SPtrYieldCurve discountYieldCurve,
+                   double divYield,
+                   SPtrLocalVolSurface localVolSurface,
+                   double spot,
+                   McParams const& mcparams,
+                   size_t nsteps = 0);
+
+private:
+  SPtrLocalVolSurface lvs_;    // pointer to the local vol surface
+};
+
+END_NAMESPACE(qf)
+
+#endif // QF_LOCALVOLMCPRICER_HPP
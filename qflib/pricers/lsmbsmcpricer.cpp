@@ -0,0 +1,337 @@
+/**
+  @file  lsmbsmcpricer.cpp
+  @brief Implementation of the LsmBsMcPricer class
+*/
+
+#include <qflib/pricers/lsmbsmcpricer.hpp>
+#include <qflib/methods/montecarlo/eulerpathgenerator.hpp>
+#include <qflib/methods/montecarlo/sobolpathgenerator.hpp>
+#include <qflib/methods/montecarlo/antitheticpathgenerator.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+BEGIN_NAMESPACE(qf)
+
+LsmBsMcPricer::LsmBsMcPricer(SPtrProduct prod,
+                             SPtrYieldCurve discountCurve,
+                             Vector const& divYields,
+                             Vector const& volatilities,
+                             Vector const& spots,
+                             Matrix const& correlMatrix,
+                             McParams const& mcparams,
+                             RegressionBasis const& basis,
+                             unsigned long nRegressionPaths)
+: prod_(prod), discyc_(discountCurve), divylds_(divYields), vols_(volatilities),
+spots_(spots), mcparams_(mcparams), basis_(basis), nregpaths_(nRegressionPaths),
+regressed_(false), regressionPV_(0.0)
+{
+  QF_ASSERT(prod->hasEarlyExercise(), "the product has no early exercise!");
+  QF_ASSERT(!mcparams.controlVariate(), "control variates are not supported for early exercise!");
+  QF_ASSERT(!mcparams.greeks, "Greeks are not supported for early exercise!");
+  QF_ASSERT(mcparams.precision == McParams::Precision::DOUBLE, "FLOAT precision is not supported for early exercise!");
+  QF_ASSERT(nRegressionPaths > 0, "need regression paths!");
+
+  // Get the simulation times, the exercise dates
+  Vector timesteps = prod->fixTimes();
+  size_t ntimesteps = timesteps.size();
+  QF_ASSERT(prod->payTimes().size() == ntimesteps, "need one payment time per exercise date!");
+
+  // Get the number of assets (factors) and check inputs for size.
+  size_t nassets = prod->nAssets();
+  QF_ASSERT(divYields.size() == nassets, "need as many div yields as product assets!");
+  QF_ASSERT(volatilities.size() == nassets, "need as many volatilities as product assets!");
+  QF_ASSERT(spots.size() == nassets, "need as many spots as product assets!");
+  if (nassets > 1) {
+    QF_ASSERT(correlMatrix.is_square(), "the correlation matrix must be square!");
+    QF_ASSERT(correlMatrix.n_rows == nassets, "need as many correlation matrix rows as product assets!");
+  }
+  for (size_t j = 0; j < nassets; ++j)
+    QF_ASSERT(spots[j] > 0.0, "the spots must be positive!");
+
+  // Create the path generator, one factor per asset
+  if (mcparams.pathGenType == McParams::PathGenType::EULER) {
+    if (mcparams.urngType == McParams::UrngType::MINSTDRAND)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMinStdRand>(
+        timesteps.begin(), timesteps.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::MT19937)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMt19937>(
+        timesteps.begin(), timesteps.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX3)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux3>(
+        timesteps.begin(), timesteps.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX4)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux4>(
+        timesteps.begin(), timesteps.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::PHILOX4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngPhilox4x32>(
+        timesteps.begin(), timesteps.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::THREEFRY4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngThreefry4x32>(
+        timesteps.begin(), timesteps.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else
+      QF_ASSERT(0, "unknown urng type!");
+  }
+  else if (mcparams.pathGenType == McParams::PathGenType::SOBOL)
+    pathgen_ = SPtrPathGenerator(new SobolPathGenerator(
+      timesteps.begin(), timesteps.end(), nassets, correlMatrix, mcparams.scrambleType,
+      mcparams.nCorrFactors));
+  else
+    QF_ASSERT(0, "unknown path generator type!");
+
+  if (mcparams.antithetic()) {
+    QF_ASSERT(mcparams.blockSize % 2 == 0, "the block size must be even with antithetic paths!");
+    pathgen_ = SPtrPathGenerator(new AntitheticPathGenerator(pathgen_));
+    if (nregpaths_ % 2 != 0)
+      ++nregpaths_;
+  }
+
+  // Pre-compute the discount factors
+  Vector const& paytimes = prod->payTimes();
+  discfactors_.resize(paytimes.size());
+  for (size_t i = 0; i < paytimes.size(); ++i)
+    discfactors_[i] = discyc_->discount(paytimes[i]);
+
+  // Pre-compute the stdevs and drifts from time step to time step
+  drifts_.resize(ntimesteps, nassets);
+  stdevs_.resize(ntimesteps, nassets);
+
+  // loop over assets
+  for (size_t j = 0; j < nassets; ++j) {
+    double t1 = 0.0;
+    // loop over exercise dates
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double t2 = timesteps[i];
+      double var = vols_[j] * vols_[j] * (t2 - t1);
+      stdevs_(i, j) = sqrt(var);
+      double fwdrate = discyc_->fwdRate(t1, t2);
+      // risk free rate less yield plus convexity adjustment
+      drifts_(i, j) = (fwdrate - divylds_[j]) * (t2 - t1) - 0.5 * var;
+      t1 = t2;
+    }
+  }
+}
+
+LsmBsMcPricer::Worker LsmBsMcPricer::makeWorker() const
+{
+  size_t nassets = spots_.size();
+  size_t blocksize = mcparams_.blockSize;
+  Worker worker;
+  worker.pathgen = pathgen_->clone();
+  worker.prod = prod_->clone();
+  worker.pathBatch.set_size(blocksize, pathgen_->nTimeSteps() * pathgen_->nFactors());
+  worker.alive.reserve(blocksize);
+  worker.itm.reserve(blocksize);
+  worker.evs.set_size(blocksize);
+  worker.basisBatch.set_size(blocksize, basis_.size(nassets));
+  worker.contValues.set_size(blocksize);
+  worker.state.set_size(nassets);
+  return worker;
+}
+
+void LsmBsMcPricer::simulatePaths(Worker& worker, size_t npaths) const
+{
+  Matrix& pathBatch = worker.pathBatch;
+  worker.pathgen->nextBatch(npaths, pathBatch);
+  size_t nassets = spots_.size();
+  size_t ntimesteps = drifts_.n_rows;
+
+  // convert the normal deviates to price paths in-place, one asset and time step at a time for all paths
+  for (size_t j = 0; j < nassets; ++j) {
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double drift = drifts_(i, j);
+      double stdev = stdevs_(i, j);
+      double* spots = pathBatch.colptr(j * ntimesteps + i);
+      if (i == 0) {
+        double spot = spots_[j];
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = spot * exp(drift + stdev * spots[p]);
+      }
+      else {
+        double const* prevspots = pathBatch.colptr(j * ntimesteps + i - 1);
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = prevspots[p] * exp(drift + stdev * spots[p]);
+      }
+    }
+  }
+}
+
+void LsmBsMcPricer::evalBasis(Matrix const& pathBatch, size_t idx, vector<size_t> const& paths,
+                              Vector const& evs, size_t nrows, Vector& state, Matrix& basisBatch) const
+{
+  size_t nassets = spots_.size();
+  size_t ntimesteps = drifts_.n_rows;
+  for (size_t r = 0; r < nrows; ++r) {
+    size_t p = paths[r];
+    for (size_t j = 0; j < nassets; ++j)
+      state[j] = pathBatch(p, j * ntimesteps + idx) / spots_[j];
+    basis_.eval(state.memptr(), nassets, evs[r], basisBatch.memptr() + r, basisBatch.n_rows);
+  }
+}
+
+void LsmBsMcPricer::regress()
+{
+  if (regressed_)
+    return;
+
+  size_t nassets = spots_.size();
+  size_t ntimesteps = drifts_.n_rows;
+  size_t nbasis = basis_.size(nassets);
+
+  // first pass: simulate the regression paths into one block, paths innermost;
+  // all of them are needed, so the time budget does not apply
+  Worker scratch = makeWorker();
+  Matrix& regPaths = scratch.pathBatch;
+  regPaths.set_size(nregpaths_, ntimesteps * nassets);
+  McParams regparams = mcparams_;
+  regparams.maxSeconds = 0.0;
+  runPathBlocks(nregpaths_, 0, regparams,
+    [this]() { return makeWorker(); },
+    [&](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double* values) {
+      worker.pathgen->seed(mcparams_.seed, firstPath);
+      simulatePaths(worker, nBlockPaths);
+      for (size_t c = 0; c < regPaths.n_cols; ++c)
+        std::copy(worker.pathBatch.colptr(c), worker.pathBatch.colptr(c) + nBlockPaths,
+                  regPaths.colptr(c) + firstPath);
+    },
+    [](double* values, size_t nBlockPaths) { return true; });
+
+  // the PV of the cash flows of each path, starting from exercise at expiration
+  Product const& prod = *prod_;
+  size_t stride = regPaths.n_rows;
+  auto pricePath = [&](size_t p) {
+    return MatrixView(regPaths.colptr(0) + p, ntimesteps, nassets, stride, stride * ntimesteps);
+  };
+  size_t last = ntimesteps - 1;
+  Vector pvs(nregpaths_);
+  for (size_t p = 0; p < nregpaths_; ++p)
+    pvs[p] = discfactors_[last] * prod.exerciseValue(pricePath(p), last);
+
+  // then backwards over the exercise dates, regressing the PVs of the paths in the money
+  coeffs_.zeros(ntimesteps, nbasis);
+  exercisable_.assign(ntimesteps, false);
+  vector<size_t>& itm = scratch.itm;
+  Vector& evs = scratch.evs;
+  Matrix& basisBatch = scratch.basisBatch;
+  itm.reserve(nregpaths_);
+  evs.set_size(nregpaths_);
+  basisBatch.set_size(nregpaths_, nbasis);
+  Vector pvsItm(nregpaths_), coeffs;
+  for (size_t i = last; i-- > 0;) {
+    itm.clear();
+    for (size_t p = 0; p < nregpaths_; ++p) {
+      double ev = prod.exerciseValue(pricePath(p), i);
+      if (ev > 0.0) {
+        evs[itm.size()] = ev;
+        itm.push_back(p);
+      }
+    }
+    size_t nitm = itm.size();
+    if (nitm < 2 * nbasis)
+      continue;    // too few paths to regress on, exercise is not considered
+
+    evalBasis(regPaths, i, itm, evs, nitm, scratch.state, basisBatch);
+    for (size_t r = 0; r < nitm; ++r)
+      pvsItm[r] = pvs[itm[r]];
+    // least squares on the SVD, which also copes with collinear basis functions, e.g. at t = 0
+    auto X = basisBatch.head_rows(nitm);
+    if (!arma::solve(coeffs, X, pvsItm.head(nitm), arma::solve_opts::force_approx))
+      continue;
+    coeffs_.row(i) = coeffs.t();
+    exercisable_[i] = true;
+
+    Vector contValues = X * coeffs;
+    double df = discfactors_[i];
+    for (size_t r = 0; r < nitm; ++r)
+      if (df * evs[r] >= contValues[r])
+        pvs[itm[r]] = df * evs[r];
+  }
+
+  regressionPV_ = arma::mean(pvs);
+  regressed_ = true;
+}
+
+void LsmBsMcPricer::processBlock(Worker& worker, size_t npaths, double* values) const
+{
+  simulatePaths(worker, npaths);
+  Matrix const& pathBatch = worker.pathBatch;
+  size_t nassets = spots_.size();
+  size_t ntimesteps = drifts_.n_rows;
+  size_t nbasis = coeffs_.n_cols;
+  size_t stride = pathBatch.n_rows;
+  size_t last = ntimesteps - 1;
+  Product const& prod = *worker.prod;
+
+  vector<size_t>& alive = worker.alive;
+  vector<size_t>& itm = worker.itm;
+  Vector& evs = worker.evs;
+  double* cont = worker.contValues.memptr();
+  alive.clear();
+  for (size_t p = 0; p < npaths; ++p)
+    alive.push_back(p);
+
+  // go forward over the exercise dates, with the paths not exercised yet
+  for (size_t i = 0; i < ntimesteps && !alive.empty(); ++i) {
+    if (i < last && !exercisable_[i])
+      continue;
+    double df = discfactors_[i];
+    itm.clear();
+    for (size_t p : alive) {
+      double ev = prod.exerciseValue(
+        MatrixView(pathBatch.colptr(0) + p, ntimesteps, nassets, stride, stride * ntimesteps), i);
+      if (ev > 0.0) {
+        evs[itm.size()] = ev;
+        itm.push_back(p);
+      }
+    }
+
+    if (i == last) {
+      // the paths still alive get the final payoff
+      for (size_t p : alive)
+        values[p] = 0.0;
+      for (size_t r = 0; r < itm.size(); ++r)
+        values[itm[r]] = df * evs[r];
+      break;
+    }
+
+    // the continuation values of the paths in the money, one column of the basis at a time
+    size_t nitm = itm.size();
+    evalBasis(pathBatch, i, itm, evs, nitm, worker.state, worker.basisBatch);
+    for (size_t r = 0; r < nitm; ++r)
+      cont[r] = 0.0;
+    for (size_t k = 0; k < nbasis; ++k) {
+      double coeff = coeffs_(i, k);
+      double const* basis = worker.basisBatch.colptr(k);
+      for (size_t r = 0; r < nitm; ++r)
+        cont[r] += coeff * basis[r];
+    }
+
+    // exercise where it pays at least the continuation value, and drop those paths;
+    // the paths in the money are a subsequence of the alive ones
+    size_t nalive = 0;
+    for (size_t a = 0, r = 0; a < alive.size(); ++a) {
+      size_t p = alive[a];
+      if (r < nitm && itm[r] == p) {
+        double exv = df * evs[r];
+        bool exercise = exv >= cont[r];
+        ++r;
+        if (exercise) {
+          values[p] = exv;
+          continue;
+        }
+      }
+      alive[nalive++] = p;
+    }
+    alive.resize(nalive);
+  }
+}
+
+END_NAMESPACE(qf)
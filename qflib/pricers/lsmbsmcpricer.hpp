@@ -0,0 +1,193 @@
+/**
+@file  lsmbsmcpricer.hpp
+@brief Longstaff-Schwartz Monte Carlo pricer of early exercise products in the Black Scholes model
+*/
+
+#ifndef QF_LSMBSMCPRICER_HPP
+#define QF_LSMBSMCPRICER_HPP
+
+#include <qflib/products/product.hpp>
+#include <qflib/market/yieldcurve.hpp>
+#include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <qflib/methods/montecarlo/pathblockrunner.hpp>
+#include <qflib/methods/montecarlo/variancereducer.hpp>
+#include <qflib/methods/montecarlo/mcruninfo.hpp>
+#include <qflib/methods/montecarlo/regressionbasis.hpp>
+#include <qflib/math/stats/statisticscalculator.hpp>
+#include <chrono>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Longstaff-Schwartz (least squares Monte Carlo) pricer of products with early exercise
+    in the multiasset Black-Scholes model (deterministic rates and vols).
+    The product may be exercised at its fixing times, see Product::exerciseValue.
+    The pricing runs in two passes over independent random streams:
+    regress() simulates nRegressionPaths paths, keeps them in one block, paths innermost,
+    and goes backwards over the exercise dates, regressing the PV of the future cash flows
+    of the in-the-money paths on the basis functions of their state, one least squares solve per date;
+    simulate() then prices on new paths in blocks, exercising at the first date where the exercise
+    value is at least the regressed continuation value. Since the exercise policy is suboptimal
+    and independent of these paths, their mean is biased low, by less than the standard error
+    when the basis is adequate.
+    The memory is that of the regression paths, nRegressionPaths * nfixings * nassets doubles,
+    whatever the number of pricing paths.
+    Antithetic paths are supported, control variates and Greeks are not.
+*/
+class LsmBsMcPricer
+{
+public:
+  /** Initializing ctor */
+  LsmBsMcPricer(SPtrProduct prod,
+                SPtrYieldCurve discountYieldCurve,
+                Vector const& divYields,
+                Vector const& volatilities,
+                Vector const& spots,
+                Matrix const& correlMatrix,
+                McParams const& mcparams,
+                RegressionBasis const& basis = RegressionBasis(),
+                unsigned long nRegressionPaths = 16384);
+
+  /** Returns the number of variables that can be tracked for stats, the PV */
+  size_t nVariables();
+
+  /** Runs the regression pass, if not run yet. simulate() calls it. */
+  void regress();
+
+  /** After regress(), the mean PV of the regression paths under the regressed exercise policy.
+      It is biased high, since the policy is fit to these paths.
+  */
+  double regressionPV() const;
+
+  /** After regress(), the regression coefficients, one row per exercise date, one column per basis function;
+      a row of zeros for the dates with too few paths in the money to regress, where exercise is not considered
+  */
+  Matrix const& exerciseCoeffs() const;
+
+  /** Runs the regression pass if needed, then the pricing simulation and collects statistics.
+      The pricing paths are drawn from the random streams following the regression paths.
+      The paths are split over McParams::nThreads threads; the results do not depend on the thread count.
+      With antithetic pairs, npaths is rounded up to an even number and each sample is the average of a pair.
+      With the McParams tolerances or time budget set, npaths is the maximum number of paths
+      and the simulation stops as soon as a criterion is met.
+      Returns the number of paths used, the time spent and the standard error.
+  */
+  template<typename ITER>
+  McRunInfo simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths);
+
+protected:
+
+  /** The state owned by one simulation thread */
+  struct Worker
+  {
+    SPtrPathGenerator pathgen;       // this thread's path generator
+    SPtrProduct prod;                // this thread's copy of the product
+    Matrix pathBatch;                // scratch block of paths, paths innermost
+    std::vector<size_t> alive;       // scratch, the paths of the block not exercised yet
+    std::vector<size_t> itm;         // scratch, the paths in the money at the current date
+    Vector evs;                      // scratch, the exercise value of each path in the money
+    Matrix basisBatch;               // scratch, the basis functions of each path in the money
+    Vector contValues;               // scratch, the continuation value of each path in the money
+    Vector state;                    // scratch, the spots of a path over their initial values
+  };
+
+  /** Creates the state of one simulation thread */
+  Worker makeWorker() const;
+
+  /** Draws a block of npaths price paths into worker.pathBatch */
+  void simulatePaths(Worker& worker, size_t npaths) const;
+
+  /** Evaluates the basis functions of the nrows paths paths[r], at fixing idx of the block pathBatch,
+      into the first nrows rows of basisBatch
+  */
+  void evalBasis(Matrix const& pathBatch, size_t idx, std::vector<size_t> const& paths, Vector const& evs,
+                 size_t nrows, Vector& state, Matrix& basisBatch) const;
+
+  /** Creates and prices a block of npaths paths under the regressed exercise policy.
+      It writes the PV on path p into values[p].
+  */
+  void processBlock(Worker& worker, size_t npaths, double* values) const;
+
+private:
+  SPtrProduct prod_;               // pointer to the product
+  SPtrYieldCurve discyc_;          // pointer to the discount curve
+  Vector divylds_;                 // the constant dividend yield, one per asset
+  Vector vols_;                    // the constant volatility, one per asset
+  Vector spots_;                   // the initial spots, one per asset
+  McParams mcparams_;              // the Monte Carlo parameters
+  RegressionBasis basis_;          // the regression basis functions
+  unsigned long nregpaths_;        // the number of regression paths
+
+  SPtrPathGenerator pathgen_;      // pointer to the path generator
+  Vector discfactors_;             // caches the pre-computed discount factors, one per exercise date
+  Matrix drifts_;                  // caches the pre-computed asset drifts, one column per asset
+  Matrix stdevs_;                  // caches the pre-computed standard deviations, one column per asset
+
+  bool regressed_;                 // whether regress() has run
+  Matrix coeffs_;                  // the regression coefficients, one row per exercise date
+  std::vector<bool> exercisable_;  // whether exercise is considered at each date
+  double regressionPV_;            // the mean PV of the regression paths
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+size_t LsmBsMcPricer::nVariables()
+{
+  return 1;
+}
+
+inline
+double LsmBsMcPricer::regressionPV() const
+{
+  return regressionPV_;
+}
+
+inline
+Matrix const& LsmBsMcPricer::exerciseCoeffs() const
+{
+  return coeffs_;
+}
+
+template<typename ITER>
+McRunInfo LsmBsMcPricer::simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths)
+{
+  // check the size of the statistics calculator
+  QF_ASSERT(statsCalc.nVariables() == nVariables(), "the statistics calculator must track as many variables as the pricer captures!");
+
+  regress();
+
+  VarianceReducer reducer(mcparams_.antithetic(), false, 0.0, nVariables());
+  if (mcparams_.antithetic() && npaths % 2 != 0)
+    ++npaths;
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [start]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  bool converged = false;
+  unsigned long nallocs = 0;
+
+  unsigned long nused = runPathBlocks(npaths, reducer.nValues(), mcparams_,
+    [this]() { return makeWorker(); },
+    [this](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double* values) {
+      // the pricing paths follow the regression paths, so that they are independent
+      worker.pathgen->seed(mcparams_.seed, nregpaths_ + firstPath);
+      processBlock(worker, nBlockPaths, values);
+    },
+    [&](double* values, size_t nBlockPaths) {
+      reducer.feed(values, nBlockPaths, statsCalc);
+      converged = reducer.nSamples() > 1 && mcparams_.toleranceMet(reducer.mean(), reducer.stdErr());
+      bool outoftime = mcparams_.maxSeconds > 0.0 && elapsed() >= mcparams_.maxSeconds;
+      return !converged && !outoftime;
+    },
+    &nallocs);
+
+  return McRunInfo{ nused, elapsed(), reducer.stdErr(), converged, nallocs };
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_LSMBSMCPRICER_HPP
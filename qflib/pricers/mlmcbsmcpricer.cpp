@@ -0,0 +1,406 @@
+/**
+  @file  mlmcbsmcpricer.cpp
+  @brief Implementation of the MlmcBsMcPricer class
+*/
+
+#include <qflib/pricers/mlmcbsmcpricer.hpp>
+#include <qflib/methods/montecarlo/eulerpathgenerator.hpp>
+#include <qflib/methods/montecarlo/pathblockrunner.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+BEGIN_NAMESPACE(qf)
+
+MlmcBsMcPricer::MlmcBsMcPricer(SPtrProduct prod,
+                               SPtrYieldCurve discountCurve,
+                               Vector const& divYields,
+                               Vector const& volatilities,
+                               Vector const& spots,
+                               Matrix const& correlMatrix,
+                               McParams const& mcparams,
+                               size_t nCoarseSteps,
+                               unsigned long nPilotPaths)
+: prod_(prod), discyc_(discountCurve), divylds_(divYields), vols_(volatilities),
+spots_(spots), mcparams_(mcparams), npilot_(nPilotPaths)
+{
+  QF_ASSERT(!mcparams.antithetic(), "antithetic paths are not supported by multilevel Monte Carlo!");
+  QF_ASSERT(!mcparams.controlVariate(), "control variates are not supported by multilevel Monte Carlo!");
+  QF_ASSERT(!mcparams.greeks, "Greeks are not supported by multilevel Monte Carlo!");
+  QF_ASSERT(mcparams.precision == McParams::Precision::DOUBLE, "FLOAT precision is not supported by multilevel Monte Carlo!");
+  // the levels would share their low-discrepancy points, and the standard error assumes independent samples
+  QF_ASSERT(mcparams.pathGenType == McParams::PathGenType::EULER,
+    "only Euler paths are supported by multilevel Monte Carlo!");
+  QF_ASSERT(nCoarseSteps > 0, "the coarsest level needs at least one step!");
+  QF_ASSERT(nPilotPaths > 1, "need at least two pilot paths per level!");
+
+  // Get the number of assets (factors) and check inputs for size.
+  Vector const& fixtimes = prod->fixTimes();
+  size_t nfixings = fixtimes.size();
+  size_t nassets = prod->nAssets();
+  QF_ASSERT(divYields.size() == nassets, "need as many div yields as product assets!");
+  QF_ASSERT(volatilities.size() == nassets, "need as many volatilities as product assets!");
+  QF_ASSERT(spots.size() == nassets, "need as many spots as product assets!");
+  if (nassets > 1) {
+    QF_ASSERT(correlMatrix.is_square(), "the correlation matrix must be square!");
+    QF_ASSERT(correlMatrix.n_rows == nassets, "need as many correlation matrix rows as product assets!");
+  }
+
+  // The fixings simulated by each level: m + 1 fixings evenly spread over all of them, m doubling
+  // from level to level, until every fixing is simulated; the rounding keeps the grids nested
+  for (size_t m = nCoarseSteps; ; m *= 2) {
+    vector<size_t> grid;
+    if (m >= nfixings - 1) {
+      for (size_t i = 0; i < nfixings; ++i)
+        grid.push_back(i);
+    }
+    else {
+      for (size_t k = 0; k <= m; ++k)
+        grid.push_back((k * (nfixings - 1) + m / 2) / m);
+    }
+    grids_.push_back(grid);
+    if (grid.size() == nfixings)
+      break;
+  }
+
+  // The interpolation weights of all fixings between the simulated fixings in the given columns
+  auto interpolation = [&](vector<size_t> const& grid, vector<size_t> const& cols) {
+    Interpolation interp;
+    interp.left.resize(nfixings);
+    interp.right.resize(nfixings);
+    interp.weights.set_size(nfixings);
+    size_t k = 0;
+    for (size_t i = 0; i < nfixings; ++i) {
+      while (k + 1 < grid.size() && grid[k + 1] <= i)
+        ++k;
+      interp.left[i] = cols[k];
+      if (grid[k] == i) {
+        interp.right[i] = cols[k];
+        interp.weights[i] = 0.0;
+      }
+      else {
+        interp.right[i] = cols[k + 1];
+        interp.weights[i] = (fixtimes[i] - fixtimes[grid[k]]) / (fixtimes[grid[k + 1]] - fixtimes[grid[k]]);
+      }
+    }
+    return interp;
+  };
+
+  size_t nlevels = grids_.size();
+  for (size_t l = 0; l < nlevels; ++l) {
+    vector<size_t> const& grid = grids_[l];
+    size_t m = grid.size();
+
+    // the path generator, drifts and standard deviations on the simulated fixings
+    vector<double> times(m);
+    for (size_t k = 0; k < m; ++k)
+      times[k] = fixtimes[grid[k]];
+    pathgens_.push_back(makePathGenerator(times, correlMatrix));
+    Matrix drifts(m, nassets), stdevs(m, nassets);
+    for (size_t j = 0; j < nassets; ++j) {
+      double t1 = 0.0;
+      for (size_t k = 0; k < m; ++k) {
+        double t2 = times[k];
+        double var = vols_[j] * vols_[j] * (t2 - t1);
+        stdevs(k, j) = sqrt(var);
+        double fwdrate = discyc_->fwdRate(t1, t2);
+        // risk free rate less yield plus convexity adjustment
+        drifts(k, j) = (fwdrate - divylds_[j]) * (t2 - t1) - 0.5 * var;
+        t1 = t2;
+      }
+    }
+    drifts_.push_back(drifts);
+    stdevs_.push_back(stdevs);
+
+    // the interpolations from the level's own fixings, and from those of the level below
+    vector<size_t> cols(m);
+    for (size_t k = 0; k < m; ++k)
+      cols[k] = k;
+    fineInterps_.push_back(interpolation(grid, cols));
+    if (l > 0) {
+      vector<size_t> const& coarse = grids_[l - 1];
+      vector<size_t> coarsecols(coarse.size());
+      for (size_t k = 0; k < coarse.size(); ++k)
+        coarsecols[k] = lower_bound(grid.begin(), grid.end(), coarse[k]) - grid.begin();
+      coarseInterps_.push_back(interpolation(coarse, coarsecols));
+    }
+    else
+      coarseInterps_.push_back(Interpolation());
+
+    levelStats_.push_back(WelfordCalculator<double*>(1));
+    // the simulated spots, and the spots of all fixings interpolated and evaluated, twice above level 0
+    levelCosts_.push_back(double(m * nassets + (l > 0 ? 2 : 1) * nfixings * nassets));
+  }
+
+  // Pre-compute the discount factors
+  Vector const& paytimes = prod->payTimes();
+  discfactors_.resize(paytimes.size());
+  for (size_t i = 0; i < paytimes.size(); ++i)
+    discfactors_[i] = discyc_->discount(paytimes[i]);
+}
+
+SPtrPathGenerator MlmcBsMcPricer::makePathGenerator(vector<double> const& times, Matrix const& correlMatrix) const
+{
+  size_t nassets = spots_.size();
+  McParams const& mcparams = mcparams_;
+  SPtrPathGenerator pathgen;
+  if (mcparams.pathGenType == McParams::PathGenType::EULER) {
+    if (mcparams.urngType == McParams::UrngType::MINSTDRAND)
+      pathgen = SPtrPathGenerator(new EulerPathGenerator<NormalRngMinStdRand>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::MT19937)
+      pathgen = SPtrPathGenerator(new EulerPathGenerator<NormalRngMt19937>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX3)
+      pathgen = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux3>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX4)
+      pathgen = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux4>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::PHILOX4X32)
+      pathgen = SPtrPathGenerator(new EulerPathGenerator<NormalRngPhilox4x32>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::THREEFRY4X32)
+      pathgen = SPtrPathGenerator(new EulerPathGenerator<NormalRngThreefry4x32>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else
+      QF_ASSERT(0, "unknown urng type!");
+  }
+  else
+    QF_ASSERT(0, "unknown path generator type!");
+  return pathgen;
+}
+
+size_t MlmcBsMcPricer::nLevels() const
+{
+  return grids_.size();
+}
+
+size_t MlmcBsMcPricer::nLevelsUsed() const
+{
+  size_t n = 0;
+  while (n < levelStats_.size() && levelStats_[n].nSamples() > 0)
+    ++n;
+  return n;
+}
+
+double MlmcBsMcPricer::mean() const
+{
+  return arma::accu(levelMeans());
+}
+
+Vector MlmcBsMcPricer::levelMeans() const
+{
+  size_t nused = nLevelsUsed();
+  Vector means(nused);
+  for (size_t l = 0; l < nused; ++l)
+    means[l] = levelStats_[l].results()(0, 0);
+  return means;
+}
+
+Vector MlmcBsMcPricer::levelVariances() const
+{
+  size_t nused = nLevelsUsed();
+  Vector vars(nused);
+  for (size_t l = 0; l < nused; ++l)
+    vars[l] = levelStats_[l].results()(1, 0);
+  return vars;
+}
+
+vector<unsigned long> MlmcBsMcPricer::levelPaths() const
+{
+  size_t nused = nLevelsUsed();
+  vector<unsigned long> npaths(nused);
+  for (size_t l = 0; l < nused; ++l)
+    npaths[l] = levelStats_[l].nSamples();
+  return npaths;
+}
+
+MlmcBsMcPricer::Worker MlmcBsMcPricer::makeWorker() const
+{
+  Worker worker;
+  for (auto const& pathgen : pathgens_)
+    worker.pathgens.push_back(pathgen->clone());
+  worker.prod = prod_->clone();
+  worker.pathBatch.set_size(mcparams_.blockSize, grids_.back().size() * spots_.size());
+  worker.fixingBatch.set_size(mcparams_.blockSize, prod_->fixTimes().size() * spots_.size());
+  worker.coarsePVs.set_size(mcparams_.blockSize);
+  return worker;
+}
+
+void MlmcBsMcPricer::interpolate(Matrix const& pathBatch, size_t m, Interpolation const& interp, size_t npaths,
+                                 Matrix& fixingBatch) const
+{
+  size_t nassets = spots_.size();
+  size_t nfixings = interp.left.size();
+  fixingBatch.set_size(npaths, nfixings * nassets);
+  for (size_t j = 0; j < nassets; ++j) {
+    for (size_t i = 0; i < nfixings; ++i) {
+      double w = interp.weights[i];
+      double const* left = pathBatch.colptr(j * m + interp.left[i]);
+      double const* right = pathBatch.colptr(j * m + interp.right[i]);
+      double* spots = fixingBatch.colptr(j * nfixings + i);
+      for (size_t p = 0; p < npaths; ++p)
+        spots[p] = left[p] + w * (right[p] - left[p]);
+    }
+  }
+}
+
+void MlmcBsMcPricer::evalPVs(Product& prod, Matrix const& fixingBatch, size_t npaths, double* pvs, size_t stride) const
+{
+  size_t nassets = spots_.size();
+  size_t nfixings = prod_->fixTimes().size();
+  Vector const& payamts = prod.payAmounts();
+  size_t batchstride = fixingBatch.n_rows;
+  for (size_t p = 0; p < npaths; ++p) {
+    prod.eval(MatrixView(fixingBatch.colptr(0) + p, nfixings, nassets, batchstride, batchstride * nfixings));
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    pvs[p * stride] = pv;
+  }
+}
+
+void MlmcBsMcPricer::processBlock(Worker& worker, size_t l, size_t npaths, double* values) const
+{
+  Matrix& pathBatch = worker.pathBatch;
+  worker.pathgens[l]->nextBatch(npaths, pathBatch);
+  size_t nassets = spots_.size();
+  size_t m = grids_[l].size();
+  Matrix const& drifts = drifts_[l];
+  Matrix const& stdevs = stdevs_[l];
+
+  // convert the normal deviates to price paths in-place, one asset and time step at a time for all paths
+  for (size_t j = 0; j < nassets; ++j) {
+    for (size_t k = 0; k < m; ++k) {
+      double drift = drifts(k, j);
+      double stdev = stdevs(k, j);
+      double* spots = pathBatch.colptr(j * m + k);
+      if (k == 0) {
+        double spot = spots_[j];
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = spot * exp(drift + stdev * spots[p]);
+      }
+      else {
+        double const* prevspots = pathBatch.colptr(j * m + k - 1);
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = prevspots[p] * exp(drift + stdev * spots[p]);
+      }
+    }
+  }
+
+  // the PV on the fine path, less that on the coarse path, i.e. the same path on the fixings of the level below
+  Product& prod = *worker.prod;
+  interpolate(pathBatch, m, fineInterps_[l], npaths, worker.fixingBatch);
+  evalPVs(prod, worker.fixingBatch, npaths, values, 1);
+  if (l > 0) {
+    double* coarsepvs = worker.coarsePVs.memptr();
+    interpolate(pathBatch, m, coarseInterps_[l], npaths, worker.fixingBatch);
+    evalPVs(prod, worker.fixingBatch, npaths, coarsepvs, 1);
+    for (size_t p = 0; p < npaths; ++p)
+      values[p] -= coarsepvs[p];
+  }
+}
+
+unsigned long MlmcBsMcPricer::runLevel(size_t l, unsigned long n)
+{
+  // each level draws from its own seed, and new paths from the streams after those already drawn;
+  // the time budget is checked between the rounds of levels, so all n paths are run
+  WelfordCalculator<double*>& stats = levelStats_[l];
+  unsigned long first = stats.nSamples();
+  unsigned long nallocs = 0;
+  McParams levelparams = mcparams_;
+  levelparams.maxSeconds = 0.0;
+  runPathBlocks(n, 1, levelparams,
+    [this]() { return makeWorker(); },
+    [&](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double* values) {
+      worker.pathgens[l]->seed(mcparams_.seed + l, first + firstPath);
+      processBlock(worker, l, nBlockPaths, values);
+    },
+    [&](double* values, size_t nBlockPaths) {
+      stats.addSamples(values, values + nBlockPaths, nBlockPaths);
+      return true;
+    },
+    &nallocs);
+  return nallocs;
+}
+
+McRunInfo MlmcBsMcPricer::simulate(double rmse)
+{
+  QF_ASSERT(rmse > 0.0, "the target root mean square error must be positive!");
+  auto start = chrono::steady_clock::now();
+  auto elapsed = [start]() {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  };
+
+  for (auto& stats : levelStats_)
+    stats.reset();
+  size_t finest = nLevels() - 1;
+  size_t L = min(size_t(2), finest);
+  vector<unsigned long> dn(L + 1, npilot_);
+  bool converged = false;
+  unsigned long nallocs = 0;
+
+  while (true) {
+    for (size_t l = 0; l <= L; ++l)
+      if (dn[l] > 0)
+        nallocs += runLevel(l, dn[l]);
+
+    // the optimal number of paths of each level, N_l = 2 / rmse^2 sqrt(V_l / C_l) sum_k sqrt(V_k C_k),
+    // spends half the mean square error on the variance
+    Vector vars = levelVariances();
+    double sum = 0.0;
+    for (size_t l = 0; l <= L; ++l)
+      sum += sqrt(vars[l] * levelCosts_[l]);
+    bool more = false;
+    for (size_t l = 0; l <= L; ++l) {
+      double nopt = ceil(2.0 / (rmse * rmse) * sqrt(vars[l] / levelCosts_[l]) * sum);
+      unsigned long n = levelStats_[l].nSamples();
+      dn[l] = nopt > n ? static_cast<unsigned long>(nopt) - n : 0;
+      more = more || dn[l] > 0;
+    }
+    if (mcparams_.maxSeconds > 0.0 && elapsed() >= mcparams_.maxSeconds)
+      break;
+    if (more)
+      continue;
+
+    // the bias of the levels above L, from the decay of the means of the last two levels:
+    // mean_L+k ~ mean_L 2^(-alpha k), summed over k > 0; none once the finest level is simulated
+    if (L == finest) {
+      converged = true;
+      break;
+    }
+    Vector means = levelMeans();
+    double alpha = 1.0;
+    if (L >= 2 && means[L] != 0.0)
+      alpha = max(0.5, log2(fabs(means[L - 1] / means[L])));
+    double bias = fabs(means[L]) / (pow(2.0, alpha) - 1.0);
+    if (bias <= rmse / sqrt(2.0)) {
+      converged = true;
+      break;
+    }
+    ++L;
+    dn.push_back(npilot_);
+  }
+
+  unsigned long npaths = 0;
+  double var = 0.0;
+  Vector vars = levelVariances();
+  for (size_t l = 0; l < vars.size(); ++l) {
+    unsigned long n = levelStats_[l].nSamples();
+    npaths += n;
+    var += vars[l] / n;
+  }
+  return McRunInfo{ npaths, elapsed(), sqrt(var), converged, nallocs };
+}
+
+END_NAMESPACE(qf)
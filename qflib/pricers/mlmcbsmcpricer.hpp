@@ -0,0 +1,138 @@
+/**
+@file  mlmcbsmcpricer.hpp
+@brief Multilevel Monte Carlo pricer of path-dependent products in the Black Scholes model
+*/
+
+#ifndef QF_MLMCBSMCPRICER_HPP
+#define QF_MLMCBSMCPRICER_HPP
+
+#include <qflib/products/product.hpp>
+#include <qflib/market/yieldcurve.hpp>
+#include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <qflib/methods/montecarlo/mcruninfo.hpp>
+#include <qflib/math/stats/welfordcalculator.hpp>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Multilevel Monte Carlo (Giles) pricer of products with many fixings, e.g. Asian options
+    with daily fixings, in the multiasset Black-Scholes model (deterministic rates and vols).
+    Level l simulates the assets on nCoarseSteps * 2^l fixings only, spread evenly over all fixings,
+    and interpolates the spots linearly in time between them to evaluate the product on all fixings;
+    the finest level simulates every fixing, so it prices the product itself.
+    The levels are coupled: the fine and coarse paths of a level share their Brownian increments,
+    the coarse path being the fine one at every other simulated fixing, exactly since the
+    log-Euler scheme has no discretization error in this model. The PV is the sum over the levels
+    of the mean of P_l - P_l-1, whose variance shrinks as the grid refines, so that most paths
+    are drawn on the cheap coarse levels.
+    simulate() chooses the number of paths of each level from the observed variances and costs,
+    to reach a target root mean square error at close to O(eps^-2) cost.
+    Only Euler paths are supported: Sobol points would be shared by the levels, which the standard error,
+    summed over independent levels, does not allow for; antithetic paths, control variates and Greeks are not supported.
+*/
+class MlmcBsMcPricer
+{
+public:
+  /** Initializing ctor; level 0 simulates nCoarseSteps + 1 fixings, the first and the last among them,
+      and the first run of each level uses nPilotPaths paths to estimate its variance
+  */
+  MlmcBsMcPricer(SPtrProduct prod,
+                 SPtrYieldCurve discountYieldCurve,
+                 Vector const& divYields,
+                 Vector const& volatilities,
+                 Vector const& spots,
+                 Matrix const& correlMatrix,
+                 McParams const& mcparams,
+                 size_t nCoarseSteps = 1,
+                 unsigned long nPilotPaths = 1024);
+
+  /** Returns the number of levels, the finest simulating every fixing */
+  size_t nLevels() const;
+
+  /** Runs the levels until the estimated root mean square error of the PV is at most rmse:
+      the standard error contributes rmse / sqrt(2), and the bias of the levels not yet
+      simulated, extrapolated from the last two, the rest; it vanishes once the finest level is used.
+      Stops at the McParams time budget, if any.
+      Returns the total number of paths over all levels, the time spent, the standard error
+      and the heap allocations of the path loops.
+  */
+  McRunInfo simulate(double rmse);
+
+  /** After simulate(), the multilevel estimate of the PV */
+  double mean() const;
+
+  /** After simulate(), the number of levels used, the mean and variance of P_l - P_l-1
+      and the number of paths of each level
+  */
+  size_t nLevelsUsed() const;
+  Vector levelMeans() const;
+  Vector levelVariances() const;
+  std::vector<unsigned long> levelPaths() const;
+
+protected:
+
+  /** The interpolation of the spots at all fixings from the simulated ones of a level.
+      Fixing i is interpolated between the simulated fixings in columns left[i] and right[i],
+      i.e. positions in the level's grid, with weight weights[i] on the right one.
+  */
+  struct Interpolation
+  {
+    std::vector<size_t> left;
+    std::vector<size_t> right;
+    Vector weights;
+  };
+
+  /** The state owned by one simulation thread */
+  struct Worker
+  {
+    std::vector<SPtrPathGenerator> pathgens;  // this thread's path generator of each level
+    SPtrProduct prod;                // this thread's copy of the product
+    Matrix pathBatch;                // scratch block of paths on the simulated fixings, paths innermost
+    Matrix fixingBatch;              // scratch block of paths on all fixings, paths innermost
+    Vector coarsePVs;                // scratch, the PV of each path on the fixings of the level below
+  };
+
+  /** Creates the state of one simulation thread */
+  Worker makeWorker() const;
+
+  /** Creates a path generator on the given simulation times */
+  SPtrPathGenerator makePathGenerator(std::vector<double> const& times, Matrix const& correlMatrix) const;
+
+  /** Interpolates the spots of the first npaths paths of pathBatch, with m simulated fixings, onto fixingBatch */
+  void interpolate(Matrix const& pathBatch, size_t m, Interpolation const& interp, size_t npaths,
+                   Matrix& fixingBatch) const;
+
+  /** Evaluates the PV of the product on each of the first npaths paths of fixingBatch, into pvs[p * stride] */
+  void evalPVs(Product& prod, Matrix const& fixingBatch, size_t npaths, double* pvs, size_t stride) const;
+
+  /** Creates a block of npaths paths of level l and writes P_l - P_l-1 on path p into values[p] */
+  void processBlock(Worker& worker, size_t l, size_t npaths, double* values) const;
+
+  /** Runs n more paths of level l; returns the heap allocations of its path loop, see runPathBlocks */
+  unsigned long runLevel(size_t l, unsigned long n);
+
+private:
+  SPtrProduct prod_;               // pointer to the product
+  SPtrYieldCurve discyc_;          // pointer to the discount curve
+  Vector divylds_;                 // the constant dividend yield, one per asset
+  Vector vols_;                    // the constant volatility, one per asset
+  Vector spots_;                   // the initial spots, one per asset
+  McParams mcparams_;              // the Monte Carlo parameters
+  unsigned long npilot_;           // the paths of the first run of a level
+
+  std::vector<std::vector<size_t>> grids_;   // the fixings simulated by each level
+  std::vector<SPtrPathGenerator> pathgens_;  // the path generator of each level
+  std::vector<Matrix> drifts_;     // the drifts of each level, one column per asset
+  std::vector<Matrix> stdevs_;     // the standard deviations of each level, one column per asset
+  std::vector<Interpolation> fineInterps_;    // all fixings from the simulated fixings of each level
+  std::vector<Interpolation> coarseInterps_;  // all fixings from those of the level below, in the level's columns
+  Vector discfactors_;             // caches the pre-computed discount factors
+
+  mutable std::vector<WelfordCalculator<double*>> levelStats_;  // the statistics of P_l - P_l-1 of each level
+  std::vector<double> levelCosts_;  // the cost of a path of each level, in simulated and interpolated spots
+};
+
+END_NAMESPACE(qf)
+
+#endif // QF_MLMCBSMCPRICER_HPP
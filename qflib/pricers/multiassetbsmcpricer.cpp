@@ -4,8 +4,16 @@
 */
 
 #include <qflib/pricers/multiassetbsmcpricer.hpp>
+#include <qflib/pricers/bsmckernels.hpp>
 #include <qflib/methods/montecarlo/eulerpathgenerator.hpp>
+#include <qflib/methods/montecarlo/sobolpathgenerator.hpp>
+#include <qflib/methods/montecarlo/antitheticpathgenerator.hpp>
+#include <qflib/products/asianbasketcallput.hpp>
+#include <qflib/math/stats/normaldistribution.hpp>
+#include <qflib/math/linalg/linalg.hpp>
+#include <qflib/math/ad/adouble.hpp>
 
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
@@ -36,26 +44,67 @@ spots_(spots), mcparams_(mcparams)
     QF_ASSERT(correlMatrix.n_rows == nassets, "need as many correlation matrix rows as product assets!");
   }
 
+  // With adjoint differentiation, the correlation is applied by the pricer, to record it on the tape
+  bool aad = mcparams.greeks && mcparams.aad;
+  QF_ASSERT(!aad || mcparams.nCorrFactors == 0,
+            "adjoint differentiation does not support a correlation factor model!");
+  nrates_ = discyc_->fwdRateTimes().size();
+  Matrix pathgenCorrel = correlMatrix;
+  if (aad && !correlMatrix.is_empty()) {
+    correl_ = correlMatrix;
+    spectrunc(correl_);
+    choldcmp(correl_, sqrtCorrel_);
+    correlator_ = CholeskyMultiplier(sqrtCorrel_);
+    pathgenCorrel.reset();
+  }
+
   // Create the path generator, one factor to simulate the spot
   if (mcparams.pathGenType == McParams::PathGenType::EULER) {
     if (mcparams.urngType == McParams::UrngType::MINSTDRAND)
       pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMinStdRand>(
-        timesteps.begin(), timesteps.end(), nassets, correlMatrix));
+        timesteps.begin(), timesteps.end(), nassets, pathgenCorrel,
+        mcparams.normalGenType, mcparams.nCorrFactors));
     else if (mcparams.urngType == McParams::UrngType::MT19937)
       pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMt19937>(
-        timesteps.begin(), timesteps.end(), nassets, correlMatrix));
+        timesteps.begin(), timesteps.end(), nassets, pathgenCorrel,
+        mcparams.normalGenType, mcparams.nCorrFactors));
     else if (mcparams.urngType == McParams::UrngType::RANLUX3)
       pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux3>(
-        timesteps.begin(), timesteps.end(), nassets, correlMatrix));
+        timesteps.begin(), timesteps.end(), nassets, pathgenCorrel,
+        mcparams.normalGenType, mcparams.nCorrFactors));
     else if (mcparams.urngType == McParams::UrngType::RANLUX4)
       pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux4>(
-        timesteps.begin(), timesteps.end(), nassets, correlMatrix));
+        timesteps.begin(), timesteps.end(), nassets, pathgenCorrel,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::PHILOX4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngPhilox4x32>(
+        timesteps.begin(), timesteps.end(), nassets, pathgenCorrel,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::THREEFRY4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngThreefry4x32>(
+        timesteps.begin(), timesteps.end(), nassets, pathgenCorrel,
+        mcparams.normalGenType, mcparams.nCorrFactors));
     else
       QF_ASSERT(0, "unknown urng type!");
   }
+  else if (mcparams.pathGenType == McParams::PathGenType::SOBOL)
+    pathgen_ = SPtrPathGenerator(new SobolPathGenerator(
+      timesteps.begin(), timesteps.end(), nassets, pathgenCorrel, mcparams.scrambleType,
+      mcparams.nCorrFactors));
   else
     QF_ASSERT(0, "unknown path generator type!");
 
+  if (mcparams.antithetic()) {
+    QF_ASSERT(mcparams.blockSize % 2 == 0, "the block size must be even with antithetic paths!");
+    pathgen_ = SPtrPathGenerator(new AntitheticPathGenerator(pathgen_));
+  }
+
+  // the Greeks need whole paths
+  streaming_ = mcparams.streamFixings && pathgen_->canStream() && !mcparams.greeks;
+  // the control variate needs the final spots of every path
+  settling_ = prod->canSettle() && prod->isIncremental() && pathgen_->canStream()
+    && !mcparams.greeks && !mcparams.controlVariate();
+
   // Pre-compute the discount factors
   Vector const& paytimes = prod->payTimes();
   discfactors_.resize(paytimes.size());
@@ -66,6 +115,7 @@ spots_(spots), mcparams_(mcparams)
   Vector const& fixtimes = prod->fixTimes();
   drifts_.resize(fixtimes.size(), nassets);
   stdevs_.resize(fixtimes.size(), nassets);
+  cumDrifts_.resize(fixtimes.size(), nassets);
 
   // loop over assets
   for (size_t j = 0; j < nassets; ++j) {
@@ -74,40 +124,539 @@ spots_(spots), mcparams_(mcparams)
     for (size_t i = 0; i < fixtimes.size(); ++i) {
       double t2 = fixtimes[i];
       double var = vols_[j] * vols_[j] * (t2 - t1);
-      stdevs_(i, j) = vols_[j];
+      stdevs_(i, j) = sqrt(var);
       double fwdrate = discyc_->fwdRate(t1, t2);
       // risk free rate less yield plus convexity adjustment
       drifts_(i, j) = (fwdrate - divylds_[j]) * (t2 - t1) - 0.5 * var;
+      cumDrifts_(i, j) = (i == 0 ? 0.0 : cumDrifts_(i - 1, j)) + drifts_(i, j);
       t1 = t2;
     }
   }
 
-  // Resize the payment amounts
-  payamts_.resize(prod->payTimes().size());
+  if (mcparams.fusedKernels && !streaming_ && !settling_)
+    kernel_ = makeBsMcKernel(prod, spots_, drifts_, stdevs_, correlMatrix, discfactors_, mcparams);
+  // FLOAT changes only the fused kernels, so it must not fall back silently to the double paths
+  QF_ASSERT(mcparams.precision == McParams::Precision::DOUBLE || kernel_,
+    "FLOAT precision needs a fused kernel: a European, digital or Asian basket product with EULER paths, "
+    "FUSEDKERNELS and no variance reduction, Greeks, correlation factors, streamed fixings or settling!");
+
+  if (mcparams.greeks) {
+    QF_ASSERT(prod->hasPathDerivs(), "Greeks need a product with pathwise derivatives!");
+    for (size_t j = 0; j < nassets; ++j)
+      QF_ASSERT(vols_[j] > 0.0, "the volatilities must be positive to compute Greeks!");
+  }
+
+  if (aad) {
+    // the derivatives of the drifts and log discount factors with respect to the forward rates
+    fwdWeights_.set_size(fixtimes.size(), nrates_);
+    double t1 = 0.0;
+    for (size_t i = 0; i < fixtimes.size(); ++i) {
+      fwdWeights_.row(i) = discyc_->fwdRateWeights(t1, fixtimes[i]).t();
+      t1 = fixtimes[i];
+    }
+    dfWeights_.set_size(paytimes.size(), nrates_);
+    for (size_t k = 0; k < paytimes.size(); ++k)
+      dfWeights_.row(k) = discyc_->fwdRateWeights(0.0, paytimes[k]).t();
+  }
+
+  initControlVariate(sqrtCorrel_.n_rows > 0 ? correl_ : pathgen_->correlation());
+}
+
+void MultiAssetBsMcPricer::initControlVariate(Matrix const& correlation)
+{
+  cvPayoffType_ = 0;
+  cvStrike_ = 0.0;
+  cvLogBasket_ = 0.0;
+  cvMean_ = 0.0;
+  Vector const& fixtimes = prod_->fixTimes();
+  size_t ntimesteps = fixtimes.size();
+  size_t nassets = prod_->nAssets();
+  double T = fixtimes[ntimesteps - 1];
+  cvDiscount_ = discyc_->discount(T);
+  if (!mcparams_.controlVariate())
+    return;
+
+  auto asian = std::dynamic_pointer_cast<AsianBasketCallPut>(prod_);
+  double basket = 0.0;
+  bool longonly = true;
+  if (asian) {
+    Vector const& qties = asian->assetQuantities();
+    for (size_t j = 0; j < nassets; ++j) {
+      basket += qties[j] * spots_[j];
+      longonly = longonly && qties[j] >= 0.0;
+    }
+  }
+  if (!asian || !longonly || basket <= 0.0) {
+    cvMean_ = spots_[0] * exp(-divylds_[0] * T);
+    return;
+  }
+
+  // log G = log B0 + sum_{i,j} a_j / n * log(S_j(t_i) / S_j(0)), with a_j = q_j S_j(0) / B0;
+  // the log increment of asset j over step l enters the n - l fixings from l onwards
+  Vector const& qties = asian->assetQuantities();
+  cvPayoffType_ = asian->payoffType();
+  cvStrike_ = asian->strike();
+  cvLogBasket_ = log(basket);
+  cvWeights_.set_size(ntimesteps, nassets);
+  double mean = cvLogBasket_, var = 0.0;
+  for (size_t l = 0; l < ntimesteps; ++l) {
+    for (size_t j = 0; j < nassets; ++j) {
+      double a = qties[j] * spots_[j] / basket;
+      cvWeights_(l, j) = a * double(ntimesteps - l) / double(ntimesteps);
+      mean += cvWeights_(l, j) * drifts_(l, j);
+    }
+    for (size_t j = 0; j < nassets; ++j)
+      for (size_t k = 0; k < nassets; ++k)
+        var += cvWeights_(l, j) * stdevs_(l, j) * correlation(j, k) * cvWeights_(l, k) * stdevs_(l, k);
+  }
+
+  // Black formula on the lognormal geometric average
+  double phi = cvPayoffType_;
+  double fwd = exp(mean + 0.5 * var);
+  // without variance, e.g. zero vols, or without strike, the option is worth its discounted intrinsic value
+  if (cvStrike_ <= 0.0 || var <= 0.0)
+    cvMean_ = cvDiscount_ * max(phi * (fwd - cvStrike_), 0.0);
+  else {
+    NormalDistribution normal;
+    double sd = sqrt(var);
+    double d1 = (log(fwd / cvStrike_) + 0.5 * var) / sd;
+    double d2 = d1 - sd;
+    cvMean_ = phi * cvDiscount_ * (fwd * normal.cdf(phi * d1) - cvStrike_ * normal.cdf(phi * d2));
+  }
+}
+
+PathStoreKey MultiAssetBsMcPricer::pathStoreKey() const
+{
+  return PathStoreKey(prod_->fixTimes(), pathgen_->nFactors(), pathgen_->correlation(), mcparams_);
+}
+
+SPtrPathStore MultiAssetBsMcPricer::makePathStore(unsigned long npaths, std::string const& fileName) const
+{
+  return PathStore::create(pathStoreKey(), *pathgen_, npaths, mcparams_, fileName);
+}
+
+void MultiAssetBsMcPricer::setPathStore(SPtrPathStore store)
+{
+  QF_ASSERT(!store || mcparams_.precision == McParams::Precision::DOUBLE,
+    "FLOAT precision does not support a path store, whose deviates are in double!");
+  QF_ASSERT(!store || !(mcparams_.greeks && mcparams_.aad),
+    "adjoint differentiation does not support a path store!");
+  if (store)
+    QF_ASSERT(store->key() == pathStoreKey(), "the path store was drawn with another key than this pricer's!");
+  pathStore_ = store;
+}
+
+MultiAssetBsMcPricer::Worker MultiAssetBsMcPricer::makeWorker() const
+{
+  Worker worker;
+  if (kernel_ && !pathStore_) {
+    worker.kernel = kernel_->clone();
+    return worker;
+  }
+  worker.pathgen = pathgen_->clone();
+  worker.prod = prod_->clone();
+  if (streaming_ && !pathStore_) {
+    worker.stepDevs.set_size(prod_->nAssets());
+    worker.stepSpots.set_size(prod_->nAssets());
+    return worker;
+  }
+  if (settling_ && !pathStore_) {
+    size_t blocksize = mcparams_.blockSize;
+    worker.laneProds.resize(blocksize);
+    for (size_t p = 0; p < blocksize; ++p)
+      worker.laneProds[p] = prod_->clone();
+    worker.lanes.resize(blocksize);
+    worker.laneSpots.set_size(blocksize * prod_->nAssets());
+    worker.laneDevs.set_size(blocksize * prod_->nAssets());
+    return worker;
+  }
+  worker.pathBatch.set_size(mcparams_.blockSize, pathgen_->nTimeSteps() * pathgen_->nFactors());
+  worker.cvLogs.set_size(mcparams_.blockSize);
+  if (mcparams_.greeks && mcparams_.aad)
+    recordModel(worker);
+  return worker;
+}
+
+void MultiAssetBsMcPricer::recordModel(Worker& worker) const
+{
+  Tape& tape = worker.tape;
+  size_t nassets = prod_->nAssets();
+  size_t ntimesteps = drifts_.n_rows;
+  size_t ncorr = sqrtCorrel_.n_rows;
+  Vector const& fixtimes = prod_->fixTimes();
+
+  // the leaves: spots, vols, dividend yields, forward rates and Cholesky factor
+  size_t nleaves = 3 * nassets + nrates_ + ncorr * (ncorr + 1) / 2;
+  for (size_t k = 0; k < nleaves; ++k)
+    tape.newLeaf();
+  size_t volleaf = nassets, divleaf = 2 * nassets, rateleaf = 3 * nassets;
+
+  // the drifts and standard deviations:
+  // drift_ij = int f(t) dt - q_j dt_i - sigma_j^2 dt_i / 2 and stdev_ij = sigma_j sqrt(dt_i)
+  std::vector<size_t>& args = worker.nodeArgs;
+  std::vector<double>& partials = worker.nodePartials;
+  worker.driftNodes.resize(nassets * ntimesteps);
+  worker.stdevNodes.resize(nassets * ntimesteps);
+  for (size_t j = 0; j < nassets; ++j) {
+    double t1 = 0.0;
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double dt = fixtimes[i] - t1;
+      args.clear();
+      partials.clear();
+      for (size_t k = 0; k < nrates_; ++k) {
+        if (fwdWeights_(i, k) != 0.0) {
+          args.push_back(rateleaf + k);
+          partials.push_back(fwdWeights_(i, k));
+        }
+      }
+      args.push_back(divleaf + j);
+      partials.push_back(-dt);
+      args.push_back(volleaf + j);
+      partials.push_back(-vols_[j] * dt);
+      worker.driftNodes[j * ntimesteps + i] = tape.newNode(args.size(), args.data(), partials.data());
+      worker.stdevNodes[j * ntimesteps + i] = tape.newNode(volleaf + j, sqrt(dt));
+      t1 = fixtimes[i];
+    }
+  }
+
+  // the discount factors, df_k = exp(-int f(t) dt)
+  worker.dfNodes.resize(discfactors_.size());
+  for (size_t k = 0; k < discfactors_.size(); ++k) {
+    args.clear();
+    partials.clear();
+    for (size_t m = 0; m < nrates_; ++m) {
+      if (dfWeights_(k, m) != 0.0) {
+        args.push_back(rateleaf + m);
+        partials.push_back(-discfactors_[k] * dfWeights_(k, m));
+      }
+    }
+    worker.dfNodes[k] = tape.newNode(args.size(), args.data(), partials.data());
+  }
+
+  worker.pathMark = tape.size();
+  worker.cholAdjoints.zeros(ncorr, ncorr);
+}
+
+void MultiAssetBsMcPricer::adjointPath(Worker& worker, size_t p, double* pathValues) const
+{
+  Tape& tape = worker.tape;
+  size_t nassets = prod_->nAssets();
+  size_t ntimesteps = drifts_.n_rows;
+  size_t ncorr = sqrtCorrel_.n_rows;
+  size_t cholleaf = 3 * nassets + nrates_;
+  Matrix const& pathBatch = worker.pathBatch;
+  Matrix const& devBatch = worker.devBatch;
+  Matrix const& pathDerivs = worker.pathDerivs;
+  Vector const& payamts = worker.prod->payAmounts();
+  std::vector<size_t>& args = worker.nodeArgs;
+  std::vector<double>& partials = worker.nodePartials;
+
+  // record the path: S_ij = S_i-1,j exp(drift_ij + stdev_ij eps_ij), with eps_ij = sum_k L_jk z_ik,
+  // and seed the adjoint of each spot with the derivative of the PV
+  for (size_t j = 0; j < nassets; ++j) {
+    size_t prevnode = j;
+    double prevspot = spots_[j];
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double spot = pathBatch(p, j * ntimesteps + i);
+      double stdev = stdevs_(i, j);
+      args.clear();
+      partials.clear();
+      double eps = 0.0;
+      if (ncorr > 0) {
+        for (size_t k = 0; k <= j; ++k) {
+          double z = devBatch(p, k * ntimesteps + i);
+          eps += sqrtCorrel_(j, k) * z;
+          args.push_back(cholleaf + j * (j + 1) / 2 + k);
+          partials.push_back(z);
+        }
+        size_t epsnode = tape.newNode(args.size(), args.data(), partials.data());
+        args.assign(1, epsnode);
+        partials.assign(1, spot * stdev);
+      }
+      else
+        eps = devBatch(p, j * ntimesteps + i);
+      args.push_back(prevnode);
+      partials.push_back(spot / prevspot);
+      args.push_back(worker.driftNodes[j * ntimesteps + i]);
+      partials.push_back(spot);
+      args.push_back(worker.stdevNodes[j * ntimesteps + i]);
+      partials.push_back(spot * eps);
+      prevnode = tape.newNode(args.size(), args.data(), partials.data());
+      tape.adjoint(prevnode) = pathDerivs(i, j);
+      prevspot = spot;
+    }
+  }
+  // the PV is sum_k df_k A_k
+  for (size_t k = 0; k < payamts.size(); ++k)
+    tape.adjoint(worker.dfNodes[k]) += payamts[k];
+
+  // propagate down to the leaves and read out the sensitivities
+  tape.propagate(tape.size());
+  for (size_t j = 0; j < nassets; ++j) {
+    pathValues[1 + j] = tape.adjoint(j);
+    pathValues[1 + nassets + j] = tape.adjoint(nassets + j);
+    pathValues[1 + 2 * nassets + j] = tape.adjoint(2 * nassets + j);
+  }
+  for (size_t k = 0; k < nrates_; ++k)
+    pathValues[1 + 3 * nassets + k] = tape.adjoint(3 * nassets + k);
+  for (size_t j = 0; j < ncorr; ++j)
+    for (size_t k = 0; k <= j; ++k)
+      worker.cholAdjoints(j, k) += tape.adjoint(cholleaf + j * (j + 1) / 2 + k);
 
+  tape.clearAdjoints();
+  tape.rewind(worker.pathMark);
 }
 
-double MultiAssetBsMcPricer::processOnePath(Matrix& pricePath)
+void MultiAssetBsMcPricer::setCorrelationSensitivities(Matrix const& cholAdjoints)
+{
+  corrSens_.reset();
+  size_t n = sqrtCorrel_.n_rows;
+  if (n == 0)
+    return;
+
+  // record the Cholesky decomposition of the correlation matrix on a tape,
+  // and propagate the adjoints of the factor back to the correlations
+  Tape tape;
+  std::vector<ADouble> rho(n * n), L(n * n);
+  for (size_t j = 0; j < n; ++j)
+    for (size_t k = 0; k < j; ++k)
+      rho[j * n + k] = ADouble(tape, correl_(j, k));
+  for (size_t j = 0; j < n; ++j) {
+    for (size_t k = 0; k <= j; ++k) {
+      ADouble sum = j == k ? ADouble(correl_(j, j)) : rho[j * n + k];
+      for (size_t m = 0; m < k; ++m)
+        sum -= L[j * n + m] * L[k * n + m];
+      L[j * n + k] = j == k ? sqrt(sum) : sum / L[k * n + k];
+    }
+  }
+  for (size_t j = 0; j < n; ++j)
+    for (size_t k = 0; k <= j; ++k)
+      if (L[j * n + k].tape())
+        tape.adjoint(L[j * n + k].node()) += cholAdjoints(j, k);
+  tape.propagate(tape.size());
+
+  corrSens_.zeros(n, n);
+  for (size_t j = 0; j < n; ++j)
+    for (size_t k = 0; k < j; ++k)
+      corrSens_(j, k) = corrSens_(k, j) = rho[j * n + k].adjoint();
+}
+
+void MultiAssetBsMcPricer::processBlock(Worker& worker, size_t npaths, double* values,
+                                        double const* storedDevs, size_t storedStride) const
 {
-  pathgen_->next(pricePath);
   size_t nassets = prod_->nAssets();
-  currspots_ = spots_;               // initialize the current spots array
-  // convert the normal deviates to a price path in-place
-  for (size_t i = 0; i < pricePath.n_rows; ++i) {
+  size_t ntimesteps = drifts_.n_rows;
+  Matrix& pathBatch = worker.pathBatch;
+  if (storedDevs)
+    pathBatch.set_size(npaths, nassets * ntimesteps);
+  else
+    worker.pathgen->nextBatch(npaths, pathBatch);
+  bool cv = mcparams_.controlVariate();
+  bool geocv = cv && cvPayoffType_ != 0;
+  bool greeks = mcparams_.greeks;
+  bool aad = greeks && mcparams_.aad;
+  size_t nvars = greeks ? (aad ? 1 + 3 * nassets + nrates_ : 1 + 2 * nassets) : 1;
+  size_t nvalues = cv ? nvars + 1 : nvars;
+
+  // with adjoint differentiation, keep the independent deviates and apply the Cholesky factor here,
+  // as one blocked matrix product for the whole block; the correlated deviates then swap in
+  if (aad) {
+    worker.cholAdjoints.zeros();
+    if (sqrtCorrel_.n_rows > 0) {
+      worker.devBatch.set_size(pathBatch.n_rows, pathBatch.n_cols);
+      correlator_.apply(pathBatch.memptr(), worker.devBatch.memptr(), npaths * ntimesteps);
+      pathBatch.swap(worker.devBatch);
+    }
+    else
+      worker.devBatch = pathBatch;
+  }
+
+  // the deviates are in the block and turn into spots in place,
+  // or are read from the path store and turn into spots in the block
+  double const* deviates = storedDevs ? storedDevs : pathBatch.memptr();
+  size_t devStride = storedDevs ? storedStride : pathBatch.n_rows;
+
+  // the log geometric average is accumulated from the log increments, before they turn into spots
+  double* cvlogs = worker.cvLogs.memptr();
+  if (geocv) {
+    for (size_t p = 0; p < npaths; ++p)
+      cvlogs[p] = cvLogBasket_;
     for (size_t j = 0; j < nassets; ++j) {
-      double normaldeviate = pricePath(i, j);
-      pricePath(i, j) = currspots_[j] * exp(drifts_(i, j) + stdevs_(i, j) * normaldeviate);
-      currspots_[j] = pricePath(i, j);  // store the spot for the next time step
+      for (size_t i = 0; i < ntimesteps; ++i) {
+        double w = cvWeights_(i, j);
+        double drift = drifts_(i, j);
+        double stdev = stdevs_(i, j);
+        double const* devs = deviates + (j * ntimesteps + i) * devStride;
+        for (size_t p = 0; p < npaths; ++p)
+          cvlogs[p] += w * (drift + stdev * devs[p]);
+      }
+    }
+  }
+
+  // convert the normal deviates to price paths, one asset and time step at a time for all paths
+  for (size_t j = 0; j < nassets; ++j) {
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double drift = drifts_(i, j);
+      double stdev = stdevs_(i, j);
+      double const* devs = deviates + (j * ntimesteps + i) * devStride;
+      double* spots = pathBatch.colptr(j * ntimesteps + i);
+      if (i == 0) {
+        double spot = spots_[j];
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = spot * exp(drift + stdev * devs[p]);
+      }
+      else {
+        double const* prevspots = pathBatch.colptr(j * ntimesteps + i - 1);
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = prevspots[p] * exp(drift + stdev * devs[p]);
+      }
+    }
+  }
+
+  // evaluate the product on each path, viewed in place in the block
+  Product& prod = *worker.prod;
+  Matrix const& pathDerivs = worker.pathDerivs;
+  Vector const& payamts = prod.payAmounts();
+  Vector const& fixtimes = prod_->fixTimes();
+  size_t stride = pathBatch.n_rows;
+  for (size_t p = 0; p < npaths; ++p) {
+    MatrixView pricePath(pathBatch.colptr(0) + p, ntimesteps, nassets, stride, stride * ntimesteps);
+    if (greeks)
+      prod.evalPathDerivs(pricePath, discfactors_, worker.pathDerivs);
+    else
+      prod.eval(pricePath);
+
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    values[p * nvalues] = pv;
+
+    if (aad)
+      adjointPath(worker, p, values + p * nvalues);
+    else if (greeks) {
+      // S_ij = S0_j exp(D_ij + sigma_j W_ij), so dS_ij/dS0_j = S_ij / S0_j and dS_ij/dsigma_j = S_ij (W_ij - sigma_j t_i)
+      for (size_t j = 0; j < nassets; ++j) {
+        double delta = 0.0, vega = 0.0;
+        for (size_t i = 0; i < ntimesteps; ++i) {
+          double S = pricePath(i, j);
+          double W = (log(S / spots_[j]) - cumDrifts_(i, j)) / vols_[j];
+          delta += pathDerivs(i, j) * S;
+          vega += pathDerivs(i, j) * S * (W - vols_[j] * fixtimes[i]);
+        }
+        values[p * nvalues + 1 + j] = delta / spots_[j];
+        values[p * nvalues + 1 + nassets + j] = vega;
+      }
+    }
+
+    if (geocv) {
+      double G = exp(cvlogs[p]);
+      double payoff = cvPayoffType_ * (G - cvStrike_);
+      values[p * nvalues + nvars] = cvDiscount_ * (payoff > 0.0 ? payoff : 0.0);
     }
+    else if (cv)
+      values[p * nvalues + nvars] = cvDiscount_ * pathBatch(p, ntimesteps - 1);
   }
-  prod_->eval(pricePath);
-  payamts_ = prod_->payAmounts();
+}
 
-  double pv = 0.0;
-  for (size_t i = 0; i < payamts_.size(); ++i)
-    pv += discfactors_[i] * payamts_[i];
+void MultiAssetBsMcPricer::streamBlock(Worker& worker, size_t npaths, double* values) const
+{
+  size_t nassets = prod_->nAssets();
+  size_t ntimesteps = drifts_.n_rows;
+  bool cv = mcparams_.controlVariate();
+  bool geocv = cv && cvPayoffType_ != 0;
+  size_t nvalues = cv ? 2 : 1;
+  PathGenerator& pathgen = *worker.pathgen;
+  Product& prod = *worker.prod;
+  Vector const& payamts = prod.payAmounts();
+  double* devs = worker.stepDevs.memptr();
+  double* spots = worker.stepSpots.memptr();
+
+  for (size_t p = 0; p < npaths; ++p) {
+    pathgen.beginPath();
+    prod.begin();
+    std::copy(spots_.begin(), spots_.end(), spots);
+    double cvlog = cvLogBasket_;
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      pathgen.nextStep(i, devs);
+      for (size_t j = 0; j < nassets; ++j) {
+        double logret = drifts_(i, j) + stdevs_(i, j) * devs[j];
+        if (geocv)
+          cvlog += cvWeights_(i, j) * logret;
+        spots[j] *= exp(logret);
+      }
+      prod.onFixing(i, spots);
+      // a settled path is not simulated any further
+      if (settling_ && prod.isSettled())
+        break;
+    }
+    prod.finish();
 
-  return pv;
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    values[p * nvalues] = pv;
+
+    if (geocv) {
+      double G = exp(cvlog);
+      double payoff = cvPayoffType_ * (G - cvStrike_);
+      values[p * nvalues + 1] = cvDiscount_ * (payoff > 0.0 ? payoff : 0.0);
+    }
+    else if (cv)
+      values[p * nvalues + 1] = cvDiscount_ * spots[0];
+  }
+}
+
+void MultiAssetBsMcPricer::settleBlock(Worker& worker, size_t npaths, double* values) const
+{
+  size_t nassets = prod_->nAssets();
+  size_t ntimesteps = drifts_.n_rows;
+  PathGenerator& pathgen = *worker.pathgen;
+  size_t* lanes = worker.lanes.data();
+  double* spots = worker.laneSpots.memptr();
+  double* devs = worker.laneDevs.memptr();
+
+  pathgen.beginBatch(npaths);
+  for (size_t p = 0; p < npaths; ++p) {
+    lanes[p] = p;
+    std::copy(spots_.begin(), spots_.end(), spots + p * nassets);
+    worker.laneProds[p]->begin();
+  }
+
+  // step the paths still simulated for all of them, then fix each one and compact out the settled ones
+  size_t nlanes = npaths;
+  for (size_t i = 0; i < ntimesteps && nlanes > 0; ++i) {
+    pathgen.nextStepBatch(i, nlanes, lanes, devs);
+    for (size_t j = 0; j < nassets; ++j) {
+      double drift = drifts_(i, j);
+      double stdev = stdevs_(i, j);
+      double const* assetdevs = devs + j * nlanes;
+      for (size_t k = 0; k < nlanes; ++k)
+        spots[k * nassets + j] *= exp(drift + stdev * assetdevs[k]);
+    }
+
+    size_t nkept = 0;
+    for (size_t k = 0; k < nlanes; ++k) {
+      Product& prod = *worker.laneProds[lanes[k]];
+      prod.onFixing(i, spots + k * nassets);
+      if (prod.isSettled())
+        continue;
+      lanes[nkept] = lanes[k];
+      if (nkept != k)
+        std::copy(spots + k * nassets, spots + (k + 1) * nassets, spots + nkept * nassets);
+      ++nkept;
+    }
+    nlanes = nkept;
+  }
+
+  for (size_t p = 0; p < npaths; ++p) {
+    Product& prod = *worker.laneProds[p];
+    prod.finish();
+    Vector const& payamts = prod.payAmounts();
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    values[p] = pv;
+  }
 }
 
 END_NAMESPACE(qf)
@@ -11,7 +11,17 @@
 #include <qflib/market/yieldcurve.hpp>
 #include <qflib/methods/montecarlo/mcparams.hpp>
 #include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <qflib/methods/montecarlo/pathblockrunner.hpp>
+#include <qflib/methods/montecarlo/variancereducer.hpp>
+#include <qflib/methods/montecarlo/mcruninfo.hpp>
+#include <qflib/methods/montecarlo/mckernel.hpp>
+#include <qflib/methods/montecarlo/pathstore.hpp>
 #include <qflib/math/stats/statisticscalculator.hpp>
+#include <qflib/math/ad/tape.hpp>
+#include <qflib/math/linalg/linalg.hpp>
+#include <algorithm>
+#include <chrono>
+#include <vector>
 
 BEGIN_NAMESPACE(qf)
 
@@ -31,19 +41,139 @@ public:
                        Matrix const& correlMatrix,
                        McParams const& mcparams);
 
-  /** Returns the number of variables that can be tracked for stats */
+  /** Returns the number of variables that can be tracked for stats: the PV,
+      and with McParams::greeks, the delta of each asset followed by the vega of each asset.
+      With McParams::aad, these are followed by the sensitivities to the dividend yield of each asset
+      and to each forward rate of the discount curve (see YieldCurve::fwdRates).
+  */
   size_t nVariables();
 
-  /** Runs the simulation and collects statistics */
+  /** After simulate() with McParams::greeks and McParams::aad, the sensitivities of the PV
+      to the correlations: entry (j, k) is the sensitivity to the correlation between assets j and k,
+      moving entries (j, k) and (k, j) together. These are computed from the average adjoint
+      of the Cholesky factor over all paths, so they come without standard errors.
+      The correlation matrix is taken after spectral truncation.
+  */
+  Matrix const& correlationSensitivities() const;
+
+  /** With McParams::nCorrFactors, the fraction of the variance of the asset returns explained
+      by the systematic factors of the correlation factor model, otherwise 1
+  */
+  double explainedVariance() const;
+
+  /** Runs the simulation and collects statistics.
+      The paths are split over McParams::nThreads threads; the results do not depend on the thread count.
+      With antithetic pairs, npaths is rounded up to an even number and each sample is the average of a pair.
+      With a control variate, each sample is corrected by the control; see VarianceReducer.
+      With McParams::greeks, the pathwise deltas and vegas are estimated on the same paths;
+      this requires a product with path derivatives.
+      With McParams::aad, each path is recorded on a tape and differentiated backwards, one at a time,
+      which also gives the sensitivities to the dividend yields, the discount curve and the correlations.
+      With McParams::fusedKernels, the products with a fused kernel are priced by it, see makeBsMcKernel;
+      in DOUBLE the paths are the same, to rounding, and in FLOAT the same paths as DOUBLE with INVCDF,
+      to float rounding; other paths than STDLIB, see McKernel.
+      With a path store set, the deviates are read from it in place, and the fused kernel is not used.
+      With McParams::streamFixings, Euler paths and no antithetic paths or Greeks, each path is simulated
+      one time step at a time and its fixings are streamed into the product, see streamBlock().
+      With a product that can settle before its last fixing (e.g. a worst-of autocallable), Euler paths
+      and no variance reduction or Greeks, the simulation of each path stops as soon as it is settled:
+      streamed paths end early, and otherwise the block is simulated one time step at a time with the settled
+      paths compacted out, see settleBlock(). The paths and the prices are the same as without settling, to rounding.
+      With the McParams tolerances or time budget set, npaths is the maximum number of paths
+      and the simulation stops as soon as a criterion is met.
+      Returns the number of paths used, the time spent and the standard error.
+  */
   template<typename ITER>
-  void simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths);
+  McRunInfo simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths);
+
+  /** Returns the key of the deviates this pricer draws, see PathStore */
+  PathStoreKey pathStoreKey() const;
+
+  /** Draws npaths paths of this pricer into a path store, kept in memory or written to the given file */
+  SPtrPathStore makePathStore(unsigned long npaths, std::string const& fileName = "") const;
+
+  /** Makes simulate() replay the deviates of the path store instead of drawing them, e.g. to price
+      scenarios of spots, vols or curves on common random numbers; the store must have the key
+      of this pricer and at least as many paths as simulated. A null store draws them again.
+  */
+  void setPathStore(SPtrPathStore store);
 
 protected:
 
-  /** Creates and processes one price path.
-      It returns the PV of the product
+  /** The state owned by one simulation thread */
+  struct Worker
+  {
+    SPtrPathGenerator pathgen;   // this thread's path generator
+    SPtrMcKernel kernel;         // this thread's fused kernel, if any; it then replaces the path generator and product
+    SPtrProduct prod;            // this thread's copy of the product
+    Matrix pathBatch;            // scratch block of paths, paths innermost
+    Vector cvLogs;               // scratch, log of the geometric basket average of each path
+    Vector stepDevs;             // scratch, the correlated deviates of one time step of a streamed path
+    Vector stepSpots;            // scratch, the current spots of a streamed path
+    std::vector<SPtrProduct> laneProds;  // a copy of the product per path of a block, for settleBlock()
+    std::vector<size_t> lanes;   // scratch, the paths still simulated by settleBlock(), compacted
+    Vector laneSpots;            // scratch, the current spots of the paths still simulated, assets innermost
+    Vector laneDevs;             // scratch, the deviates of a time step of the paths still simulated, paths innermost
+    Matrix pathDerivs;           // scratch, derivatives of the PV with respect to the price path
+    // adjoint differentiation
+    Tape tape;                       // the model, then the current path
+    size_t pathMark;                 // the tape checkpoint where each path starts
+    std::vector<size_t> driftNodes;  // tape node of each drift, time steps innermost
+    std::vector<size_t> stdevNodes;  // tape node of each standard deviation, time steps innermost
+    std::vector<size_t> dfNodes;     // tape node of each discount factor
+    std::vector<size_t> nodeArgs;    // scratch, the arguments of a node
+    std::vector<double> nodePartials;  // scratch, the partial derivatives of a node
+    Matrix devBatch;                 // scratch, the independent deviates of a block
+    Matrix cholAdjoints;             // sum over the block of the adjoints of the Cholesky factor
+  };
+
+  /** Creates the state of one simulation thread */
+  Worker makeWorker() const;
+
+  /** Creates and processes a block of npaths price paths, from the path generator, or from the deviates
+      of a path store, column c of the block at storedDevs + c * storedStride.
+      It writes the PV of the product on each path into values[p * nvalues], with McParams::greeks
+      the delta and vega of asset j into values[p * nvalues + 1 + j] and values[p * nvalues + 1 + nassets + j],
+      and with a control variate, the PV of the control into values[p * nvalues + nVariables()].
+  */
+  void processBlock(Worker& worker, size_t npaths, double* values,
+                    double const* storedDevs = nullptr, size_t storedStride = 0) const;
+
+  /** Simulates npaths paths one at a time, one time step at a time, streaming the fixings into the product:
+      with an incremental product, the working memory is the current spots of a path instead of a block
+      of whole paths. It writes the same values as processBlock(), on the same paths, to rounding.
+  */
+  void streamBlock(Worker& worker, size_t npaths, double* values) const;
+
+  /** Simulates a block of npaths paths one time step at a time, each path evaluated incrementally by its own copy
+      of the product; after each fixing, the settled paths are compacted out, so that no more spots are computed
+      for them, nor, with a counter-based urng, deviates drawn. It writes the PV of each path into values[p],
+      on the same paths as processBlock(), see EulerPathGenerator.
+  */
+  void settleBlock(Worker& worker, size_t npaths, double* values) const;
+
+  /** Sets up the control variate: for an Asian basket, the same option on the geometric average
+      of the assets over the fixings, weighted by their initial values in the basket;
+      otherwise the discounted final spot of the first asset.
+  */
+  void initControlVariate(Matrix const& correlation);
+
+  /** Records the model parameters as the leaves of the worker's tape, followed by the drifts,
+      standard deviations and discount factors derived from them. The leaves are the spots,
+      the volatilities, the dividend yields, the forward rates of the discount curve and the
+      lower triangle of the Cholesky factor, in this order.
+  */
+  void recordModel(Worker& worker) const;
+
+  /** Records path p of the current block, already converted to spots, on the worker's tape,
+      propagates the adjoints of its PV back to the model parameters and rewinds the tape.
+      It writes the Greeks into pathValues[1], ..., pathValues[nVariables() - 1]
+      and adds the adjoints of the Cholesky factor to worker.cholAdjoints.
   */
-  double processOnePath(Matrix& pricePath);
+  void adjointPath(Worker& worker, size_t p, double* pathValues) const;
+
+  /** Sets the correlation sensitivities from the average adjoints of the Cholesky factor */
+  void setCorrelationSensitivities(Matrix const& cholAdjoints);
 
 private:
   SPtrProduct prod_;               // pointer to the product
@@ -54,12 +184,30 @@ private:
   McParams mcparams_;              // the Monte Carlo parameters
 
   SPtrPathGenerator pathgen_;  // pointer to the path generator
+  SPtrMcKernel kernel_;        // the fused kernel of the product, null if it has none, see makeBsMcKernel
+  SPtrPathStore pathStore_;    // the path store replayed by simulate(), if any
+  bool streaming_;             // whether simulate() streams the fixings of each path, see streamBlock()
+  bool settling_;              // whether simulate() stops simulating the settled paths, see settleBlock()
   Vector discfactors_;         // caches the pre-computed discount factors
   Matrix drifts_;              // caches the pre-computed asset drifts, one column per asset
   Matrix stdevs_;              // caches the pre-computed standard deviations, one column per asset 
+  Matrix cumDrifts_;           // caches the drifts accumulated up to each fixing time, one column per asset
+
+  // adjoint differentiation
+  size_t nrates_;              // number of forward rates of the discount curve
+  Matrix fwdWeights_;          // derivative of each time step's drift with respect to each forward rate
+  Matrix dfWeights_;           // derivative of each log discount factor with respect to each forward rate
+  Matrix correl_;              // the correlation matrix after spectral truncation
+  Matrix sqrtCorrel_;          // its Cholesky factor; the path generator then draws independent factors
+  CholeskyMultiplier correlator_;  // applies the Cholesky factor to a block of independent deviates
+  Matrix corrSens_;            // the correlation sensitivities
 
-  Vector currspots_;           // scratch array with the current spots, one per asset
-  Vector payamts_;             // scratch array for writting the payments after each simulation
+  int cvPayoffType_;           // control variate, 1: call; -1: put; 0: discounted final spot
+  double cvStrike_;            // control variate strike
+  double cvLogBasket_;         // log of the initial basket value
+  Matrix cvWeights_;           // weight of each log increment in the log geometric average
+  double cvDiscount_;          // control variate discount factor, to the last fixing time
+  double cvMean_;              // control variate expectation
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -68,22 +216,97 @@ private:
 inline
 size_t MultiAssetBsMcPricer::nVariables()
 {
-  return 1;  // just one variable, the price
+  if (!mcparams_.greeks)
+    return 1;
+  return mcparams_.aad ? 1 + 3 * prod_->nAssets() + nrates_ : 1 + 2 * prod_->nAssets();
+}
+
+inline
+Matrix const& MultiAssetBsMcPricer::correlationSensitivities() const
+{
+  return corrSens_;
+}
+
+inline
+double MultiAssetBsMcPricer::explainedVariance() const
+{
+  return pathgen_->explainedVariance();
 }
 
 template<typename ITER>
-void MultiAssetBsMcPricer::simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths)
+McRunInfo MultiAssetBsMcPricer::simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths)
 {
-  // create the price path matrix
-  Matrix pricePath(pathgen_->nTimeSteps(), pathgen_->nFactors());
   // check the size of the statistics calculator
   QF_ASSERT(statsCalc.nVariables() == nVariables(), "the statistics calculator must track as many variables as the pricer captures!");
 
-  // This is the HOT loop
-  for (unsigned long i = 0; i < npaths; ++i) {
-    double pv = processOnePath(pricePath);
-    statsCalc.addSample(&pv, &pv + 1);
-  }
+  VarianceReducer reducer(mcparams_.antithetic(), mcparams_.controlVariate(), cvMean_, nVariables());
+  if (mcparams_.antithetic() && npaths % 2 != 0)
+    ++npaths;
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [start]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  bool converged = false;
+  unsigned long nallocs = 0;
+
+  // with adjoint differentiation, the Cholesky factor adjoints of each block are summed in path order,
+  // so that the correlation sensitivities do not depend on the thread count either;
+  // each block in flight keeps its adjoints in a column of a ring of pre-allocated slots
+  bool aad = mcparams_.greeks && mcparams_.aad;
+  size_t blocksize = mcparams_.blockSize;
+  size_t ncholadj = sqrtCorrel_.n_elem;
+  unsigned long nslots = pathBlocksInFlight(mcparams_);
+  Matrix blockCholAdjoints(ncholadj, aad ? nslots : 0);
+  Matrix cholAdjoints(sqrtCorrel_.n_rows, sqrtCorrel_.n_cols, arma::fill::zeros);
+  unsigned long nfedblocks = 0;
+
+  if (pathStore_)
+    QF_ASSERT(npaths <= pathStore_->nPaths(), "the path store holds fewer paths than requested!");
+
+  unsigned long nused = runPathBlocks(npaths, reducer.nValues(), mcparams_,
+    [this]() { return makeWorker(); },
+    [&](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double* values) {
+      if (pathStore_) {
+        processBlock(worker, nBlockPaths, values, pathStore_->block(firstPath), pathStore_->blockRows(firstPath));
+        return;
+      }
+      if (worker.kernel) {
+        worker.kernel->seed(mcparams_.seed, firstPath);
+        worker.kernel->run(nBlockPaths, values, 1);
+        return;
+      }
+      worker.pathgen->seed(mcparams_.seed, firstPath);
+      if (streaming_) {
+        streamBlock(worker, nBlockPaths, values);
+        return;
+      }
+      if (settling_) {
+        settleBlock(worker, nBlockPaths, values);
+        return;
+      }
+      processBlock(worker, nBlockPaths, values);
+      if (aad)
+        std::copy(worker.cholAdjoints.begin(), worker.cholAdjoints.end(),
+                  blockCholAdjoints.colptr((firstPath / blocksize) % nslots));
+    },
+    [&](double* values, size_t nBlockPaths) {
+      if (aad) {
+        double const* adjoints = blockCholAdjoints.colptr(nfedblocks++ % nslots);
+        for (size_t k = 0; k < ncholadj; ++k)
+          cholAdjoints[k] += adjoints[k];
+      }
+      reducer.feed(values, nBlockPaths, statsCalc);
+      converged = reducer.nSamples() > 1 && mcparams_.toleranceMet(reducer.mean(), reducer.stdErr());
+      bool outoftime = mcparams_.maxSeconds > 0.0 && elapsed() >= mcparams_.maxSeconds;
+      return !converged && !outoftime;
+    },
+    &nallocs);
+
+  if (aad && nused > 0)
+    setCorrelationSensitivities(cholAdjoints / double(nused));
+
+  return McRunInfo{ nused, elapsed(), reducer.stdErr(), converged, nallocs };
 }
 
 END_NAMESPACE(qf)
@@ -0,0 +1,207 @@
+/**
+  @file  portfoliobsmcpricer.cpp
+  @brief Implementation of the PortfolioBsMcPricer class
+*/
+
+#include <qflib/pricers/portfoliobsmcpricer.hpp>
+#include <qflib/methods/montecarlo/eulerpathgenerator.hpp>
+#include <qflib/methods/montecarlo/sobolpathgenerator.hpp>
+#include <qflib/methods/montecarlo/antitheticpathgenerator.hpp>
+
+#include <cmath>
+
+using namespace std;
+
+BEGIN_NAMESPACE(qf)
+
+PortfolioBsMcPricer::PortfolioBsMcPricer(vector<SPtrProduct> const& prods,
+                                         SPtrYieldCurve discountCurve,
+                                         Vector const& divYields,
+                                         Vector const& volatilities,
+                                         Vector const& spots,
+                                         Matrix const& correlMatrix,
+                                         McParams const& mcparams)
+: prods_(prods), discyc_(discountCurve), divylds_(divYields), vols_(volatilities),
+spots_(spots), mcparams_(mcparams)
+{
+  QF_ASSERT(!prods.empty(), "no products to price!");
+  QF_ASSERT(!mcparams.controlVariate(), "control variates are not supported for portfolios!");
+  QF_ASSERT(!mcparams.greeks, "Greeks are not supported for portfolios!");
+  QF_ASSERT(mcparams.precision == McParams::Precision::DOUBLE, "FLOAT precision is not supported for portfolios!");
+
+  // Check inputs for size; each product depends on the first assets of the model
+  size_t nassets = spots.size();
+  QF_ASSERT(nassets > 0, "need at least one asset!");
+  QF_ASSERT(divYields.size() == nassets, "need as many div yields as spots!");
+  QF_ASSERT(volatilities.size() == nassets, "need as many volatilities as spots!");
+  if (nassets > 1) {
+    QF_ASSERT(correlMatrix.is_square(), "the correlation matrix must be square!");
+    QF_ASSERT(correlMatrix.n_rows == nassets, "need as many correlation matrix rows as spots!");
+  }
+  for (auto const& prod : prods) {
+    QF_ASSERT(prod, "missing product!");
+    QF_ASSERT(prod->nAssets() <= nassets, "a product depends on more assets than the model has!");
+  }
+
+  // The simulation times are the union of the fixing times
+  vector<double> times;
+  for (auto const& prod : prods)
+    times.insert(times.end(), prod->fixTimes().begin(), prod->fixTimes().end());
+  sort(times.begin(), times.end());
+  times.erase(unique(times.begin(), times.end()), times.end());
+  QF_ASSERT(!times.empty(), "no fixing times!");
+  simtimes_ = Vector(times);
+  size_t ntimesteps = simtimes_.size();
+
+  // Map the fixing times of each product to simulation time steps
+  fixindices_.resize(prods.size());
+  contiguous_.resize(prods.size());
+  for (size_t m = 0; m < prods.size(); ++m) {
+    Vector const& fixtimes = prods[m]->fixTimes();
+    fixindices_[m].resize(fixtimes.size());
+    contiguous_[m] = true;
+    for (size_t i = 0; i < fixtimes.size(); ++i) {
+      fixindices_[m][i] = lower_bound(times.begin(), times.end(), fixtimes[i]) - times.begin();
+      if (i > 0 && fixindices_[m][i] != fixindices_[m][i - 1] + 1)
+        contiguous_[m] = false;
+    }
+  }
+
+  // Create the path generator, one factor per asset
+  if (mcparams.pathGenType == McParams::PathGenType::EULER) {
+    if (mcparams.urngType == McParams::UrngType::MINSTDRAND)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMinStdRand>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::MT19937)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMt19937>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX3)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux3>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX4)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux4>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::PHILOX4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngPhilox4x32>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else if (mcparams.urngType == McParams::UrngType::THREEFRY4X32)
+      pathgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngThreefry4x32>(
+        times.begin(), times.end(), nassets, correlMatrix,
+        mcparams.normalGenType, mcparams.nCorrFactors));
+    else
+      QF_ASSERT(0, "unknown urng type!");
+  }
+  else if (mcparams.pathGenType == McParams::PathGenType::SOBOL)
+    pathgen_ = SPtrPathGenerator(new SobolPathGenerator(
+      times.begin(), times.end(), nassets, correlMatrix, mcparams.scrambleType,
+      mcparams.nCorrFactors));
+  else
+    QF_ASSERT(0, "unknown path generator type!");
+
+  if (mcparams.antithetic()) {
+    QF_ASSERT(mcparams.blockSize % 2 == 0, "the block size must be even with antithetic paths!");
+    pathgen_ = SPtrPathGenerator(new AntitheticPathGenerator(pathgen_));
+  }
+
+  // Pre-compute the discount factors of each product
+  discfactors_.resize(prods.size());
+  for (size_t m = 0; m < prods.size(); ++m) {
+    Vector const& paytimes = prods[m]->payTimes();
+    discfactors_[m].resize(paytimes.size());
+    for (size_t i = 0; i < paytimes.size(); ++i)
+      discfactors_[m][i] = discyc_->discount(paytimes[i]);
+  }
+
+  // Pre-compute the stdevs and drifts from time step to time step
+  drifts_.resize(ntimesteps, nassets);
+  stdevs_.resize(ntimesteps, nassets);
+
+  // loop over assets
+  for (size_t j = 0; j < nassets; ++j) {
+    double t1 = 0.0;
+    // loop over simulation times
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double t2 = simtimes_[i];
+      double var = vols_[j] * vols_[j] * (t2 - t1);
+      stdevs_(i, j) = sqrt(var);
+      double fwdrate = discyc_->fwdRate(t1, t2);
+      // risk free rate less yield plus convexity adjustment
+      drifts_(i, j) = (fwdrate - divylds_[j]) * (t2 - t1) - 0.5 * var;
+      t1 = t2;
+    }
+  }
+}
+
+PortfolioBsMcPricer::Worker PortfolioBsMcPricer::makeWorker() const
+{
+  Worker worker;
+  worker.pathgen = pathgen_->clone();
+  worker.pathBatch.set_size(mcparams_.blockSize, pathgen_->nTimeSteps() * pathgen_->nFactors());
+  for (size_t m = 0; m < prods_.size(); ++m) {
+    worker.prods.push_back(prods_[m]->clone());
+    worker.pricePaths.push_back(contiguous_[m] ? Matrix() : Matrix(prods_[m]->fixTimes().size(), prods_[m]->nAssets()));
+  }
+  return worker;
+}
+
+void PortfolioBsMcPricer::processBlock(Worker& worker, size_t npaths, double* values) const
+{
+  Matrix& pathBatch = worker.pathBatch;
+  worker.pathgen->nextBatch(npaths, pathBatch);
+  size_t nassets = spots_.size();
+  size_t ntimesteps = simtimes_.size();
+  size_t nprods = prods_.size();
+
+  // convert the normal deviates to price paths in-place, one asset and time step at a time for all paths
+  for (size_t j = 0; j < nassets; ++j) {
+    for (size_t i = 0; i < ntimesteps; ++i) {
+      double drift = drifts_(i, j);
+      double stdev = stdevs_(i, j);
+      double* spots = pathBatch.colptr(j * ntimesteps + i);
+      if (i == 0) {
+        double spot = spots_[j];
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = spot * exp(drift + stdev * spots[p]);
+      }
+      else {
+        double const* prevspots = pathBatch.colptr(j * ntimesteps + i - 1);
+        for (size_t p = 0; p < npaths; ++p)
+          spots[p] = prevspots[p] * exp(drift + stdev * spots[p]);
+      }
+    }
+  }
+
+  // evaluate every product on each path, on its own fixing times;
+  // the path is viewed in place if they are consecutive simulation times, and gathered otherwise
+  size_t stride = pathBatch.n_rows;
+  for (size_t p = 0; p < npaths; ++p) {
+    for (size_t m = 0; m < nprods; ++m) {
+      Product& prod = *worker.prods[m];
+      vector<size_t> const& fixidx = fixindices_[m];
+      if (contiguous_[m])
+        prod.eval(MatrixView(pathBatch.colptr(fixidx[0]) + p, fixidx.size(), prod.nAssets(),
+                             stride, stride * ntimesteps));
+      else {
+        Matrix& pricePath = worker.pricePaths[m];
+        for (size_t j = 0; j < pricePath.n_cols; ++j)
+          for (size_t i = 0; i < fixidx.size(); ++i)
+            pricePath(i, j) = pathBatch(p, j * ntimesteps + fixidx[i]);
+        prod.eval(pricePath);
+      }
+
+      Vector const& payamts = prod.payAmounts();
+      Vector const& discfactors = discfactors_[m];
+      double pv = 0.0;
+      for (size_t k = 0; k < payamts.size(); ++k)
+        pv += discfactors[k] * payamts[k];
+      values[p * nprods + m] = pv;
+    }
+  }
+}
+
+END_NAMESPACE(qf)
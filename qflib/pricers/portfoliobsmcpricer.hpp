@@ -0,0 +1,166 @@
+/**
+@file  portfoliobsmcpricer.hpp
+@brief Monte Carlo pricer of a portfolio of products on shared paths in the Black Scholes model
+*/
+
+#ifndef QF_PORTFOLIOBSMCPRICER_HPP
+#define QF_PORTFOLIOBSMCPRICER_HPP
+
+#include <qflib/products/product.hpp>
+#include <qflib/market/yieldcurve.hpp>
+#include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <qflib/methods/montecarlo/pathblockrunner.hpp>
+#include <qflib/methods/montecarlo/variancereducer.hpp>
+#include <qflib/methods/montecarlo/mcruninfo.hpp>
+#include <qflib/math/stats/statisticscalculator.hpp>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** Monte Carlo pricer of a portfolio of products in the multiasset Black-Scholes model
+    (deterministic rates and vols).
+    The paths are simulated once, on the union of the fixing times of all products,
+    and every product is evaluated on every path, so the random number and path construction
+    costs do not grow with the number of products.
+    A product on fewer assets than the model depends on the first assets.
+    Antithetic paths are supported, control variates and Greeks are not.
+*/
+class PortfolioBsMcPricer
+{
+public:
+  /** Initializing ctor */
+  PortfolioBsMcPricer(std::vector<SPtrProduct> const& prods,
+                      SPtrYieldCurve discountYieldCurve,
+                      Vector const& divYields,
+                      Vector const& volatilities,
+                      Vector const& spots,
+                      Matrix const& correlMatrix,
+                      McParams const& mcparams);
+
+  /** Returns the number of variables that can be tracked for stats, the PV of each product */
+  size_t nVariables();
+
+  /** Returns the simulation times, the union of the fixing times of the products */
+  Vector const& simTimes() const;
+
+  /** With McParams::nCorrFactors, the fraction of the variance of the asset returns explained
+      by the systematic factors of the correlation factor model, otherwise 1
+  */
+  double explainedVariance() const;
+
+  /** Runs the simulation and collects statistics, one variable per product.
+      The paths are split over McParams::nThreads threads; the results do not depend on the thread count.
+      With antithetic pairs, npaths is rounded up to an even number and each sample is the average of a pair.
+      With the McParams tolerances or time budget set, npaths is the maximum number of paths
+      and the simulation stops as soon as the time is up or every product meets a tolerance.
+      Returns the number of paths used, the time spent and the largest standard error.
+  */
+  template<typename ITER>
+  McRunInfo simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths);
+
+protected:
+
+  /** The state owned by one simulation thread */
+  struct Worker
+  {
+    SPtrPathGenerator pathgen;       // this thread's path generator
+    std::vector<SPtrProduct> prods;  // this thread's copies of the products
+    Matrix pathBatch;                // scratch block of paths, paths innermost
+    std::vector<Matrix> pricePaths;  // scratch price path of each product fixing on scattered simulation times
+  };
+
+  /** Creates the state of one simulation thread */
+  Worker makeWorker() const;
+
+  /** Creates and processes a block of npaths price paths.
+      It writes the PV of product m on path p into values[p * nproducts + m].
+  */
+  void processBlock(Worker& worker, size_t npaths, double* values) const;
+
+private:
+  std::vector<SPtrProduct> prods_;  // pointers to the products
+  SPtrYieldCurve discyc_;           // pointer to the discount curve
+  Vector divylds_;                  // the constant dividend yield, one per asset
+  Vector vols_;                     // the constant volatility, one per asset
+  Vector spots_;                    // the initial spots, one per asset
+  McParams mcparams_;               // the Monte Carlo parameters
+
+  SPtrPathGenerator pathgen_;       // pointer to the path generator
+  Vector simtimes_;                 // the simulation times
+  std::vector<std::vector<size_t>> fixindices_;  // index of each product fixing time in simtimes_
+  std::vector<bool> contiguous_;    // whether a product fixes on consecutive simulation times, so its path is a view
+  std::vector<Vector> discfactors_; // caches the pre-computed discount factors, per product
+  Matrix drifts_;                   // caches the pre-computed asset drifts, one column per asset
+  Matrix stdevs_;                   // caches the pre-computed standard deviations, one column per asset
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+size_t PortfolioBsMcPricer::nVariables()
+{
+  return prods_.size();
+}
+
+inline
+Vector const& PortfolioBsMcPricer::simTimes() const
+{
+  return simtimes_;
+}
+
+inline
+double PortfolioBsMcPricer::explainedVariance() const
+{
+  return pathgen_->explainedVariance();
+}
+
+template<typename ITER>
+McRunInfo PortfolioBsMcPricer::simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths)
+{
+  // check the size of the statistics calculator
+  QF_ASSERT(statsCalc.nVariables() == nVariables(), "the statistics calculator must track as many variables as the pricer captures!");
+
+  size_t nprods = nVariables();
+  VarianceReducer reducer(mcparams_.antithetic(), false, 0.0, nprods);
+  if (mcparams_.antithetic() && npaths % 2 != 0)
+    ++npaths;
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [start]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  auto maxStdErr = [&]() {
+    double se = 0.0;
+    for (size_t m = 0; m < nprods; ++m)
+      se = std::max(se, reducer.stdErr(m));
+    return se;
+  };
+  bool converged = false;
+  unsigned long nallocs = 0;
+
+  unsigned long nused = runPathBlocks(npaths, reducer.nValues(), mcparams_,
+    [this]() { return makeWorker(); },
+    [this](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double* values) {
+      worker.pathgen->seed(mcparams_.seed, firstPath);
+      processBlock(worker, nBlockPaths, values);
+    },
+    [&](double* values, size_t nBlockPaths) {
+      reducer.feed(values, nBlockPaths, statsCalc);
+      converged = reducer.nSamples() > 1;
+      for (size_t m = 0; m < nprods && converged; ++m)
+        converged = mcparams_.toleranceMet(reducer.mean(m), reducer.stdErr(m));
+      bool outoftime = mcparams_.maxSeconds > 0.0 && elapsed() >= mcparams_.maxSeconds;
+      return !converged && !outoftime;
+    },
+    &nallocs);
+
+  return McRunInfo{ nused, elapsed(), maxStdErr(), converged, nallocs };
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_PORTFOLIOBSMCPRICER_HPP
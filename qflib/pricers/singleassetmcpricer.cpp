@@ -0,0 +1,136 @@
+/**
+@file  singleassetmcpricer.cpp
+@brief Implementation of the SingleAssetMcPricer class
+*/
+
+#include <qflib/pricers/singleassetmcpricer.hpp>
+#include <qflib/methods/montecarlo/eulerpathgenerator.hpp>
+#include <qflib/methods/montecarlo/sobolpathgenerator.hpp>
+#include <qflib/methods/montecarlo/antitheticpathgenerator.hpp>
+#include <cmath>
+
+using namespace std;
+
+BEGIN_NAMESPACE(qf)
+
+SingleAssetMcPricer::SingleAssetMcPricer(SPtrProduct prod,
+                                         SPtrYieldCurve discountCurve,
+                                         double divYield,
+                                         double spot,
+                                         McParams const& mcparams,
+                                         size_t nsteps,
+                                         size_t nfactors,
+                                         string const& modelName)
+: prod_(prod), discyc_(discountCurve), divyld_(divYield), spot_(spot), mcparams_(mcparams)
+{
+  QF_ASSERT(prod->nAssets() == 1, "the " + modelName + " pricer needs a product on a single asset!");
+  QF_ASSERT(!mcparams.greeks, "the " + modelName + " pricer does not compute Greeks!");
+  QF_ASSERT(mcparams.precision == McParams::Precision::DOUBLE,
+    "the " + modelName + " pricer does not support FLOAT precision!");
+  Vector const& fixtimes = prod->fixTimes();
+  QF_ASSERT(fixtimes[0] > 0.0, "the " + modelName + " pricer needs fixing times after t = 0!");
+
+  // Get the simulation times: the fixing times, refined to at least nsteps steps; drop t = 0
+  vector<double> timesteps;
+  vector<ptrdiff_t> stepindex;
+  prod->timeSteps(nsteps, timesteps, stepindex);
+  simTimes_.resize(timesteps.size() - 1);
+  for (size_t i = 1; i < timesteps.size(); ++i) {
+    simTimes_[i - 1] = timesteps[i];
+    if (stepindex[i] >= 0)
+      fixSteps_.push_back(i - 1);
+  }
+  size_t nsimsteps = simTimes_.size();
+
+  // Create the generator of the deviates, nfactors per step
+  Matrix correlMat;
+  if (mcparams.pathGenType == McParams::PathGenType::EULER) {
+    if (mcparams.urngType == McParams::UrngType::MINSTDRAND)
+      devgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMinStdRand>(
+          simTimes_.begin(), simTimes_.end(), nfactors, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::MT19937)
+      devgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngMt19937>(
+          simTimes_.begin(), simTimes_.end(), nfactors, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX3)
+      devgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux3>(
+          simTimes_.begin(), simTimes_.end(), nfactors, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::RANLUX4)
+      devgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngRanLux4>(
+          simTimes_.begin(), simTimes_.end(), nfactors, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::PHILOX4X32)
+      devgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngPhilox4x32>(
+          simTimes_.begin(), simTimes_.end(), nfactors, correlMat, mcparams.normalGenType));
+    else if (mcparams.urngType == McParams::UrngType::THREEFRY4X32)
+      devgen_ = SPtrPathGenerator(new EulerPathGenerator<NormalRngThreefry4x32>(
+          simTimes_.begin(), simTimes_.end(), nfactors, correlMat, mcparams.normalGenType));
+    else
+      QF_ASSERT(0, "unknown urng type!");
+  }
+  else if (mcparams.pathGenType == McParams::PathGenType::SOBOL)
+    devgen_ = SPtrPathGenerator(new SobolPathGenerator(
+        simTimes_.begin(), simTimes_.end(), nfactors, correlMat, mcparams.scrambleType));
+  else
+    QF_ASSERT(0, "unknown path generator type!");
+
+  if (mcparams.antithetic()) {
+    QF_ASSERT(mcparams.blockSize % 2 == 0, "the block size must be even with antithetic paths!");
+    devgen_ = SPtrPathGenerator(new AntitheticPathGenerator(devgen_));
+  }
+
+  // Pre-compute the log drifts of the simulation steps
+  logDrifts_.resize(nsimsteps);
+  double t1 = 0.0;
+  for (size_t i = 0; i < nsimsteps; ++i) {
+    double t2 = simTimes_[i];
+    logDrifts_[i] = (discyc_->fwdRate(t1, t2) - divyld_) * (t2 - t1);
+    t1 = t2;
+  }
+
+  // Pre-compute the discount factors
+  Vector const& paytimes = prod->payTimes();
+  discfactors_.resize(paytimes.size());
+  for (size_t i = 0; i < paytimes.size(); ++i)
+    discfactors_[i] = discyc_->discount(paytimes[i]);
+
+  // the control variate is the discounted final spot, a martingale
+  double T = fixtimes[fixtimes.size() - 1];
+  cvDiscount_ = discyc_->discount(T);
+  cvMean_ = mcparams.controlVariate() ? spot_ * exp(-divyld_ * T) : 0.0;
+}
+
+SingleAssetMcPricer::Worker SingleAssetMcPricer::makeWorker() const
+{
+  Worker worker;
+  worker.pathgen = pathgen_->clone();
+  worker.prod = prod_->clone();
+  worker.pathBatch.set_size(mcparams_.blockSize, pathgen_->nTimeSteps());
+  return worker;
+}
+
+void SingleAssetMcPricer::processBlock(Worker& worker, size_t npaths, double* values) const
+{
+  bool cv = mcparams_.controlVariate();
+  size_t nvalues = cv ? 2 : 1;
+  size_t nfixings = pathgen_->nTimeSteps();
+
+  Matrix& pathBatch = worker.pathBatch;
+  worker.pathgen->nextBatch(npaths, pathBatch);
+
+  // evaluate the product on each path, viewed in place in the block
+  Product& prod = *worker.prod;
+  Vector const& payamts = prod.payAmounts();
+  size_t stride = pathBatch.n_rows;
+  for (size_t p = 0; p < npaths; ++p) {
+    prod.eval(MatrixView(pathBatch.colptr(0) + p, nfixings, 1, stride, stride * nfixings));
+
+    double pv = 0.0;
+    for (size_t k = 0; k < payamts.size(); ++k)
+      pv += discfactors_[k] * payamts[k];
+    values[p * nvalues] = pv;
+
+    if (cv)
+      values[p * nvalues + 1] = cvDiscount_ * pathBatch(p, nfixings - 1);
+  }
+}
+
+END_NAMESPACE(qf)
@@ -0,0 +1,151 @@
+/**
+@file  singleassetmcpricer.hpp
+@brief Base class of the Monte Carlo pricers of single asset products on model path generators
+*/
+
+#ifndef QF_SINGLEASSETMCPRICER_HPP
+#define QF_SINGLEASSETMCPRICER_HPP
+
+#include <qflib/products/product.hpp>
+#include <qflib/market/yieldcurve.hpp>
+#include <qflib/methods/montecarlo/mcparams.hpp>
+#include <qflib/methods/montecarlo/pathgenerator.hpp>
+#include <qflib/methods/montecarlo/pathblockrunner.hpp>
+#include <qflib/methods/montecarlo/variancereducer.hpp>
+#include <qflib/methods/montecarlo/mcruninfo.hpp>
+#include <qflib/math/stats/statisticscalculator.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** The common part of the Monte Carlo pricers of single asset products whose paths come from a model path
+    generator wrapping the generator of the independent deviates, e.g. HestonMcPricer and LocalVolMcPricer.
+    The ctor sets up the simulation times, the log drifts of the steps, the generator of the deviates,
+    Euler or Sobol as McParams::pathGenType, antithetic with McParams::controlVarType, the discount factors
+    and the control variate, the discounted final spot; the derived class ctor then sets pathgen_,
+    the generator of the spots at the fixing times.
+    McParams::greeks and FLOAT precision are not supported; McParams::fusedKernels does not apply.
+*/
+class SingleAssetMcPricer
+{
+public:
+  /** Returns the number of variables that can be tracked for stats: the PV */
+  size_t nVariables();
+
+  /** Returns the number of simulation steps */
+  size_t nSimSteps() const;
+
+  /** Runs the simulation and collects statistics.
+      The paths are split over McParams::nThreads threads; the results do not depend on the thread count.
+      With antithetic pairs, npaths is rounded up to an even number and each sample is the average of a pair.
+      With a control variate, each sample is corrected by the discounted final spot, of expectation
+      the spot discounted at the dividend yield; see VarianceReducer.
+      With the McParams tolerances or time budget set, npaths is the maximum number of paths
+      and the simulation stops as soon as a criterion is met.
+      Returns the number of paths used, the time spent and the standard error.
+  */
+  template<typename ITER>
+  McRunInfo simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths);
+
+protected:
+  /** Ctor. The simulation takes at least nsteps equal steps up to the last fixing time,
+      and steps to every fixing time; with nsteps = 0, it steps from fixing time to fixing time.
+      The generator of the deviates draws nfactors factors per step; modelName names the pricer in the errors.
+  */
+  SingleAssetMcPricer(SPtrProduct prod,
+                      SPtrYieldCurve discountYieldCurve,
+                      double divYield,
+                      double spot,
+                      McParams const& mcparams,
+                      size_t nsteps,
+                      size_t nfactors,
+                      std::string const& modelName);
+
+  /** The state owned by one simulation thread */
+  struct Worker
+  {
+    SPtrPathGenerator pathgen;   // this thread's path generator
+    SPtrProduct prod;            // this thread's copy of the product
+    Matrix pathBatch;            // scratch block of paths, paths innermost
+  };
+
+  /** Creates the state of one simulation thread */
+  Worker makeWorker() const;
+
+  /** Creates and processes a block of npaths price paths.
+      It writes the PV of the product on each path into values[p * nvalues],
+      and with a control variate, the PV of the control into values[p * nvalues + 1].
+  */
+  void processBlock(Worker& worker, size_t npaths, double* values) const;
+
+  SPtrProduct prod_;           // pointer to the product
+  SPtrYieldCurve discyc_;      // pointer to the discount curve
+  double divyld_;              // the constant dividend yield
+  double spot_;                // the initial spot
+  McParams mcparams_;          // the Monte Carlo parameters
+
+  Vector simTimes_;            // the simulation times, after t = 0
+  std::vector<size_t> fixSteps_;  // the simulation step of each fixing time
+  Vector logDrifts_;           // (r - q) dt of each simulation step
+  SPtrPathGenerator devgen_;   // the generator of the independent deviates, for the model path generator
+  SPtrPathGenerator pathgen_;  // pointer to the path generator, set by the derived class
+  Vector discfactors_;         // caches the pre-computed discount factors
+
+  double cvDiscount_;          // control variate discount factor, to the last fixing time
+  double cvMean_;              // control variate expectation
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+size_t SingleAssetMcPricer::nVariables()
+{
+  return 1;
+}
+
+inline
+size_t SingleAssetMcPricer::nSimSteps() const
+{
+  return simTimes_.size();
+}
+
+template<typename ITER>
+McRunInfo SingleAssetMcPricer::simulate(StatisticsCalculator<ITER>& statsCalc, unsigned long npaths)
+{
+  QF_ASSERT(statsCalc.nVariables() == nVariables(), "the statistics calculator must track as many variables as the pricer captures!");
+  QF_ASSERT(pathgen_, "no path generator!");
+
+  VarianceReducer reducer(mcparams_.antithetic(), mcparams_.controlVariate(), cvMean_, nVariables());
+  if (mcparams_.antithetic() && npaths % 2 != 0)
+    ++npaths;
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [start]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  bool converged = false;
+  unsigned long nallocs = 0;
+
+  unsigned long nused = runPathBlocks(npaths, reducer.nValues(), mcparams_,
+    [this]() { return makeWorker(); },
+    [this](Worker& worker, unsigned long firstPath, size_t nBlockPaths, double* values) {
+      worker.pathgen->seed(mcparams_.seed, firstPath);
+      processBlock(worker, nBlockPaths, values);
+    },
+    [&](double* values, size_t nBlockPaths) {
+      reducer.feed(values, nBlockPaths, statsCalc);
+      converged = reducer.nSamples() > 1 && mcparams_.toleranceMet(reducer.mean(), reducer.stdErr());
+      bool outoftime = mcparams_.maxSeconds > 0.0 && elapsed() >= mcparams_.maxSeconds;
+      return !converged && !outoftime;
+    },
+    &nallocs);
+
+  return McRunInfo{ nused, elapsed(), reducer.stdErr(), converged, nallocs };
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_SINGLEASSETMCPRICER_HPP
@@ -0,0 +1,145 @@
+/**
+@file  americanbasketcallput.hpp
+@brief The payoff of an American (Bermudan) Call/Put option on a basket of assets
+*/
+
+#ifndef QF_AMERICANBASKETCALLPUT_HPP
+#define QF_AMERICANBASKETCALLPUT_HPP
+
+#include <qflib/products/product.hpp>
+#include <algorithm>
+#include <functional>
+
+BEGIN_NAMESPACE(qf)
+
+/** The American basket call/put class.
+    The holder may exercise at each of the exercise times, receiving the intrinsic value
+    of the basket then; the last exercise time is the expiration.
+    Daily exercise times approximate an American option.
+*/
+class AmericanBasketCallPut : public Product
+{
+public:
+  /** Initializing ctor */
+  AmericanBasketCallPut(int payoffType,
+                        double strike,
+                        Vector const& exerciseTimes,
+                        Vector const& assetQuantities);
+
+  /** The number of assets this product depends on */
+  virtual size_t nAssets() const override;
+
+  /** The payoff type, 1: call; -1: put */
+  int payoffType() const { return payoffType_; }
+
+  /** The strike */
+  double strike() const { return strike_; }
+
+  /** The number of units of each asset in the basket */
+  Vector const& assetQuantities() const { return assetQuantities_; }
+
+  /** Returns a copy of this product */
+  virtual SPtrProduct clone() const override;
+
+  /** Evaluates the product given the passed-in path, exercising at expiration only */
+  virtual void eval(MatrixView const& pricePath) override;
+
+  /** Evaluates the product at exercise time index idx, given the continuation value */
+  virtual void eval(size_t idx, Vector const& spots, double contValue) override;
+
+  /** The option can be exercised at each exercise time */
+  virtual bool hasEarlyExercise() const override { return true; }
+
+  /** The intrinsic value of the basket at exercise time index idx */
+  virtual double exerciseValue(MatrixView const& pricePath, size_t idx) const override;
+
+private:
+  // The intrinsic value of basket value bsktval
+  double intrinsic(double bsktval) const;
+
+  int payoffType_;          // 1: call; -1 put
+  double strike_;
+  Vector assetQuantities_;  // number of units of each asset in the basket
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+AmericanBasketCallPut::AmericanBasketCallPut(int payoffType,
+                                             double strike,
+                                             Vector const& exerciseTimes,
+                                             Vector const& assetQuantities)
+: payoffType_(payoffType), strike_(strike), assetQuantities_(assetQuantities)
+{
+  QF_ASSERT(payoffType == 1 || payoffType == -1, "AmericanBasketCallPut: the payoff type must be 1 (call) or -1 (put)!");
+  QF_ASSERT(strike >= 0.0, "AmericanBasketCallPut: the strike must be positive!");
+  QF_ASSERT(exerciseTimes.size() > 0, "AmericanBasketCallPut: no exercise times!");
+  QF_ASSERT(exerciseTimes[0] >= 0.0,
+    "AmericanBasketCallPut: the first exercise time must be non-negative!");
+  Vector::const_iterator it(
+    std::adjacent_find(exerciseTimes.begin(), exerciseTimes.end(), std::greater_equal<double>()));
+  QF_ASSERT(it == exerciseTimes.end(),
+    "AmericanBasketCallPut: the exercise times must be in strict increasing order");
+
+  // the fixing times are the exercise times, and the payment is made on exercise
+  fixTimes_ = exerciseTimes;
+  payTimes_ = exerciseTimes;
+  payAmounts_.resize(payTimes_.size());
+}
+
+inline
+size_t AmericanBasketCallPut::nAssets() const
+{
+  return assetQuantities_.size();
+}
+
+inline SPtrProduct AmericanBasketCallPut::clone() const
+{
+  return SPtrProduct(new AmericanBasketCallPut(*this));
+}
+
+inline double AmericanBasketCallPut::intrinsic(double bsktval) const
+{
+  double payoff = (bsktval - strike_) * payoffType_;
+  return payoff > 0.0 ? payoff : 0.0;
+}
+
+inline double AmericanBasketCallPut::exerciseValue(MatrixView const& pricePath, size_t idx) const
+{
+  double bsktval = 0.0;
+  for (size_t j = 0; j < assetQuantities_.size(); ++j)
+    bsktval += assetQuantities_[j] * pricePath(idx, j);
+  return intrinsic(bsktval);
+}
+
+inline void AmericanBasketCallPut::eval(MatrixView const& pricePath)
+{
+  size_t last = payAmounts_.size() - 1;
+  QF_ASSERT(pricePath.n_rows == fixTimes_.size(),
+    "AmericanBasketCallPut: number of fixings mismatch in price path!");
+  for (size_t i = 0; i < last; ++i)
+    payAmounts_[i] = 0.0;
+  payAmounts_[last] = exerciseValue(pricePath, last);
+}
+
+inline void AmericanBasketCallPut::eval(size_t idx, Vector const& spots, double contValue)
+{
+  double bsktval = 0.0;
+  for (size_t j = 0; j < assetQuantities_.size(); ++j)
+    bsktval += assetQuantities_[j] * spots[j];
+  double intrinsicValue = intrinsic(bsktval);
+
+  if (idx == payAmounts_.size() - 1)  // this is the last index
+    payAmounts_[idx] = intrinsicValue;
+  else {  // this is not the last index, check the exercise condition
+    payAmounts_[idx] = contValue >= intrinsicValue ? contValue : intrinsicValue;
+    // zero out the amounts after this index
+    for (size_t j = idx + 1; j < payAmounts_.size(); ++j)
+      payAmounts_[j] = 0.0;
+  }
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_AMERICANBASKETCALLPUT_HPP
@@ -18,9 +18,18 @@ public:
   /** Initializing ctor */
   AmericanCallPut(int payoffType, double strike, double timeToExp);
 
+  /** Returns a copy of this product */
+  virtual SPtrProduct clone() const override;
+
   /** Evaluates the product at fixing time index idx
   */
   virtual void eval(size_t idx, Vector const& pricePath, double contValue);
+
+  /** The option can be exercised on each fixing day */
+  virtual bool hasEarlyExercise() const override { return true; }
+
+  /** The intrinsic value at fixing time index idx */
+  virtual double exerciseValue(MatrixView const& pricePath, size_t idx) const override;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -44,6 +53,11 @@ AmericanCallPut::AmericanCallPut(int payoffType, double strike, double timeToExp
   payAmounts_.resize(payTimes_.size());
 }
 
+inline SPtrProduct AmericanCallPut::clone() const
+{
+  return SPtrProduct(new AmericanCallPut(*this));
+}
+
 // This product has as many fixings as days between 0 and time to expiration.
 inline void AmericanCallPut::eval(size_t idx, Vector const& spots, double contValue)
 {
@@ -63,6 +77,12 @@ inline void AmericanCallPut::eval(size_t idx, Vector const& spots, double contVa
   }
 }
 
+inline double AmericanCallPut::exerciseValue(MatrixView const& pricePath, size_t idx) const
+{
+  double intrinsicValue = (pricePath(idx, 0) - strike_) * payoffType_;
+  return intrinsicValue > 0.0 ? intrinsicValue : 0.0;
+}
+
 END_NAMESPACE(qf)
 
 #endif // QF_AMERICANCALLPUT_HPP
@@ -26,20 +26,54 @@ public:
   /** The number of assets this product depends on */
   virtual size_t nAssets() const override;
 
+  /** The payoff type, 1: call; -1: put */
+  int payoffType() const { return payoffType_; }
+
+  /** The strike */
+  double strike() const { return strike_; }
+
+  /** The number of units of each asset in the basket */
+  Vector const& assetQuantities() const { return assetQuantities_; }
+
+  /** Returns a copy of this product */
+  virtual SPtrProduct clone() const override;
+
   /** Evaluates the product given the passed-in path
       The "pricePath" matrix must have as many rows as
       the number of fixing times
       */
-  virtual void eval(Matrix const& pricePath) override;
+  virtual void eval(MatrixView const& pricePath) override;
 
   /** Evaluates the product at fixing time index idx
   */
   virtual void eval(size_t idx, Vector const& spots, double contValue) override;
 
+  /** The basket values are summed on the fly, so it evaluates incrementally */
+  virtual bool isIncremental() const override { return true; }
+
+  /** Resets the running sum of the basket values */
+  virtual void begin() override;
+
+  /** Adds the basket value at fixing time index idx to the running sum */
+  virtual void onFixing(size_t idx, double const* spots) override;
+
+  /** Sets the payment amount from the average of the basket values */
+  virtual void finish() override;
+
+  /** The payoff is Lipschitz continuous in the path */
+  virtual bool hasPathDerivs() const override { return true; }
+
+  /** Evaluates the product and the derivatives of the weighted payment with respect to each fixing of each asset */
+  virtual void evalPathDerivs(MatrixView const& pricePath, Vector const& weights, Matrix& pathDerivs) override;
+
 private:
+  // sets the payment amount given the average basket value
+  void setPayAmount(double bsktAvg);
+
   int payoffType_;          // 1: call; -1 put
   double strike_;
   Vector assetQuantities_;  // number of units of each asset in the basket
+  double bsktSum_;          // incremental evaluation: the sum of the basket values so far
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -50,7 +84,7 @@ AsianBasketCallPut::AsianBasketCallPut(int payoffType,
                                        double strike,
                                        Vector const& fixingTimes,
                                        Vector const& assetQuantities)
-: payoffType_(payoffType), strike_(strike), assetQuantities_(assetQuantities)
+: payoffType_(payoffType), strike_(strike), assetQuantities_(assetQuantities), bsktSum_(0.0)
 {
   QF_ASSERT(payoffType == 1 || payoffType == -1, "AsianBasketCallPut: the payoff type must be 1 (call) or -1 (put)!");
   QF_ASSERT(strike >= 0.0, "AsianBasketCallPut: the strike must be positive!");
@@ -78,7 +112,12 @@ size_t AsianBasketCallPut::nAssets() const
   return assetQuantities_.size();
 }
 
-inline void AsianBasketCallPut::eval(Matrix const& pricePath)
+inline SPtrProduct AsianBasketCallPut::clone() const
+{
+  return SPtrProduct(new AsianBasketCallPut(*this));
+}
+
+inline void AsianBasketCallPut::eval(MatrixView const& pricePath)
 {
   double bsktAvg = 0;
   size_t nfixings = pricePath.n_rows;
@@ -95,14 +134,49 @@ inline void AsianBasketCallPut::eval(Matrix const& pricePath)
     }
     bsktAvg += bsktval;
   }
-  bsktAvg /= nfixings;
+  setPayAmount(bsktAvg / nfixings);
+}
 
+inline void AsianBasketCallPut::begin()
+{
+  bsktSum_ = 0.0;
+}
+
+inline void AsianBasketCallPut::onFixing(size_t idx, double const* spots)
+{
+  double bsktval = 0.0;
+  for (size_t j = 0; j < assetQuantities_.size(); ++j)
+    bsktval += assetQuantities_[j] * spots[j];
+  bsktSum_ += bsktval;
+}
+
+inline void AsianBasketCallPut::finish()
+{
+  setPayAmount(bsktSum_ / fixTimes_.size());
+}
+
+inline void AsianBasketCallPut::setPayAmount(double bsktAvg)
+{
   if (payoffType_ == 1)
     payAmounts_[0] = bsktAvg >= strike_ ? bsktAvg - strike_ : 0.0;
   else
     payAmounts_[0] = bsktAvg >= strike_ ? 0.0 : strike_ - bsktAvg;
 }
 
+inline void AsianBasketCallPut::evalPathDerivs(MatrixView const& pricePath, Vector const& weights, Matrix& pathDerivs)
+{
+  eval(pricePath);
+  size_t nfixings = pricePath.n_rows;
+  size_t nassets = pricePath.n_cols;
+  pathDerivs.set_size(nfixings, nassets);
+
+  // the payoff moves with the basket average when it is in the money
+  double dpayoff = payAmounts_[0] > 0.0 ? payoffType_ * weights[0] / nfixings : 0.0;
+  for (size_t j = 0; j < nassets; ++j)
+    for (size_t i = 0; i < nfixings; ++i)
+      pathDerivs(i, j) = dpayoff * assetQuantities_[j];
+}
+
 // Not implemented
 inline void AsianBasketCallPut::eval(size_t idx, Vector const& spots, double contValue)
 {
@@ -0,0 +1,166 @@
+/**
+@file  autocallable.hpp
+@brief The payoff of a worst-of autocallable note
+*/
+
+#ifndef QF_AUTOCALLABLE_HPP
+#define QF_AUTOCALLABLE_HPP
+
+#include <qflib/products/product.hpp>
+#include <algorithm>
+#include <functional>
+
+BEGIN_NAMESPACE(qf)
+
+/** The worst-of autocallable note class.
+    At each fixing time t_i, the performance of the note is the worst of the assets' spots over their
+    reference spots. If it is at or above the call level, the note redeems early and pays at t_i the notional
+    plus a coupon for each period elapsed, notional * (1 + (i + 1) * coupon). If it is never called,
+    at the last fixing time it pays the notional if the performance is at or above the protection level,
+    and the notional times the performance otherwise. The path is settled once the note is called.
+*/
+class Autocallable : public Product
+{
+public:
+  /** Initializing ctor */
+  Autocallable(Vector const& fixingTimes,
+               Vector const& refSpots,
+               double callLevel,
+               double coupon,
+               double protectionLevel,
+               double notional = 1.0);
+
+  /** The number of assets this product depends on */
+  virtual size_t nAssets() const override { return refSpots_.size(); }
+
+  /** The reference spots of the assets */
+  Vector const& refSpots() const { return refSpots_; }
+
+  /** Returns a copy of this product */
+  virtual SPtrProduct clone() const override;
+
+  /** Evaluates the product given the passed-in path
+      The "pricePath" matrix must have as many rows as
+      the number of fixing times
+  */
+  virtual void eval(MatrixView const& pricePath) override;
+
+  /** Evaluates the product at fixing time index idx
+  */
+  virtual void eval(size_t idx, Vector const& spots, double contValue) override;
+
+  /** The state of a path is whether it has been called, so it evaluates incrementally */
+  virtual bool isIncremental() const override { return true; }
+
+  /** Resets the payment amounts and the call state */
+  virtual void begin() override;
+
+  /** Checks the call level at fixing time index idx, and at the last fixing sets the redemption amount */
+  virtual void onFixing(size_t idx, double const* spots) override;
+
+  /** The payment amounts are set by onFixing() */
+  virtual void finish() override {}
+
+  /** The note may be called before its last fixing */
+  virtual bool canSettle() const override { return true; }
+
+  /** Whether the note has been called */
+  virtual bool isSettled() const override { return called_; }
+
+private:
+  Vector refSpots_;          // the reference spot of each asset
+  double callLevel_;         // the performance at or above which the note is called
+  double coupon_;            // the coupon per period elapsed, paid on call
+  double protectionLevel_;   // the performance at or above which the notional is repaid at the last fixing
+  double notional_;
+  bool called_;              // incremental evaluation: whether the note has been called
+  Vector fixingSpots_;       // scratch, the spots of a fixing in eval()
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+Autocallable::Autocallable(Vector const& fixingTimes,
+                           Vector const& refSpots,
+                           double callLevel,
+                           double coupon,
+                           double protectionLevel,
+                           double notional)
+: refSpots_(refSpots), callLevel_(callLevel), coupon_(coupon), protectionLevel_(protectionLevel),
+  notional_(notional), called_(false), fixingSpots_(refSpots.size())
+{
+  QF_ASSERT(refSpots.size() > 0, "Autocallable: no reference spots!");
+  for (size_t j = 0; j < refSpots.size(); ++j)
+    QF_ASSERT(refSpots[j] > 0.0, "Autocallable: the reference spots must be positive!");
+  QF_ASSERT(callLevel > 0.0, "Autocallable: the call level must be positive!");
+  QF_ASSERT(protectionLevel >= 0.0, "Autocallable: the protection level must be non-negative!");
+  QF_ASSERT(notional > 0.0, "Autocallable: the notional must be positive!");
+  QF_ASSERT(fixingTimes.size() > 0 && fixingTimes[0] > 0.0,
+    "Autocallable: the fixing times must be positive!");
+  Vector::const_iterator it(
+    std::adjacent_find(fixingTimes.begin(), fixingTimes.end(), std::greater_equal<double>()));
+  QF_ASSERT(it == fixingTimes.end(),
+    "Autocallable: the fixing times must be in strict increasing order");
+
+  // set the fixing times; each one may be a payment time
+  fixTimes_ = fixingTimes;
+  payTimes_ = fixingTimes;
+  payAmounts_.zeros(fixingTimes.size());
+}
+
+inline SPtrProduct Autocallable::clone() const
+{
+  return SPtrProduct(new Autocallable(*this));
+}
+
+inline void Autocallable::eval(MatrixView const& pricePath)
+{
+  size_t nfixings = pricePath.n_rows;
+  QF_ASSERT(fixTimes_.size() == nfixings,
+    "Autocallable: number of fixings mismatch in price path!");
+  size_t nassets = pricePath.n_cols;
+  QF_ASSERT(refSpots_.size() == nassets,
+    "Autocallable: number of assets mismatch in price path!");
+
+  begin();
+  for (size_t i = 0; i < nfixings && !called_; ++i) {
+    for (size_t j = 0; j < nassets; ++j)
+      fixingSpots_[j] = pricePath(i, j);
+    onFixing(i, fixingSpots_.memptr());
+  }
+  finish();
+}
+
+inline void Autocallable::begin()
+{
+  payAmounts_.zeros();
+  called_ = false;
+}
+
+inline void Autocallable::onFixing(size_t idx, double const* spots)
+{
+  // once called, the note has paid; the fixings streamed after it change nothing
+  if (called_)
+    return;
+  double perf = spots[0] / refSpots_[0];
+  for (size_t j = 1; j < refSpots_.size(); ++j)
+    perf = std::min(perf, spots[j] / refSpots_[j]);
+
+  if (perf >= callLevel_) {
+    payAmounts_[idx] = notional_ * (1.0 + (idx + 1) * coupon_);
+    called_ = true;
+  }
+  else if (idx + 1 == fixTimes_.size())
+    payAmounts_[idx] = perf >= protectionLevel_ ? notional_ : notional_ * perf;
+}
+
+// Not implemented
+inline void Autocallable::eval(size_t idx, Vector const& spots, double contValue)
+{
+  QF_ASSERT(0, "not implemented!");
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_AUTOCALLABLE_HPP
@@ -0,0 +1,176 @@
+/**
+@file  barriercallput.hpp
+@brief The payoff of a discretely monitored knock-out Call/Put option
+*/
+
+#ifndef QF_BARRIERCALLPUT_HPP
+#define QF_BARRIERCALLPUT_HPP
+
+#include <qflib/products/product.hpp>
+#include <algorithm>
+#include <functional>
+
+BEGIN_NAMESPACE(qf)
+
+/** The knock-out call/put class.
+    The barrier is monitored at the fixing times, the last of which is the expiration. If the spot is at or
+    beyond the barrier at a fixing, the option knocks out and pays the rebate at expiration; otherwise it
+    pays the call/put payoff at expiration. The payoff is decided at the knock-out, so the path is settled.
+*/
+class BarrierCallPut : public Product
+{
+public:
+  /** Initializing ctor; barrierType 1: up-and-out, -1: down-and-out */
+  BarrierCallPut(int payoffType,
+                 double strike,
+                 double barrier,
+                 int barrierType,
+                 Vector const& fixingTimes,
+                 double rebate = 0.0);
+
+  /** The number of assets this product depends on */
+  virtual size_t nAssets() const override { return 1; }
+
+  /** The payoff type, 1: call; -1: put */
+  int payoffType() const { return payoffType_; }
+
+  /** The strike */
+  double strike() const { return strike_; }
+
+  /** The barrier */
+  double barrier() const { return barrier_; }
+
+  /** The barrier type, 1: up-and-out; -1: down-and-out */
+  int barrierType() const { return barrierType_; }
+
+  /** Returns a copy of this product */
+  virtual SPtrProduct clone() const override;
+
+  /** Evaluates the product given the passed-in path
+      The "pricePath" matrix must have as many rows as
+      the number of fixing times
+  */
+  virtual void eval(MatrixView const& pricePath) override;
+
+  /** Evaluates the product at fixing time index idx
+  */
+  virtual void eval(size_t idx, Vector const& spots, double contValue) override;
+
+  /** The state of a path is whether it has knocked out, so it evaluates incrementally */
+  virtual bool isIncremental() const override { return true; }
+
+  /** Resets the knock-out state */
+  virtual void begin() override;
+
+  /** Checks the barrier at fixing time index idx, and at expiration sets the payoff */
+  virtual void onFixing(size_t idx, double const* spots) override;
+
+  /** Sets the rebate if the path has knocked out */
+  virtual void finish() override;
+
+  /** The option may knock out before expiration */
+  virtual bool canSettle() const override { return true; }
+
+  /** Whether the path has knocked out */
+  virtual bool isSettled() const override { return knockedOut_; }
+
+private:
+  // whether the spot is at or beyond the barrier
+  bool isOut(double spot) const { return barrierType_ * (spot - barrier_) >= 0.0; }
+
+  int payoffType_;     // 1: call; -1 put
+  double strike_;
+  double barrier_;
+  int barrierType_;    // 1: up-and-out; -1: down-and-out
+  double rebate_;      // paid at expiration on knock-out
+  bool knockedOut_;    // incremental evaluation: whether the path has knocked out
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+inline
+BarrierCallPut::BarrierCallPut(int payoffType,
+                               double strike,
+                               double barrier,
+                               int barrierType,
+                               Vector const& fixingTimes,
+                               double rebate)
+: payoffType_(payoffType), strike_(strike), barrier_(barrier), barrierType_(barrierType),
+  rebate_(rebate), knockedOut_(false)
+{
+  QF_ASSERT(payoffType == 1 || payoffType == -1, "BarrierCallPut: the payoff type must be 1 (call) or -1 (put)!");
+  QF_ASSERT(barrierType == 1 || barrierType == -1,
+    "BarrierCallPut: the barrier type must be 1 (up-and-out) or -1 (down-and-out)!");
+  QF_ASSERT(strike > 0.0, "BarrierCallPut: the strike must be positive!");
+  QF_ASSERT(barrier > 0.0, "BarrierCallPut: the barrier must be positive!");
+  QF_ASSERT(rebate >= 0.0, "BarrierCallPut: the rebate must be non-negative!");
+  QF_ASSERT(fixingTimes.size() > 0 && fixingTimes[0] > 0.0,
+    "BarrierCallPut: the fixing times must be positive!");
+  Vector::const_iterator it(
+    std::adjacent_find(fixingTimes.begin(), fixingTimes.end(), std::greater_equal<double>()));
+  QF_ASSERT(it == fixingTimes.end(),
+    "BarrierCallPut: the fixing times must be in strict increasing order");
+
+  // set the fixing times
+  fixTimes_ = fixingTimes;
+  // it settles (pays) at expiration
+  payTimes_.resize(1);
+  payTimes_[0] = fixingTimes[fixingTimes.size() - 1];
+
+  // this product generates only one payment
+  payAmounts_.resize(1);
+}
+
+inline SPtrProduct BarrierCallPut::clone() const
+{
+  return SPtrProduct(new BarrierCallPut(*this));
+}
+
+inline void BarrierCallPut::eval(MatrixView const& pricePath)
+{
+  size_t nfixings = pricePath.n_rows;
+  QF_ASSERT(fixTimes_.size() == nfixings,
+    "BarrierCallPut: number of fixings mismatch in price path!");
+
+  begin();
+  for (size_t i = 0; i < nfixings && !knockedOut_; ++i) {
+    double spot = pricePath(i, 0);
+    onFixing(i, &spot);
+  }
+  finish();
+}
+
+inline void BarrierCallPut::begin()
+{
+  knockedOut_ = false;
+}
+
+inline void BarrierCallPut::onFixing(size_t idx, double const* spots)
+{
+  double spot = spots[0];
+  if (isOut(spot)) {
+    knockedOut_ = true;
+    return;
+  }
+  if (idx + 1 == fixTimes_.size()) {
+    double payoff = payoffType_ * (spot - strike_);
+    payAmounts_[0] = payoff > 0.0 ? payoff : 0.0;
+  }
+}
+
+inline void BarrierCallPut::finish()
+{
+  if (knockedOut_)
+    payAmounts_[0] = rebate_;
+}
+
+// Not implemented
+inline void BarrierCallPut::eval(size_t idx, Vector const& spots, double contValue)
+{
+  QF_ASSERT(0, "not implemented!");
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_BARRIERCALLPUT_HPP
@@ -20,8 +20,29 @@ public:
   /** The number of assets this product depends on */
   virtual size_t nAssets() const override { return 1; }
 
+  /** The payoff type, 1: call; -1: put */
+  int payoffType() const { return payoffType_; }
+
+  /** The strike */
+  double strike() const { return strike_; }
+
+  /** Returns a copy of this product */
+  virtual SPtrProduct clone() const override;
+
   /** Evaluates the product given the passed-in path */
-  virtual void eval(Matrix const& pricePath) override;
+  virtual void eval(MatrixView const& pricePath) override;
+
+  /** The payoff only depends on the spot at expiration, so it evaluates incrementally */
+  virtual bool isIncremental() const override { return true; }
+
+  /** Nothing to reset */
+  virtual void begin() override {}
+
+  /** Sets the payment amount from the spot at expiration */
+  virtual void onFixing(size_t idx, double const* spots) override;
+
+  /** The payment amount is set by onFixing() */
+  virtual void finish() override {}
 
   /** Evaluates the product at fixing time index idx */
   virtual void eval(size_t idx, Vector const& spots, double contValue) override;
@@ -52,7 +73,12 @@ DigitalCallPut::DigitalCallPut(int payoffType, double strike, double timeToExp)
   payAmounts_.resize(1);
 }
 
-inline void DigitalCallPut::eval(Matrix const& pricePath)
+inline SPtrProduct DigitalCallPut::clone() const
+{
+  return SPtrProduct(new DigitalCallPut(*this));
+}
+
+inline void DigitalCallPut::eval(MatrixView const& pricePath)
 {
   double S_T = pricePath(0, 0);
   if (payoffType_ == 1)
@@ -61,6 +87,11 @@ inline void DigitalCallPut::eval(Matrix const& pricePath)
     payAmounts_[0] = S_T <= strike_ ? 1.0 : 0.0;
 }
 
+inline void DigitalCallPut::onFixing(size_t idx, double const* spots)
+{
+  eval(MatrixView(spots, 1, 1, 1, 1));
+}
+
 inline void DigitalCallPut::eval(size_t idx, Vector const& spots, double contValue)
 {
   QF_ASSERT(idx == 0, "DigitalCallPut: wrong fixing time index!");
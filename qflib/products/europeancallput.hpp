@@ -21,16 +21,43 @@ public:
   /** The number of assets this product depends on */
   virtual size_t nAssets() const override { return 1; }
 
+  /** The payoff type, 1: call; -1: put */
+  int payoffType() const { return payoffType_; }
+
+  /** The strike */
+  double strike() const { return strike_; }
+
+  /** Returns a copy of this product */
+  virtual SPtrProduct clone() const override;
+
   /** Evaluates the product given the passed-in path
       The "pricePath" matrix must have as many rows as
       the number of fixing times
   */
-  virtual void eval(Matrix const& pricePath) override;
+  virtual void eval(MatrixView const& pricePath) override;
+
+  /** The payoff only depends on the spot at expiration, so it evaluates incrementally */
+  virtual bool isIncremental() const override { return true; }
+
+  /** Nothing to reset */
+  virtual void begin() override {}
+
+  /** Sets the payment amount from the spot at expiration */
+  virtual void onFixing(size_t idx, double const* spots) override;
+
+  /** The payment amount is set by onFixing() */
+  virtual void finish() override {}
 
   /** Evaluates the product at fixing time index idx
   */
   virtual void eval(size_t idx, Vector const& spots, double contValue) override;
 
+  /** The payoff is Lipschitz continuous in the spot at expiration */
+  virtual bool hasPathDerivs() const override { return true; }
+
+  /** Evaluates the product and the derivative of the weighted payment with respect to the spot at expiration */
+  virtual void evalPathDerivs(MatrixView const& pricePath, Vector const& weights, Matrix& pathDerivs) override;
+
 protected:
   int payoffType_;     // 1: call; -1 put
   double strike_;
@@ -61,7 +88,12 @@ EuropeanCallPut::EuropeanCallPut(int payoffType, double strike, double timeToExp
   payAmounts_.resize(1);
 }
 
-inline void EuropeanCallPut::eval(Matrix const& pricePath)
+inline SPtrProduct EuropeanCallPut::clone() const
+{
+  return SPtrProduct(new EuropeanCallPut(*this));
+}
+
+inline void EuropeanCallPut::eval(MatrixView const& pricePath)
 {
   double S_T = pricePath(0, 0);
   if (payoffType_ == 1)
@@ -70,6 +102,24 @@ inline void EuropeanCallPut::eval(Matrix const& pricePath)
     payAmounts_[0] = S_T >= strike_ ? 0.0 : strike_ - S_T;
 }
 
+inline void EuropeanCallPut::onFixing(size_t idx, double const* spots)
+{
+  // as eval(), which reads the first fixing
+  if (idx == 0)
+    eval(MatrixView(spots, 1, 1, 1, 1));
+}
+
+inline void EuropeanCallPut::evalPathDerivs(MatrixView const& pricePath, Vector const& weights, Matrix& pathDerivs)
+{
+  eval(pricePath);
+  double S_T = pricePath(0, 0);
+  pathDerivs.set_size(1, 1);
+  if (payoffType_ == 1)
+    pathDerivs(0, 0) = S_T >= strike_ ? weights[0] : 0.0;
+  else
+    pathDerivs(0, 0) = S_T >= strike_ ? 0.0 : -weights[0];
+}
+
 // This product has only one fixing.
 inline void EuropeanCallPut::eval(size_t idx, Vector const& spots, double contValue)
 {
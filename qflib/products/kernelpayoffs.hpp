@@ -0,0 +1,217 @@
+/**
+@file  kernelpayoffs.hpp
+@brief The payoffs of common products, evaluated a block of paths at a time by the fused kernels
+*/
+
+#ifndef QF_KERNELPAYOFFS_HPP
+#define QF_KERNELPAYOFFS_HPP
+
+#include <qflib/products/europeancallput.hpp>
+#include <qflib/products/digitalcallput.hpp>
+#include <qflib/products/asianbasketcallput.hpp>
+#include <algorithm>
+#include <vector>
+
+BEGIN_NAMESPACE(qf)
+
+/** The payoff of a European call/put for McKernel.
+    The spots of a block are stored with the paths innermost, spots[j * npaths + p] for asset j of path p.
+    They are of type REAL, double or float, and so is the payoff of each path; only the discounted payoffs
+    are in double.
+    It pays max(phi (S_T - K), 0) at expiration, as EuropeanCallPut.
+*/
+template <typename REAL = double>
+class EuropeanKernelPayoff
+{
+public:
+  /** The type of the spots and of the payoffs */
+  using real_type = REAL;
+
+  /** Ctor from the product */
+  explicit EuropeanKernelPayoff(EuropeanCallPut const& prod);
+
+  /** Starts a block of npaths paths */
+  void begin(size_t npaths);
+
+  /** Fixes the spots of fixing i */
+  void fix(size_t i, size_t npaths, REAL const* spots);
+
+  /** Writes the discounted payoff of path p into pvs[p * stride] */
+  void payoffs(size_t npaths, double discount, double* pvs, size_t stride) const;
+
+private:
+  REAL phi_;                   // 1: call; -1: put
+  REAL strike_;
+  std::vector<REAL> values_;   // scratch, the payoff of each path of the block
+};
+
+/** The payoff of a European digital call/put for McKernel.
+    It pays 1 if phi (S_T - K) >= 0 at expiration, as DigitalCallPut.
+*/
+template <typename REAL = double>
+class DigitalKernelPayoff
+{
+public:
+  /** The type of the spots and of the payoffs */
+  using real_type = REAL;
+
+  /** Ctor from the product */
+  explicit DigitalKernelPayoff(DigitalCallPut const& prod);
+
+  /** Starts a block of npaths paths */
+  void begin(size_t npaths);
+
+  /** Fixes the spots of fixing i */
+  void fix(size_t i, size_t npaths, REAL const* spots);
+
+  /** Writes the discounted payoff of path p into pvs[p * stride] */
+  void payoffs(size_t npaths, double discount, double* pvs, size_t stride) const;
+
+private:
+  REAL phi_;                   // 1: call; -1: put
+  REAL strike_;
+  std::vector<REAL> values_;   // scratch, the payoff of each path of the block
+};
+
+/** The payoff of an Asian basket call/put for McKernel.
+    It sums the basket value over the fixings, and pays max(phi (average - K), 0) at the last fixing,
+    as AsianBasketCallPut. With float, the sums of the basket values are in float as well.
+*/
+template <typename REAL = double>
+class AsianBasketKernelPayoff
+{
+public:
+  /** The type of the spots and of the payoffs */
+  using real_type = REAL;
+
+  /** Ctor from the product */
+  explicit AsianBasketKernelPayoff(AsianBasketCallPut const& prod);
+
+  /** Starts a block of npaths paths */
+  void begin(size_t npaths);
+
+  /** Fixes the spots of fixing i */
+  void fix(size_t i, size_t npaths, REAL const* spots);
+
+  /** Writes the discounted payoff of path p into pvs[p * stride] */
+  void payoffs(size_t npaths, double discount, double* pvs, size_t stride) const;
+
+private:
+  REAL phi_;                   // 1: call; -1: put
+  REAL strike_;
+  std::vector<REAL> assetQuantities_;  // number of units of each asset in the basket
+  size_t nfixings_;
+  std::vector<REAL> sums_;     // scratch, the sum of the basket values of each path of the block
+  std::vector<REAL> basket_;   // scratch, the basket value of each path at the current fixing
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+
+template <typename REAL>
+inline
+EuropeanKernelPayoff<REAL>::EuropeanKernelPayoff(EuropeanCallPut const& prod)
+: phi_(REAL(prod.payoffType())), strike_(REAL(prod.strike()))
+{}
+
+template <typename REAL>
+inline void EuropeanKernelPayoff<REAL>::begin(size_t npaths)
+{
+  if (values_.size() < npaths)
+    values_.resize(npaths);
+}
+
+template <typename REAL>
+inline void EuropeanKernelPayoff<REAL>::fix(size_t i, size_t npaths, REAL const* spots)
+{
+  REAL* v = values_.data();
+  for (size_t p = 0; p < npaths; ++p) {
+    REAL x = phi_ * (spots[p] - strike_);
+    v[p] = x > REAL(0) ? x : REAL(0);
+  }
+}
+
+template <typename REAL>
+inline void EuropeanKernelPayoff<REAL>::payoffs(size_t npaths, double discount, double* pvs, size_t stride) const
+{
+  for (size_t p = 0; p < npaths; ++p)
+    pvs[p * stride] = discount * double(values_[p]);
+}
+
+template <typename REAL>
+inline
+DigitalKernelPayoff<REAL>::DigitalKernelPayoff(DigitalCallPut const& prod)
+: phi_(REAL(prod.payoffType())), strike_(REAL(prod.strike()))
+{}
+
+template <typename REAL>
+inline void DigitalKernelPayoff<REAL>::begin(size_t npaths)
+{
+  if (values_.size() < npaths)
+    values_.resize(npaths);
+}
+
+template <typename REAL>
+inline void DigitalKernelPayoff<REAL>::fix(size_t i, size_t npaths, REAL const* spots)
+{
+  REAL* v = values_.data();
+  for (size_t p = 0; p < npaths; ++p)
+    v[p] = phi_ * (spots[p] - strike_) >= REAL(0) ? REAL(1) : REAL(0);
+}
+
+template <typename REAL>
+inline void DigitalKernelPayoff<REAL>::payoffs(size_t npaths, double discount, double* pvs, size_t stride) const
+{
+  for (size_t p = 0; p < npaths; ++p)
+    pvs[p * stride] = discount * double(values_[p]);
+}
+
+template <typename REAL>
+inline
+AsianBasketKernelPayoff<REAL>::AsianBasketKernelPayoff(AsianBasketCallPut const& prod)
+: phi_(REAL(prod.payoffType())), strike_(REAL(prod.strike())),
+  assetQuantities_(prod.assetQuantities().begin(), prod.assetQuantities().end()),
+  nfixings_(prod.fixTimes().size())
+{}
+
+template <typename REAL>
+inline void AsianBasketKernelPayoff<REAL>::begin(size_t npaths)
+{
+  if (sums_.size() < npaths) {
+    sums_.resize(npaths);
+    basket_.resize(npaths);
+  }
+  std::fill(sums_.begin(), sums_.begin() + npaths, REAL(0));
+}
+
+template <typename REAL>
+inline void AsianBasketKernelPayoff<REAL>::fix(size_t i, size_t npaths, REAL const* spots)
+{
+  // the basket value, summed over the assets in the same order as AsianBasketCallPut
+  REAL* b = basket_.data();
+  REAL* s = sums_.data();
+  for (size_t p = 0; p < npaths; ++p)
+    b[p] = REAL(0);
+  for (size_t j = 0; j < assetQuantities_.size(); ++j) {
+    REAL q = assetQuantities_[j];
+    REAL const* sj = spots + j * npaths;
+    for (size_t p = 0; p < npaths; ++p)
+      b[p] += q * sj[p];
+  }
+  for (size_t p = 0; p < npaths; ++p)
+    s[p] += b[p];
+}
+
+template <typename REAL>
+inline void AsianBasketKernelPayoff<REAL>::payoffs(size_t npaths, double discount, double* pvs, size_t stride) const
+{
+  REAL n = REAL(nfixings_);
+  for (size_t p = 0; p < npaths; ++p) {
+    REAL x = phi_ * (sums_[p] / n - strike_);
+    pvs[p * stride] = discount * double(x > REAL(0) ? x : REAL(0));
+  }
+}
+
+END_NAMESPACE(qf)
+
+#endif // QF_KERNELPAYOFFS_HPP
@@ -10,6 +10,7 @@
 #include <qflib/exception.hpp>
 #include <qflib/sptr.hpp>
 #include <qflib/math/matrix.hpp>
+#include <qflib/math/matrixview.hpp>
 
 BEGIN_NAMESPACE(qf)
 
@@ -37,10 +38,16 @@ public:
   /** Returns the number of assets this product depends on */
   virtual size_t nAssets() const = 0;
 
+  /** Returns a copy of this product.
+      Monte Carlo worker threads evaluate their own copies, since eval() writes the payment amounts.
+  */
+  virtual std::shared_ptr<Product> clone() const = 0;
+
   /** Evaluates the product given the passed-in path
-      The "pricePath" matrix must have as many rows as the number of fixing times
+      The "pricePath" matrix must have as many rows as the number of fixing times.
+      It is a view, so the Monte Carlo pricers can pass a path in place inside a block of paths.
   */
-  virtual void eval(Matrix const& pricePath) = 0;
+  virtual void eval(MatrixView const& pricePath) = 0;
 
   /** Evaluates the product at fixing time index idx, for a vector of current spots,
       and a given continuation value.
@@ -48,6 +55,59 @@ public:
   */
   virtual void eval(size_t idx, Vector const& spots, double contValue) = 0;
 
+  /** Whether the payment amounts are Lipschitz continuous functions of the path,
+      so that evalPathDerivs() can be used for pathwise Greeks
+  */
+  virtual bool hasPathDerivs() const;
+
+  /** Evaluates the product given the passed-in path, and the derivatives of
+      sum_k weights[k] * payAmounts()[k] with respect to each pricePath(i, j) into pathDerivs.
+      With the discount factors as weights, these are the derivatives of the path PV.
+      Only available if hasPathDerivs() returns true.
+  */
+  virtual void evalPathDerivs(MatrixView const& pricePath, Vector const& weights, Matrix& pathDerivs);
+
+  /** Whether the product may be exercised early, at its fixing times;
+      then exerciseValue() can be used for Longstaff-Schwartz Monte Carlo pricing
+  */
+  virtual bool hasEarlyExercise() const;
+
+  /** The amount paid at payTimes()[idx] on exercise at fixing time index idx, given the price path
+      up to that fixing; zero if exercise is not possible then. At the last fixing, it is the payoff
+      if the product has not been exercised before.
+      Only available if hasEarlyExercise() returns true.
+  */
+  virtual double exerciseValue(MatrixView const& pricePath, size_t idx) const;
+
+  /** Whether the product evaluates a path incrementally, one fixing at a time, through begin(), onFixing()
+      and finish(), with state of size O(nAssets()); the Monte Carlo pricers can then stream the fixings
+      into it instead of storing the whole path, see McParams::streamFixings.
+  */
+  virtual bool isIncremental() const;
+
+  /** Starts the incremental evaluation of a path.
+      Unless the product is incremental, the default begin(), onFixing() and finish() store the path and call eval().
+  */
+  virtual void begin();
+
+  /** Fixes the spots of all assets at fixing time index idx, spots[j] for asset j.
+      It is called once for each fixing, in increasing order.
+  */
+  virtual void onFixing(size_t idx, double const* spots);
+
+  /** Ends the incremental evaluation of a path and sets the payment amounts, as eval() on the whole path */
+  virtual void finish();
+
+  /** Whether the product may be settled before its last fixing, e.g. on a knock-out or an early redemption,
+      so that isSettled() can be true during an incremental evaluation
+  */
+  virtual bool canSettle() const;
+
+  /** Whether the payment amounts of the path being evaluated incrementally are decided by the fixings so far.
+      The Monte Carlo pricers then stop simulating the path and call finish() right away.
+  */
+  virtual bool isSettled() const;
+
   /** Sets up the time steps, to be used in a numerical method.
   The timesteps are returned in the std::vector<double> timesteps,
   and for each timestep, the corresponding index in the fixingTimes() array
@@ -64,6 +124,7 @@ protected:
   Vector fixTimes_;       // the fixing (observation) times
   Vector payTimes_;       // the payment times
   Vector payAmounts_;     // the payment times
+  Matrix fixings_;        // the path stored by the default incremental evaluation
 };
 
 /** Smart pointer to Product */
@@ -95,6 +156,68 @@ Vector const& Product::payAmounts() const
   return payAmounts_;
 }
 
+inline
+bool Product::hasPathDerivs() const
+{
+  return false;
+}
+
+inline
+void Product::evalPathDerivs(MatrixView const& pricePath, Vector const& weights, Matrix& pathDerivs)
+{
+  QF_ASSERT(0, "pathwise derivatives are not available for this product!");
+}
+
+inline
+bool Product::hasEarlyExercise() const
+{
+  return false;
+}
+
+inline
+double Product::exerciseValue(MatrixView const& pricePath, size_t idx) const
+{
+  QF_ASSERT(0, "early exercise is not available for this product!");
+  return 0.0;
+}
+
+inline
+bool Product::isIncremental() const
+{
+  return false;
+}
+
+inline
+void Product::begin()
+{
+  fixings_.set_size(fixTimes_.size(), nAssets());
+}
+
+inline
+void Product::onFixing(size_t idx, double const* spots)
+{
+  for (size_t j = 0; j < fixings_.n_cols; ++j)
+    fixings_(idx, j) = spots[j];
+}
+
+inline
+void Product::finish()
+{
+  eval(fixings_);
+}
+
+inline
+bool Product::canSettle() const
+{
+  return false;
+}
+
+inline
+bool Product::isSettled() const
+{
+  return false;
+}
+
 inline
 void Product::timeSteps(size_t nsteps,
                         std::vector<double>& timesteps,